@@ -0,0 +1,110 @@
+/**
+ *
+ **/
+
+#include "PolylineSimplifier.h"
+#include <utility>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+namespace
+{
+/// squared distance of p from the segment a-b
+double
+distSq( const QPointF & p, const QPointF & a, const QPointF & b )
+{
+    QPointF ab = b - a;
+    QPointF ap = p - a;
+    double lenSq = QPointF::dotProduct( ab, ab );
+    if ( lenSq > 0 ) {
+        double t = QPointF::dotProduct( ap, ab ) / lenSq;
+        if ( t >= 1 ) {
+            ap = p - b;
+        }
+        else if ( t > 0 ) {
+            ap -= t * ab;
+        }
+    }
+    return QPointF::dotProduct( ap, ap );
+}
+}
+
+PolylineSimplifier::PolylineSimplifier( double tolerance )
+{
+    setTolerance( tolerance );
+}
+
+void
+PolylineSimplifier::setTolerance( double tolerance )
+{
+    m_tolerance = tolerance > 0 ? tolerance : 0.0;
+}
+
+double
+PolylineSimplifier::tolerance() const
+{
+    return m_tolerance;
+}
+
+QPolygonF
+PolylineSimplifier::simplify( const QPolygonF & poly ) const
+{
+    if ( poly.size() < 3 || m_tolerance == 0 ) {
+        return poly;
+    }
+
+    // split ranges at their furthest vertex until all the vertices in a range are
+    // within tolerance of its end points; an explicit stack instead of recursion,
+    // since contours can have hundreds of thousands of vertices
+    const double toleranceSq = m_tolerance * m_tolerance;
+    std::vector < char > keep( poly.size(), 0 );
+    keep.front() = 1;
+    keep.back() = 1;
+    std::vector < std::pair < int, int > > ranges { { 0, poly.size() - 1 } };
+    while ( ! ranges.empty() ) {
+        int first = ranges.back().first;
+        int last = ranges.back().second;
+        ranges.pop_back();
+
+        int furthest = - 1;
+        double furthestDistSq = toleranceSq;
+        for ( int i = first + 1 ; i < last ; ++i ) {
+            double d = distSq( poly[i], poly[first], poly[last] );
+            if ( d > furthestDistSq ) {
+                furthestDistSq = d;
+                furthest = i;
+            }
+        }
+        if ( furthest >= 0 ) {
+            keep[furthest] = 1;
+            ranges.emplace_back( first, furthest );
+            ranges.emplace_back( furthest, last );
+        }
+    }
+
+    QPolygonF result;
+    for ( int i = 0 ; i < poly.size() ; ++i ) {
+        if ( keep[i] ) {
+            result.append( poly[i] );
+        }
+    }
+    return result;
+} // simplify
+
+std::vector < QPolygonF >
+PolylineSimplifier::simplify( const std::vector < QPolygonF > & polys ) const
+{
+    std::vector < QPolygonF > result;
+    result.reserve( polys.size() );
+    for ( const QPolygonF & poly : polys ) {
+        result.push_back( simplify( poly ) );
+    }
+    return result;
+}
+}
+}
+}
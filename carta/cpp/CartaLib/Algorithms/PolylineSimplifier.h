@@ -0,0 +1,50 @@
+/**
+ * Reduce the number of vertices in polylines (Douglas-Peucker), e.g. to draw
+ * contours or grid lines with only as much detail as the screen can show.
+ *
+ * see https://en.wikipedia.org/wiki/Ramer%E2%80%93Douglas%E2%80%93Peucker_algorithm
+ *
+ **/
+
+#pragma once
+
+#include <QPolygonF>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+class PolylineSimplifier
+{
+public:
+
+    /// \param tolerance how far the simplified polyline may deviate from the original
+    /// one, in the units of the vertices; 0 disables simplification
+    explicit
+    PolylineSimplifier( double tolerance = 0.0 );
+
+    void
+    setTolerance( double tolerance );
+
+    double
+    tolerance() const;
+
+    /// simplify a polyline, the first and last vertices are always kept so closed
+    /// polylines stay closed
+    QPolygonF
+    simplify( const QPolygonF & poly ) const;
+
+    /// simplify a list of polylines
+    std::vector < QPolygonF >
+    simplify( const std::vector < QPolygonF > & polys ) const;
+
+private:
+
+    double m_tolerance = 0.0;
+};
+}
+}
+}
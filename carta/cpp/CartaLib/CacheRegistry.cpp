@@ -0,0 +1,101 @@
+#include "CacheRegistry.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace Carta
+{
+namespace Lib
+{
+CacheRegistry &
+CacheRegistry::instance()
+{
+    static CacheRegistry registry;
+    return registry;
+}
+
+void
+CacheRegistry::setBudget( int64_t bytes )
+{
+    {
+        QMutexLocker locker( & m_mutex );
+        m_budget = bytes;
+    }
+    enforceBudget();
+}
+
+int64_t
+CacheRegistry::budget() const
+{
+    QMutexLocker locker( & m_mutex );
+    return m_budget;
+}
+
+void
+CacheRegistry::registerCache( CacheRegistry::ICache * cache )
+{
+    QMutexLocker locker( & m_mutex );
+    m_caches.push_back( cache );
+}
+
+void
+CacheRegistry::unregisterCache( CacheRegistry::ICache * cache )
+{
+    QMutexLocker locker( & m_mutex );
+    m_caches.erase( std::remove( m_caches.begin(), m_caches.end(), cache ), m_caches.end() );
+}
+
+void
+CacheRegistry::enforceBudget()
+{
+    QMutexLocker locker( & m_mutex );
+
+    int64_t total = 0;
+    for ( ICache * cache : m_caches ) {
+        total += cache-> cacheBytes();
+    }
+
+    // evict the globally least recently used entry until we fit
+    while ( total > m_budget ) {
+        ICache * victim = nullptr;
+        int64_t victimUse = 0;
+        for ( ICache * cache : m_caches ) {
+            int64_t use = cache-> oldestUse();
+            if ( use >= 0 && ( ! victim || use < victimUse ) ) {
+                victim = cache;
+                victimUse = use;
+            }
+        }
+        if ( ! victim ) {
+            break;
+        }
+        total -= victim-> evictOldest();
+    }
+} // enforceBudget
+
+int64_t
+CacheRegistry::totalBytes() const
+{
+    QMutexLocker locker( & m_mutex );
+    int64_t total = 0;
+    for ( ICache * cache : m_caches ) {
+        total += cache-> cacheBytes();
+    }
+    return total;
+}
+
+std::vector < CacheRegistry::Usage >
+CacheRegistry::usage() const
+{
+    QMutexLocker locker( & m_mutex );
+    std::vector < Usage > result;
+    for ( ICache * cache : m_caches ) {
+        Usage u;
+        u.name = cache-> cacheName();
+        u.bytes = cache-> cacheBytes();
+        u.entries = cache-> cacheEntries();
+        result.push_back( u );
+    }
+    return result;
+}
+}
+}
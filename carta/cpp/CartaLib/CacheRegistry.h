@@ -0,0 +1,275 @@
+/// Process wide accounting of memory used by in-memory caches.
+///
+/// Every cache registers with the CacheRegistry and reports how many bytes it holds.
+/// The registry enforces a single byte budget (configured in the main config file)
+/// by evicting the least recently used entries across all caches, regardless of
+/// which cache they live in. This way e.g. nine image views don't each get their
+/// own budget.
+///
+/// LruCache is a ready to use cache that registers itself.
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <list>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+class CacheRegistry
+{
+    CLASS_BOILERPLATE( CacheRegistry );
+
+public:
+
+    /// interface a cache has to implement to participate in the budget
+    /// \note all methods can be called from any thread, and they must not call
+    /// back into the registry
+    class ICache
+    {
+public:
+
+        /// name shown in usage reports
+        virtual QString
+        cacheName() const = 0;
+
+        /// number of bytes currently used
+        virtual int64_t
+        cacheBytes() const = 0;
+
+        /// number of entries
+        virtual int64_t
+        cacheEntries() const = 0;
+
+        /// tick (see CacheRegistry::tick()) of the least recently used entry, or
+        /// a negative number if there is nothing to evict
+        virtual int64_t
+        oldestUse() const = 0;
+
+        /// evict the least recently used entry
+        /// \return number of bytes freed
+        virtual int64_t
+        evictOldest() = 0;
+
+        virtual
+        ~ICache() { }
+    };
+
+    /// usage of a single cache
+    struct Usage {
+        QString name;
+        int64_t bytes = 0;
+        int64_t entries = 0;
+    };
+
+    /// the registry
+    static CacheRegistry &
+    instance();
+
+    /// set the budget (in bytes) for all caches together, evicting entries if needed
+    void
+    setBudget( int64_t bytes );
+
+    /// the budget in bytes
+    int64_t
+    budget() const;
+
+    /// add a cache to the registry
+    void
+    registerCache( ICache * cache );
+
+    /// remove a cache from the registry (call this before destroying the cache)
+    void
+    unregisterCache( ICache * cache );
+
+    /// returns a monotonically increasing number, used to timestamp cache accesses
+    int64_t
+    tick() { return ++ m_tick; }
+
+    /// caches call this after they grew, the registry will evict entries from any
+    /// cache until all of them fit into the budget
+    void
+    enforceBudget();
+
+    /// total number of bytes used by all caches
+    int64_t
+    totalBytes() const;
+
+    /// usage per registered cache
+    std::vector < Usage >
+    usage() const;
+
+private:
+
+    CacheRegistry() { }
+
+    mutable QMutex m_mutex;
+    std::vector < ICache * > m_caches;
+    int64_t m_budget = 2LL * 1024 * 1024 * 1024;
+    std::atomic < int64_t > m_tick { 0 };
+};
+
+/// Least recently used cache with byte costs, registered with the CacheRegistry.
+///
+/// Lookups return copies, so Value should be cheap to copy (e.g. implicitly shared
+/// Qt types, or shared pointers). All methods are thread safe.
+template < typename Key, typename Value >
+class LruCache : public CacheRegistry::ICache
+{
+    CLASS_BOILERPLATE( LruCache );
+
+public:
+
+    /// \param name shown in usage reports
+    /// \param maxBytes optional limit for this cache alone, on top of the global budget
+    LruCache( const QString & name, int64_t maxBytes = - 1 )
+        : m_name( name )
+          , m_maxBytes( maxBytes )
+    {
+        CacheRegistry::instance().registerCache( this );
+    }
+
+    ~LruCache()
+    {
+        CacheRegistry::instance().unregisterCache( this );
+    }
+
+    /// find an entry, and mark it as recently used
+    /// \return false if not found
+    bool
+    find( const Key & key, Value & value )
+    {
+        QMutexLocker locker( & m_mutex );
+        auto it = m_index.find( key );
+        if ( it == m_index.end() ) {
+            return false;
+        }
+        auto entry = it.value();
+        entry-> lastUse = CacheRegistry::instance().tick();
+        m_entries.splice( m_entries.begin(), m_entries, entry );
+        value = entry-> value;
+        return true;
+    }
+
+    /// insert (or replace) an entry
+    /// \param cost number of bytes the entry uses
+    void
+    insert( const Key & key, const Value & value, int64_t cost )
+    {
+        {
+            QMutexLocker locker( & m_mutex );
+            p_remove( key );
+            m_entries.push_front( Entry { key, value, cost, CacheRegistry::instance().tick() } );
+            m_index.insert( key, m_entries.begin() );
+            m_bytes += cost;
+            while ( m_maxBytes >= 0 && m_bytes > m_maxBytes && ! m_entries.empty() ) {
+                p_evictOldest();
+            }
+        }
+        CacheRegistry::instance().enforceBudget();
+    }
+
+    /// remove an entry
+    bool
+    remove( const Key & key )
+    {
+        QMutexLocker locker( & m_mutex );
+        return p_remove( key );
+    }
+
+    /// remove all entries
+    void
+    clear()
+    {
+        QMutexLocker locker( & m_mutex );
+        m_entries.clear();
+        m_index.clear();
+        m_bytes = 0;
+    }
+
+    virtual QString
+    cacheName() const override
+    {
+        return m_name;
+    }
+
+    virtual int64_t
+    cacheBytes() const override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_bytes;
+    }
+
+    virtual int64_t
+    cacheEntries() const override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_entries.size();
+    }
+
+    virtual int64_t
+    oldestUse() const override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_entries.empty() ? - 1 : m_entries.back().lastUse;
+    }
+
+    virtual int64_t
+    evictOldest() override
+    {
+        QMutexLocker locker( & m_mutex );
+        return p_evictOldest();
+    }
+
+private:
+
+    struct Entry {
+        Key key;
+        Value value;
+        int64_t cost;
+        int64_t lastUse;
+    };
+
+    bool
+    p_remove( const Key & key )
+    {
+        auto it = m_index.find( key );
+        if ( it == m_index.end() ) {
+            return false;
+        }
+        m_bytes -= it.value()-> cost;
+        m_entries.erase( it.value() );
+        m_index.erase( it );
+        return true;
+    }
+
+    int64_t
+    p_evictOldest()
+    {
+        if ( m_entries.empty() ) {
+            return 0;
+        }
+        int64_t cost = m_entries.back().cost;
+        m_index.remove( m_entries.back().key );
+        m_entries.pop_back();
+        m_bytes -= cost;
+        return cost;
+    }
+
+    QString m_name;
+    int64_t m_maxBytes;
+    int64_t m_bytes = 0;
+
+    /// most recently used first
+    std::list < Entry > m_entries;
+    QHash < Key, typename std::list < Entry >::iterator > m_index;
+    mutable QMutex m_mutex;
+};
+}
+}
@@ -2,7 +2,7 @@
   error( "Could not find the common.pri file!" )
 }
 
-QT       += network xml
+QT       += network xml concurrent
 
 TARGET = CartaLib
 TEMPLATE = lib
@@ -26,11 +26,13 @@ SOURCES += \
     PixelPipeline/CustomizablePixelPipeline.cpp \
     PWLinear.cpp \
     VectorGraphics/VGList.cpp \
+    VectorGraphics/VGBuffer.cpp \
     VectorGraphics/BetterQPainter.cpp \
     Algorithms/ContourConrec.cpp \
     IWcsGridRenderService.cpp \
     ContourSet.cpp \
     Algorithms/LineCombiner.cpp \
+    Algorithms/PolylineSimplifier.cpp \
     IImageRenderService.cpp \
     IRemoteVGView.cpp \
     Hooks/GetProfileExtractor.cpp \
@@ -40,6 +42,14 @@ SOURCES += \
     Hooks/CoordSystemHook.cpp \
     Regions/CoordinateSystemFormatter.cpp \
     IPCache.cpp \
+    CacheRegistry.cpp \
+    FloatRawView.cpp \
+    PlaneCache.cpp \
+    ImageRegistry.cpp \
+    DerivedImage.cpp \
+    DisplacementGrid.cpp \
+    MemoryImage.cpp \
+    SpectralAxis.cpp \
     Hooks/GetPersistantCache.cpp
 
 HEADERS += \
@@ -65,6 +75,7 @@ HEADERS += \
     PixelPipeline/CustomizablePixelPipeline.h \
     PWLinear.h \
     VectorGraphics/VGList.h \
+    VectorGraphics/VGBuffer.h \
     Hooks/GetWcsGridRenderer.h \
     Hooks/LoadPlugin.h \
     VectorGraphics/BetterQPainter.h \
@@ -73,6 +84,7 @@ HEADERS += \
     IContourGeneratorService.h \
     ContourSet.h \
     Algorithms/LineCombiner.h \
+    Algorithms/PolylineSimplifier.h \
     Hooks/GetInitialFileList.h \
     Hooks/Initialize.h \
     IImageRenderService.h \
@@ -80,12 +92,24 @@ HEADERS += \
     IRemoteVGView.h \
     Hooks/GetProfileExtractor.h \
     Regions/IRegion.h \
+    Regions/RTree.h \
     InputEvents.h \
     Regions/ICoordSystem.h \
     Hooks/CoordSystemHook.h \
     Regions/CoordinateSystemFormatter.h \
     IPCache.h \
-    Hooks/GetPersistantCache.h
+    CacheRegistry.h \
+    FloatRawView.h \
+    PlaneCache.h \
+    ImageRegistry.h \
+    DerivedImage.h \
+    DisplacementGrid.h \
+    MemoryImage.h \
+    SpectralAxis.h \
+    IMomentGeneratorService.h \
+    Hooks/GetMomentGeneratorService.h \
+    Hooks/GetPersistantCache.h \
+    Hooks/RawViewFunction.h
 
 unix {
     target.path = /usr/lib
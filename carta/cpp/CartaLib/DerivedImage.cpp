@@ -0,0 +1,665 @@
+#include "DerivedImage.h"
+#include "CartaLib/CacheRegistry.h"
+#include "CartaLib/PlaneCache.h"
+#include <QtConcurrent/QtConcurrentMap>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Image
+{
+namespace
+{
+typedef DerivedImage::Node Node;
+typedef Node::VI VI;
+
+/// size of the chunks along the first two axes
+static const int CHUNK_SIZE = 256;
+
+static const float NaN = std::numeric_limits < float >::quiet_NaN();
+
+/// the chunks of all derived images
+LruCache < QString, NdArray::FloatRawView::DataPtr > &
+chunkCache()
+{
+    static LruCache < QString, NdArray::FloatRawView::DataPtr > cache( "derived image chunks" );
+    return cache;
+}
+
+int64_t
+boxSize( const VI & lo, const VI & hi )
+{
+    int64_t size = 1;
+    for ( size_t i = 0 ; i < lo.size() ; i++ ) {
+        size *= std::max( hi[i] - lo[i], 0 );
+    }
+    return size;
+}
+
+/// index of pos in the values of a box
+int64_t
+boxOffset( const VI & pos, const VI & lo, const VI & hi )
+{
+    int64_t offset = 0;
+    int64_t stride = 1;
+    for ( size_t i = 0 ; i < pos.size() ; i++ ) {
+        offset += ( pos[i] - lo[i] ) * stride;
+        stride *= hi[i] - lo[i];
+    }
+    return offset;
+}
+
+/// calls f with the position of the first value of every row (along the first axis)
+/// of the box
+void
+forEachRow( const VI & lo, const VI & hi, const std::function < void (const VI &) > & f )
+{
+    if ( boxSize( lo, hi ) == 0 ) {
+        return;
+    }
+    VI pos = lo;
+    while ( true ) {
+        f( pos );
+        size_t i = 1;
+        for ( ; i < pos.size() ; i++ ) {
+            if ( ++pos[i] < hi[i] ) {
+                break;
+            }
+            pos[i] = lo[i];
+        }
+        if ( i >= pos.size() ) {
+            return;
+        }
+    }
+}
+
+class SourceNode : public Node
+{
+public:
+
+    SourceNode( ImageInterface::SharedPtr image )
+        : m_image( image )
+          , m_dims( image-> dims() )
+    { }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_dims;
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        SliceND slice;
+        for ( size_t i = 0 ; i < lo.size() ; i++ ) {
+            slice.slice( i ).start( lo[i] ).end( hi[i] );
+        }
+        return PlaneCache::instance().readSlice( * m_image, slice, out ) &&
+               int64_t( out.size() ) == boxSize( lo, hi );
+    }
+
+private:
+
+    ImageInterface::SharedPtr m_image;
+    VI m_dims;
+};
+
+class MapNode : public Node
+{
+public:
+
+    MapNode( Node::SharedPtr input, const std::function < float (float) > & f )
+        : m_input( input )
+          , m_f( f )
+    { }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_input-> dims();
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        if ( ! m_input-> evaluate( lo, hi, out ) ) {
+            return false;
+        }
+        for ( float & val : out ) {
+            val = m_f( val );
+        }
+        return true;
+    }
+
+private:
+
+    Node::SharedPtr m_input;
+    std::function < float (float) > m_f;
+};
+
+class CombineNode : public Node
+{
+public:
+
+    CombineNode( Node::SharedPtr a, Node::SharedPtr b, const std::function < float (float, float) > & f )
+        : m_a( a )
+          , m_b( b )
+          , m_f( f )
+    { }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_a-> dims();
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        std::vector < float > other;
+        if ( ! m_a-> evaluate( lo, hi, out ) || ! m_b-> evaluate( lo, hi, other ) ) {
+            return false;
+        }
+        for ( size_t i = 0 ; i < out.size() ; i++ ) {
+            out[i] = m_f( out[i], other[i] );
+        }
+        return true;
+    }
+
+private:
+
+    Node::SharedPtr m_a, m_b;
+    std::function < float (float, float) > m_f;
+};
+
+class SelectNode : public Node
+{
+public:
+
+    SelectNode( Node::SharedPtr input, int axis, int index )
+        : m_input( input )
+          , m_dims( input-> dims() )
+          , m_axis( axis )
+          , m_index( index )
+    {
+        m_dims[axis] = 1;
+    }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_dims;
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        VI inputLo = lo;
+        VI inputHi = hi;
+        inputLo[m_axis] = m_index;
+        inputHi[m_axis] = m_index + 1;
+        return m_input-> evaluate( inputLo, inputHi, out );
+    }
+
+private:
+
+    Node::SharedPtr m_input;
+    VI m_dims;
+    int m_axis, m_index;
+};
+
+/// normalized convolution with a separable gaussian, so that blanks and the edges of
+/// the image don't darken their surroundings
+class SmoothNode : public Node
+{
+public:
+
+    SmoothNode( Node::SharedPtr input, double sigma )
+        : m_input( input )
+    {
+        m_radius = std::max( 1, int ( std::ceil( 3 * sigma ) ) );
+        for ( int k = - m_radius ; k <= m_radius ; k++ ) {
+            m_weights.push_back( std::exp( - k * k / ( 2 * sigma * sigma ) ) );
+        }
+    }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_input-> dims();
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        const VI & dims = m_input-> dims();
+        if ( dims.size() < 2 ) {
+            return m_input-> evaluate( lo, hi, out );
+        }
+
+        // the input needs a margin around the box
+        VI inputLo = lo;
+        VI inputHi = hi;
+        for ( int i = 0 ; i < 2 ; i++ ) {
+            inputLo[i] = std::max( 0, lo[i] - m_radius );
+            inputHi[i] = std::min( dims[i], hi[i] + m_radius );
+        }
+        std::vector < float > in;
+        if ( ! m_input-> evaluate( inputLo, inputHi, in ) ) {
+            return false;
+        }
+
+        const int ex = inputHi[0] - inputLo[0];
+        const int ey = inputHi[1] - inputLo[1];
+        const int ox = hi[0] - lo[0];
+        const int oy = hi[1] - lo[1];
+        const int dx = lo[0] - inputLo[0];
+        const int dy = lo[1] - inputLo[1];
+        out.resize( boxSize( lo, hi ) );
+        if ( out.empty() ) {
+            return true;
+        }
+        const int64_t planes = out.size() / ( int64_t( ox ) * oy );
+
+        // sums of weighted values and of weights, after smoothing the rows
+        std::vector < double > rowValues( int64_t( ex ) * ey );
+        std::vector < double > rowWeights( rowValues.size() );
+        for ( int64_t p = 0 ; p < planes ; p++ ) {
+            const float * plane = & in[p * ex * ey];
+            for ( int y = 0 ; y < ey ; y++ ) {
+                for ( int x = 0 ; x < ox ; x++ ) {
+                    double sv = 0, sw = 0;
+                    for ( int k = - m_radius ; k <= m_radius ; k++ ) {
+                        int xx = x + dx + k;
+                        if ( xx < 0 || xx >= ex || std::isnan( plane[y * ex + xx] ) ) {
+                            continue;
+                        }
+                        double w = m_weights[k + m_radius];
+                        sv += w * plane[y * ex + xx];
+                        sw += w;
+                    }
+                    rowValues[y * ex + x] = sv;
+                    rowWeights[y * ex + x] = sw;
+                }
+            }
+            float * result = & out[p * ox * oy];
+            for ( int y = 0 ; y < oy ; y++ ) {
+                for ( int x = 0 ; x < ox ; x++ ) {
+                    if ( std::isnan( plane[( y + dy ) * ex + x + dx] ) ) {
+                        result[y * ox + x] = NaN;
+                        continue;
+                    }
+                    double sv = 0, sw = 0;
+                    for ( int k = - m_radius ; k <= m_radius ; k++ ) {
+                        int yy = y + dy + k;
+                        if ( yy < 0 || yy >= ey ) {
+                            continue;
+                        }
+                        double w = m_weights[k + m_radius];
+                        sv += w * rowValues[yy * ex + x];
+                        sw += w * rowWeights[yy * ex + x];
+                    }
+                    result[y * ox + x] = sw > 0 ? sv / sw : NaN;
+                }
+            }
+        }
+        return true;
+    } // evaluate
+
+private:
+
+    Node::SharedPtr m_input;
+    int m_radius;
+    std::vector < double > m_weights;
+};
+
+class RebinNode : public Node
+{
+public:
+
+    RebinNode( Node::SharedPtr input, int axis, int factor )
+        : m_input( input )
+          , m_dims( input-> dims() )
+          , m_axis( axis )
+          , m_factor( factor )
+    {
+        m_dims[axis] = ( m_dims[axis] + factor - 1 ) / factor;
+    }
+
+    virtual const VI &
+    dims() const override
+    {
+        return m_dims;
+    }
+
+    virtual bool
+    evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) override
+    {
+        VI inputLo = lo;
+        VI inputHi = hi;
+        inputLo[m_axis] = lo[m_axis] * m_factor;
+        inputHi[m_axis] = std::min( m_input-> dims()[m_axis], hi[m_axis] * m_factor );
+        std::vector < float > in;
+        if ( ! m_input-> evaluate( inputLo, inputHi, in ) ) {
+            return false;
+        }
+
+        // values are laid out as [outer][axis][inner]
+        int64_t inner = 1, outer = 1;
+        for ( int i = 0 ; i < m_axis ; i++ ) {
+            inner *= hi[i] - lo[i];
+        }
+        for ( size_t i = m_axis + 1 ; i < lo.size() ; i++ ) {
+            outer *= hi[i] - lo[i];
+        }
+        const int nOut = hi[m_axis] - lo[m_axis];
+        const int nIn = inputHi[m_axis] - inputLo[m_axis];
+        out.resize( outer * nOut * inner );
+        for ( int64_t o = 0 ; o < outer ; o++ ) {
+            for ( int c = 0 ; c < nOut ; c++ ) {
+                for ( int64_t j = 0 ; j < inner ; j++ ) {
+                    double sum = 0;
+                    int count = 0;
+                    for ( int k = c * m_factor ; k < std::min( ( c + 1 ) * m_factor, nIn ) ; k++ ) {
+                        float val = in[( o * nIn + k ) * inner + j];
+                        if ( ! std::isnan( val ) ) {
+                            sum += val;
+                            count++;
+                        }
+                    }
+                    out[( o * nOut + c ) * inner + j] = count > 0 ? sum / count : NaN;
+                }
+            }
+        }
+        return true;
+    } // evaluate
+
+private:
+
+    Node::SharedPtr m_input;
+    VI m_dims;
+    int m_axis, m_factor;
+};
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::source( ImageInterface::SharedPtr image )
+{
+    CARTA_ASSERT( image );
+    return std::make_shared < SourceNode > ( image );
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::map( Node::SharedPtr input, const std::function < float (float) > & f )
+{
+    CARTA_ASSERT( input );
+    return std::make_shared < MapNode > ( input, f );
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::combine( Node::SharedPtr a, Node::SharedPtr b, const std::function < float (float, float) > & f )
+{
+    CARTA_ASSERT( a && b );
+    if ( a-> dims() != b-> dims() ) {
+        return nullptr;
+    }
+    return std::make_shared < CombineNode > ( a, b, f );
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::select( Node::SharedPtr input, int axis, int index )
+{
+    CARTA_ASSERT( input );
+    if ( axis < 0 || axis >= int ( input-> dims().size() ) ||
+         index < 0 || index >= input-> dims()[axis] ) {
+        return nullptr;
+    }
+    return std::make_shared < SelectNode > ( input, axis, index );
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::smooth( Node::SharedPtr input, double sigma )
+{
+    CARTA_ASSERT( input && sigma > 0 );
+    return std::make_shared < SmoothNode > ( input, sigma );
+}
+
+DerivedImage::Node::SharedPtr
+DerivedImage::rebin( Node::SharedPtr input, int axis, int factor )
+{
+    CARTA_ASSERT( input && factor > 0 );
+    if ( axis < 0 || axis >= int ( input-> dims().size() ) ) {
+        return nullptr;
+    }
+    return std::make_shared < RebinNode > ( input, axis, factor );
+}
+
+DerivedImage::DerivedImage( Node::SharedPtr root,
+                            const Unit & unit,
+                            MetaDataInterface::SharedPtr metaData )
+    : m_root( root )
+      , m_unit( unit )
+      , m_metaData( metaData )
+{
+    CARTA_ASSERT( m_root );
+    m_dims = m_root-> dims();
+    m_chunkDims = VI( m_dims.size(), 1 );
+    for ( size_t i = 0 ; i < m_dims.size() && i < 2 ; i++ ) {
+        m_chunkDims[i] = std::min( m_dims[i], CHUNK_SIZE );
+    }
+
+    static std::atomic < int > count( 0 );
+    m_cacheId = QString( "derived%1" ).arg( ++ count );
+}
+
+DerivedImage::~DerivedImage()
+{
+    for ( const QString & key : m_cacheKeys ) {
+        chunkCache().remove( key );
+    }
+}
+
+const Unit &
+DerivedImage::getPixelUnit() const
+{
+    return m_unit;
+}
+
+const DerivedImage::VI &
+DerivedImage::dims() const
+{
+    return m_dims;
+}
+
+bool
+DerivedImage::hasMask() const
+{
+    return false;
+}
+
+bool
+DerivedImage::hasErrorsInfo() const
+{
+    return false;
+}
+
+DerivedImage::PixelType
+DerivedImage::pixelType() const
+{
+    return PixelType::Real32;
+}
+
+DerivedImage::PixelType
+DerivedImage::errorType() const
+{
+    return PixelType::Real32;
+}
+
+NdArray::RawViewInterface *
+DerivedImage::getDataSlice( const SliceND & sliceInfo )
+{
+    SliceND::ApplyResult ar = sliceInfo.apply( m_dims );
+    if ( ar.isError() ) {
+        return nullptr;
+    }
+
+    // the box containing the slice, and the slice relative to the box
+    const size_t nAxes = m_dims.size();
+    VI lo( nAxes, 0 ), hi( nAxes, 0 );
+    SliceND boxSlice;
+    for ( size_t i = 0 ; i < nAxes ; i++ ) {
+        const Slice1D::ApplyResult & d = ar.dims()[i];
+        if ( d.isSingle() ) {
+            lo[i] = d.start;
+            hi[i] = d.start + 1;
+            boxSlice.slice( i ).index( 0 );
+        }
+        else if ( d.count <= 0 ) {
+            boxSlice.slice( i ).start( 0 ).end( 0 );
+        }
+        else {
+            lo[i] = std::min( d.start, d.end() );
+            hi[i] = std::max( d.start, d.end() ) + 1;
+            boxSlice.slice( i ).start( d.step > 0 ? 0 : hi[i] - lo[i] - 1 ).step( d.step );
+        }
+    }
+    VI boxDims( nAxes );
+    for ( size_t i = 0 ; i < nAxes ; i++ ) {
+        boxDims[i] = hi[i] - lo[i];
+    }
+    auto data = std::make_shared < std::vector < float > > ( boxSize( lo, hi ), NaN );
+
+    // chunks overlapping the box, computed in parallel
+    std::vector < VI > chunks;
+    if ( ! data-> empty() ) {
+        VI first( nAxes ), last( nAxes );
+        for ( size_t i = 0 ; i < nAxes ; i++ ) {
+            first[i] = lo[i] / m_chunkDims[i];
+            last[i] = ( hi[i] - 1 ) / m_chunkDims[i] + 1;
+        }
+        VI pos = first;
+        while ( true ) {
+            chunks.push_back( pos );
+            size_t i = 0;
+            for ( ; i < nAxes ; i++ ) {
+                if ( ++pos[i] < last[i] ) {
+                    break;
+                }
+                pos[i] = first[i];
+            }
+            if ( i >= nAxes ) {
+                break;
+            }
+        }
+    }
+    std::vector < NdArray::FloatRawView::DataPtr > values( chunks.size() );
+    std::vector < int > indices( chunks.size() );
+    for ( size_t i = 0 ; i < indices.size() ; i++ ) {
+        indices[i] = i;
+    }
+    QtConcurrent::blockingMap( indices, [this, & chunks, & values] ( const int & i ) {
+                                   values[i] = chunk( chunks[i] );
+                               }
+                               );
+
+    // copy the parts of the chunks inside the box
+    for ( size_t c = 0 ; c < chunks.size() ; c++ ) {
+        if ( ! values[c] ) {
+            return nullptr;
+        }
+        VI chunkLo, chunkHi;
+        chunkBox( chunks[c], chunkLo, chunkHi );
+        VI partLo( nAxes ), partHi( nAxes );
+        for ( size_t i = 0 ; i < nAxes ; i++ ) {
+            partLo[i] = std::max( lo[i], chunkLo[i] );
+            partHi[i] = std::min( hi[i], chunkHi[i] );
+        }
+        const float * src = values[c]-> data();
+        float * dst = data-> data();
+        const size_t rowBytes = ( partHi[0] - partLo[0] ) * sizeof( float );
+        forEachRow( partLo, partHi, [&] ( const VI & pos ) {
+                        std::memcpy( dst + boxOffset( pos, lo, hi ),
+                                     src + boxOffset( pos, chunkLo, chunkHi ),
+                                     rowBytes );
+                    }
+                    );
+    }
+
+    return new NdArray::FloatRawView( data, boxDims, boxSlice );
+} // getDataSlice
+
+NdArray::Byte *
+DerivedImage::getMaskSlice( const SliceND & sliceInfo )
+{
+    Q_UNUSED( sliceInfo );
+    return nullptr;
+}
+
+NdArray::RawViewInterface *
+DerivedImage::getErrorSlice( const SliceND & sliceInfo )
+{
+    Q_UNUSED( sliceInfo );
+    return nullptr;
+}
+
+MetaDataInterface::SharedPtr
+DerivedImage::metaData()
+{
+    return m_metaData;
+}
+
+bool
+DerivedImage::cachesPixels() const
+{
+    // evaluated chunks are kept in our own cache
+    return true;
+}
+
+NdArray::FloatRawView::DataPtr
+DerivedImage::chunk( const VI & index )
+{
+    QString key = m_cacheId;
+    for ( int c : index ) {
+        key += QString( "|%1" ).arg( c );
+    }
+    NdArray::FloatRawView::DataPtr data;
+    if ( chunkCache().find( key, data ) ) {
+        return data;
+    }
+
+    VI lo, hi;
+    chunkBox( index, lo, hi );
+    auto values = std::make_shared < std::vector < float > > ();
+    if ( ! m_root-> evaluate( lo, hi, * values ) || int64_t( values-> size() ) != boxSize( lo, hi ) ) {
+        qWarning() << "Could not compute chunk" << key;
+        return nullptr;
+    }
+    {
+        QMutexLocker locker( & m_cacheKeysMutex );
+        m_cacheKeys.insert( key );
+    }
+    chunkCache().insert( key, values, values-> size() * sizeof( float ) );
+    return values;
+}
+
+void
+DerivedImage::chunkBox( const VI & index, VI & lo, VI & hi ) const
+{
+    lo.resize( index.size() );
+    hi.resize( index.size() );
+    for ( size_t i = 0 ; i < index.size() ; i++ ) {
+        lo[i] = index[i] * m_chunkDims[i];
+        hi[i] = std::min( lo[i] + m_chunkDims[i], m_dims[i] );
+    }
+}
+}
+}
+}
@@ -0,0 +1,153 @@
+/// Image computed on demand from other images.
+///
+/// A derived image is described by an expression graph, e.g. the ratio of two images, a
+/// smoothed cube, a spectrally rebinned cube or a combination of stokes planes. Nothing is
+/// computed up front. The image is split into chunks (tiles of a single plane), and
+/// getDataSlice() evaluates only the chunks the requested slice touches, in parallel,
+/// keeping them in a cache registered with the CacheRegistry. Since it is an
+/// ImageInterface like any other, everything that views images (rendering, histograms,
+/// profiles, contours, ...) works with derived images and only ever computes the parts
+/// the user looks at.
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include "CartaLib/FloatRawView.h"
+#include <QSet>
+#include <QMutex>
+#include <functional>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Image
+{
+class DerivedImage : public ImageInterface
+{
+    CLASS_BOILERPLATE( DerivedImage );
+
+public:
+
+    /// node of the expression graph
+    /// \note nodes are evaluated from several threads at once
+    class Node
+    {
+        CLASS_BOILERPLATE( Node );
+
+public:
+
+        typedef std::vector < int > VI;
+
+        /// dimensions of the values this node produces
+        virtual const VI &
+        dims() const = 0;
+
+        /// compute the values in the box lo <= pos < hi
+        /// \param out the values, first axis varies fastest
+        /// \return false if the values could not be computed
+        virtual bool
+        evaluate( const VI & lo, const VI & hi, std::vector < float > & out ) = 0;
+
+        virtual
+        ~Node() { }
+    };
+
+    /// the pixels of an image
+    static Node::SharedPtr
+    source( ImageInterface::SharedPtr image );
+
+    /// f applied to every value
+    static Node::SharedPtr
+    map( Node::SharedPtr input, const std::function < float (float) > & f );
+
+    /// f applied to pairs of values at the same position, e.g. for the ratio of two images
+    /// \return nullptr if the inputs have different dimensions
+    static Node::SharedPtr
+    combine( Node::SharedPtr a, Node::SharedPtr b, const std::function < float (float, float) > & f );
+
+    /// a single plane along an axis, e.g. one stokes parameter; the axis keeps size 1
+    /// \return nullptr if there is no such plane
+    static Node::SharedPtr
+    select( Node::SharedPtr input, int axis, int index );
+
+    /// gaussian smoothing of each plane (first two axes), blanks are ignored
+    static Node::SharedPtr
+    smooth( Node::SharedPtr input, double sigma );
+
+    /// average of groups of factor consecutive values along an axis, e.g. spectral rebinning
+    /// \return nullptr if there is no such axis
+    static Node::SharedPtr
+    rebin( Node::SharedPtr input, int axis, int factor );
+
+    /// \param root the expression computing the pixels
+    /// \param unit unit of the pixels
+    /// \param metaData coordinates etc., typically those of the image the expression is based on
+    DerivedImage( Node::SharedPtr root,
+                  const Unit & unit,
+                  MetaDataInterface::SharedPtr metaData );
+
+    virtual
+    ~DerivedImage();
+
+    virtual const Unit &
+    getPixelUnit() const override;
+
+    virtual const VI &
+    dims() const override;
+
+    virtual bool
+    hasMask() const override;
+
+    virtual bool
+    hasErrorsInfo() const override;
+
+    virtual PixelType
+    pixelType() const override;
+
+    virtual PixelType
+    errorType() const override;
+
+    virtual NdArray::RawViewInterface *
+    getDataSlice( const SliceND & sliceInfo ) override;
+
+    virtual NdArray::Byte *
+    getMaskSlice( const SliceND & sliceInfo ) override;
+
+    virtual NdArray::RawViewInterface *
+    getErrorSlice( const SliceND & sliceInfo ) override;
+
+    virtual MetaDataInterface::SharedPtr
+    metaData() override;
+
+    virtual bool
+    cachesPixels() const override;
+
+private:
+
+    /// the values of one chunk, computing it if it's not cached
+    /// \param index position of the chunk in the grid of chunks
+    NdArray::FloatRawView::DataPtr
+    chunk( const VI & index );
+
+    /// box covered by a chunk
+    void
+    chunkBox( const VI & index, VI & lo, VI & hi ) const;
+
+    Node::SharedPtr m_root;
+    VI m_dims;
+    Unit m_unit;
+    MetaDataInterface::SharedPtr m_metaData;
+
+    /// size of the chunks along each axis
+    VI m_chunkDims;
+
+    /// prefix of our keys in the chunk cache, and the keys we inserted
+    QString m_cacheId;
+    QSet < QString > m_cacheKeys;
+    QMutex m_cacheKeysMutex;
+};
+}
+}
+}
@@ -0,0 +1,40 @@
+#include "DisplacementGrid.h"
+#include <limits>
+
+namespace Carta
+{
+namespace Lib
+{
+DisplacementGrid::DisplacementGrid( const QRectF & area, double step, const BatchMap & map )
+    : m_area( area )
+      , m_step( step )
+      , m_invStep( 1.0 / step )
+      , m_x0( area.left() )
+      , m_y0( area.top() )
+{
+    CARTA_ASSERT( step > 0 );
+
+    // at least two nodes in each direction, so that map() always has a cell
+    m_nx = std::max( int ( std::ceil( area.width() / step ) ) + 1, 2 );
+    m_ny = std::max( int ( std::ceil( area.height() / step ) ) + 1, 2 );
+    int64_t count = int64_t( m_nx ) * m_ny;
+
+    std::vector < double > dst( count * 2 ), src( count * 2 );
+    for ( int iy = 0 ; iy < m_ny ; iy++ ) {
+        for ( int ix = 0 ; ix < m_nx ; ix++ ) {
+            int64_t ind = 2 * ( int64_t( iy ) * m_nx + ix );
+            dst[ind] = m_x0 + ix * step;
+            dst[ind + 1] = m_y0 + iy * step;
+        }
+    }
+    map( dst.data(), src.data(), count );
+
+    // store displacements, they need much less precision than the coordinates themselves
+    m_nodes.resize( count * 2 );
+    for ( int64_t i = 0 ; i < count * 2 ; i++ ) {
+        double d = src[i] - dst[i];
+        m_nodes[i] = std::isfinite( d ) ? d : std::numeric_limits < float >::quiet_NaN();
+    }
+}
+}
+}
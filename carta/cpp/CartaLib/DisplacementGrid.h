@@ -0,0 +1,94 @@
+/// Compact, interpolated version of a 2D coordinate mapping.
+///
+/// Mapping pixels of one image onto the pixels of another one (e.g. to overlay images
+/// with different world coordinate systems) needs a world coordinate evaluation per pixel,
+/// which is far too slow to do for every pixel of every rendered frame. The mapping is
+/// smooth however, so we evaluate it only on the nodes of a regular grid, remember how far
+/// each node moved (as floats), and bilinearly interpolate the displacement for the
+/// pixels in between.
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include <QRectF>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+class DisplacementGrid
+{
+    CLASS_BOILERPLATE( DisplacementGrid );
+
+public:
+
+    /// the mapping to approximate: converts n points from destination to source
+    /// coordinates, points are stored as x,y pairs one after another
+    /// \return false if some points could not be converted, those should be set to NaN
+    typedef std::function < bool (const double * dst, double * src, int64_t n) > BatchMap;
+
+    /// evaluates the map on a grid covering the area (in destination coordinates)
+    /// \param area where the grid will be used
+    /// \param step distance between the grid nodes
+    /// \param map the mapping, it is called once, with all the nodes
+    DisplacementGrid( const QRectF & area, double step, const BatchMap & map );
+
+    /// approximate the mapping of the destination point x,y
+    /// \return false if the point is outside of the grid, or too close to a node
+    /// that could not be mapped
+    bool
+    map( double x, double y, double & sx, double & sy ) const
+    {
+        double fx = ( x - m_x0 ) * m_invStep;
+        double fy = ( y - m_y0 ) * m_invStep;
+        if ( ! ( fx >= 0 && fy >= 0 && fx <= m_nx - 1 && fy <= m_ny - 1 ) ) {
+            return false;
+        }
+        int ix = std::min( int ( fx ), m_nx - 2 );
+        int iy = std::min( int ( fy ), m_ny - 2 );
+        float tx = fx - ix;
+        float ty = fy - iy;
+        const float * n0 = & m_nodes[2 * ( int64_t( iy ) * m_nx + ix )];
+        const float * n1 = n0 + 2 * m_nx;
+        float dx = ( 1 - ty ) * ( n0[0] + ( n0[2] - n0[0] ) * tx ) +
+                   ty * ( n1[0] + ( n1[2] - n1[0] ) * tx );
+        float dy = ( 1 - ty ) * ( n0[1] + ( n0[3] - n0[1] ) * tx ) +
+                   ty * ( n1[1] + ( n1[3] - n1[1] ) * tx );
+        if ( std::isnan( dx ) || std::isnan( dy ) ) {
+            return false;
+        }
+        sx = x + dx;
+        sy = y + dy;
+        return true;
+    }
+
+    /// area covered by the grid
+    const QRectF &
+    area() const { return m_area; }
+
+    /// distance between the nodes
+    double
+    step() const { return m_step; }
+
+    /// memory used by the grid, for the caches
+    int64_t
+    byteCount() const
+    {
+        return sizeof( * this ) + m_nodes.size() * sizeof( float );
+    }
+
+private:
+
+    QRectF m_area;
+    double m_step, m_invStep, m_x0, m_y0;
+    int m_nx, m_ny;
+
+    /// displacements (dx,dy) of the nodes, row by row
+    std::vector < float > m_nodes;
+};
+}
+}
@@ -0,0 +1,269 @@
+#include "FloatRawView.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace NdArray
+{
+namespace
+{
+/// number of elements along an axis of an applied slice (single index counts as 1)
+inline int64_t
+axisCount( const Slice1D::ApplyResult & ar )
+{
+    return ar.isSingle() ? 1 : ar.count;
+}
+
+/// dimensions with the single index axes replaced by 1
+RawViewInterface::VI
+positiveDims( const RawViewInterface::VI & dims )
+{
+    RawViewInterface::VI res = dims;
+    for ( auto & d : res ) {
+        d = std::max( d, 1 );
+    }
+    return res;
+}
+
+/// slice that keeps the single index axes single
+SliceND
+sliceForDims( const RawViewInterface::VI & dims )
+{
+    SliceND res;
+    for ( size_t i = 0 ; i < dims.size() ; i++ ) {
+        res.slice( i ) = dims[i] < 0 ? Slice1D( 0 ) : Slice1D();
+    }
+    return res;
+}
+}
+
+FloatRawView::FloatRawView( DataPtr data, const VI & dims )
+    : m_data( data )
+      , m_origDims( positiveDims( dims ) )
+{
+    init( sliceForDims( dims ).apply( m_origDims ) );
+}
+
+FloatRawView::FloatRawView( DataPtr data, const VI & dims, const SliceND & sliceInfo )
+    : m_data( data )
+      , m_origDims( positiveDims( dims ) )
+{
+    init( sliceInfo.apply( m_origDims ) );
+}
+
+FloatRawView::FloatRawView( DataPtr data, const VI & origDims,
+                            const SliceND::ApplyResult & applyResult )
+    : m_data( data )
+      , m_origDims( origDims )
+{
+    init( applyResult );
+}
+
+void
+FloatRawView::init( const SliceND::ApplyResult & applyResult )
+{
+    m_appliedSlice = applyResult;
+    m_strides.resize( m_origDims.size() );
+    int64_t stride = 1;
+    for ( size_t i = 0 ; i < m_origDims.size() ; i++ ) {
+        m_strides[i] = stride;
+        stride *= m_origDims[i];
+    }
+    CARTA_ASSERT( ! m_data || int64_t( m_data-> size() ) >= stride );
+
+    for ( auto & x : m_appliedSlice.dims() ) {
+        m_viewDims.push_back( x.count );
+    }
+    m_currPos.resize( m_viewDims.size(), 0 );
+}
+
+FloatRawView::PixelType
+FloatRawView::pixelType()
+{
+    return PixelType::Real32;
+}
+
+const FloatRawView::VI &
+FloatRawView::dims()
+{
+    return m_viewDims;
+}
+
+bool
+FloatRawView::isContiguous() const
+{
+    const auto & ard = m_appliedSlice.dims();
+    if ( m_appliedSlice.isError() || ard.size() != m_origDims.size() ) {
+        return false;
+    }
+    for ( size_t i = 0 ; i < ard.size() ; i++ ) {
+        if ( ard[i].start != 0 || axisCount( ard[i] ) != m_origDims[i] ) {
+            return false;
+        }
+        if ( ! ard[i].isSingle() && ard[i].step != 1 ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *
+FloatRawView::get( const VI & pos )
+{
+    const auto & ard = m_appliedSlice.dims();
+    int64_t offset = 0;
+    for ( size_t i = 0 ; i < ard.size() ; i++ ) {
+        int p = i < pos.size() ? pos[i] : 0;
+        int64_t ind = ard[i].isSingle() ? ard[i].start : ard[i].start + int64_t( ard[i].step ) * p;
+        offset += ind * m_strides[i];
+    }
+    m_buff = ( * m_data )[offset];
+    return reinterpret_cast < const char * > ( & m_buff );
+}
+
+void
+FloatRawView::forEachRow( std::function < void (const float *, int) > func )
+{
+    const auto & ard = m_appliedSlice.dims();
+    if ( ard.empty() || m_appliedSlice.isError() ) {
+        return;
+    }
+    for ( auto & ar : ard ) {
+        if ( axisCount( ar ) <= 0 ) {
+            return;
+        }
+    }
+    const float * raw = m_data-> data();
+    const int rowCount = axisCount( ard[0] );
+    std::fill( m_currPos.begin(), m_currPos.end(), 0 );
+    while ( true ) {
+        int64_t offset = ard[0].start;
+        for ( size_t i = 1 ; i < ard.size() ; i++ ) {
+            offset += ( ard[i].start + int64_t( ard[i].step ) * m_currPos[i] ) * m_strides[i];
+        }
+        func( raw + offset, rowCount );
+
+        // advance to the next row, odometer style
+        size_t axis = 1;
+        for ( ; axis < ard.size() ; axis++ ) {
+            if ( ++ m_currPos[axis] < axisCount( ard[axis] ) ) {
+                break;
+            }
+            m_currPos[axis] = 0;
+        }
+        if ( axis == ard.size() ) {
+            break;
+        }
+    }
+} // forEachRow
+
+void
+FloatRawView::forEach( std::function < void (const char *) > func, Traversal traversal )
+{
+    // the sequential traversal is also the fastest one for us
+    Q_UNUSED( traversal );
+    const int step = m_appliedSlice.dims().empty() ? 1 : m_appliedSlice.dims()[0].step;
+    forEachRow( [&] ( const float * ptr, int count ) {
+                    for ( int x = 0 ; x < count ; x++ ) {
+                        m_currPos[0] = x;
+                        func( reinterpret_cast < const char * > ( ptr ) );
+                        ptr += step;
+                    }
+                }
+                );
+}
+
+const FloatRawView::VI &
+FloatRawView::currentPos()
+{
+    return m_currPos;
+}
+
+RawViewInterface *
+FloatRawView::getView( const SliceND & sliceInfo )
+{
+    // apply the slice to dimensions of this view (single index axes have one element)
+    SliceND::ApplyResult ar = sliceInfo.apply( positiveDims( dims() ) );
+
+    // create applied result that combines m_appliedSlice with ar
+    SliceND::ApplyResult newAr = SliceND::ApplyResult::combine( m_appliedSlice, ar );
+
+    // return a new view sharing our data
+    return new FloatRawView( m_data, m_origDims, newAr );
+}
+
+int64_t
+FloatRawView::read( int64_t buffSize, char * buff, Traversal traversal )
+{
+    Q_UNUSED( buffSize );
+    Q_UNUSED( buff );
+    Q_UNUSED( traversal );
+    qFatal( "not implemented" );
+}
+
+void
+FloatRawView::seek( int64_t ind )
+{
+    Q_UNUSED( ind );
+    qFatal( "not implemented" );
+}
+
+int64_t
+FloatRawView::read( int64_t chunk, int64_t buffSize, char * buff, Traversal traversal )
+{
+    Q_UNUSED( chunk );
+    Q_UNUSED( buffSize );
+    Q_UNUSED( buff );
+    Q_UNUSED( traversal );
+    qFatal( "not implemented" );
+}
+
+void
+FloatRawView::forEach( int64_t buffSize,
+                       std::function < void (const char *, int64_t) > func,
+                       char * buff,
+                       Traversal traversal )
+{
+    Q_UNUSED( traversal );
+    const int64_t capacity = std::max < int64_t > ( buffSize / sizeof( float ), 1 );
+    std::vector < float > ownBuffer;
+    float * dst = reinterpret_cast < float * > ( buff );
+    if ( ! dst ) {
+        ownBuffer.resize( capacity );
+        dst = ownBuffer.data();
+    }
+    const int step = m_appliedSlice.dims().empty() ? 1 : m_appliedSlice.dims()[0].step;
+    int64_t used = 0;
+    forEachRow( [&] ( const float * ptr, int count ) {
+                    while ( count > 0 ) {
+                        int64_t n = std::min < int64_t > ( count, capacity - used );
+                        if ( step == 1 ) {
+                            std::memcpy( dst + used, ptr, n * sizeof( float ) );
+                            ptr += n;
+                        }
+                        else {
+                            for ( int64_t i = 0 ; i < n ; i++ ) {
+                                dst[used + i] = * ptr;
+                                ptr += step;
+                            }
+                        }
+                        used += n;
+                        count -= n;
+                        if ( used == capacity ) {
+                            func( reinterpret_cast < const char * > ( dst ), used );
+                            used = 0;
+                        }
+                    }
+                }
+                );
+    if ( used > 0 ) {
+        func( reinterpret_cast < const char * > ( dst ), used );
+    }
+} // forEach
+}
+}
+}
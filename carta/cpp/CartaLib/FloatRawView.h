@@ -0,0 +1,122 @@
+/// Raw view into an n-dimensional array of floats that lives in memory.
+///
+/// The data is shared (not copied) between the view and all views derived from it
+/// with getView(), so it is cheap to hand these out, e.g. from a cache.
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include <memory>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace NdArray
+{
+class FloatRawView
+    : public RawViewInterface
+{
+public:
+
+    /// the shared data, first axis varies fastest
+    typedef std::shared_ptr < const std::vector < float > > DataPtr;
+
+    FloatRawView() = delete;
+
+    /// construct a view of the entire array
+    /// \param data the pixels
+    /// \param dims dimensions of the data, a negative dimension denotes a single
+    /// index axis (as reported by views of sliced images), it is treated as size 1
+    FloatRawView( DataPtr data, const VI & dims );
+
+    /// construct a view of a slice of the array
+    /// \param data the pixels
+    /// \param dims dimensions of the data
+    /// \param sliceInfo what part of the data the view is for
+    FloatRawView( DataPtr data, const VI & dims, const SliceND & sliceInfo );
+
+    virtual PixelType
+    pixelType() override;
+
+    virtual const VI &
+    dims() override;
+
+    virtual const char *
+    get( const VI & pos ) override;
+
+    virtual void
+    forEach( std::function < void (const char *) > func,
+             Traversal traversal = Traversal::Sequential ) override;
+
+    virtual const VI &
+    currentPos() override;
+
+    virtual RawViewInterface *
+    getView( const SliceND & sliceInfo ) override;
+
+    virtual int64_t
+    read( int64_t buffSize, char * buff,
+          Traversal traversal = Traversal::Sequential ) override;
+
+    virtual void
+    seek( int64_t ind = 0 ) override;
+
+    virtual int64_t
+    read( int64_t chunk, int64_t buffSize, char * buff,
+          Traversal traversal = Traversal::Sequential ) override;
+
+    virtual void
+    forEach( int64_t buffSize,
+             std::function < void (const char *, int64_t count) > func,
+             char * buff = nullptr,
+             Traversal traversal = Traversal::Sequential ) override;
+
+    /// the shared data this view reads from
+    const DataPtr &
+    data() const { return m_data; }
+
+    /// does this view cover all of data() in its original order, i.e. can data()
+    /// be used directly instead of iterating through the view
+    bool
+    isContiguous() const;
+
+private:
+
+    /// construct a view directly from an applied slice
+    FloatRawView( DataPtr data, const VI & origDims, const SliceND::ApplyResult & applyResult );
+
+    /// common part of the constructors
+    void
+    init( const SliceND::ApplyResult & applyResult );
+
+    /// calls func with runs of consecutive values along the first axis
+    /// (pointer to the first value, number of values)
+    void
+    forEachRow( std::function < void (const float *, int) > func );
+
+    /// the pixels
+    DataPtr m_data;
+
+    /// dimensions of the original data (no negative values)
+    VI m_origDims;
+
+    /// offset between neighbours along each axis in the original data
+    std::vector < int64_t > m_strides;
+
+    /// the resolved slice for the data we have
+    SliceND::ApplyResult m_appliedSlice;
+
+    /// dimensions of this view
+    VI m_viewDims;
+
+    /// current position during forEach(), in view coordinates
+    VI m_currPos;
+
+    /// buffer for reporting results of get()
+    float m_buff = 0;
+};
+}
+}
+}
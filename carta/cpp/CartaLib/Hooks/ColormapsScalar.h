@@ -49,3 +49,15 @@ public:
 }
 }
 }
+
+/// the list of colormaps does not change, so there is no need to ask plugins again
+template <>
+struct HookMemoization < Carta::Lib::Hooks::ColormapsScalarHook > {
+    static constexpr bool memoize = true;
+
+    static QString
+    key( const Carta::Lib::Hooks::ColormapsScalarHook::Params & )
+    {
+        return QString();
+    }
+};
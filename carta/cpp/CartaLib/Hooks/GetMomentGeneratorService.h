@@ -0,0 +1,49 @@
+/**
+ * Hook for adding a new moment generator service.
+ *
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/IPlugin.h"
+#include "CartaLib/IMomentGeneratorService.h"
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Hooks
+{
+class GetMomentGeneratorService : public BaseHook
+{
+    CARTA_HOOK_BOILER1( GetMomentGeneratorService );
+
+public:
+
+    /**
+     * @brief Result is a moment generator service.
+     */
+    typedef IMomentGeneratorService::SharedPtr ResultType;
+
+    /**
+     * @brief No input
+     */
+    struct Params { };
+
+    /**
+     * @brief constructor
+     * @param pptr pointer to the input parameters
+     */
+    GetMomentGeneratorService( Params * pptr ) : BaseHook( staticId ), paramsPtr( pptr )
+    {
+        CARTA_ASSERT( is < Me > () );
+    }
+
+    ResultType result;
+    Params * paramsPtr;
+};
+}
+}
+}
@@ -55,3 +55,15 @@ public:
 }
 }
 }
+
+/// the persistent cache is a singleton, so we only ever ask the plugins once
+template <>
+struct HookMemoization < Carta::Lib::Hooks::GetPersistantCache > {
+    static constexpr bool memoize = true;
+
+    static QString
+    key( const Carta::Lib::Hooks::GetPersistantCache::Params & )
+    {
+        return QString();
+    }
+};
@@ -28,6 +28,8 @@ enum class UniqueHookIDs {
     GetProfileExtractor_ID,
 
     GetPersistantCache_ID,
+    GetMomentGeneratorService_ID,
+    RawViewFunction_ID,
 
     /// region related stuff, still to be considered experimental
     CoordSystemHook_ID,
@@ -0,0 +1,62 @@
+/**
+ * Hook for running a function provided by a plugin (e.g. a python script) on the
+ * pixels of a raw view.
+ *
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/IPlugin.h"
+#include "CartaLib/IImage.h"
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Hooks
+{
+/// \brief Hook for handing the pixels of a raw view to a named plugin function
+///
+/// Plugins that don't provide a function with the requested name should not
+/// handle the hook, so that the next plugin gets a chance.
+class RawViewFunction : public BaseHook
+{
+    CARTA_HOOK_BOILER1( RawViewFunction );
+
+public:
+
+    /// result is true if the function ran without errors
+    typedef bool ResultType;
+
+    /// input parameters are:
+    /// name of the function, the view with the pixels and the maximum number of
+    /// pixels the plugin should hand to the function at once
+    struct Params {
+        Params( const QString & p_funcName,
+                NdArray::RawViewInterface * p_view,
+                int64_t p_chunkSize = 1024 * 1024 )
+        {
+            funcName = p_funcName;
+            view = p_view;
+            chunkSize = p_chunkSize;
+        }
+
+        QString funcName;
+        NdArray::RawViewInterface * view = nullptr;
+        int64_t chunkSize;
+    };
+
+    /// standard constructor (could be probably a macro)
+    RawViewFunction( Params * pptr ) : BaseHook( staticId ), paramsPtr( pptr )
+    {
+        // force instantiation of templates
+        CARTA_ASSERT( is < Me > () );
+    }
+
+    ResultType result = false;
+    Params * paramsPtr = nullptr;
+};
+}
+}
+}
@@ -4,4 +4,43 @@
 
 
 #include "ICoordinateFormatter.h"
+#include <limits>
 
+namespace
+{
+/// converts n points one by one with the single point version of a conversion
+template < typename Convert >
+bool
+convertEach( const double * src, double * dst, int64_t n, int nAxes, Convert convert )
+{
+    CoordinateFormatterInterface::VD in( nAxes ), out;
+    bool allValid = true;
+    for ( int64_t i = 0 ; i < n ; i++ ) {
+        in.assign( src + i * nAxes, src + ( i + 1 ) * nAxes );
+        bool valid = convert( in, out ) && int ( out.size() ) >= nAxes;
+        for ( int k = 0 ; k < nAxes ; k++ ) {
+            dst[i * nAxes + k] = valid ? out[k] : std::numeric_limits < double >::quiet_NaN();
+        }
+        allValid = allValid && valid;
+    }
+    return allValid;
+}
+}
+
+bool
+CoordinateFormatterInterface::toWorld( const double * pixel, double * world, int64_t n ) const
+{
+    return convertEach( pixel, world, n, nAxes(), [this] ( const VD & in, VD & out ) {
+                            return toWorld( in, out );
+                        }
+                        );
+}
+
+bool
+CoordinateFormatterInterface::toPixel( const double * world, double * pixel, int64_t n ) const
+{
+    return convertEach( world, pixel, n, nAxes(), [this] ( const VD & in, VD & out ) {
+                            return toPixel( in, out );
+                        }
+                        );
+}
@@ -87,6 +87,21 @@ public:
     /// convert world coordinates to pixel coordinates
     virtual bool toPixel(const VD& world, VD& pixel) const = 0;
 
+    /// convert n pixel coordinates to world coordinates in one go, which is much
+    /// cheaper per point than calling toWorld() for each of them
+    /// \param pixel n points, nAxes() values each, stored one point after another
+    /// \param world output, laid out the same way as pixel
+    /// \param n number of points
+    /// \return false if any of the points could not be converted (those are set to NaN)
+    /// \note default implementation converts the points one by one; subclasses that only
+    /// override the VD versions need 'using CoordinateFormatterInterface::toWorld' to
+    /// keep this one visible
+    virtual bool toWorld(const double * pixel, double * world, int64_t n) const;
+
+    /// convert n world coordinates to pixel coordinates in one go, see the
+    /// batched toWorld() for the details
+    virtual bool toPixel(const double * world, double * pixel, int64_t n) const;
+
     /// virtual destructor
     virtual ~CoordinateFormatterInterface() {}
 
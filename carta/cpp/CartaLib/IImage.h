@@ -392,6 +392,15 @@ public:
     /// the image
     virtual Image::MetaDataInterface::SharedPtr
     metaData() = 0;
+
+    /// does the image keep its pixels in memory, or cache the pixels it computes?
+    /// Such images can be read from any thread, and caches of decoded pixels (e.g.
+    /// the PlaneCache) read them directly instead of keeping another copy.
+    virtual bool
+    cachesPixels() const
+    {
+        return false;
+    }
 };
 } // namespace Image
 }
@@ -0,0 +1,122 @@
+/**
+ * Purpose of IMomentGeneratorService is to define an API that
+ *
+ * a) can be implemented by plugins to offer new ways of computing moment maps
+ * b) can be used elsewhere (eg. by core or plugins) to compute moment maps of cubes
+ *
+ **/
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include "CartaLib/CartaLib.h"
+#include <QObject>
+#include <limits>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+///
+/// Computes moment maps of a spectral cube (the spectral axis being the third axis),
+/// i.e. one value per spatial pixel, calculated from the spectrum at that pixel.
+///
+/// The results are images that live in memory, with the same coordinate system as
+/// the cube, and a single channel.
+class IMomentGeneratorService
+    : public QObject
+{
+    Q_OBJECT
+    CLASS_BOILERPLATE( IMomentGeneratorService );
+
+public:
+
+    typedef int64_t JobId;
+
+    /// the supported moments, the spectral coordinate of channel c is v(c), its width dv(c)
+    ///
+    /// v is the world coordinate of the spectral axis in the units of the cube (e.g. Hz),
+    /// or the channel index if the cube has no spectral coordinate. It is not converted
+    /// to velocity, as the images do not offer a rest frequency, so the moments 1 and 2
+    /// are frequencies (or whatever the spectral axis is) rather than velocities.
+    enum class Moment
+    {
+        Integrated, ///< moment 0, sum of I*dv
+        SpectralMean, ///< moment 1, intensity weighted mean of v
+        SpectralDispersion, ///< moment 2, intensity weighted standard deviation of v
+        Peak ///< maximum of I
+    };
+
+    /// what to compute, and which pixels to use
+    struct Params {
+        /// requested moments
+        std::vector < Moment > moments;
+
+        /// channels to use, negative for all of them
+        int minChannel = - 1;
+        int maxChannel = - 1;
+
+        /// alternatively, the range of the spectral axis to use in rangeUnits, same as
+        /// for histograms; used if both are non-negative
+        double minFrequency = - 1;
+        double maxFrequency = - 1;
+        QString rangeUnits;
+
+        /// only pixels with values in this range contribute
+        double minIntensity = - std::numeric_limits < double >::infinity();
+        double maxIntensity = std::numeric_limits < double >::infinity();
+    };
+
+    /// one image per requested moment, in the order they were requested, the
+    /// vector is empty if the moments could not be computed
+    typedef std::vector < Image::ImageInterface::SharedPtr > Result;
+
+    /// set the cube
+    virtual void
+    setInput( Image::ImageInterface::SharedPtr image ) = 0;
+
+    /// set the moments to compute
+    virtual void
+    setParams( const Params & params ) = 0;
+
+    /// \brief start the job, a previous job that did not finish yet will not report
+    /// its result
+    /// \param jobId what id to assign to job, if -1, it'll be auto-generated (0,1,2,...)
+    /// \return the jobId of the job
+    virtual JobId
+    start( JobId jobId = - 1 ) = 0;
+
+    /// short name of a moment, e.g. for naming the resulting images
+    static QString
+    momentName( Moment moment )
+    {
+        switch ( moment ) {
+        case Moment::Integrated :
+            return "moment0";
+        case Moment::SpectralMean :
+            return "moment1";
+        case Moment::SpectralDispersion :
+            return "moment2";
+        case Moment::Peak :
+            return "peak";
+        }
+        return "";
+    }
+
+    IMomentGeneratorService( QObject * parent = nullptr )
+        : QObject( parent ) { }
+
+    virtual
+    ~IMomentGeneratorService() { }
+
+signals:
+
+    /// emitted (on the thread of the service) when the job is done
+    /// \param result contains the moment maps
+    /// \param jobId which jobid does this result correspond to
+    void
+    done( const Result & result, JobId jobId );
+};
+}
+}
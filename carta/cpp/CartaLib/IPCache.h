@@ -45,6 +45,11 @@ public:
     setEntry( const QByteArray & key,
               const QByteArray & val,
               int64_t priority ) = 0;
+
+    /// write out entries that are still buffered; caches that write every entry
+    /// right away have nothing to do
+    virtual void
+    flush() { }
 };
 }
 }
@@ -9,6 +9,7 @@
 #include <QDebug>
 #include <QJsonObject>
 #include <cstdint>
+#include <functional>
 
 /// Every hook as a unique ID and we are using 64bit integers for hook IDs
 /// The IDs will allow us to do static_cast<> downcasting inside plugins.
@@ -63,6 +64,21 @@ protected:
     HookId m_hookId;
 };
 
+/// Some hooks return results that depend only on their parameters (e.g. list of
+/// colormaps). Such hooks can specialize this template with memoize = true and a
+/// key() that identifies the parameters, and the plugin manager will remember their
+/// results instead of asking the plugins again.
+template < typename HookType >
+struct HookMemoization {
+    static constexpr bool memoize = false;
+
+    static QString
+    key( const typename HookType::Params & )
+    {
+        return QString();
+    }
+};
+
 /// parsed plugin.json information
 struct PluginJson {
     /// API version against which
@@ -141,14 +157,25 @@ public:
 
     typedef FakeVoid ResultType;
     struct Params {
-        Params( QString p_viewName, QImage * p_imgPtr )
+        Params( QString p_viewName, QImage * p_imgPtr, qint64 p_frameId = - 1,
+                std::function < void () > p_requestRepaint = nullptr )
         {
             imgPtr = p_imgPtr;
             viewName = p_viewName;
+            frameId = p_frameId;
+            requestRepaint = p_requestRepaint;
         }
 
         QImage * imgPtr;
         QString viewName;
+
+        /// identifies the rendered pixels (unique across views), the same id means the
+        /// same image, so results can be reused; -1 if unknown
+        qint64 frameId;
+
+        /// plugins that finish their work after the hook returned can call this (from
+        /// any thread) to have the view rendered again
+        std::function < void () > requestRepaint;
     };
     PreRender( Params * pptr ) : BaseHook( staticId ), paramsPtr( pptr ) { }
 
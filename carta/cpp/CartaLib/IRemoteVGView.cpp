@@ -8,11 +8,62 @@
 
 #include <QTimer>
 #include <QPainter>
+#include <algorithm>
+#include <cstring>
 
 namespace Carta
 {
 namespace Lib
 {
+namespace
+{
+/// bounding rectangle of the pixels that differ between two images, the whole
+/// rectangle of both if they can't be compared pixel by pixel
+QRect
+changedRect( const QImage & a, const QImage & b )
+{
+    if ( a.size() != b.size() || a.format() != b.format() || a.depth() != 32 ) {
+        return QRect( QPoint( 0, 0 ), a.size().expandedTo( b.size() ) );
+    }
+    const int width = a.width();
+    const size_t rowBytes = size_t( width ) * 4;
+    auto sameRow = [&] ( int y ) {
+        return std::memcmp( a.constScanLine( y ), b.constScanLine( y ), rowBytes ) == 0;
+    };
+    int top = 0;
+    while ( top < a.height() && sameRow( top ) ) {
+        top++;
+    }
+    if ( top == a.height() ) {
+        return QRect();
+    }
+    int bottom = a.height() - 1;
+    while ( sameRow( bottom ) ) {
+        bottom--;
+    }
+    int left = width, right = - 1;
+    for ( int y = top ; y <= bottom ; y++ ) {
+        const QRgb * pa = reinterpret_cast < const QRgb * > ( a.constScanLine( y ) );
+        const QRgb * pb = reinterpret_cast < const QRgb * > ( b.constScanLine( y ) );
+        for ( int x = 0 ; x < left ; x++ ) {
+            if ( pa[x] != pb[x] ) {
+                left = x;
+                break;
+            }
+        }
+        for ( int x = width - 1 ; x > right ; x-- ) {
+            if ( pa[x] != pb[x] ) {
+                right = x;
+                break;
+            }
+        }
+    }
+    return QRect( QPoint( left, top ), QPoint( right, bottom ) );
+} // changedRect
+}
+
+const QRect LayeredRemoteVGView::AllDamaged( 0, 0, 1 << 24, 1 << 24 );
+
 //LayeredRemoteVGView::SharedPtr
 //LayeredRemoteVGView::create( IConnector * connector, QString viewName, QObject * parent )
 //{
@@ -45,26 +96,64 @@ LayeredRemoteVGView::resetLayers()
 {
     m_vgLayers.clear();
     m_rasterLayers.clear();
+    m_rasterStackChanged = true;
+    m_vgDirty = true;
 }
 
-void
-LayeredRemoteVGView::setRasterLayer( int layer, const QImage & img )
+LayeredRemoteVGView::RasterLayerInfo &
+LayeredRemoteVGView::p_rasterLayer( int layer )
 {
     CARTA_ASSERT( layer >= 0 && layer < 1000 );
     if ( int ( m_rasterLayers.size() ) <= layer ) {
         m_rasterLayers.resize( layer + 1 );
     }
-    m_rasterLayers[layer].qimg = img;
+    return m_rasterLayers[layer];
+}
+
+void
+LayeredRemoteVGView::p_damage( RasterLayerInfo & info, const QRect & rect )
+{
+    if ( rect.isEmpty() ) {
+        return;
+    }
+    info.damage |= rect;
+    info.revision++;
+}
+
+void
+LayeredRemoteVGView::setRasterLayer( int layer, const QImage & img )
+{
+    auto & info = p_rasterLayer( layer );
+
+    // setting the same (unmodified) image again does not damage anything, a new image
+    // only damages the pixels that differ, e.g. around a moved cursor
+    if ( info.qimg.cacheKey() != img.cacheKey() ) {
+        p_damage( info, changedRect( info.qimg, img ) );
+    }
+    info.qimg = img;
+}
+
+void
+LayeredRemoteVGView::setRasterLayer( int layer, const QImage & img, const QRect & dirtyRect )
+{
+    auto & info = p_rasterLayer( layer );
+    if ( info.qimg.size() != img.size() ) {
+        p_damage( info, AllDamaged );
+    }
+    else {
+        p_damage( info, dirtyRect );
+    }
+    info.qimg = img;
 }
 
 void
 LayeredRemoteVGView::setRasterLayerCombiner( int layer, IQImageCombiner::SharedPtr combiner )
 {
-    CARTA_ASSERT( layer >= 0 && layer < 1000 );
-    if ( int ( m_rasterLayers.size() ) <= layer ) {
-        m_rasterLayers.resize( layer + 1 );
+    auto & info = p_rasterLayer( layer );
+    if ( info.combiner != combiner ) {
+        p_damage( info, AllDamaged );
     }
-    m_rasterLayers[layer].combiner = combiner;
+    info.combiner = combiner;
 }
 
 void
@@ -73,6 +162,12 @@ LayeredRemoteVGView::setVGLayer( int layer, const VectorGraphics::VGList & vglis
     CARTA_ASSERT( layer >= 0 && layer < 1000 );
     if ( int ( m_vgLayers.size() ) <= layer ) {
         m_vgLayers.resize( layer + 1 );
+        m_vgDirty = true;
+    }
+
+    // the entries are shared pointers, so identical lists are cheap to detect
+    if ( m_vgLayers[layer].vglist.entries() != vglist.entries() ) {
+        m_vgDirty = true;
     }
     m_vgLayers[layer].vglist = vglist;
 }
@@ -129,30 +224,89 @@ void
 LayeredRemoteVGView::p_timerCB()
 {
     QSize size = getClientSize();
+    const QRect all( QPoint( 0, 0 ), size );
+    int nLayers = m_rasterLayers.size();
 
-    QImage buff( size, QImage::Format_ARGB32_Premultiplied );
-    buff.fill( QColor( 0, 0, 0, 255 ) );
+    // everything needs to be redone if the size or the layer stack changed
+    bool redoAll = m_rasterStackChanged || size != m_outBuffs[m_outIndex].size();
+    if ( redoAll ) {
+        m_outStale[0] = m_outStale[1] = all;
+    }
 
-    // now go through the layers and paint them on top of the last result
-    for ( auto & layer : m_rasterLayers ) {
-        IQImageCombiner::SharedPtr combiner = layer.combiner;
-        if ( ! combiner ) {
-            combiner = std::make_shared < DefaultCombiner > ();
+    // find the lowest damaged layer, and the union of the damage of all damaged layers
+    int lowest = redoAll ? 0 : nLayers;
+    QRect damage = redoAll ? all : QRect();
+    for ( int i = 0 ; i < nLayers ; ++i ) {
+        const RasterLayerInfo & layer = m_rasterLayers[i];
+        if ( layer.isDamaged() ) {
+            lowest = std::min( lowest, i );
+            damage |= layer.damage;
         }
-        combiner->combine( buff, layer.qimg );
     }
+    damage &= all;
+
+    if ( ! damage.isEmpty() ) {
+        IQImageCombiner::SharedPtr defaultCombiner = std::make_shared < DefaultCombiner > ();
+        auto combinerFor = [&] ( const RasterLayerInfo & layer ) {
+            return layer.combiner ? layer.combiner : defaultCombiner;
+        };
+
+        // make sure the prefix buffer holds the composite of all layers below the
+        // lowest damaged one, reusing what we can
+        if ( m_rasterStackChanged || m_prefixBuff.size() != size || lowest < m_prefixCount ) {
+            m_prefixBuff = QImage( size, QImage::Format_ARGB32_Premultiplied );
+            m_prefixBuff.fill( QColor( 0, 0, 0, 255 ) );
+            m_prefixCount = 0;
+        }
+        for ( ; m_prefixCount < lowest ; ++m_prefixCount ) {
+            combinerFor( m_rasterLayers[m_prefixCount] )->
+                combine( m_prefixBuff, m_rasterLayers[m_prefixCount].qimg );
+        }
 
-    m_vgView-> setRaster( buff );
+        // composite into the buffer we did not send last time, the view normally has
+        // released it by now, so nothing gets detached; only the damage, plus whatever
+        // changed while the other buffer was being shown, is recomposited
+        m_outIndex ^= 1;
+        QImage & out = m_outBuffs[m_outIndex];
+        if ( out.size() != size ) {
+            out = QImage( size, QImage::Format_ARGB32_Premultiplied );
+            m_outStale[m_outIndex] = all;
+        }
+        QRect repaint = ( damage | m_outStale[m_outIndex] ) & all;
+        {
+            QPainter p( & out );
+            p.setCompositionMode( QPainter::CompositionMode_Source );
+            p.drawImage( repaint.topLeft(), m_prefixBuff, repaint );
+        }
+        for ( int i = lowest ; i < nLayers ; ++i ) {
+            combinerFor( m_rasterLayers[i] )-> combineRect( out, m_rasterLayers[i].qimg, repaint );
+        }
+        m_outStale[m_outIndex] = QRect();
+        m_outStale[m_outIndex ^ 1] |= damage;
+
+        // the view only needs to update the damaged area
+        m_vgView-> setRasterPartial( out, damage );
+    }
 
-    // concatenate all VG lists into one
-    VectorGraphics::VGComposer composer;
-    for ( auto & vglayer : m_vgLayers ) {
-        composer.append < VectorGraphics::Entries::Reset > ();
-        composer.appendList( vglayer.vglist );
+    // everything is up to date now
+    for ( auto & layer : m_rasterLayers ) {
+        layer.compositedRevision = layer.revision;
+        layer.damage = QRect();
     }
+    m_rasterStackChanged = false;
+
+    // concatenate all VG lists into one, but only if some of them changed
+    if ( m_vgDirty ) {
+        VectorGraphics::VGComposer composer;
+        for ( auto & vglayer : m_vgLayers ) {
+            composer.append < VectorGraphics::Entries::Reset > ();
+            composer.appendList( vglayer.vglist );
+        }
 
-    // render the combined vector graphics list
-    m_vgView-> setVG( composer.vgList() );
+        // render the combined vector graphics list
+        m_vgView-> setVG( composer.vgList() );
+        m_vgDirty = false;
+    }
 
     // schedule repaint
     (void) m_vgView-> scheduleRepaint( m_repaintId );
@@ -8,6 +8,7 @@
 #include <QObject>
 #include <QString>
 #include <QImage>
+#include <QPainter>
 //#include <QJsonObject>
 //#include <QJsonDocument>
 
@@ -54,6 +55,17 @@ public:
     virtual void
     setRaster( const QImage & image ) = 0;
 
+    /// same as setRaster(), but tells the view that only pixels inside dirtyRect
+    /// differ from the previously set raster, so that only those need to be sent
+    /// to the client
+    /// \note the default implementation ignores the hint
+    virtual void
+    setRasterPartial( const QImage & image, const QRect & dirtyRect )
+    {
+        Q_UNUSED( dirtyRect );
+        setRaster( image );
+    }
+
     /// sets the VG to be rendered on top of the raster, as soon as possible
     /// without synchronizing with raster
     virtual void
@@ -108,6 +120,19 @@ public:
     virtual void
     combine( QImage & src1dst, const QImage & src2 ) = 0;
 
+    /// same as combine(), but only the pixels inside rect need to be updated
+    /// the default implementation runs combine() on copies of the rectangle, reimplement
+    /// this if you can do better
+    virtual void
+    combineRect( QImage & src1dst, const QImage & src2, const QRect & rect )
+    {
+        QImage dst = src1dst.copy( rect );
+        combine( dst, src2.copy( rect ) );
+        QPainter p( & src1dst );
+        p.setCompositionMode( QPainter::CompositionMode_Source );
+        p.drawImage( rect.topLeft(), dst );
+    }
+
     /// is this fully opaque combiner? Return true for some extra optimization (e.g. no layers
     /// below this one need to be actually rendered...)
     virtual bool
@@ -128,6 +153,11 @@ public:
 /// Again, this is the lowest level functionality for multiple layers, for example there is
 /// no layer deletion, re-ordering, marshalling input, etc.
 ///
+/// Repaints are incremental: only the area damaged since the last repaint is recomposited,
+/// starting from a cached composite of the unchanged layers below the lowest damaged layer,
+/// the view is told which area changed (setRasterPartial()), and VG layers are only
+/// re-sent when they change.
+///
 /// \note there is a slightly different implementation of this in LayeredViewArbitrary,
 /// which has essentially the same functionality as this class, but it allows layers
 /// to have arbitrary order, e.g. raster/VG/raster. See that class's documentation for more
@@ -160,9 +190,16 @@ public:
     void
     resetLayers();
 
+    /// sets the raster for the layer, if it's a different image than last time the
+    /// pixels that differ from the previous one are damaged
     void
     setRasterLayer( int layer, const QImage & img );
 
+    /// sets the raster for the layer, but only pixels inside dirtyRect will be
+    /// recomposited, use this for small interactive overlays that know what they touched
+    void
+    setRasterLayer( int layer, const QImage & img, const QRect & dirtyRect );
+
     void
     setRasterLayerCombiner( int layer, IQImageCombiner::SharedPtr combiner );
 
@@ -203,8 +240,23 @@ private:
     struct RasterLayerInfo {
         QImage qimg;
         IQImageCombiner::SharedPtr combiner = nullptr;
+
+        /// incremented every time the layer changes
+        quint64 revision = 1;
+
+        /// the revision that was composited last
+        quint64 compositedRevision = 0;
+
+        /// part of the layer that changed since the composited revision
+        QRect damage = AllDamaged;
+
+        bool
+        isDamaged() const { return revision != compositedRevision; }
     };
 
+    /// damage rectangle of a layer that changed everywhere
+    static const QRect AllDamaged;
+
     struct VGLayerInfo {
         VectorGraphics::VGList vglist;
     };
@@ -212,6 +264,35 @@ private:
     std::vector < RasterLayerInfo > m_rasterLayers;
     std::vector < VGLayerInfo > m_vgLayers;
 
+    /// cached composite of the bottom m_prefixCount raster layers, i.e. the layers
+    /// below the lowest changed layer
+    QImage m_prefixBuff;
+    int m_prefixCount = 0;
+
+    /// composites of all raster layers, used alternately: the view keeps a reference
+    /// to the raster we hand it, so painting into that same image would detach (deep copy)
+    /// it on every repaint
+    QImage m_outBuffs[2];
+    int m_outIndex = 0;
+
+    /// area of each composite that is out of date, i.e. the damage of the repaints done
+    /// in the other buffer since this one was painted
+    QRect m_outStale[2];
+
+    /// set when the layer stack itself changed (e.g. layers were reset)
+    bool m_rasterStackChanged = true;
+
+    /// whether the VG layers need to be concatenated and sent again
+    bool m_vgDirty = true;
+
+    /// returns a layer info, creating it if necessary
+    RasterLayerInfo &
+    p_rasterLayer( int layer );
+
+    /// record that part of a layer changed
+    void
+    p_damage( RasterLayerInfo & info, const QRect & rect );
+
     qint64 m_repaintId = - 1;
     QTimer * m_timer = nullptr;
 
@@ -270,6 +351,17 @@ public:
         p.drawImage( 0, 0, src2 );
     }
 
+    virtual void
+    combineRect( QImage & src1dst, const QImage & src2, const QRect & rect ) override
+    {
+        if ( m_alpha == 0.0 || src1dst.size().isEmpty() || src2.size().isEmpty() ) {
+            return;
+        }
+        QPainter p( & src1dst );
+        p.setOpacity( m_alpha );
+        p.drawImage( rect.topLeft(), src2, rect );
+    }
+
     virtual bool
     isOpaque()  override
     {
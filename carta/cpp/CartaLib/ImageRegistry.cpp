@@ -0,0 +1,94 @@
+#include "ImageRegistry.h"
+#include "PlaneCache.h"
+#include <QDateTime>
+#include <QFileInfo>
+
+namespace Carta
+{
+namespace Lib
+{
+ImageRegistry::Handle::Handle( Image::ImageInterface::SharedPtr image, const QString & key )
+    : m_image( image )
+      , m_key( key )
+      , m_quantiles( "clip quantiles" )
+{ }
+
+QString
+ImageRegistry::Handle::quantileKey( int frame, double minPercentile, double maxPercentile )
+{
+    return QString( "%1|%2|%3" ).arg( frame ).arg( minPercentile, 0, 'g', 17 )
+               .arg( maxPercentile, 0, 'g', 17 );
+}
+
+ImageRegistry::Handle::~Handle()
+{
+    PlaneCache::instance().removeImage( m_key );
+}
+
+ImageRegistry &
+ImageRegistry::instance()
+{
+    static ImageRegistry registry;
+    return registry;
+}
+
+QString
+ImageRegistry::fileKey( const QString & fileName )
+{
+    QFileInfo info( fileName );
+    QString path = info.canonicalFilePath();
+    if ( path.isEmpty() ) {
+        // not a local file (or it does not exist), let the loader deal with it
+        path = fileName;
+    }
+    return QString( "%1|%2" ).arg( path ).arg( info.lastModified().toMSecsSinceEpoch() );
+}
+
+ImageRegistry::HandlePtr
+ImageRegistry::open( const QString & fileName, const Loader & loader, bool * loaded )
+{
+    if ( loaded ) {
+        * loaded = false;
+    }
+    QString key = fileKey( fileName );
+    {
+        QMutexLocker locker( & m_mutex );
+        HandlePtr handle = m_handles.value( key ).lock();
+        if ( handle ) {
+            return handle;
+        }
+    }
+
+    // load without holding the lock, loading can take a while
+    Image::ImageInterface::SharedPtr image = loader();
+    if ( ! image ) {
+        return nullptr;
+    }
+
+    QMutexLocker locker( & m_mutex );
+
+    // somebody else could have loaded the same file in the meantime
+    HandlePtr handle = m_handles.value( key ).lock();
+    if ( handle ) {
+        return handle;
+    }
+
+    // forget about images nobody uses anymore
+    for ( auto it = m_handles.begin() ; it != m_handles.end() ; ) {
+        if ( it.value().expired() ) {
+            it = m_handles.erase( it );
+        }
+        else {
+            ++it;
+        }
+    }
+
+    handle = std::make_shared < Handle > ( image, QString( "%1#%2" ).arg( key ).arg( ++ m_serial ) );
+    m_handles.insert( key, handle );
+    if ( loaded ) {
+        * loaded = true;
+    }
+    return handle;
+} // open
+}
+}
@@ -0,0 +1,94 @@
+/// Images shared by all views showing the same file.
+///
+/// Loading a file through the LoadAstroImage hook creates a new image every time,
+/// including e.g. a new casacore lattice with its own caches. The registry keeps track
+/// of open images, keyed by the canonical path and modification time of the file, and
+/// hands out the same instance to everyone asking for it while anyone still holds it.
+/// Analytics computed from the image (decoded planes, clip quantiles) are shared the
+/// same way, so several views of one file cost about as much as a single view.
+
+#pragma once
+
+#include "CartaLib/CacheRegistry.h"
+#include "CartaLib/IImage.h"
+#include <functional>
+#include <memory>
+
+namespace Carta
+{
+namespace Lib
+{
+class ImageRegistry
+{
+    CLASS_BOILERPLATE( ImageRegistry );
+
+public:
+
+    /// loads the image when nobody has it open, returns nullptr on failure
+    typedef std::function < Image::ImageInterface::SharedPtr () > Loader;
+
+    /// an open image, and the data shared by all its users
+    class Handle
+    {
+        CLASS_BOILERPLATE( Handle );
+
+public:
+
+        Handle( Image::ImageInterface::SharedPtr image, const QString & key );
+
+        /// the image
+        const Image::ImageInterface::SharedPtr &
+        image() const { return m_image; }
+
+        /// identifies this image instance, use it as the image key in the PlaneCache
+        const QString &
+        key() const { return m_key; }
+
+        /// clip values, keyed by quantileKey()
+        LruCache < QString, std::vector < double > > &
+        quantiles() { return m_quantiles; }
+
+        /// key of the clip values of a frame for the given percentiles
+        static QString
+        quantileKey( int frame, double minPercentile, double maxPercentile );
+
+        /// discards the decoded planes of the image
+        ~Handle();
+
+private:
+
+        Image::ImageInterface::SharedPtr m_image;
+        QString m_key;
+        LruCache < QString, std::vector < double > > m_quantiles;
+    };
+
+    typedef Handle::SharedPtr HandlePtr;
+
+    /// the registry
+    static ImageRegistry &
+    instance();
+
+    /// return the image for the file, shared with everyone else who has it open
+    /// \param fileName the file to open
+    /// \param loader used to load the image if nobody has it open
+    /// \param loaded if not null, set to whether the loader was used, i.e. whether
+    /// the image is a new instance nobody else knew about when this returned
+    /// \return the handle of the image, or nullptr if it could not be loaded
+    /// \note exceptions thrown by the loader are passed on
+    HandlePtr
+    open( const QString & fileName, const Loader & loader, bool * loaded = nullptr );
+
+private:
+
+    ImageRegistry() { }
+
+    /// key of the current version of the file
+    static QString
+    fileKey( const QString & fileName );
+
+    QHash < QString, std::weak_ptr < Handle > > m_handles;
+    QMutex m_mutex;
+    int64_t m_serial = 0;
+};
+}
+}
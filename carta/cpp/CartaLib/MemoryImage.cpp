@@ -0,0 +1,90 @@
+#include "MemoryImage.h"
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Image
+{
+MemoryImage::MemoryImage( NdArray::FloatRawView::DataPtr data,
+                          const VI & dims,
+                          const Unit & unit,
+                          MetaDataInterface::SharedPtr metaData )
+    : m_data( data )
+      , m_dims( dims )
+      , m_unit( unit )
+      , m_metaData( metaData )
+{
+    CARTA_ASSERT( m_data );
+}
+
+const Unit &
+MemoryImage::getPixelUnit() const
+{
+    return m_unit;
+}
+
+const MemoryImage::VI &
+MemoryImage::dims() const
+{
+    return m_dims;
+}
+
+bool
+MemoryImage::hasMask() const
+{
+    return false;
+}
+
+bool
+MemoryImage::hasErrorsInfo() const
+{
+    return false;
+}
+
+MemoryImage::PixelType
+MemoryImage::pixelType() const
+{
+    return PixelType::Real32;
+}
+
+MemoryImage::PixelType
+MemoryImage::errorType() const
+{
+    return PixelType::Real32;
+}
+
+NdArray::RawViewInterface *
+MemoryImage::getDataSlice( const SliceND & sliceInfo )
+{
+    return new NdArray::FloatRawView( m_data, m_dims, sliceInfo );
+}
+
+NdArray::Byte *
+MemoryImage::getMaskSlice( const SliceND & sliceInfo )
+{
+    Q_UNUSED( sliceInfo );
+    return nullptr;
+}
+
+NdArray::RawViewInterface *
+MemoryImage::getErrorSlice( const SliceND & sliceInfo )
+{
+    Q_UNUSED( sliceInfo );
+    return nullptr;
+}
+
+MetaDataInterface::SharedPtr
+MemoryImage::metaData()
+{
+    return m_metaData;
+}
+
+bool
+MemoryImage::cachesPixels() const
+{
+    return true;
+}
+}
+}
+}
@@ -0,0 +1,73 @@
+/// Image whose pixels live in memory, e.g. the result of an analysis of another image.
+///
+/// The pixels are floats, shared with all the views handed out by getDataSlice().
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include "CartaLib/FloatRawView.h"
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Image
+{
+class MemoryImage : public ImageInterface
+{
+    CLASS_BOILERPLATE( MemoryImage );
+
+public:
+
+    /// \param data the pixels, first axis varies fastest
+    /// \param dims dimensions of the image
+    /// \param unit unit of the pixels
+    /// \param metaData coordinates etc., e.g. those of the image the pixels were computed from
+    MemoryImage( NdArray::FloatRawView::DataPtr data,
+                 const VI & dims,
+                 const Unit & unit,
+                 MetaDataInterface::SharedPtr metaData );
+
+    virtual const Unit &
+    getPixelUnit() const override;
+
+    virtual const VI &
+    dims() const override;
+
+    virtual bool
+    hasMask() const override;
+
+    virtual bool
+    hasErrorsInfo() const override;
+
+    virtual PixelType
+    pixelType() const override;
+
+    virtual PixelType
+    errorType() const override;
+
+    virtual NdArray::RawViewInterface *
+    getDataSlice( const SliceND & sliceInfo ) override;
+
+    virtual NdArray::Byte *
+    getMaskSlice( const SliceND & sliceInfo ) override;
+
+    virtual NdArray::RawViewInterface *
+    getErrorSlice( const SliceND & sliceInfo ) override;
+
+    virtual MetaDataInterface::SharedPtr
+    metaData() override;
+
+    virtual bool
+    cachesPixels() const override;
+
+private:
+
+    NdArray::FloatRawView::DataPtr m_data;
+    VI m_dims;
+    Unit m_unit;
+    MetaDataInterface::SharedPtr m_metaData;
+};
+}
+}
+}
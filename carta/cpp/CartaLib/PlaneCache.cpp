@@ -0,0 +1,225 @@
+#include "PlaneCache.h"
+#include <QDebug>
+#include <memory>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace
+{
+/// append the pixels of a view to data, first axis varies fastest
+/// \param rawView the view, deleted when done
+void
+decode( NdArray::RawViewInterface * rawView, std::vector < float > & data )
+{
+    NdArray::Float floatView( rawView, true );
+    floatView.forEach( [& data] ( const float & val ) {
+                           data.push_back( val );
+                       }
+                       );
+}
+
+/// view that holds a lock while it reads the wrapped view, used to stream through
+/// slices that are too big to be decoded into memory
+class LockedRawView
+    : public NdArray::RawViewInterface
+{
+public:
+
+    /// \param rawView the view to read, deleted with this instance
+    /// \param mutex held during every access to rawView
+    LockedRawView( NdArray::RawViewInterface * rawView, QMutex & mutex )
+        : m_rawView( rawView )
+          , m_mutex( mutex )
+    { }
+
+    virtual PixelType
+    pixelType() override
+    {
+        return m_rawView-> pixelType();
+    }
+
+    virtual const VI &
+    dims() override
+    {
+        return m_rawView-> dims();
+    }
+
+    virtual const char *
+    get( const VI & pos ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_rawView-> get( pos );
+    }
+
+    virtual void
+    forEach( std::function < void (const char *) > func,
+             Traversal traversal = Traversal::Sequential ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        m_rawView-> forEach( func, traversal );
+    }
+
+    virtual const VI &
+    currentPos() override
+    {
+        return m_rawView-> currentPos();
+    }
+
+    virtual RawViewInterface *
+    getView( const SliceND & sliceInfo ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        return new LockedRawView( m_rawView-> getView( sliceInfo ), m_mutex );
+    }
+
+    virtual int64_t
+    read( int64_t buffSize, char * buff,
+          Traversal traversal = Traversal::Sequential ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_rawView-> read( buffSize, buff, traversal );
+    }
+
+    virtual void
+    seek( int64_t ind = 0 ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        m_rawView-> seek( ind );
+    }
+
+    virtual int64_t
+    read( int64_t chunk, int64_t buffSize, char * buff,
+          Traversal traversal = Traversal::Sequential ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_rawView-> read( chunk, buffSize, buff, traversal );
+    }
+
+    virtual void
+    forEach( int64_t buffSize,
+             std::function < void (const char *, int64_t count) > func,
+             char * buff = nullptr,
+             Traversal traversal = Traversal::Sequential ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        m_rawView-> forEach( buffSize, func, buff, traversal );
+    }
+
+private:
+
+    std::unique_ptr < NdArray::RawViewInterface > m_rawView;
+    QMutex & m_mutex;
+};
+}
+
+PlaneCache &
+PlaneCache::instance()
+{
+    static PlaneCache cache;
+    return cache;
+}
+
+PlaneCache::PlaneCache()
+    : m_planes( "decoded planes" )
+      , m_decodeMutex( QMutex::Recursive )
+{ }
+
+NdArray::RawViewInterface *
+PlaneCache::getDataSlice( const QString & imageKey,
+                          Image::ImageInterface & image,
+                          const SliceND & sliceInfo )
+{
+    // images that cache their own pixels are read directly, without another copy and
+    // without the decode lock (derived images read their sources through this cache)
+    if ( image.cachesPixels() ) {
+        return image.getDataSlice( sliceInfo );
+    }
+
+    QString key = imageKey + "|" + sliceInfo.toStr();
+    Plane plane;
+    if ( m_planes.find( key, plane ) ) {
+        return new NdArray::FloatRawView( plane.data, plane.dims );
+    }
+
+    // another thread might have decoded the slice while we waited
+    QMutexLocker decodeLocker( & m_decodeMutex );
+    if ( m_planes.find( key, plane ) ) {
+        return new NdArray::FloatRawView( plane.data, plane.dims );
+    }
+
+    // figure out how big the decoded slice would be
+    SliceND::ApplyResult ar = sliceInfo.apply( image.dims() );
+    if ( ar.isError() ) {
+        return nullptr;
+    }
+    int64_t count = 1;
+    for ( auto & d : ar.dims() ) {
+        count *= d.isSingle() ? 1 : d.count;
+    }
+    int64_t cost = count * int64_t( sizeof( float ) );
+
+    NdArray::RawViewInterface * rawView = image.getDataSlice( sliceInfo );
+    if ( ! rawView ) {
+        return nullptr;
+    }
+
+    // slices that would take a big part of the whole budget (e.g. entire cubes) are
+    // not decoded at all, the caller streams through the image's own view, which
+    // holds the decode lock while it reads
+    if ( cost > CacheRegistry::instance().budget() / 4 ) {
+        return new LockedRawView( rawView, m_decodeMutex );
+    }
+
+    plane.dims = rawView-> dims();
+    auto data = std::make_shared < std::vector < float > > ();
+    data-> reserve( count );
+    decode( rawView, * data );
+    if ( int64_t( data-> size() ) != count ) {
+        qWarning() << "Unexpected number of pixels in" << key << data-> size() << count;
+        return nullptr;
+    }
+    plane.data = data;
+
+    {
+        QMutexLocker locker( & m_keysMutex );
+        m_keys[imageKey].insert( key );
+    }
+    m_planes.insert( key, plane, cost );
+
+    return new NdArray::FloatRawView( plane.data, plane.dims );
+} // getDataSlice
+
+bool
+PlaneCache::readSlice( Image::ImageInterface & image,
+                       const SliceND & sliceInfo,
+                       std::vector < float > & data )
+{
+    QMutexLocker decodeLocker( & m_decodeMutex );
+    if ( image.cachesPixels() ) {
+        decodeLocker.unlock();
+    }
+    NdArray::RawViewInterface * rawView = image.getDataSlice( sliceInfo );
+    if ( ! rawView ) {
+        return false;
+    }
+    data.clear();
+    decode( rawView, data );
+    return true;
+}
+
+void
+PlaneCache::removeImage( const QString & imageKey )
+{
+    QSet < QString > keys;
+    {
+        QMutexLocker locker( & m_keysMutex );
+        keys = m_keys.take( imageKey );
+    }
+    for ( const QString & key : keys ) {
+        m_planes.remove( key );
+    }
+}
+}
+}
@@ -0,0 +1,84 @@
+/// Cache of decoded image data.
+///
+/// Reading pixels through an image plugin can be expensive (disk I/O, type conversions),
+/// and the same plane is typically read many times: once for the clips, once for every
+/// render after a colormap/gamma/transform change, once for the histogram, etc.
+/// The PlaneCache decodes a slice of an image once into a contiguous array of floats,
+/// and then hands out FloatRawView-s into that array.
+///
+/// The cache is registered with the CacheRegistry, so it shares the global memory budget.
+
+#pragma once
+
+#include "CartaLib/CacheRegistry.h"
+#include "CartaLib/FloatRawView.h"
+#include <QSet>
+
+namespace Carta
+{
+namespace Lib
+{
+class PlaneCache
+{
+    CLASS_BOILERPLATE( PlaneCache );
+
+public:
+
+    /// the cache
+    static PlaneCache &
+    instance();
+
+    /// return a view of the given slice of an image, decoding it if it's not cached
+    /// \param imageKey identifies the image instance, it must not be reused for a different
+    /// image before removeImage() is called
+    /// \param image the image to read from on cache miss
+    /// \param sliceInfo which part of the image
+    /// \return new view owned by the caller, or nullptr if the image can't provide the slice
+    /// \note slices too big for the cache are not decoded, the view reads the image
+    /// itself, holding the decode lock while doing so
+    /// \note can be called from any thread, decoding is done by one thread at a time
+    /// because image plugins can't be read from several threads at once
+    /// \note images that cache their own pixels (ImageInterface::cachesPixels()) are
+    /// neither cached nor locked, the view comes straight from the image
+    NdArray::RawViewInterface *
+    getDataSlice( const QString & imageKey,
+                  Image::ImageInterface & image,
+                  const SliceND & sliceInfo );
+
+    /// decode a slice of an image without caching it, e.g. to stream through a whole cube
+    /// \param image the image to read from
+    /// \param sliceInfo which part of the image
+    /// \param data the pixels of the slice, first axis varies fastest
+    /// \return false if the image can't provide the slice
+    /// \note reading is serialized with the decoding done by getDataSlice()
+    bool
+    readSlice( Image::ImageInterface & image,
+               const SliceND & sliceInfo,
+               std::vector < float > & data );
+
+    /// discard all cached data of an image
+    void
+    removeImage( const QString & imageKey );
+
+private:
+
+    PlaneCache();
+
+    /// decoded slice
+    struct Plane {
+        NdArray::FloatRawView::DataPtr data;
+        NdArray::RawViewInterface::VI dims;
+    };
+
+    LruCache < QString, Plane > m_planes;
+
+    /// cache keys used for each image
+    QHash < QString, QSet < QString > > m_keys;
+    QMutex m_keysMutex;
+
+    /// serializes reading of the images, recursive because streaming views hold it
+    /// while calling back into the caller
+    QMutex m_decodeMutex;
+};
+}
+}
@@ -4,6 +4,7 @@
 
 #include "ICoordSystem.h"
 #include "CoordinateSystemFormatter.h"
+#include <limits>
 
 namespace Carta
 {
@@ -57,6 +58,48 @@ BasicCoordinateSystemInfo::BasicCoordinateSystemInfo( int dims, WcsType type, Wc
     m_wcsSubType = subType;
 }
 
+namespace
+{
+/// converts n points one by one with the single point version of a conversion
+template < typename Convert >
+bool
+convertEach( const double * pts, double * result, int64_t n, int srcDim, int dstDim,
+             Convert convert )
+{
+    PointN in( srcDim ), out;
+    bool allValid = true;
+    for ( int64_t i = 0 ; i < n ; i++ ) {
+        in.assign( pts + i * srcDim, pts + ( i + 1 ) * srcDim );
+        bool valid = convert( in, out ) && int ( out.size() ) >= dstDim;
+        for ( int k = 0 ; k < dstDim ; k++ ) {
+            result[i * dstDim + k] = valid ? out[k] : std::numeric_limits < double >::quiet_NaN();
+        }
+        allValid = allValid && valid;
+    }
+    return allValid;
+}
+}
+
+bool
+ICoordSystemConverter::src2dst( const double * pts, double * result, int64_t n )
+{
+    return convertEach( pts, result, n, srcCS().ndim(), dstCS().ndim(),
+                        [this] ( const PointN & in, PointN & out ) {
+                            return src2dst( in, out );
+                        }
+                        );
+}
+
+bool
+ICoordSystemConverter::dst2src( const double * pts, double * result, int64_t n )
+{
+    return convertEach( pts, result, n, dstCS().ndim(), srcCS().ndim(),
+                        [this] ( const PointN & in, PointN & out ) {
+                            return dst2src( in, out );
+                        }
+                        );
+}
+
 ICoordSystemConverter::UniquePtr
 makePixelIdentityConverter( int ndim )
 {
@@ -4,6 +4,7 @@
 
 #include "CartaLib/CartaLib.h"
 #include <QString>
+#include <algorithm>
 
 #pragma once
 
@@ -171,6 +172,23 @@ public:
     virtual bool
     dst2src( const PointN & pt, PointN & result ) = 0;
 
+    /// convert n points given in source coordinate system to destination CS in one go,
+    /// which amortizes the per point overhead of src2dst()
+    /// \param pts input points, srcCS().ndim() values each, stored one after another
+    /// \param result resulting points, dstCS().ndim() values each
+    /// \param n number of points
+    /// \return false if any of the points could not be converted (those are set to NaN)
+    /// \note default implementation converts the points one by one; subclasses that only
+    /// override the single point versions need 'using ICoordSystemConverter::src2dst'
+    /// to keep this one visible
+    virtual bool
+    src2dst( const double * pts, double * result, int64_t n );
+
+    /// convert n points given in destination coordinate system to source CS in one go,
+    /// see the batched src2dst() for the details
+    virtual bool
+    dst2src( const double * pts, double * result, int64_t n );
+
     /// return a map of axes in src to dst
     /// for example, a standard RA,DEC,FREQ,STOKES polarization cube would return
     /// [ 0, 1, 2, 3]
@@ -214,6 +232,20 @@ public:
         return true;
     }
 
+    virtual bool
+    src2dst( const double * pts, double * result, int64_t n ) override
+    {
+        std::copy( pts, pts + n * m_srcCS.ndim(), result );
+        return true;
+    }
+
+    virtual bool
+    dst2src( const double * pts, double * result, int64_t n ) override
+    {
+        std::copy( pts, pts + n * m_dstCS.ndim(), result );
+        return true;
+    }
+
     virtual const CompositeCoordinateSystem &
     srcCS() override
     {
@@ -378,6 +410,10 @@ public:
 
     DefaultCoordSystemConverter( int ndim );
 
+    // don't hide the batched versions
+    using ICoordSystemConverter::src2dst;
+    using ICoordSystemConverter::dst2src;
+
     virtual bool
     src2dst( const PointN & src, PointN & dst ) override;
 
@@ -6,6 +6,8 @@
 
 #include <QFile>
 #include <QJsonDocument>
+#include <algorithm>
+#include <limits>
 
 namespace Carta
 {
@@ -60,6 +62,136 @@ fromJson( QJsonObject json, RegionBase * parent )
     return nullptr;
 } // fromJson
 
+namespace
+{
+/// squared distance from the point to the closest point of the rectangle
+double
+distanceSq( const QRectF & rect, const QPointF & pt )
+{
+    QRectF r = rect.normalized();
+    double dx = std::max( { r.left() - pt.x(), 0.0, pt.x() - r.right() } );
+    double dy = std::max( { r.top() - pt.y(), 0.0, pt.y() - r.bottom() } );
+    return dx * dx + dy * dy;
+}
+}
+
+void
+RegionBase::buildKidIndex()
+{
+    if ( m_kidIndexBuilt ) {
+        return;
+    }
+    m_kidIndexBuilt = true;
+    for ( size_t i = 0 ; i < m_kids.size() ; i++ ) {
+        indexKid( i );
+    }
+}
+
+void
+RegionBase::indexKid( size_t i )
+{
+    RegionBase * kid = m_kids[i];
+
+    // remove the old entry
+    if ( kid-> m_indexedCS >= 0 ) {
+        m_kidIndex[kid-> m_indexedCS].remove( i );
+    }
+    else {
+        m_unindexedKids.erase( i );
+    }
+
+    // the outline box of a group can mix coordinate systems of its kids, so groups
+    // are not indexed
+    QRectF box;
+    if ( ! kid-> canHaveChildren() ) {
+        box = kid-> outlineBox();
+    }
+    if ( box.isNull() ) {
+        m_unindexedKids.insert( i );
+        kid-> m_indexedCS = - 1;
+    }
+    else {
+        m_kidIndex[kid-> csId()].insert( i, box );
+        kid-> m_indexedCS = kid-> csId();
+    }
+} // indexKid
+
+std::vector < size_t >
+RegionBase::kidCandidates( const RegionPointV & pts )
+{
+    buildKidIndex();
+    std::vector < size_t > result( m_unindexedKids.begin(), m_unindexedKids.end() );
+    for ( const auto & entry : m_kidIndex ) {
+        if ( entry.first < 0 || entry.first >= int ( pts.size() ) ) {
+            continue;
+        }
+        std::vector < size_t > found = entry.second.query( pts[entry.first] );
+        result.insert( result.end(), found.begin(), found.end() );
+    }
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+std::vector < RegionBase * >
+RegionBase::childrenAt( const RegionPointV & pts )
+{
+    std::vector < RegionBase * > result;
+    for ( size_t i : kidCandidates( pts ) ) {
+        if ( m_kids[i]-> isPointInsideUnion( pts ) ) {
+            result.push_back( m_kids[i] );
+        }
+    }
+    return result;
+}
+
+std::vector < RegionBase * >
+RegionBase::childrenIntersecting( const QRectF & rect, int cs )
+{
+    buildKidIndex();
+    std::vector < size_t > found;
+    auto tree = m_kidIndex.find( cs );
+    if ( tree != m_kidIndex.end() ) {
+        found = tree-> second.query( rect );
+    }
+    for ( size_t i : m_unindexedKids ) {
+        if ( m_kids[i]-> outlineBox().intersects( rect ) ) {
+            found.push_back( i );
+        }
+    }
+    std::sort( found.begin(), found.end() );
+    std::vector < RegionBase * > result;
+    for ( size_t i : found ) {
+        result.push_back( m_kids[i] );
+    }
+    return result;
+} // childrenIntersecting
+
+RegionBase *
+RegionBase::nearestChild( const RegionPoint & pt, int cs )
+{
+    buildKidIndex();
+    RegionBase * result = nullptr;
+    double bestDistSq = std::numeric_limits < double >::infinity();
+    auto tree = m_kidIndex.find( cs );
+    size_t i = 0;
+    if ( tree != m_kidIndex.end() && tree-> second.nearest( pt, i ) ) {
+        result = m_kids[i];
+        bestDistSq = distanceSq( result-> outlineBox(), pt );
+    }
+    for ( size_t j : m_unindexedKids ) {
+        QRectF box = m_kids[j]-> outlineBox();
+        if ( box.isNull() || m_kids[j]-> csId() != cs ) {
+            continue;
+        }
+        double distSq = distanceSq( box, pt );
+        if ( distSq < bestDistSq ) {
+            result = m_kids[j];
+            bestDistSq = distSq;
+        }
+    }
+    return result;
+} // nearestChild
+
 void
 test1( QString inputFname, QString outputFname )
 {
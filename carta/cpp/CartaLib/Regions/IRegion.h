@@ -8,10 +8,13 @@
 #include "CartaLib/VectorGraphics/VGList.h"
 #include "CartaLib/Nullable.h"
 #include "CartaLib/Regions/ICoordSystem.h"
+#include "CartaLib/Regions/RTree.h"
 
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QRectF>
+#include <map>
+#include <set>
 
 namespace Carta
 {
@@ -132,10 +135,12 @@ public:
             qCritical() << "Cannot add kids to this region.";
             return;
         }
+        region-> m_indexInParent = m_kids.size();
         m_kids.push_back( region );
         region-> setParent( this );
 
 //        region-> m_parent = this;
+        kidGeometryChanged( region );
     }
 
     /// return a list of all children
@@ -157,6 +162,7 @@ public:
     setCoordSystem( int cs )
     {
         m_coordinateSystemID = cs;
+        geometryChanged();
     }
 
     /// initializes the object from json
@@ -231,9 +237,10 @@ public:
     isPointInsideUnion( const RegionPointV & pts )
     {
         if ( canHaveChildren() ) {
-            // for group regions we delegate to kids
-            for ( auto & kid : children() ) {
-                if ( kid-> isPointInsideUnion( pts ) ) { return true; }
+            // for group regions we delegate to kids, but only those that could contain
+            // the point
+            for ( size_t i : kidCandidates( pts ) ) {
+                if ( m_kids[i]-> isPointInsideUnion( pts ) ) { return true; }
             }
             return false;
         }
@@ -281,6 +288,25 @@ public:
         return { outlineBox() };
     }
 
+    /// returns the kids that contain the point (as in isPointInsideUnion()), in the
+    /// order in which they were added
+    ///
+    /// This and the other kid queries below use a spatial index of the kids' outline
+    /// boxes, so they only test the kids near the point. Kids that can have children
+    /// of their own are not indexed and are always tested.
+    std::vector < RegionBase * >
+    childrenAt( const RegionPointV & pts );
+
+    /// returns the kids whose outline boxes intersect the rectangle, which is given in
+    /// coordinate system cs, in the order in which they were added
+    std::vector < RegionBase * >
+    childrenIntersecting( const QRectF & rect, int cs = 0 );
+
+    /// returns the kid whose outline box is the closest to the point, which is given in
+    /// coordinate system cs, or nullptr if there are no kids in that coordinate system
+    RegionBase *
+    nearestChild( const RegionPoint & pt, int cs = 0 );
+
     RegionBase *
     parent() { return m_parent; }
 
@@ -392,8 +418,40 @@ protected:
         m_parent = parent;
     }
 
+    /// has to be called whenever the outline box or coordinate system of this region
+    /// changes, so that the parent can update its index of kids
+    void
+    geometryChanged()
+    {
+        if ( m_parent ) {
+            m_parent-> kidGeometryChanged( this );
+        }
+    }
+
+    /// indices of the kids that could contain the point, in increasing order
+    std::vector < size_t >
+    kidCandidates( const RegionPointV & pts );
+
 private:
 
+    /// updates the index entry of the kid, our own outline box changed as well
+    void
+    kidGeometryChanged( RegionBase * kid )
+    {
+        if ( m_kidIndexBuilt ) {
+            indexKid( kid-> m_indexInParent );
+        }
+        geometryChanged();
+    }
+
+    /// builds the index of kids if it was not built yet
+    void
+    buildKidIndex();
+
+    /// (re)inserts kid i into the index
+    void
+    indexKid( size_t i );
+
     RegionBase * m_parent = nullptr;
     Nullable < QColor > m_lineColor;
     Nullable < QColor > m_fillColor;
@@ -401,6 +459,20 @@ private:
     std::vector < RegionBase * > m_kids;
 
     int m_coordinateSystemID = 0;
+
+    /// outline boxes of the kids, one tree per coordinate system, built when first
+    /// needed and then kept up to date as the kids change
+    std::map < int, RTree < size_t > > m_kidIndex;
+
+    /// kids that are not in m_kidIndex (groups and kids without an outline box)
+    std::set < size_t > m_unindexedKids;
+    bool m_kidIndexBuilt = false;
+
+    /// our position in parent's list of kids
+    size_t m_indexInParent = 0;
+
+    /// the coordinate system under which the parent indexed us, or -1 if it did not
+    int m_indexedCS = - 1;
 };
 
 class Circle : public RegionBase
@@ -485,6 +557,7 @@ public:
         if ( ! obj["radius"].isDouble() ) { return false; }
         m_center = QPointF( obj["centerx"].toDouble(), obj["centery"].toDouble() );
         m_radius = obj["radius"].toDouble();
+        geometryChanged();
         return true;
     }
 
@@ -495,13 +568,18 @@ public:
     setCenter( const RegionPoint & pt )
     {
         m_center = pt;
+        geometryChanged();
     }
 
     double
     radius() const { return m_radius; }
 
     void
-    setRadius( double radius ) { m_radius = radius; }
+    setRadius( double radius )
+    {
+        m_radius = radius;
+        geometryChanged();
+    }
 
 private:
 
@@ -591,6 +669,7 @@ public:
             double y = o["y"].toDouble();
             m_qpolyf.append( QPointF( x, y ) );
         }
+        geometryChanged();
         return true;
     }
 
@@ -598,7 +677,11 @@ public:
     qpolyf() const { return m_qpolyf; }
 
     void
-    setqpolyf( const QPolygonF & poly ) { m_qpolyf = poly; }
+    setqpolyf( const QPolygonF & poly )
+    {
+        m_qpolyf = poly;
+        geometryChanged();
+    }
 
 private:
 
@@ -621,9 +704,10 @@ public:
     virtual bool
     isPointInside( const RegionPointV & pts ) override
     {
-        // return true if the point is inside any of the kids
-        for ( auto & kid : children() ) {
-            if ( kid-> isPointInside( pts ) ) { return true; }
+        // return true if the point is inside any of the kids (that could contain it)
+        const auto & kids = children();
+        for ( size_t i : kidCandidates( pts ) ) {
+            if ( kids[i]-> isPointInside( pts ) ) { return true; }
         }
 
         // otherwise it's not inside
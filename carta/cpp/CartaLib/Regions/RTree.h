@@ -0,0 +1,517 @@
+/**
+ *
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+
+#include <QPointF>
+#include <QRectF>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Regions
+{
+/// R-tree (Guttman, quadratic split) indexing items by their bounding boxes.
+///
+/// Items are identified by Id, which must be usable as a std::map key (e.g. a pointer
+/// or an integer). The tree is maintained incrementally: insert(), remove() and update()
+/// touch only the path from the root to the item's leaf, so keeping the index in sync
+/// with moving shapes is cheap. Point, rectangle and nearest item queries visit only
+/// the nodes whose boxes are relevant, i.e. O(log N) nodes for well spread out items.
+///
+/// Boxes are closed, i.e. a point on the edge of a box is inside it, and boxes with
+/// zero width or height are allowed.
+template < typename Id >
+class RTree
+{
+    CLASS_BOILERPLATE( RTree );
+
+public:
+
+    RTree()
+    {
+        clear();
+    }
+
+    /// remove all items
+    void
+    clear()
+    {
+        m_root.reset( new Node( 0 ) );
+        m_boxes.clear();
+    }
+
+    /// number of items in the tree
+    size_t
+    size() const
+    {
+        return m_boxes.size();
+    }
+
+    /// is the item in the tree
+    bool
+    contains( const Id & id ) const
+    {
+        return m_boxes.find( id ) != m_boxes.end();
+    }
+
+    /// insert an item, or update its box if it is already in the tree
+    void
+    insert( const Id & id, const QRectF & box )
+    {
+        if ( contains( id ) ) {
+            remove( id );
+        }
+        Box b = Box::fromRect( box );
+        m_boxes[id] = b;
+        Entry entry;
+        entry.box = b;
+        entry.id = id;
+        insertEntry( std::move( entry ) );
+    }
+
+    /// remove an item
+    /// \return false if the item was not in the tree
+    bool
+    remove( const Id & id )
+    {
+        auto it = m_boxes.find( id );
+        if ( it == m_boxes.end() ) {
+            return false;
+        }
+        Node * leaf = findLeaf( m_root.get(), id, it-> second );
+        m_boxes.erase( it );
+        CARTA_ASSERT( leaf );
+        if ( ! leaf ) {
+            return false;
+        }
+        for ( auto e = leaf-> entries.begin() ; e != leaf-> entries.end() ; ++e ) {
+            if ( e-> id == id ) {
+                leaf-> entries.erase( e );
+                break;
+            }
+        }
+        condense( leaf );
+        return true;
+    } // remove
+
+    /// move an item to a new box (same as insert)
+    void
+    update( const Id & id, const QRectF & box )
+    {
+        insert( id, box );
+    }
+
+    /// bounding box of all items, or a null rectangle if the tree is empty
+    QRectF
+    bounds() const
+    {
+        if ( m_root-> entries.empty() ) {
+            return QRectF();
+        }
+        return boundsOf( * m_root ).toRect();
+    }
+
+    /// items whose boxes contain the point
+    std::vector < Id >
+    query( const QPointF & pt ) const
+    {
+        return query( QRectF( pt, pt ) );
+    }
+
+    /// items whose boxes intersect the rectangle
+    std::vector < Id >
+    query( const QRectF & rect ) const
+    {
+        std::vector < Id > result;
+        Box box = Box::fromRect( rect );
+        std::vector < const Node * > stack { m_root.get() };
+        while ( ! stack.empty() ) {
+            const Node * node = stack.back();
+            stack.pop_back();
+            for ( const Entry & e : node-> entries ) {
+                if ( ! e.box.intersects( box ) ) {
+                    continue;
+                }
+                if ( node-> isLeaf() ) {
+                    result.push_back( e.id );
+                }
+                else {
+                    stack.push_back( e.child.get() );
+                }
+            }
+        }
+        return result;
+    } // query
+
+    /// item whose box is the closest to the point (distance is 0 for boxes containing it)
+    /// \param pt the point
+    /// \param id where the item is stored
+    /// \return false if the tree is empty
+    bool
+    nearest( const QPointF & pt, Id & id ) const
+    {
+        // best first search, boxes closer to the point are visited first, so the first
+        // item we pop from the queue is the closest one
+        typedef std::pair < double, const Entry * > Candidate;
+        auto farther = [] ( const Candidate & a, const Candidate & b ) {
+            return a.first > b.first;
+        };
+        std::priority_queue < Candidate, std::vector < Candidate >, decltype( farther ) >
+        queue( farther );
+        for ( const Entry & e : m_root-> entries ) {
+            queue.push( Candidate( e.box.distanceSq( pt ), & e ) );
+        }
+        while ( ! queue.empty() ) {
+            const Entry * e = queue.top().second;
+            queue.pop();
+            if ( ! e-> child ) {
+                id = e-> id;
+                return true;
+            }
+            for ( const Entry & ce : e-> child-> entries ) {
+                queue.push( Candidate( ce.box.distanceSq( pt ), & ce ) );
+            }
+        }
+        return false;
+    } // nearest
+
+private:
+
+    /// closed box, unlike QRectF this does not treat empty rectangles specially
+    struct Box {
+        double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+
+        static Box
+        fromRect( const QRectF & rect )
+        {
+            QRectF r = rect.normalized();
+            Box b;
+            b.x1 = r.left();
+            b.y1 = r.top();
+            b.x2 = r.right();
+            b.y2 = r.bottom();
+            return b;
+        }
+
+        QRectF
+        toRect() const
+        {
+            return QRectF( QPointF( x1, y1 ), QPointF( x2, y2 ) );
+        }
+
+        double
+        area() const
+        {
+            return ( x2 - x1 ) * ( y2 - y1 );
+        }
+
+        Box
+        united( const Box & b ) const
+        {
+            Box r;
+            r.x1 = std::min( x1, b.x1 );
+            r.y1 = std::min( y1, b.y1 );
+            r.x2 = std::max( x2, b.x2 );
+            r.y2 = std::max( y2, b.y2 );
+            return r;
+        }
+
+        bool
+        intersects( const Box & b ) const
+        {
+            return x1 <= b.x2 && b.x1 <= x2 && y1 <= b.y2 && b.y1 <= y2;
+        }
+
+        bool
+        contains( const Box & b ) const
+        {
+            return x1 <= b.x1 && b.x2 <= x2 && y1 <= b.y1 && b.y2 <= y2;
+        }
+
+        double
+        distanceSq( const QPointF & pt ) const
+        {
+            double dx = std::max( { x1 - pt.x(), 0.0, pt.x() - x2 } );
+            double dy = std::max( { y1 - pt.y(), 0.0, pt.y() - y2 } );
+            return dx * dx + dy * dy;
+        }
+    };
+
+    struct Node;
+
+    /// entry of a node, either an item (in leaves) or a child node
+    struct Entry {
+        Box box;
+        std::unique_ptr < Node > child;
+        Id id = Id();
+    };
+
+    struct Node {
+        Node( int lvl ) : level( lvl ) { }
+
+        bool
+        isLeaf() const { return level == 0; }
+
+        /// 0 for leaves, 1 for their parents, etc.
+        int level;
+        Node * parent = nullptr;
+        std::vector < Entry > entries;
+    };
+
+    static constexpr size_t MAX_ENTRIES = 16;
+    static constexpr size_t MIN_ENTRIES = 6;
+
+    static Box
+    boundsOf( const Node & node )
+    {
+        CARTA_ASSERT( ! node.entries.empty() );
+        Box b = node.entries[0].box;
+        for ( size_t i = 1 ; i < node.entries.size() ; i++ ) {
+            b = b.united( node.entries[i].box );
+        }
+        return b;
+    }
+
+    /// the entry of parent pointing to node
+    static Entry &
+    entryOf( Node * parent, const Node * node )
+    {
+        for ( Entry & e : parent-> entries ) {
+            if ( e.child.get() == node ) {
+                return e;
+            }
+        }
+        CARTA_ASSERT( false );
+        return parent-> entries[0];
+    }
+
+    /// insert an item entry into the leaf that needs the least enlargement
+    void
+    insertEntry( Entry && entry )
+    {
+        Node * node = m_root.get();
+        while ( ! node-> isLeaf() ) {
+            Entry * best = nullptr;
+            double bestGrowth = 0, bestArea = 0;
+            for ( Entry & e : node-> entries ) {
+                double area = e.box.area();
+                double growth = e.box.united( entry.box ).area() - area;
+                if ( ! best || growth < bestGrowth || ( growth == bestGrowth && area < bestArea ) ) {
+                    best = & e;
+                    bestGrowth = growth;
+                    bestArea = area;
+                }
+            }
+            node = best-> child.get();
+        }
+        node-> entries.push_back( std::move( entry ) );
+        adjust( node );
+    }
+
+    /// fix up the boxes on the path from node to the root, splitting overfull nodes
+    void
+    adjust( Node * node )
+    {
+        while ( true ) {
+            std::unique_ptr < Node > sibling;
+            if ( node-> entries.size() > MAX_ENTRIES ) {
+                sibling = split( node );
+            }
+            Node * parent = node-> parent;
+            if ( ! parent ) {
+                if ( sibling ) {
+                    // grow the tree by one level
+                    std::unique_ptr < Node > root( new Node( node-> level + 1 ) );
+                    Entry e1, e2;
+                    e1.box = boundsOf( * node );
+                    e2.box = boundsOf( * sibling );
+                    node-> parent = root.get();
+                    sibling-> parent = root.get();
+                    e1.child = std::move( m_root );
+                    e2.child = std::move( sibling );
+                    root-> entries.push_back( std::move( e1 ) );
+                    root-> entries.push_back( std::move( e2 ) );
+                    m_root = std::move( root );
+                }
+                return;
+            }
+            entryOf( parent, node ).box = boundsOf( * node );
+            if ( sibling ) {
+                Entry e;
+                e.box = boundsOf( * sibling );
+                sibling-> parent = parent;
+                e.child = std::move( sibling );
+                parent-> entries.push_back( std::move( e ) );
+            }
+            node = parent;
+        }
+    } // adjust
+
+    /// quadratic split, moves some of the entries of node into a new sibling
+    std::unique_ptr < Node >
+    split( Node * node )
+    {
+        std::vector < Entry > all;
+        all.swap( node-> entries );
+        std::unique_ptr < Node > sibling( new Node( node-> level ) );
+
+        // pick the two entries that would waste the most area if put together
+        size_t seed1 = 0, seed2 = 1;
+        double worst = - std::numeric_limits < double >::infinity();
+        for ( size_t i = 0 ; i < all.size() ; i++ ) {
+            for ( size_t j = i + 1 ; j < all.size() ; j++ ) {
+                double waste = all[i].box.united( all[j].box ).area()
+                               - all[i].box.area() - all[j].box.area();
+                if ( waste > worst ) {
+                    worst = waste;
+                    seed1 = i;
+                    seed2 = j;
+                }
+            }
+        }
+        Box box1 = all[seed1].box, box2 = all[seed2].box;
+        node-> entries.push_back( std::move( all[seed1] ) );
+        sibling-> entries.push_back( std::move( all[seed2] ) );
+        all.erase( all.begin() + seed2 );
+        all.erase( all.begin() + seed1 );
+
+        // distribute the rest, most decisive entries first
+        while ( ! all.empty() ) {
+            // make sure both nodes end up with at least MIN_ENTRIES
+            if ( node-> entries.size() + all.size() <= MIN_ENTRIES ||
+                 sibling-> entries.size() + all.size() <= MIN_ENTRIES ) {
+                Node * target = node-> entries.size() < sibling-> entries.size()
+                                ? node : sibling.get();
+                for ( Entry & e : all ) {
+                    target-> entries.push_back( std::move( e ) );
+                }
+                break;
+            }
+            size_t pick = 0;
+            double bestDiff = - 1, grow1 = 0, grow2 = 0;
+            for ( size_t i = 0 ; i < all.size() ; i++ ) {
+                double g1 = box1.united( all[i].box ).area() - box1.area();
+                double g2 = box2.united( all[i].box ).area() - box2.area();
+                if ( std::abs( g1 - g2 ) > bestDiff ) {
+                    bestDiff = std::abs( g1 - g2 );
+                    pick = i;
+                    grow1 = g1;
+                    grow2 = g2;
+                }
+            }
+            bool toFirst = grow1 < grow2 || ( grow1 == grow2 &&
+                                              node-> entries.size() <= sibling-> entries.size() );
+            if ( toFirst ) {
+                box1 = box1.united( all[pick].box );
+                node-> entries.push_back( std::move( all[pick] ) );
+            }
+            else {
+                box2 = box2.united( all[pick].box );
+                sibling-> entries.push_back( std::move( all[pick] ) );
+            }
+            all.erase( all.begin() + pick );
+        }
+
+        for ( Entry & e : sibling-> entries ) {
+            if ( e.child ) {
+                e.child-> parent = sibling.get();
+            }
+        }
+        return sibling;
+    } // split
+
+    /// find the leaf containing the item
+    Node *
+    findLeaf( Node * node, const Id & id, const Box & box ) const
+    {
+        for ( Entry & e : node-> entries ) {
+            if ( node-> isLeaf() ) {
+                if ( e.id == id ) {
+                    return node;
+                }
+            }
+            else if ( e.box.contains( box ) ) {
+                Node * leaf = findLeaf( e.child.get(), id, box );
+                if ( leaf ) {
+                    return leaf;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /// move all items under node to items
+    static void
+    takeItems( Node & node, std::vector < Entry > & items )
+    {
+        for ( Entry & e : node.entries ) {
+            if ( node.isLeaf() ) {
+                items.push_back( std::move( e ) );
+            }
+            else {
+                takeItems( * e.child, items );
+            }
+        }
+        node.entries.clear();
+    }
+
+    /// after removing an item from leaf, dissolve underfull nodes on the path to the
+    /// root, reinserting their items, and shorten the tree if possible
+    void
+    condense( Node * leaf )
+    {
+        std::vector < Entry > orphans;
+        Node * node = leaf;
+        while ( node-> parent ) {
+            Node * parent = node-> parent;
+            if ( node-> entries.size() < MIN_ENTRIES ) {
+                takeItems( * node, orphans );
+                for ( auto e = parent-> entries.begin() ; e != parent-> entries.end() ; ++e ) {
+                    if ( e-> child.get() == node ) {
+                        parent-> entries.erase( e );
+                        break;
+                    }
+                }
+            }
+            else {
+                entryOf( parent, node ).box = boundsOf( * node );
+            }
+            node = parent;
+        }
+
+        while ( ! m_root-> isLeaf() && m_root-> entries.size() <= 1 ) {
+            if ( m_root-> entries.empty() ) {
+                m_root.reset( new Node( 0 ) );
+            }
+            else {
+                std::unique_ptr < Node > child = std::move( m_root-> entries[0].child );
+                child-> parent = nullptr;
+                m_root = std::move( child );
+            }
+        }
+
+        for ( Entry & e : orphans ) {
+            insertEntry( std::move( e ) );
+        }
+    } // condense
+
+    std::unique_ptr < Node > m_root;
+
+    /// box of each item, needed to find its leaf when removing it
+    std::map < Id, Box > m_boxes;
+};
+}
+}
+}
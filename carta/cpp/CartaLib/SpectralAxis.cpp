@@ -0,0 +1,115 @@
+#include "SpectralAxis.h"
+#include <QDebug>
+#include <algorithm>
+#include <memory>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace SpectralAxis
+{
+int
+find( Image::ImageInterface & image )
+{
+    auto meta = image.metaData();
+    if ( ! meta ) {
+        return - 1;
+    }
+    auto cf = meta-> coordinateFormatter();
+    int nAxes = std::min < int > ( cf-> nAxes(), image.dims().size() );
+    for ( int axis = 0 ; axis < nAxes ; axis++ ) {
+        if ( cf-> axisInfo( axis ).knownType() == AxisInfo::KnownType::SPECTRAL ) {
+            return axis;
+        }
+    }
+    return - 1;
+}
+
+double
+hzPerUnit( const QString & unit )
+{
+    if ( unit == "Hz" ) {
+        return 1;
+    }
+    if ( unit == "kHz" ) {
+        return 1e3;
+    }
+    if ( unit == "MHz" ) {
+        return 1e6;
+    }
+    if ( unit == "GHz" ) {
+        return 1e9;
+    }
+    return 0;
+}
+
+std::vector < double >
+channelValues( Image::ImageInterface & image, int axis, QString * unit )
+{
+    int nChannels = axis >= 0 && axis < int( image.dims().size() ) ? image.dims()[axis] : 1;
+    std::vector < double > values( nChannels );
+    for ( int c = 0 ; c < nChannels ; c++ ) {
+        values[c] = c;
+    }
+    unit-> clear();
+
+    auto meta = image.metaData();
+    if ( ! meta || axis < 0 ) {
+        return values;
+    }
+
+    // our own copy, the formatter of the image is used by the gui thread
+    std::unique_ptr < CoordinateFormatterInterface > cf( meta-> coordinateFormatter()-> clone() );
+    int nAxes = cf-> nAxes();
+    if ( axis >= nAxes || cf-> axisInfo( axis ).knownType() != AxisInfo::KnownType::SPECTRAL ) {
+        return values;
+    }
+
+    // convert the pixel positions of all channels at once
+    std::vector < double > pixel( int64_t( nChannels ) * nAxes, 0 );
+    std::vector < double > world( pixel.size(), 0 );
+    for ( int c = 0 ; c < nChannels ; c++ ) {
+        pixel[int64_t( c ) * nAxes + axis] = c;
+    }
+    if ( ! cf-> toWorld( pixel.data(), world.data(), nChannels ) ) {
+        qWarning() << "Could not compute the spectral coordinates, using channels";
+        return values;
+    }
+    for ( int c = 0 ; c < nChannels ; c++ ) {
+        values[c] = world[int64_t( c ) * nAxes + axis];
+    }
+    * unit = cf-> axisInfo( axis ).unit();
+    return values;
+} // channelValues
+
+bool
+channelRange( const std::vector < double > & values,
+              const QString & valueUnit,
+              double min,
+              double max,
+              const QString & rangeUnit,
+              int * minChannel,
+              int * maxChannel )
+{
+    double from = hzPerUnit( rangeUnit );
+    double to = hzPerUnit( valueUnit );
+    if ( from <= 0 || to <= 0 ) {
+        return false;
+    }
+    double lo = std::min( min, max ) * from / to;
+    double hi = std::max( min, max ) * from / to;
+    int last = values.size() - 1;
+    * minChannel = last + 1;
+    * maxChannel = - 1;
+    for ( int c = 0 ; c <= last ; c++ ) {
+        if ( values[c] >= lo && values[c] <= hi ) {
+            * minChannel = std::min( * minChannel, c );
+            * maxChannel = c;
+        }
+    }
+    return true;
+}
+}
+}
+}
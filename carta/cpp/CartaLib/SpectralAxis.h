@@ -0,0 +1,50 @@
+/// Helpers for the spectral axis of an image that only use the generic image interfaces,
+/// e.g. for images that do not come from casacore, like moment maps and derived images.
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include <QString>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace SpectralAxis
+{
+/// index of the spectral axis of an image, -1 if it has none
+int
+find( Image::ImageInterface & image );
+
+/// Hz per unit of frequency, 0 for units that are not frequencies we know
+double
+hzPerUnit( const QString & unit );
+
+/// world coordinates of all the channels along an axis
+/// \param image the image
+/// \param axis the spectral axis
+/// \param unit set to the unit of the coordinates, empty if they are channel indices
+/// \return one coordinate per channel, the channel indices if the axis is not a
+/// spectral axis or its coordinates could not be computed
+std::vector < double >
+channelValues( Image::ImageInterface & image, int axis, QString * unit );
+
+/// channels whose coordinates lie in a range
+/// \param values coordinates of the channels, in valueUnit
+/// \param valueUnit unit of the coordinates
+/// \param min, max the range, in rangeUnit
+/// \param rangeUnit unit of the range
+/// \param minChannel, maxChannel set to the channels in the range, min > max if there are none
+/// \return false if the units can't be converted into each other
+bool
+channelRange( const std::vector < double > & values,
+              const QString & valueUnit,
+              double min,
+              double max,
+              const QString & rangeUnit,
+              int * minChannel,
+              int * maxChannel );
+}
+}
+}
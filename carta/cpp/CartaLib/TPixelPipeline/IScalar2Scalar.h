@@ -1,315 +1,250 @@
 /// \file
 ///
-/// This is just some branstorming ideas I had. Nothing from this file is currently used
-/// anywhere.
+/// Templated pixel pipeline, used by the renderers for the per-pixel work.
+///
+/// The configurable pipeline in PixelPipeline is built from virtual stages and works
+/// in double, which is fine for setting things up, but too slow to call for every pixel.
+/// The classes here are templated over the scalar type (in practice float, as almost all
+/// our images are 32 bit floats), and the stages are composed at compile time, so the
+/// compiler can inline the whole per-pixel path.
+///
+/// A stage is any class with an inline method 'void apply( Scalar & val ) const'.
 
 #pragma once
 
-#ifdef DONT_COMPILE
-
 #include "CartaLib/CartaLib.h"
+#include "CartaLib/PixelPipeline/IPixelPipeline.h"
+#include <QRgb>
+#include <array>
+#include <cmath>
+#include <vector>
 
 namespace Carta
 {
 namespace Lib
 {
 /// same as PixelPipeline but templated
-/// this is more customizable, but I'm not sure how well it would work across
-/// shared library boundaries
 namespace TemplatedPixelPipeline
 {
 /// generic scalar RGB
 template < typename Scalar >
 using ScalarRgb = std::array < Scalar, 3 >;
 
-/// RGB as triplet of doubles in range 0..1
-typedef ScalarRgb < double > DRgb;
-
-/// generic scalar -> scalar (Stage 1) component
+/// stage 0: clamp values to [min..max]
 template < typename Scalar >
-class IScalar2Scalar
+class ClampStage
 {
-    CLASS_BOILERPLATE( IScalar2Scalar );
-
 public:
 
-    virtual void
-    setMinMax( Scalar & min, Scalar & max ) = 0;
-
-    virtual void
-    convert( Scalar & val ) = 0;
-
-    virtual
-    ~IScalar2Scalar() { }
-};
-
-/// interface for implementing stage 3 (normalized scalar -> ScalarRgb)
-/// this is the most generic colormap
-template < typename InputScalar, typename OutputScalar >
-class IScalar2ScalarRgb
-{
-    CLASS_BOILERPLATE( IScalar2ScalarRgb );
+    void
+    setMinMax( Scalar min, Scalar max )
+    {
+        m_min = min;
+        m_max = max;
+    }
 
-public:
+    void
+    apply( Scalar & val ) const
+    {
+        val = Carta::Lib::clamp( val, m_min, m_max );
+    }
 
-    virtual void
-    convert( const InputScalar & val, ScalarRgb < OutputScalar > & result ) = 0;
+private:
 
-    virtual
-    ~IScalar2ScalarRgb() { }
+    Scalar m_min = 0, m_max = 1;
 };
 
-/// primitive gray scale colormap
-template < typename InputScalar, typename OutputScalar >
-class GrayCMap : public IScalar2ScalarRgb < InputScalar, OutputScalar >
+/// stage 2: linear map of [min..max] to [0..scale]
+template < typename Scalar >
+class NormalizeStage
 {
-    CLASS_BOILERPLATE( GrayCMap );
-
 public:
 
-    virtual void
-    convert( const InputScalar & val, ScalarRgb < OutputScalar > & result ) override
+    void
+    setMinMax( Scalar min, Scalar max, Scalar scale = 1 )
     {
-        result.fill( static_cast < OutputScalar > ( val ) );
+        m_min = min;
+        m_factor = scale / ( max - min );
     }
-};
 
-/// interface for implementing stage 4 (ScalarRgb -> ScalarRgb)
-template < typename Scalar >
-class IScalarRgb2ScalarRgb
-{
-    CLASS_BOILERPLATE( IScalarRgb2ScalarRgb );
-
-public:
+    void
+    apply( Scalar & val ) const
+    {
+        val = ( val - m_min ) * m_factor;
+    }
 
-    virtual void
-    convert( ScalarRgb < Scalar > & srgb ) = 0;
+private:
 
-    virtual
-    ~IScalarRgb2ScalarRgb() { }
+    Scalar m_min = 0, m_factor = 1;
 };
 
-/// the minimal interface representing an implemented pipeline
-/// - if we ever wanted to replace the whole pipeline
-template < typename InputScalar, typename OutputScalar >
-class IScalar2ScalarRgbAndQRgb
+/// stages composed at compile time, applied in the order they are listed, e.g.
+///
+///     Chain < float, ClampStage < float >, NormalizeStage < float > > chain;
+///     chain.head().setMinMax( -1, 1 );
+///     chain.tail().head().setMinMax( -1, 1 );
+///     chain.apply( val );
+template < typename Scalar, typename ... Stages >
+class Chain;
+
+/// empty chain, does nothing
+template < typename Scalar >
+class Chain < Scalar >
 {
-    CLASS_BOILERPLATE( IScalar2ScalarRgbAndQRgb );
-
 public:
 
-    virtual void
-    setMinMax( InputScalar min, InputScalar max ) = 0;
-
-    /// do the conversion up to stage 4
-    virtual void
-    convert( InputScalar val, ScalarRgb < OutputScalar > & result ) = 0;
-
-    /// do the conversion including stage 5
-    virtual void
-    convert( InputScalar val, QRgb & result ) = 0;
-
-    virtual
-    ~IScalar2ScalarRgbAndQRgb() { }
+    void
+    apply( Scalar & ) const { }
 };
 
-/// composite function for converting pixels to rgb
-/// can have multiple stage 1 (double->double) functions, and one stage 2 (double->rgb),
-/// followed by multiple rgb2rgb
-template < typename InputScalar, typename OutputScalar >
-class Composite : public IScalar2ScalarRgbAndQRgb < InputScalar, OutputScalar >
+template < typename Scalar, typename Stage, typename ... Rest >
+class Chain < Scalar, Stage, Rest ... > : public Chain < Scalar, Rest ... >
 {
-    CLASS_BOILERPLATE( Composite );
-
 public:
 
-    typedef IScalar2Scalar < InputScalar > Stage1;
-    typedef IScalar2ScalarRgb < InputScalar, OutputScalar > Stage3;
-    typedef IScalarRgb2ScalarRgb < OutputScalar > Stage4;
+    typedef Chain < Scalar, Rest ... > Tail;
 
-    // e.g. log scaling, gamma correction
-    void
-    addStage1( typename Stage1::SharedPtr func )
-    {
-        m_stage1.push_back( func );
-    }
+    /// the first stage
+    Stage &
+    head() { return m_stage; }
 
-    // e.g. colormap
-    void
-    setStage3( typename Stage3::SharedPtr func )
-    {
-        m_stage3 = func;
-    }
+    /// the remaining stages
+    Tail &
+    tail() { return * this; }
 
-    // e.g. invert
     void
-    addStage4( typename Stage4::SharedPtr func )
+    apply( Scalar & val ) const
     {
-        m_stage4.push_back( func );
-    }
-
-    virtual void
-    setMinMax( InputScalar min, InputScalar max ) override
-    {
-        m_min = min;
-        m_max = max;
-        for ( auto & s : m_stage1 ) {
-            s-> setMinMax( m_min, m_max );
-        }
+        m_stage.apply( val );
+        Tail::apply( val );
     }
 
-    virtual void
-    convert( InputScalar p_val, ScalarRgb < OutputScalar > & result ) override
-    {
-        CARTA_ASSERT( ! std::isnan( p_val ) );
-
-        // stage 0: clamp
-        double val = clamp( p_val, m_min, m_max );
-
-        // stage 1: scalar to scalar
-        for ( auto & s : m_stage1 ) {
-            s-> convert( val );
-        }
-
-        // stage 2: normalize
-        val = ( val - m_min ) / ( m_max - m_min );
-
-        // stage 3: scalar -> drgb
-        m_stage3-> convert( val, result );
-
-        // stage 4: drgb -> drgb
-        for ( auto & s : m_stage4 ) {
-            s-> convert( result );
-        }
-    } // convert
-
-    virtual void
-    convert( InputScalar p_val, QRgb & result ) override
-    {
-        CARTA_ASSERT( ! std::isnan( p_val ) );
-
-        ScalarRgb < OutputScalar > drgb;
-        convert( p_val, drgb );
-
-        /// stage 5:
-        result = qRgb( round( drgb[0] * 255 ), round( drgb[1] * 255 ), round( drgb[2] * 255 ) );
-    } // convert
-
-protected:
+private:
 
-    std::vector < typename Stage1::SharedPtr > m_stage1;
-    typename Stage3::SharedPtr m_stage3;
-    std::vector < typename Stage4::SharedPtr > m_stage4;
-
-    InputScalar m_min = 0, m_max = 1; // needed for stage 3 (normalization)
+    Stage m_stage;
 };
 
-/*void
-test2()
+/// Lookup table version of a pixel pipeline.
+///
+/// The (slow) pipeline is evaluated at nSegments points between min and max, and
+/// pixels are then converted by clamping and normalizing them to a table index
+/// (a compile time chain of stages), followed by a table lookup. Colors are stored
+/// as floats, and also as QRgb for the non-interpolated case.
+///
+/// \tparam Scalar type of the pixels
+/// \tparam interpolated whether to interpolate between table entries
+template < typename Scalar, bool interpolated >
+class CachedPipeline
 {
-    Composite < double, float > composite;
-}*/
+    CLASS_BOILERPLATE( CachedPipeline );
 
-/// adapter for implementing double -> double from std::function
-template < typename Scalar >
-class FunctionD2DAdapter : public IScalar2Scalar < Scalar >
-{
 public:
 
-    FunctionD2DAdapter( std::function < Scalar( Scalar ) > func )
-        : m_func( func )
-    { }
-
-    virtual void
-    setMinMax( Scalar & min, Scalar & max ) override
+    /// \brief create a cached version of the supplied function
+    /// \param funcToCache function to cache
+    /// \param nSegments how many segments to create for caching
+    /// \param min minimum value
+    /// \param max maximum value, a range that is empty (e.g. the clips of a constant
+    /// image) is widened to [min..min+1]
+    /// @warning funcToCache should already be prepped with min/max if applicable
+    void
+    cache( PixelPipeline::IPixelPipeline & funcToCache, int64_t nSegments, double min, double max )
     {
-        Q_UNUSED( min );
-        Q_UNUSED( max );
-    }
+        CARTA_ASSERT( nSegments > 1 );
+        if ( ! ( min < max ) ) {
+            max = min + 1;
+        }
+        m_rgb.resize( nSegments );
+        m_qrgb.resize( nSegments );
+        double delta = ( max - min ) / ( nSegments - 1 );
+        for ( int64_t i = 0 ; i < nSegments ; i++ ) {
+            PixelPipeline::NormRgb drgb;
+            funcToCache.convert( min + i * delta, drgb );
+            m_rgb[i] = { { float (drgb[0]), float (drgb[1]), float (drgb[2]) } };
+            PixelPipeline::normRgb2QRgb( drgb, m_qrgb[i] );
+        }
+        m_lastIndex = nSegments - 1;
 
-    virtual void
-    convert( Scalar & val ) override
-    {
-        val = m_func( val );
+        // clamp to [min..max], then map [min..max] to [0..lastIndex]
+        m_toIndex.head().setMinMax( min, max );
+        m_toIndex.tail().head().setMinMax( min, max, m_lastIndex );
     }
 
-protected:
-
-    std::function < Scalar( Scalar ) > m_func;
-};
-
-/*void
-test3()
-{
-    FunctionD2DAdapter < double > adapter([] (double x) { return 1 - x;
-                                          }
-                                          );
-    double x = 7;
-    adapter.convert( x );
-}*/
-
-/// algorithm for caching a double->rgb function
-template < typename InputScalar, typename OutputScalar >
-class CachedD2Rgb : public IScalar2ScalarRgbAndQRgb < InputScalar, OutputScalar >
-{
-    CLASS_BOILERPLATE( CachedD2Rgb );
-
-public:
-
-//    static IScalar2ScalarRgbAndQRgb <  *
-//    create( IScalar2ScalarRgbAndQRgb & funcToCache, int nSegments );
-};
-
-/// default implementation of pixel transfer
-/// basically just applies gray colormap
-template < typename InputScalar, typename OutputScalar >
-class DefaultPipeline : public IScalar2ScalarRgbAndQRgb < InputScalar, OutputScalar >
-{
-public:
-
-    DefaultPipeline()
+    /// convert a pixel to normalized rgb
+    void
+    convert( Scalar x, ScalarRgb < float > & result ) const
     {
-        m_comp = std::make_shared < Comp > ();
-        m_comp-> setStage3( std::make_shared < GrayCMap < InputScalar, OutputScalar > > () );
+        CARTA_ASSERT( ! std::isnan( x ) );
+        m_toIndex.apply( x );
+        if ( ! interpolated ) {
+            result = m_rgb[p_clampIndex( x + Scalar( 0.5 ) )];
+            return;
+        }
+        int64_t ind = p_clampIndex( x );
+        if ( Q_UNLIKELY( ind >= m_lastIndex ) ) {
+            result = m_rgb.back();
+            return;
+        }
+        float frac = x - ind;
+        const ScalarRgb < float > & c1 = m_rgb[ind];
+        const ScalarRgb < float > & c2 = m_rgb[ind + 1];
+        result[0] = c1[0] + ( c2[0] - c1[0] ) * frac;
+        result[1] = c1[1] + ( c2[1] - c1[1] ) * frac;
+        result[2] = c1[2] + ( c2[2] - c1[2] ) * frac;
     }
 
-    virtual void
-    setMinMax( double min, double max )
+    /// convert a pixel to 8 bit rgb
+    void
+    convertq( Scalar x, QRgb & result ) const
     {
-        m_comp-> setMinMax( min, max );
+        if ( ! interpolated ) {
+            CARTA_ASSERT( ! std::isnan( x ) );
+            m_toIndex.apply( x );
+            result = m_qrgb[p_clampIndex( x + Scalar( 0.5 ) )];
+            return;
+        }
+        ScalarRgb < float > rgb;
+        convert( x, rgb );
+        result = qRgb( std::round( rgb[0] * 255 ), std::round( rgb[1] * 255 ),
+                       std::round( rgb[2] * 255 ) );
     }
 
-    virtual void
-    convert( InputScalar val, ScalarRgb < OutputScalar > & result ) override
+    /// convert a run of pixels, NaNs are converted to nanColor
+    void
+    convertRow( const Scalar * in, int64_t count, QRgb * out, QRgb nanColor ) const
     {
-        m_comp-> convert( val, result );
+        for ( int64_t i = 0 ; i < count ; i++ ) {
+            if ( Q_LIKELY( ! std::isnan( in[i] ) ) ) {
+                convertq( in[i], out[i] );
+            }
+            else {
+                out[i] = nanColor;
+            }
+        }
     }
 
-    virtual void
-    convert( InputScalar val, QRgb & result ) override
+private:
+
+    /// table index for a normalized value, the clamp stage already keeps it in range,
+    /// this only guards against rounding at the ends of the table
+    int64_t
+    p_clampIndex( Scalar x ) const
     {
-        m_comp-> convert( val, result );
+        int64_t ind = x;
+        if ( Q_UNLIKELY( ind < 0 ) ) {
+            return 0;
+        }
+        if ( Q_UNLIKELY( ind > m_lastIndex ) ) {
+            return m_lastIndex;
+        }
+        return ind;
     }
 
-protected:
-
-    typedef Composite < InputScalar, OutputScalar > Comp;
-    typename Comp::SharedPtr m_comp;
+    Chain < Scalar, ClampStage < Scalar >, NormalizeStage < Scalar > > m_toIndex;
+    std::vector < ScalarRgb < float > > m_rgb;
+    std::vector < QRgb > m_qrgb;
+    int64_t m_lastIndex = 1;
 };
-
-/*void
-test4()
-{
-    DefaultPipeline < double, double > pipe;
-    pipe.setMinMax( 1.0, 2.0 );
-    ScalarRgb < double > drgb;
-    pipe.convert( 1.4, drgb );
-
-    IScalar2Scalar < int >::SharedPtr ptr;
-    Composite < int, int >::SharedPtr x;
-}*/
 }
 }
 }
-
-#endif
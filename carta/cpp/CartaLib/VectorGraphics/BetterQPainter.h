@@ -108,6 +108,20 @@ public:
         m_qPainter.drawPolygon( poly );
     }
 
+    /// draw a polyline from an array of points
+    void
+    drawPolyline( const QPointF * points, int count )
+    {
+        m_qPainter.drawPolyline( points, count );
+    }
+
+    /// draw a polygon from an array of points
+    void
+    drawPolygon( const QPointF * points, int count )
+    {
+        m_qPainter.drawPolygon( points, count );
+    }
+
 
     /// draw an ellipse
     void
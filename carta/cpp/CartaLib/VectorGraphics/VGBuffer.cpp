@@ -0,0 +1,752 @@
+/**
+ *
+ **/
+
+#include "VGBuffer.h"
+#include "VGList.h"
+#include "BetterQPainter.h"
+
+namespace Carta
+{
+namespace Lib
+{
+namespace VectorGraphics
+{
+namespace
+{
+/// size of the encoded pen/brush (see p_putPen/p_putBrush)
+constexpr size_t PenSize = 4 + 4 + 4;
+constexpr size_t BrushSize = 4 + 1;
+
+/// marks the byte order of the encoding, the arena is stored in host order
+constexpr quint8 HostByteOrder = ( Q_BYTE_ORDER == Q_LITTLE_ENDIAN ) ? 1 : 2;
+
+template < typename T >
+void
+appendRaw( QByteArray & ba, const T & val )
+{
+    ba.append( reinterpret_cast < const char * > ( & val ), sizeof( T ) );
+}
+
+/// sequential reader with bounds checking
+class Reader
+{
+public:
+
+    Reader( const char * ptr, const char * end )
+        : m_ptr( ptr ), m_end( end ) { }
+
+    template < typename T >
+    T
+    get()
+    {
+        T val;
+        if ( ! ensure( sizeof( T ) ) ) {
+            return T();
+        }
+        std::memcpy( & val, m_ptr, sizeof( T ) );
+        m_ptr += sizeof( T );
+        return val;
+    }
+
+    QPointF
+    point()
+    {
+        float x = get < float > ();
+        float y = get < float > ();
+        return QPointF( x, y );
+    }
+
+    QRectF
+    rect()
+    {
+        float x = get < float > ();
+        float y = get < float > ();
+        float w = get < float > ();
+        float h = get < float > ();
+        return QRectF( x, y, w, h );
+    }
+
+    QPen
+    pen()
+    {
+        QRgb color = get < quint32 > ();
+        float width = get < float > ();
+        quint8 style = get < quint8 > ();
+        quint8 cap = get < quint8 > ();
+        quint8 join = get < quint8 > ();
+        quint8 cosmetic = get < quint8 > ();
+        QPen pen( QColor::fromRgba( color ) );
+        pen.setWidthF( width );
+        pen.setStyle( Qt::PenStyle( style ) );
+        pen.setCapStyle( Qt::PenCapStyle( cap ) );
+        pen.setJoinStyle( Qt::PenJoinStyle( join ) );
+        pen.setCosmetic( cosmetic != 0 );
+        return pen;
+    }
+
+    QBrush
+    brush()
+    {
+        QRgb color = get < quint32 > ();
+        quint8 style = get < quint8 > ();
+        return QBrush( QColor::fromRgba( color ), Qt::BrushStyle( style ) );
+    }
+
+    /// reads count points into a reusable buffer
+    void
+    points( size_t count, std::vector < QPointF > & out )
+    {
+        out.resize( count );
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            out[i] = point();
+        }
+    }
+
+    QByteArray
+    bytes( size_t count )
+    {
+        if ( ! ensure( count ) ) {
+            return QByteArray();
+        }
+        QByteArray result( m_ptr, int ( count ) );
+        m_ptr += count;
+        return result;
+    }
+
+    bool
+    ensure( size_t count )
+    {
+        if ( m_ok && size_t( m_end - m_ptr ) >= count ) {
+            return true;
+        }
+        m_ok = false;
+        return false;
+    }
+
+    bool
+    ok() const { return m_ok; }
+
+    const char *
+    ptr() const { return m_ptr; }
+
+private:
+
+    const char * m_ptr;
+    const char * m_end;
+    bool m_ok = true;
+};
+}
+
+VGBuffer
+VGBuffer::fromVGList( const VGList & vgList )
+{
+    VGBuffer buffer;
+    buffer.m_offsets.reserve( vgList.entries().size() );
+    for ( auto & entry : vgList.entries() ) {
+        entry-> appendTo( buffer );
+    }
+    return buffer;
+}
+
+void
+VGBuffer::clear()
+{
+    m_data.clear();
+    m_offsets.clear();
+}
+
+void
+VGBuffer::reserve( size_t nCommands, size_t nBytes )
+{
+    m_offsets.reserve( nCommands );
+    m_data.reserve( nBytes );
+}
+
+bool
+VGBuffer::commandEquals( size_t ind, const VGBuffer & other, size_t otherInd ) const
+{
+    size_t start1 = m_offsets[ind], end1 = p_end( ind );
+    size_t start2 = other.m_offsets[otherInd], end2 = other.p_end( otherInd );
+    if ( end1 - start1 != end2 - start2 ) {
+        return false;
+    }
+    return std::memcmp( m_data.data() + start1, other.m_data.data() + start2,
+                        end1 - start1 ) == 0;
+}
+
+void
+VGBuffer::appendCommands( const VGBuffer & other, size_t first, size_t count )
+{
+    if ( count == 0 ) {
+        return;
+    }
+    CARTA_ASSERT( first + count <= other.size() );
+
+    // the commands are contiguous, so copy them in one go and shift the offsets
+    size_t srcStart = other.m_offsets[first];
+    size_t srcEnd = other.p_end( first + count - 1 );
+    size_t dstStart = m_data.size();
+    m_data.insert( m_data.end(), other.m_data.begin() + srcStart, other.m_data.begin() + srcEnd );
+    for ( size_t i = first ; i < first + count ; ++i ) {
+        m_offsets.push_back( quint32( other.m_offsets[i] - srcStart + dstStart ) );
+    }
+}
+
+void
+VGBuffer::p_putRect( const QRectF & r )
+{
+    p_put < float > ( r.x() );
+    p_put < float > ( r.y() );
+    p_put < float > ( r.width() );
+    p_put < float > ( r.height() );
+}
+
+void
+VGBuffer::p_putPoly( const QPolygonF & poly )
+{
+    p_put < quint32 > ( poly.size() );
+    for ( const QPointF & p : poly ) {
+        p_putPoint( p );
+    }
+}
+
+void
+VGBuffer::p_putPen( const QPen & pen )
+{
+    p_put < quint32 > ( pen.color().rgba() );
+    p_put < float > ( pen.widthF() );
+    p_put < quint8 > ( pen.style() );
+    p_put < quint8 > ( pen.capStyle() );
+    p_put < quint8 > ( pen.joinStyle() );
+    p_put < quint8 > ( pen.isCosmetic() ? 1 : 0 );
+}
+
+void
+VGBuffer::p_putBrush( const QBrush & brush )
+{
+    /// \note only solid/pattern brushes are representable, gradients and textures
+    /// are reduced to their color
+    p_put < quint32 > ( brush.color().rgba() );
+    p_put < quint8 > ( brush.style() );
+}
+
+void
+VGBuffer::reset()
+{
+    p_begin( Op::Reset );
+}
+
+void
+VGBuffer::drawLine( const QPointF & p1, const QPointF & p2 )
+{
+    p_begin( Op::DrawLine );
+    p_putPoint( p1 );
+    p_putPoint( p2 );
+}
+
+void
+VGBuffer::drawPolyline( const QPolygonF & poly )
+{
+    p_begin( Op::DrawPolyline );
+    p_putPoly( poly );
+}
+
+void
+VGBuffer::drawPolygon( const QPolygonF & poly )
+{
+    p_begin( Op::DrawPolygon );
+    p_putPoly( poly );
+}
+
+void
+VGBuffer::setPenWidth( double width )
+{
+    p_begin( Op::SetPenWidth );
+    p_put < float > ( width );
+}
+
+void
+VGBuffer::setPenColor( const QColor & color )
+{
+    p_begin( Op::SetPenColor );
+    p_put < quint32 > ( color.rgba() );
+}
+
+void
+VGBuffer::setPen( const QPen & pen )
+{
+    p_begin( Op::SetPen );
+    p_putPen( pen );
+}
+
+void
+VGBuffer::setFontIndex( int fontIndex )
+{
+    p_begin( Op::SetFontIndex );
+    p_put < qint32 > ( fontIndex );
+}
+
+void
+VGBuffer::setFontSize( double size )
+{
+    p_begin( Op::SetFontSize );
+    p_put < float > ( size );
+}
+
+void
+VGBuffer::save()
+{
+    p_begin( Op::Save );
+}
+
+void
+VGBuffer::restore()
+{
+    p_begin( Op::Restore );
+}
+
+void
+VGBuffer::setTransform( const QTransform & t, bool combine )
+{
+    p_begin( Op::SetTransform );
+    for ( double v : { t.m11(), t.m12(), t.m13(), t.m21(), t.m22(), t.m23(),
+                       t.m31(), t.m32(), t.m33() } ) {
+        p_put < double > ( v );
+    }
+    p_put < quint8 > ( combine ? 1 : 0 );
+}
+
+void
+VGBuffer::fillRect( const QRectF & rect, const QColor & color )
+{
+    p_begin( Op::FillRect );
+    p_putRect( rect );
+    p_put < quint32 > ( color.rgba() );
+}
+
+void
+VGBuffer::drawRect( const QRectF & rect )
+{
+    p_begin( Op::DrawRect );
+    p_putRect( rect );
+}
+
+void
+VGBuffer::drawEllipse( const QRectF & rect )
+{
+    p_begin( Op::DrawEllipse );
+    p_putRect( rect );
+}
+
+void
+VGBuffer::drawText( const QString & text, const QPointF & pos )
+{
+    QByteArray utf8 = text.toUtf8();
+    p_begin( Op::DrawText );
+    p_putPoint( pos );
+    p_put < quint32 > ( utf8.size() );
+    m_data.insert( m_data.end(), utf8.constData(), utf8.constData() + utf8.size() );
+}
+
+void
+VGBuffer::storeIndexedPen( int ind, const QPen & pen )
+{
+    p_begin( Op::StoreIndexedPen );
+    p_put < qint32 > ( ind );
+    p_putPen( pen );
+}
+
+void
+VGBuffer::setIndexedPen( int ind )
+{
+    p_begin( Op::SetIndexedPen );
+    p_put < qint32 > ( ind );
+}
+
+void
+VGBuffer::storeIndexedBrush( int ind, const QBrush & brush )
+{
+    p_begin( Op::StoreIndexedBrush );
+    p_put < qint32 > ( ind );
+    p_putBrush( brush );
+}
+
+void
+VGBuffer::setIndexedBrush( int ind )
+{
+    p_begin( Op::SetIndexedBrush );
+    p_put < qint32 > ( ind );
+}
+
+void
+VGBuffer::setBrush( const QBrush & brush )
+{
+    p_begin( Op::SetBrush );
+    p_putBrush( brush );
+}
+
+size_t
+VGBuffer::p_commandSize( const char * ptr, const char * end )
+{
+    if ( ptr >= end ) {
+        return 0;
+    }
+    Op op = Op( * ptr );
+    size_t payload = 0;
+    switch ( op )
+    {
+    case Op::Reset:
+    case Op::Save:
+    case Op::Restore:
+        payload = 0;
+        break;
+    case Op::DrawLine:
+    case Op::DrawRect:
+    case Op::DrawEllipse:
+        payload = 4 * sizeof( float );
+        break;
+    case Op::DrawPolyline:
+    case Op::DrawPolygon: {
+        Reader reader( ptr + 1, end );
+        quint32 n = reader.get < quint32 > ();
+        if ( ! reader.ok() ) {
+            return 0;
+        }
+        payload = sizeof( quint32 ) + size_t( n ) * 2 * sizeof( float );
+        break;
+    }
+    case Op::SetPenWidth:
+    case Op::SetPenColor:
+    case Op::SetFontIndex:
+    case Op::SetFontSize:
+    case Op::SetIndexedPen:
+    case Op::SetIndexedBrush:
+        payload = 4;
+        break;
+    case Op::SetPen:
+        payload = PenSize;
+        break;
+    case Op::SetTransform:
+        payload = 9 * sizeof( double ) + 1;
+        break;
+    case Op::FillRect:
+        payload = 4 * sizeof( float ) + 4;
+        break;
+    case Op::DrawText: {
+        Reader reader( ptr + 1, end );
+        reader.point();
+        quint32 n = reader.get < quint32 > ();
+        if ( ! reader.ok() ) {
+            return 0;
+        }
+        payload = 2 * sizeof( float ) + sizeof( quint32 ) + n;
+        break;
+    }
+    case Op::StoreIndexedPen:
+        payload = 4 + PenSize;
+        break;
+    case Op::StoreIndexedBrush:
+        payload = 4 + BrushSize;
+        break;
+    case Op::SetBrush:
+        payload = BrushSize;
+        break;
+    default:
+        return 0;
+    } // switch
+    if ( size_t( end - ptr ) < 1 + payload ) {
+        return 0;
+    }
+    return 1 + payload;
+} // p_commandSize
+
+void
+VGBuffer::render( BetterQPainter & painter ) const
+{
+    // reused for all polylines/polygons
+    std::vector < QPointF > points;
+
+    Reader reader( m_data.data(), m_data.data() + m_data.size() );
+    for ( size_t i = 0 ; i < m_offsets.size() ; ++i ) {
+        Op op = Op( reader.get < quint8 > () );
+        switch ( op )
+        {
+        case Op::Reset:
+            painter.reset();
+            break;
+        case Op::DrawLine: {
+            QPointF p1 = reader.point();
+            QPointF p2 = reader.point();
+            painter.drawLine( p1, p2 );
+            break;
+        }
+        case Op::DrawPolyline:
+            reader.points( reader.get < quint32 > (), points );
+            painter.drawPolyline( points.data(), points.size() );
+            break;
+        case Op::DrawPolygon:
+            reader.points( reader.get < quint32 > (), points );
+            painter.drawPolygon( points.data(), points.size() );
+            break;
+        case Op::SetPenWidth:
+            painter.setPenWidth( reader.get < float > () );
+            break;
+        case Op::SetPenColor:
+            painter.setPenColor( QColor::fromRgba( reader.get < quint32 > () ) );
+            break;
+        case Op::SetPen:
+            painter.setPen( reader.pen() );
+            break;
+        case Op::SetFontIndex:
+            painter.setFontIndex( reader.get < qint32 > () );
+            break;
+        case Op::SetFontSize:
+            painter.setFontSize( reader.get < float > () );
+            break;
+        case Op::Save:
+            painter.save();
+            break;
+        case Op::Restore:
+            painter.restore();
+            break;
+        case Op::SetTransform: {
+            double m[9];
+            for ( double & v : m ) {
+                v = reader.get < double > ();
+            }
+            bool combine = reader.get < quint8 > () != 0;
+            painter.setTransform( QTransform( m[0], m[1], m[2], m[3], m[4], m[5],
+                                              m[6], m[7], m[8] ), combine );
+            break;
+        }
+        case Op::FillRect: {
+            QRectF rect = reader.rect();
+            painter.fillRect( rect, QColor::fromRgba( reader.get < quint32 > () ) );
+            break;
+        }
+        case Op::DrawRect:
+            painter.drawRect( reader.rect() );
+            break;
+        case Op::DrawEllipse:
+            painter.drawEllipse( reader.rect() );
+            break;
+        case Op::DrawText: {
+            QPointF pos = reader.point();
+            quint32 n = reader.get < quint32 > ();
+            painter.drawText( QString::fromUtf8( reader.bytes( n ) ), pos );
+            break;
+        }
+        case Op::StoreIndexedPen: {
+            int ind = reader.get < qint32 > ();
+            painter.storeIndexedPen( ind, reader.pen() );
+            break;
+        }
+        case Op::SetIndexedPen:
+            painter.setIndexedPen( reader.get < qint32 > () );
+            break;
+        case Op::StoreIndexedBrush: {
+            int ind = reader.get < qint32 > ();
+            painter.storeIndexedBrush( ind, reader.brush() );
+            break;
+        }
+        case Op::SetIndexedBrush:
+            painter.setIndexedBrush( reader.get < qint32 > () );
+            break;
+        case Op::SetBrush:
+            painter.setBrush( reader.brush() );
+            break;
+        default:
+            qCritical() << "Corrupted VGBuffer, unknown opcode" << int ( op );
+            return;
+        } // switch
+    }
+} // render
+
+QByteArray
+VGBuffer::serialize() const
+{
+    QByteArray result;
+    result.reserve( int ( m_data.size() ) + 16 );
+    result.append( "VGB1", 4 );
+    appendRaw( result, HostByteOrder );
+    appendRaw( result, quint32( m_offsets.size() ) );
+    appendRaw( result, quint32( m_data.size() ) );
+    result.append( m_data.data(), int ( m_data.size() ) );
+    return result;
+}
+
+bool
+VGBuffer::deserialize( const QByteArray & data, VGBuffer & result )
+{
+    result.clear();
+    Reader reader( data.constData(), data.constData() + data.size() );
+    if ( reader.bytes( 4 ) != "VGB1" || reader.get < quint8 > () != HostByteOrder ) {
+        return false;
+    }
+    quint32 nCommands = reader.get < quint32 > ();
+    quint32 nBytes = reader.get < quint32 > ();
+    if ( ! reader.ensure( nBytes ) ) {
+        return false;
+    }
+
+    // every command is at least its opcode, so a command count larger than the payload
+    // is corrupted, and must not be trusted for the reserve() below
+    if ( nCommands > nBytes ) {
+        return false;
+    }
+
+    // rebuild the offsets by walking the commands, validating them on the way
+    const char * start = reader.ptr();
+    const char * end = start + nBytes;
+    result.m_data.assign( start, end );
+    result.m_offsets.reserve( nCommands );
+    const char * ptr = start;
+    while ( ptr < end ) {
+        size_t size = p_commandSize( ptr, end );
+        if ( size == 0 ) {
+            result.clear();
+            return false;
+        }
+        result.m_offsets.push_back( quint32( ptr - start ) );
+        ptr += size;
+    }
+    if ( result.m_offsets.size() != nCommands ) {
+        result.clear();
+        return false;
+    }
+    return true;
+} // deserialize
+
+VGBufferDiff
+VGBufferDiff::compute( const VGBuffer & oldBuffer, const VGBuffer & newBuffer )
+{
+    VGBufferDiff diff;
+    diff.m_oldSize = oldBuffer.size();
+
+    size_t nOld = oldBuffer.size();
+    size_t nNew = newBuffer.size();
+
+    // skip the common prefix and suffix
+    size_t prefix = 0;
+    while ( prefix < nOld && prefix < nNew &&
+            oldBuffer.commandEquals( prefix, newBuffer, prefix ) ) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while ( suffix < nOld - prefix && suffix < nNew - prefix &&
+            oldBuffer.commandEquals( nOld - 1 - suffix, newBuffer, nNew - 1 - suffix ) ) {
+        suffix++;
+    }
+
+    size_t oldMid = nOld - prefix - suffix;
+    size_t newMid = nNew - prefix - suffix;
+    if ( oldMid == 0 && newMid == 0 ) {
+        return diff;
+    }
+
+    // different number of commands: replace the middle part wholesale
+    if ( oldMid != newMid ) {
+        Edit edit;
+        edit.pos = prefix;
+        edit.removeCount = oldMid;
+        edit.insert.appendCommands( newBuffer, prefix, newMid );
+        diff.m_edits.push_back( std::move( edit ) );
+        return diff;
+    }
+
+    // same number of commands (e.g. restyled grid): record runs of changed commands
+    size_t i = prefix;
+    while ( i < prefix + oldMid ) {
+        if ( oldBuffer.commandEquals( i, newBuffer, i ) ) {
+            i++;
+            continue;
+        }
+        size_t runStart = i;
+        while ( i < prefix + oldMid && ! oldBuffer.commandEquals( i, newBuffer, i ) ) {
+            i++;
+        }
+        Edit edit;
+        edit.pos = runStart;
+        edit.removeCount = i - runStart;
+        edit.insert.appendCommands( newBuffer, runStart, i - runStart );
+        diff.m_edits.push_back( std::move( edit ) );
+    }
+    return diff;
+} // compute
+
+bool
+VGBufferDiff::apply( VGBuffer & buffer ) const
+{
+    if ( buffer.size() != m_oldSize ) {
+        return false;
+    }
+    if ( m_edits.empty() ) {
+        return true;
+    }
+
+    // splice the untouched ranges of the old buffer with the inserted commands
+    VGBuffer result;
+    result.reserve( buffer.size(), buffer.byteSize() );
+    size_t pos = 0;
+    for ( const Edit & edit : m_edits ) {
+        if ( edit.pos < pos || edit.pos + edit.removeCount > buffer.size() ) {
+            return false;
+        }
+        result.appendCommands( buffer, pos, edit.pos - pos );
+        result.appendBuffer( edit.insert );
+        pos = edit.pos + edit.removeCount;
+    }
+    result.appendCommands( buffer, pos, buffer.size() - pos );
+    buffer = std::move( result );
+    return true;
+} // apply
+
+QByteArray
+VGBufferDiff::serialize() const
+{
+    QByteArray result;
+    result.append( "VGD1", 4 );
+    appendRaw( result, HostByteOrder );
+    appendRaw( result, m_oldSize );
+    appendRaw( result, quint32( m_edits.size() ) );
+    for ( const Edit & edit : m_edits ) {
+        QByteArray blob = edit.insert.serialize();
+        appendRaw( result, edit.pos );
+        appendRaw( result, edit.removeCount );
+        appendRaw( result, quint32( blob.size() ) );
+        result.append( blob );
+    }
+    return result;
+}
+
+bool
+VGBufferDiff::deserialize( const QByteArray & data, VGBufferDiff & result )
+{
+    result = VGBufferDiff();
+    Reader reader( data.constData(), data.constData() + data.size() );
+    if ( reader.bytes( 4 ) != "VGD1" || reader.get < quint8 > () != HostByteOrder ) {
+        return false;
+    }
+    result.m_oldSize = reader.get < quint32 > ();
+    quint32 nEdits = reader.get < quint32 > ();
+    for ( quint32 i = 0 ; i < nEdits && reader.ok() ; ++i ) {
+        Edit edit;
+        edit.pos = reader.get < quint32 > ();
+        edit.removeCount = reader.get < quint32 > ();
+        quint32 blobSize = reader.get < quint32 > ();
+        if ( ! reader.ok() || ! VGBuffer::deserialize( reader.bytes( blobSize ), edit.insert ) ) {
+            result = VGBufferDiff();
+            return false;
+        }
+        result.m_edits.push_back( std::move( edit ) );
+    }
+    if ( ! reader.ok() ) {
+        result = VGBufferDiff();
+        return false;
+    }
+    return true;
+} // deserialize
+}
+}
+}
@@ -0,0 +1,274 @@
+/**
+ * Flat representation of vector graphics.
+ *
+ * VGList keeps one heap allocated polymorphic object per draw command, which is convenient
+ * for composing, but expensive for large lists (grids, contours with 100k+ segments).
+ * VGBuffer stores the same commands back to back in a single byte arena:
+ *
+ *   [opcode:u8][payload...][opcode:u8][payload...]...
+ *
+ * together with an index of command offsets. The arena doubles as the binary encoding,
+ * so serialization is a memcpy, and two buffers can be diffed command by command to ship
+ * only the changes (see VGBufferDiff).
+ *
+ * Geometry is stored as 32 bit floats, colors as QRgb, transforms as doubles.
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include <QByteArray>
+#include <QColor>
+#include <QPen>
+#include <QBrush>
+#include <QPolygonF>
+#include <QTransform>
+#include <QString>
+#include <vector>
+#include <cstring>
+
+class QPainter;
+
+namespace Carta
+{
+namespace Lib
+{
+namespace VectorGraphics
+{
+class VGList;
+class BetterQPainter;
+
+/// flat, arena backed list of vector graphics commands
+class VGBuffer
+{
+    CLASS_BOILERPLATE( VGBuffer );
+
+public:
+
+    /// opcodes, one for each of the entries in VGList.h
+    /// \warning these are part of the binary encoding, only append new ones at the end
+    enum class Op : quint8
+    {
+        Reset = 0,
+        DrawLine,
+        DrawPolyline,
+        DrawPolygon,
+        SetPenWidth,
+        SetPenColor,
+        SetPen,
+        SetFontIndex,
+        SetFontSize,
+        Save,
+        Restore,
+        SetTransform,
+        FillRect,
+        DrawRect,
+        DrawEllipse,
+        DrawText,
+        StoreIndexedPen,
+        SetIndexedPen,
+        StoreIndexedBrush,
+        SetIndexedBrush,
+        SetBrush,
+        NumOps // must be last
+    };
+
+    /// make an empty buffer
+    VGBuffer() { }
+
+    /// convert a VGList into a flat buffer
+    static VGBuffer
+    fromVGList( const VGList & vgList );
+
+    /// number of commands
+    size_t
+    size() const { return m_offsets.size(); }
+
+    /// number of bytes used by the commands
+    size_t
+    byteSize() const { return m_data.size(); }
+
+    /// remove all commands
+    void
+    clear();
+
+    /// pre-allocate space for the given number of commands/bytes
+    void
+    reserve( size_t nCommands, size_t nBytes );
+
+    /// opcode of the i-th command
+    Op
+    op( size_t ind ) const { return Op( m_data[m_offsets[ind]] ); }
+
+    /// are the two commands (possibly from different buffers) identical?
+    bool
+    commandEquals( size_t ind, const VGBuffer & other, size_t otherInd ) const;
+
+    /// append commands [first, first+count) from another buffer
+    void
+    appendCommands( const VGBuffer & other, size_t first, size_t count );
+
+    /// append all commands from another buffer
+    void
+    appendBuffer( const VGBuffer & other ) { appendCommands( other, 0, other.size() ); }
+
+    bool
+    operator== ( const VGBuffer & other ) const
+    {
+        return m_data == other.m_data && m_offsets == other.m_offsets;
+    }
+
+    bool
+    operator!= ( const VGBuffer & other ) const { return ! ( * this == other ); }
+
+    /// \name Composing
+    /// these mirror the entries in VGList.h
+    /// @{
+    void reset();
+    void drawLine( const QPointF & p1, const QPointF & p2 );
+    void drawPolyline( const QPolygonF & poly );
+    void drawPolygon( const QPolygonF & poly );
+    void setPenWidth( double width );
+    void setPenColor( const QColor & color );
+    void setPen( const QPen & pen );
+    void setFontIndex( int fontIndex );
+    void setFontSize( double size );
+    void save();
+    void restore();
+    void setTransform( const QTransform & transform, bool combine = false );
+    void fillRect( const QRectF & rect, const QColor & color );
+    void drawRect( const QRectF & rect );
+    void drawEllipse( const QRectF & rect );
+    void drawText( const QString & text, const QPointF & pos );
+    void storeIndexedPen( int ind, const QPen & pen );
+    void setIndexedPen( int ind );
+    void storeIndexedBrush( int ind, const QBrush & brush );
+    void setIndexedBrush( int ind );
+    void setBrush( const QBrush & brush );
+    /// @}
+
+    /// render all commands using the painter
+    void
+    render( BetterQPainter & painter ) const;
+
+    /// binary encoding of the buffer
+    QByteArray
+    serialize() const;
+
+    /// decode a buffer produced by serialize()
+    /// \return false if the data is not a valid encoding (result is then cleared)
+    static bool
+    deserialize( const QByteArray & data, VGBuffer & result );
+
+private:
+
+    // starts a new command
+    void
+    p_begin( Op op )
+    {
+        m_offsets.push_back( quint32( m_data.size() ) );
+        m_data.push_back( char( op ) );
+    }
+
+    template < typename T >
+    void
+    p_put( const T & val )
+    {
+        size_t pos = m_data.size();
+        m_data.resize( pos + sizeof( T ) );
+        std::memcpy( m_data.data() + pos, & val, sizeof( T ) );
+    }
+
+    void
+    p_putPoint( const QPointF & p )
+    {
+        p_put < float > ( p.x() );
+        p_put < float > ( p.y() );
+    }
+
+    void
+    p_putRect( const QRectF & r );
+
+    void
+    p_putPoly( const QPolygonF & poly );
+
+    void
+    p_putPen( const QPen & pen );
+
+    void
+    p_putBrush( const QBrush & brush );
+
+    /// byte offset one past the end of the i-th command
+    size_t
+    p_end( size_t ind ) const
+    {
+        return ind + 1 < m_offsets.size() ? m_offsets[ind + 1] : m_data.size();
+    }
+
+    /// computes the size of the command starting at ptr (including opcode), or 0 if the
+    /// command does not fit before end
+    static size_t
+    p_commandSize( const char * ptr, const char * end );
+
+    /// the arena
+    std::vector < char > m_data;
+
+    /// offsets of the commands into the arena
+    std::vector < quint32 > m_offsets;
+
+    friend class VGBufferDiff;
+};
+
+/// Difference between two VGBuffers, expressed as a list of splices against the
+/// old buffer. Applying the diff to the old buffer yields the new buffer.
+///
+/// The typical use is shipping VG updates to clients: e.g. when only the color of a grid
+/// changes, the diff contains just the replaced pen commands.
+class VGBufferDiff
+{
+    CLASS_BOILERPLATE( VGBufferDiff );
+
+public:
+
+    /// replace removeCount commands at position pos (in the old buffer) with insert
+    struct Edit {
+        quint32 pos = 0;
+        quint32 removeCount = 0;
+        VGBuffer insert;
+    };
+
+    /// compute the difference between two buffers
+    static VGBufferDiff
+    compute( const VGBuffer & oldBuffer, const VGBuffer & newBuffer );
+
+    /// apply the diff to the old buffer
+    /// \return false if the diff was not computed against a buffer of this size
+    bool
+    apply( VGBuffer & buffer ) const;
+
+    /// true if the two buffers were identical
+    bool
+    isEmpty() const { return m_edits.empty(); }
+
+    const std::vector < Edit > &
+    edits() const { return m_edits; }
+
+    /// binary encoding of the diff
+    QByteArray
+    serialize() const;
+
+    /// decode a diff produced by serialize()
+    static bool
+    deserialize( const QByteArray & data, VGBufferDiff & result );
+
+private:
+
+    /// number of commands in the old buffer, used to sanity check apply()
+    quint32 m_oldSize = 0;
+
+    /// edits sorted by position, non overlapping
+    std::vector < Edit > m_edits;
+};
+}
+}
+}
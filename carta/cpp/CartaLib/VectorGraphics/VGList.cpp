@@ -46,6 +46,14 @@ VGListQPainterRenderer::render( const VGList & vgList, QPainter & qPainter )
 //    qPainter.drawImage( 0, 0, vgList.qImage() );
     return true;
 }
+
+bool
+VGListQPainterRenderer::render( const VGBuffer & vgBuffer, QPainter & qPainter )
+{
+    BetterQPainter bp( qPainter );
+    vgBuffer.render( bp );
+    return true;
+}
 }
 }
 }
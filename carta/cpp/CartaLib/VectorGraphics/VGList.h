@@ -4,6 +4,7 @@
 
 #include "../CartaLib.h"
 #include "BetterQPainter.h"
+#include "VGBuffer.h"
 #include <QMetaType>
 #include <QImage>
 #include <QStringList>
@@ -33,6 +34,10 @@ public:
     virtual QStringList
     javascript() = 0;
 
+    /// an entry needs to be able to append itself to a flat VGBuffer
+    virtual void
+    appendTo( VGBuffer & buffer ) = 0;
+
     virtual
     ~IVGListEntry() { }
 };
@@ -53,6 +58,10 @@ public:
         return QStringList()
                << QString( "p.reset();" );
     }
+    virtual void appendTo( VGBuffer & buffer ) override
+    {
+        buffer.reset();
+    }
 };
 
 /// line entry implementation
@@ -82,6 +91,12 @@ public:
                    .arg( m_p1.x() ).arg( m_p1.y() ).arg( m_p2.x() ).arg( m_p2.y() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawLine( m_p1, m_p2 );
+    }
+
 private:
 
     QPointF m_p1, m_p2;
@@ -112,6 +127,12 @@ public:
                << QString( "p.polyline(not implemented yet);" );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawPolyline( m_poly );
+    }
+
 private:
 
     QPolygonF m_poly;
@@ -144,6 +165,12 @@ public:
                << QString( "p.polygon(not implemented yet);" );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawPolygon( m_poly );
+    }
+
 private:
 
     QPolygonF m_poly;
@@ -174,6 +201,12 @@ public:
                    .arg( m_width );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setPenWidth( m_width );
+    }
+
 private:
 
     double m_width = 1.0;
@@ -205,6 +238,12 @@ public:
                    .arg( m_color.name( QColor::HexArgb ) );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setPenColor( m_color );
+    }
+
 private:
 
     QColor m_color = QColor( 255, 255, 255 );
@@ -238,6 +277,12 @@ public:
                    .arg( m_pen.width() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setPen( m_pen );
+    }
+
 private:
 
     QPen m_pen = QPen( QColor( 255, 255, 255 ) );
@@ -269,6 +314,12 @@ public:
                    .arg( m_fontIndex );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setFontIndex( m_fontIndex );
+    }
+
 private:
 
     int m_fontIndex = 0;
@@ -300,6 +351,12 @@ public:
                    .arg( m_size );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setFontSize( m_size );
+    }
+
 private:
 
     double m_size = 0;
@@ -328,6 +385,12 @@ public:
                << QString( "p.save();" );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.save();
+    }
+
 private:
 };
 
@@ -354,6 +417,12 @@ public:
                << QString( "p.restore();" );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.restore();
+    }
+
 private:
 };
 
@@ -385,6 +454,12 @@ public:
                    .arg( matrix ).arg( m_combine );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setTransform( m_transform, m_combine );
+    }
+
 private:
 
     QTransform m_transform;
@@ -422,6 +497,12 @@ public:
                    .arg( m_color.name( QColor::HexArgb ) );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.fillRect( m_rect, m_color );
+    }
+
 private:
 
     QRectF m_rect = QRectF( 0, 0, 10, 10 );
@@ -457,6 +538,12 @@ public:
                    .arg( m_rect.height() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawRect( m_rect );
+    }
+
 private:
 
     QRectF m_rect = QRectF( 0, 0, 10, 10 );
@@ -491,6 +578,12 @@ public:
                    .arg( m_rect.height() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawEllipse( m_rect );
+    }
+
 private:
 
     QRectF m_rect = QRectF( 0, 0, 10, 10 );
@@ -529,6 +622,12 @@ public:
                    .arg( m_pos.y() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.drawText( m_text, m_pos );
+    }
+
 private:
 
     QString m_text = "";
@@ -564,6 +663,12 @@ public:
                    .arg( m_pen.widthF() );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.storeIndexedPen( m_ind, m_pen );
+    }
+
 private:
 
     int m_ind = 0;
@@ -596,6 +701,12 @@ public:
                    .arg( m_ind );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setIndexedPen( m_ind );
+    }
+
 private:
 
     int m_ind = 0;
@@ -629,6 +740,12 @@ public:
                    .arg( m_brush.color().name( QColor::HexArgb ) );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.storeIndexedBrush( m_ind, m_brush );
+    }
+
 private:
 
     int m_ind = 0;
@@ -661,6 +778,12 @@ public:
                    .arg( m_ind );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setIndexedBrush( m_ind );
+    }
+
 private:
 
     int m_ind = 0;
@@ -692,6 +815,12 @@ public:
                   .arg( m_brush.color().name( QColor::HexArgb ) );
     }
 
+    virtual void
+    appendTo( VGBuffer & buffer ) override
+    {
+        buffer.setBrush( m_brush );
+    }
+
 private:
 
     QBrush m_brush { "black" };
@@ -722,6 +851,10 @@ public:
     const std::vector < IVGListEntry::SharedPtr > &
     entries() const { return m_entries; }
 
+    /// convert to the flat representation
+    VGBuffer
+    toBuffer() const { return VGBuffer::fromVGList( * this ); }
+
     /// get a list of entries (ie. list of shared pointers to entries)
     /// with read/write access
 //    std::vector < IVGListEntry::SharedPtr > &
@@ -750,6 +883,10 @@ public:
     ///
     bool
     render( const VGList & vgList, QPainter & qPainter );
+
+    /// same as above, but for the flat representation (no per-entry virtual calls)
+    bool
+    render( const VGBuffer & vgBuffer, QPainter & qPainter );
 };
 
 /// this is the class you want to use to create vector graphics
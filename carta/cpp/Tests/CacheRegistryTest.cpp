@@ -0,0 +1,78 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "CartaLib/CacheRegistry.h"
+
+using namespace Carta::Lib;
+
+TEST_CASE( "CacheRegistry testing", "[cache]" ) {
+
+    CacheRegistry & registry = CacheRegistry::instance();
+    int64_t oldBudget = registry.budget();
+    registry.setBudget( 1000 );
+
+    SECTION( "single cache" ) {
+        LruCache < int, QString > cache( "test" );
+        cache.insert( 1, "one", 100 );
+        cache.insert( 2, "two", 200 );
+        REQUIRE( cache.cacheBytes() == 300 );
+        REQUIRE( cache.cacheEntries() == 2 );
+
+        QString val;
+        REQUIRE( cache.find( 1, val ) );
+        REQUIRE( val == "one" );
+        REQUIRE_FALSE( cache.find( 3, val ) );
+
+        // replacing an entry updates the cost
+        cache.insert( 1, "uno", 50 );
+        REQUIRE( cache.cacheBytes() == 250 );
+        REQUIRE( cache.find( 1, val ) );
+        REQUIRE( val == "uno" );
+
+        REQUIRE( cache.remove( 2 ) );
+        REQUIRE( cache.cacheBytes() == 50 );
+    }
+
+    SECTION( "eviction across caches is least recently used first" ) {
+        LruCache < int, int > c1( "c1" ), c2( "c2" );
+        c1.insert( 1, 1, 400 );
+        c2.insert( 1, 1, 400 );
+
+        // touch the c1 entry, so that c2 has the oldest one
+        int val;
+        REQUIRE( c1.find( 1, val ) );
+
+        c1.insert( 2, 2, 400 );
+        REQUIRE( registry.totalBytes() <= 1000 );
+        REQUIRE( c1.cacheEntries() == 2 );
+        REQUIRE( c2.cacheEntries() == 0 );
+
+        // lowering the budget evicts immediately
+        registry.setBudget( 500 );
+        REQUIRE( registry.totalBytes() <= 500 );
+        REQUIRE( c1.find( 2, val ) );
+        REQUIRE_FALSE( c1.find( 1, val ) );
+    }
+
+    SECTION( "per cache limit" ) {
+        LruCache < int, int > cache( "limited", 150 );
+        cache.insert( 1, 1, 100 );
+        cache.insert( 2, 2, 100 );
+        REQUIRE( cache.cacheEntries() == 1 );
+        int val;
+        REQUIRE( cache.find( 2, val ) );
+    }
+
+    SECTION( "destroyed caches are unregistered" ) {
+        size_t before = registry.usage().size();
+        {
+            LruCache < int, int > cache( "temporary" );
+            REQUIRE( registry.usage().size() == before + 1 );
+        }
+        REQUIRE( registry.usage().size() == before );
+    }
+
+    registry.setBudget( oldBudget );
+}
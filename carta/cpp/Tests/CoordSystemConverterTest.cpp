@@ -0,0 +1,122 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Regions/ICoordSystem.h"
+#include <cmath>
+
+using Carta::Lib::Regions::CompositeCoordinateSystem;
+using Carta::Lib::Regions::ICoordSystemConverter;
+using Carta::Lib::Regions::IdentityCoordSystemConverter;
+using Carta::Lib::Regions::PointN;
+
+namespace
+{
+/// converts (x,y) to (log(x), x*y) and back, only for x > 0; like most converters
+/// it only implements the single point versions
+class LogConverter : public ICoordSystemConverter
+{
+public:
+
+    using ICoordSystemConverter::src2dst;
+    using ICoordSystemConverter::dst2src;
+
+    LogConverter()
+        : m_srcCS( 2 )
+          , m_dstCS( 2 )
+    { }
+
+    virtual bool
+    src2dst( const PointN & pt, PointN & result ) override
+    {
+        if ( pt[0] <= 0 ) {
+            return false;
+        }
+        result = { std::log( pt[0] ), pt[0] * pt[1] };
+        return true;
+    }
+
+    virtual bool
+    dst2src( const PointN & pt, PointN & result ) override
+    {
+        double x = std::exp( pt[0] );
+        result = { x, pt[1] / x };
+        return true;
+    }
+
+    virtual const CompositeCoordinateSystem &
+    srcCS() override
+    {
+        return m_srcCS;
+    }
+
+    virtual const CompositeCoordinateSystem &
+    dstCS() override
+    {
+        return m_dstCS;
+    }
+
+private:
+
+    CompositeCoordinateSystem m_srcCS, m_dstCS;
+};
+
+/// points (x,y) in a small grid, including some with x <= 0
+std::vector < double >
+gridPoints()
+{
+    std::vector < double > pts;
+    for ( int i = - 2 ; i < 5 ; i++ ) {
+        for ( int j = 0 ; j < 3 ; j++ ) {
+            pts.push_back( i * 1.5 );
+            pts.push_back( j - 0.25 );
+        }
+    }
+    return pts;
+}
+}
+
+TEST_CASE( "Batched coordinate conversions", "[coords]" ) {
+
+    SECTION( "batched conversion matches converting point by point" ) {
+        LogConverter cvt;
+        std::vector < double > pts = gridPoints();
+        int64_t n = pts.size() / 2;
+        std::vector < double > world( pts.size() );
+        REQUIRE_FALSE( cvt.src2dst( pts.data(), world.data(), n ) );
+        for ( int64_t i = 0 ; i < n ; i++ ) {
+            PointN single;
+            if ( cvt.src2dst( PointN { pts[2 * i], pts[2 * i + 1] }, single ) ) {
+                REQUIRE( world[2 * i] == single[0] );
+                REQUIRE( world[2 * i + 1] == single[1] );
+            }
+            else {
+                // points that fail are NaN
+                REQUIRE( std::isnan( world[2 * i] ) );
+                REQUIRE( std::isnan( world[2 * i + 1] ) );
+            }
+        }
+    }
+
+    SECTION( "batched round trip" ) {
+        LogConverter cvt;
+        std::vector < double > pts = { 1, 2, 0.5, - 3, 10, 0 };
+        std::vector < double > world( pts.size() ), back( pts.size() );
+        REQUIRE( cvt.src2dst( pts.data(), world.data(), 3 ) );
+        REQUIRE( cvt.dst2src( world.data(), back.data(), 3 ) );
+        for ( size_t i = 0 ; i < pts.size() ; i++ ) {
+            REQUIRE( back[i] == Approx( pts[i] ) );
+        }
+    }
+
+    SECTION( "identity converter" ) {
+        IdentityCoordSystemConverter cvt( CompositeCoordinateSystem( 2 ) );
+        std::vector < double > pts = gridPoints();
+        std::vector < double > result( pts.size() );
+        REQUIRE( cvt.src2dst( pts.data(), result.data(), pts.size() / 2 ) );
+        REQUIRE( result == pts );
+        REQUIRE( cvt.dst2src( pts.data(), result.data(), pts.size() / 2 ) );
+        REQUIRE( result == pts );
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "CartaLib/DerivedImage.h"
+#include "CartaLib/MemoryImage.h"
+#include "CartaLib/PlaneCache.h"
+#include "TestUtils.h"
+
+using Carta::Lib::Image::DerivedImage;
+using Carta::Lib::Image::ImageInterface;
+using Carta::Lib::Image::MemoryImage;
+using Carta::Tests::pixels;
+
+namespace
+{
+DerivedImage::SharedPtr
+derived( DerivedImage::Node::SharedPtr root )
+{
+    return std::make_shared < DerivedImage > ( root, Carta::Lib::Unit( "Jy" ), nullptr );
+}
+}
+
+TEST_CASE( "DerivedImage testing", "[derived]" ) {
+
+    // 3 x 2 x 4 cube with value = x + 10 * y + 100 * z
+    auto data = std::make_shared < std::vector < float > > ();
+    for ( int z = 0 ; z < 4 ; z++ ) {
+        for ( int y = 0 ; y < 2 ; y++ ) {
+            for ( int x = 0 ; x < 3 ; x++ ) {
+                data-> push_back( x + 10 * y + 100 * z );
+            }
+        }
+    }
+    ImageInterface::SharedPtr cube = std::make_shared < MemoryImage > (
+        data, ImageInterface::VI( { 3, 2, 4 } ), Carta::Lib::Unit( "Jy" ), nullptr );
+    auto source = DerivedImage::source( cube );
+
+    SECTION( "map and slices" ) {
+        auto image = derived( DerivedImage::map( source, [] ( float v ) { return 2 * v; } ) );
+        REQUIRE( image-> dims() == ImageInterface::VI( { 3, 2, 4 } ) );
+        std::vector < float > all = pixels( * image );
+        REQUIRE( all.size() == data-> size() );
+        REQUIRE( all[7] == 2 * ( * data )[7] );
+
+        // [::-2, 1, 2]
+        std::vector < float > part = pixels( * image, SliceND().step( - 2 ).next().index( 1 ).next().index( 2 ) );
+        REQUIRE( part == std::vector < float > ( { 424, 420 } ) );
+    }
+
+    SECTION( "combine and select" ) {
+        auto ratio = DerivedImage::combine( source, source, [] ( float a, float b ) { return a / b; } );
+        REQUIRE( pixels( * derived( ratio ), SliceND().index( 1 ).next().index( 1 ).next().index( 3 ) )[0] == 1 );
+
+        auto plane = derived( DerivedImage::select( source, 2, 3 ) );
+        REQUIRE( plane-> dims() == ImageInterface::VI( { 3, 2, 1 } ) );
+        REQUIRE( pixels( * plane ) == std::vector < float > ( { 300, 301, 302, 310, 311, 312 } ) );
+
+        REQUIRE( DerivedImage::select( source, 2, 4 ) == nullptr );
+        REQUIRE( DerivedImage::combine( source, DerivedImage::select( source, 2, 0 ),
+                                        [] ( float a, float ) { return a; } ) == nullptr );
+    }
+
+    SECTION( "rebin" ) {
+        auto image = derived( DerivedImage::rebin( source, 2, 3 ) );
+        REQUIRE( image-> dims() == ImageInterface::VI( { 3, 2, 2 } ) );
+        std::vector < float > all = pixels( * image, SliceND().index( 0 ).next().index( 0 ) );
+        REQUIRE( all == std::vector < float > ( { 100, 300 } ) );
+    }
+
+    SECTION( "smooth" ) {
+        auto flat = DerivedImage::map( source, [] ( float ) { return 5.0f; } );
+        auto image = derived( DerivedImage::smooth( flat, 1.5 ) );
+        for ( float v : pixels( * image ) ) {
+            REQUIRE( v == Approx( 5 ) );
+        }
+    }
+
+    SECTION( "the plane cache reads images that cache their own pixels directly" ) {
+        auto image = derived( source );
+        REQUIRE( cube-> cachesPixels() );
+        REQUIRE( image-> cachesPixels() );
+        SliceND plane = SliceND().next().next().index( 1 );
+        for ( ImageInterface::SharedPtr img : { cube, ImageInterface::SharedPtr( image ) } ) {
+            std::unique_ptr < Carta::Lib::NdArray::RawViewInterface > view(
+                Carta::Lib::PlaneCache::instance().getDataSlice( "test", * img, plane ) );
+            REQUIRE( view != nullptr );
+            std::vector < float > cached;
+            Carta::Lib::NdArray::Float( view.get(), false ).forEach( [& cached] ( const float & v ) {
+                                                                         cached.push_back( v );
+                                                                     }
+                                                                     );
+            REQUIRE( cached == pixels( * img, plane ) );
+        }
+    }
+}
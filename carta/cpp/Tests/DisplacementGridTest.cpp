@@ -0,0 +1,113 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/DisplacementGrid.h"
+#include <cmath>
+#include <limits>
+
+using Carta::Lib::DisplacementGrid;
+
+namespace
+{
+/// a map that applies f to every point, and counts the points it was asked for
+DisplacementGrid::BatchMap
+pointMap( std::function < bool (double, double, double &, double &) > f, int64_t * count = nullptr )
+{
+    return [f, count] ( const double * dst, double * src, int64_t n ) -> bool {
+               bool valid = true;
+               for ( int64_t i = 0 ; i < n ; i++ ) {
+                   if ( ! f( dst[2 * i], dst[2 * i + 1], src[2 * i], src[2 * i + 1] ) ) {
+                       src[2 * i] = src[2 * i + 1] = std::numeric_limits < double >::quiet_NaN();
+                       valid = false;
+                   }
+               }
+               if ( count ) {
+                   * count += n;
+               }
+               return valid;
+    };
+}
+}
+
+TEST_CASE( "DisplacementGrid testing", "[reprojection]" ) {
+
+    // linear maps are reproduced exactly (up to float precision) by bilinear interpolation
+    auto affine = [] ( double x, double y, double & sx, double & sy ) {
+        sx = 0.9 * x + 0.2 * y + 3;
+        sy = - 0.1 * x + 1.1 * y - 7;
+        return true;
+    };
+
+    SECTION( "interpolation between the nodes" ) {
+        DisplacementGrid grid( QRectF( 0, 0, 100, 50 ), 8, pointMap( affine ) );
+        for ( double y = 0 ; y <= 50 ; y += 3.7 ) {
+            for ( double x = 0 ; x <= 100 ; x += 4.3 ) {
+                double sx, sy, ex, ey;
+                REQUIRE( grid.map( x, y, sx, sy ) );
+                affine( x, y, ex, ey );
+                REQUIRE( sx == Approx( ex ).epsilon( 1e-5 ) );
+                REQUIRE( sy == Approx( ey ).epsilon( 1e-5 ) );
+            }
+        }
+    }
+
+    SECTION( "the map is evaluated once per node" ) {
+        int64_t count = 0;
+        DisplacementGrid grid( QRectF( 0, 0, 100, 50 ), 8, pointMap( affine, & count ) );
+        REQUIRE( count == 14 * 8 );
+        REQUIRE( grid.step() == 8 );
+        REQUIRE( grid.area() == QRectF( 0, 0, 100, 50 ) );
+        REQUIRE( grid.byteCount() > count * 2 * int64_t( sizeof( float ) ) );
+    }
+
+    SECTION( "edges of the grid" ) {
+        // the last nodes are past the area when the step does not divide its size
+        DisplacementGrid grid( QRectF( - 10, 20, 100, 50 ), 8, pointMap( affine ) );
+        double sx, sy, ex, ey;
+        REQUIRE( grid.map( - 10, 20, sx, sy ) );
+        affine( - 10, 20, ex, ey );
+        REQUIRE( sx == Approx( ex ) );
+        REQUIRE( sy == Approx( ey ) );
+        REQUIRE( grid.map( 90, 70, sx, sy ) );
+        affine( 90, 70, ex, ey );
+        REQUIRE( sx == Approx( ex ) );
+        REQUIRE( sy == Approx( ey ) );
+        REQUIRE( grid.map( 94, 76, sx, sy ) );
+
+        // but not outside of the nodes
+        REQUIRE_FALSE( grid.map( - 10.01, 30, sx, sy ) );
+        REQUIRE_FALSE( grid.map( 30, 19.99, sx, sy ) );
+        REQUIRE_FALSE( grid.map( 96.01, 30, sx, sy ) );
+        REQUIRE_FALSE( grid.map( 30, 76.01, sx, sy ) );
+        REQUIRE_FALSE( grid.map( std::numeric_limits < double >::quiet_NaN(), 30, sx, sy ) );
+    }
+
+    SECTION( "tiny areas still get a cell" ) {
+        DisplacementGrid grid( QRectF( 5, 5, 0, 0 ), 16, pointMap( affine ) );
+        double sx, sy, ex, ey;
+        REQUIRE( grid.map( 5, 5, sx, sy ) );
+        affine( 5, 5, ex, ey );
+        REQUIRE( sx == Approx( ex ) );
+        REQUIRE( sy == Approx( ey ) );
+    }
+
+    SECTION( "nodes that could not be mapped" ) {
+        // only the right half of the plane maps
+        auto half = [] ( double x, double y, double & sx, double & sy ) {
+            sx = x;
+            sy = y;
+            return x >= 40;
+        };
+        DisplacementGrid grid( QRectF( 0, 0, 80, 80 ), 10, pointMap( half ) );
+        double sx, sy;
+        REQUIRE_FALSE( grid.map( 5, 5, sx, sy ) );
+
+        // cells touching a failed node fail too
+        REQUIRE_FALSE( grid.map( 35, 5, sx, sy ) );
+        REQUIRE( grid.map( 45, 5, sx, sy ) );
+        REQUIRE( sx == Approx( 45 ) );
+        REQUIRE( sy == Approx( 5 ) );
+    }
+}
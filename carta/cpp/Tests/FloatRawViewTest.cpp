@@ -0,0 +1,68 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "CartaLib/FloatRawView.h"
+
+using namespace Carta::Lib::NdArray;
+
+TEST_CASE( "FloatRawView testing", "[floatview]" ) {
+
+    // 4 x 3 x 2 array with value = x + 10 * y + 100 * z
+    auto data = std::make_shared < std::vector < float > > ();
+    for ( int z = 0 ; z < 2 ; z++ ) {
+        for ( int y = 0 ; y < 3 ; y++ ) {
+            for ( int x = 0 ; x < 4 ; x++ ) {
+                data-> push_back( x + 10 * y + 100 * z );
+            }
+        }
+    }
+
+    SECTION( "whole array" ) {
+        FloatRawView view( data, { 4, 3, 2 } );
+        REQUIRE( view.dims() == RawViewInterface::VI( { 4, 3, 2 } ) );
+        Float fview( & view );
+        REQUIRE( fview.get( { 1, 2, 1 } ) == 121 );
+
+        std::vector < float > all;
+        fview.forEach( [& all] ( const float & v ) { all.push_back( v ); } );
+        REQUIRE( all == * data );
+    }
+
+    SECTION( "slice and sub-view" ) {
+        // [1::2, :, 1]
+        FloatRawView view( data, { 4, 3, 2 }, SliceND().start( 1 ).step( 2 ).next().next().index( 1 ) );
+        REQUIRE( view.dims() == RawViewInterface::VI( { 2, 3, -1 } ) );
+
+        std::vector < float > all;
+        Float( & view ).forEach( [& all] ( const float & v ) { all.push_back( v ); } );
+        REQUIRE( all == std::vector < float > ( { 101, 103, 111, 113, 121, 123 } ) );
+
+        // second row of the slice, through getView()
+        std::unique_ptr < RawViewInterface > sub( view.getView( SliceND().next().index( 1 ) ) );
+        all.clear();
+        Float( sub.get() ).forEach( [& all] ( const float & v ) { all.push_back( v ); } );
+        REQUIRE( all == std::vector < float > ( { 111, 113 } ) );
+    }
+
+    SECTION( "single index dimensions are preserved" ) {
+        std::vector < float > plane( data-> begin(), data-> begin() + 12 );
+        auto planeData = std::make_shared < std::vector < float > > ( plane );
+        FloatRawView view( planeData, { 4, 3, -1 } );
+        REQUIRE( view.dims() == RawViewInterface::VI( { 4, 3, -1 } ) );
+    }
+
+    SECTION( "chunked forEach" ) {
+        FloatRawView view( data, { 4, 3, 2 } );
+        std::vector < float > all;
+        int calls = 0;
+        view.forEach( 5 * sizeof( float ), [&] ( const char * ptr, int64_t count ) {
+            const float * fptr = reinterpret_cast < const float * > ( ptr );
+            all.insert( all.end(), fptr, fptr + count );
+            calls++;
+        } );
+        REQUIRE( all == * data );
+        REQUIRE( calls == 5 );
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "core/DefaultMomentGeneratorService.h"
+#include "CartaLib/MemoryImage.h"
+#include "TestUtils.h"
+#include <cmath>
+#include <limits>
+
+using Carta::Core::DefaultMomentGeneratorService;
+using Carta::Lib::IMomentGeneratorService;
+using Carta::Lib::Image::ImageInterface;
+using Carta::Lib::Image::MemoryImage;
+using Carta::Tests::pixels;
+
+TEST_CASE( "Moment generator testing", "[moments]" ) {
+
+    // 2 x 1 x 3 cube, without coordinates the channel index is the spectral coordinate;
+    // the spectrum of the first pixel is 1,2,1, the second pixel is blank
+    const float nan = std::numeric_limits < float >::quiet_NaN();
+    auto data = std::make_shared < std::vector < float > > (
+        std::vector < float > ( { 1, nan, 2, nan, 1, nan } ) );
+    ImageInterface::SharedPtr cube = std::make_shared < MemoryImage > (
+        data, ImageInterface::VI( { 2, 1, 3 } ), Carta::Lib::Unit( "Jy" ), nullptr );
+    auto never = [] () { return false; };
+
+    IMomentGeneratorService::Params params;
+    params.moments = {
+        IMomentGeneratorService::Moment::Integrated,
+        IMomentGeneratorService::Moment::SpectralMean,
+        IMomentGeneratorService::Moment::SpectralDispersion,
+        IMomentGeneratorService::Moment::Peak
+    };
+
+    SECTION( "all channels" ) {
+        auto result = DefaultMomentGeneratorService::compute( cube, params, never );
+        REQUIRE( result.size() == 4 );
+        REQUIRE( result[0]-> dims() == ImageInterface::VI( { 2, 1, 1 } ) );
+        REQUIRE( pixels( * result[0] )[0] == Approx( 4 ) );
+        REQUIRE( pixels( * result[1] )[0] == Approx( 1 ) );
+        REQUIRE( pixels( * result[2] )[0] == Approx( std::sqrt( 0.5 ) ) );
+        REQUIRE( pixels( * result[3] )[0] == Approx( 2 ) );
+        for ( auto & image : result ) {
+            REQUIRE( std::isnan( pixels( * image )[1] ) );
+        }
+    }
+
+    SECTION( "channel and intensity ranges" ) {
+        params.minChannel = 1;
+        params.maxChannel = 2;
+        auto result = DefaultMomentGeneratorService::compute( cube, params, never );
+        REQUIRE( pixels( * result[0] )[0] == Approx( 3 ) );
+
+        params.minChannel = - 1;
+        params.maxChannel = - 1;
+        params.minIntensity = 1.5;
+        result = DefaultMomentGeneratorService::compute( cube, params, never );
+        REQUIRE( pixels( * result[1] )[0] == Approx( 1 ) );
+        REQUIRE( pixels( * result[2] )[0] == Approx( 0 ) );
+    }
+
+    SECTION( "cancelled" ) {
+        auto result = DefaultMomentGeneratorService::compute( cube, params, [] () { return true; } );
+        REQUIRE( result.empty() );
+    }
+}
@@ -0,0 +1,166 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "core/PluginManager.h"
+#include <list>
+
+namespace
+{
+/// memoized hook used only by these tests
+class CountHook : public BaseHook
+{
+    CLASS_BOILERPLATE( CountHook );
+
+public:
+
+    // not used by any real hook
+    enum { staticId = 900 };
+
+    typedef int ResultType;
+
+    struct Params {
+        Params( int p_base ) : base( p_base ) { }
+
+        int base;
+    };
+
+    CountHook( Params * pptr ) : BaseHook( staticId ), paramsPtr( pptr ) { }
+
+    ResultType result = 0;
+    Params * paramsPtr;
+};
+}
+
+template <>
+struct HookMemoization < CountHook > {
+    static constexpr bool memoize = true;
+
+    static QString
+    key( const CountHook::Params & params )
+    {
+        return QString::number( params.base );
+    }
+};
+
+namespace
+{
+/// answers CountHook with base + value, optionally calling the hook itself
+class CountPlugin : public IPlugin
+{
+public:
+
+    CountPlugin( int value, PluginManager * nestedPm = nullptr )
+        : m_value( value )
+          , m_nestedPm( nestedPm )
+    { }
+
+    virtual std::vector < HookId >
+    getInitialHookList() override
+    {
+        return { CountHook::staticId };
+    }
+
+    virtual bool
+    handleHook( BaseHook & hookData ) override
+    {
+        if ( ! hookData.is < CountHook > () ) {
+            return false;
+        }
+        calls++;
+        CountHook & hook = static_cast < CountHook & > ( hookData );
+        hook.result = hook.paramsPtr-> base + m_value;
+        if ( m_nestedPm && hook.paramsPtr-> base == 0 ) {
+            hook.result += m_nestedPm-> prepare < CountHook > ( 100 ).first().val();
+        }
+        return true;
+    }
+
+    int calls = 0;
+
+private:
+
+    int m_value;
+    PluginManager * m_nestedPm;
+};
+
+/// plugin manager with plugins added directly, instead of loaded from disk
+class TestPluginManager : public PluginManager
+{
+public:
+
+    void
+    addPlugin( IPlugin * plugin )
+    {
+        m_infos.emplace_back();
+        m_infos.back().rawPlugin = plugin;
+        for ( HookId id : plugin-> getInitialHookList() ) {
+            m_hook2plugin[id].push_back( & m_infos.back() );
+        }
+        buildDispatchTable();
+    }
+
+private:
+
+    std::list < PluginInfo > m_infos;
+};
+}
+
+TEST_CASE( "PluginManager hook memoization", "[plugins]" ) {
+
+    TestPluginManager pm;
+    CountPlugin p1( 1 ), p2( 2 ), p3( 3 );
+    pm.addPlugin( & p1 );
+    pm.addPlugin( & p2 );
+    pm.addPlugin( & p3 );
+
+    auto all = [&] ( int base ) {
+        std::vector < int > results;
+        pm.prepare < CountHook > ( base ).forEach( [&] ( const int & res ) {
+            results.push_back( res );
+        } );
+        return results;
+    };
+
+    SECTION( "results are replayed instead of calling plugins again" ) {
+        REQUIRE( pm.prepare < CountHook > ( 10 ).first().val() == 11 );
+        REQUIRE( pm.prepare < CountHook > ( 10 ).first().val() == 11 );
+        REQUIRE( p1.calls == 1 );
+        REQUIRE( p2.calls == 0 );
+
+        // different parameters are remembered separately
+        REQUIRE( pm.prepare < CountHook > ( 20 ).first().val() == 21 );
+        REQUIRE( p1.calls == 2 );
+    }
+
+    SECTION( "a partial memo is resumed where it stopped" ) {
+        REQUIRE( pm.prepare < CountHook > ( 10 ).first().val() == 11 );
+        REQUIRE( all( 10 ) == std::vector < int > ( { 11, 12, 13 } ) );
+        REQUIRE( all( 10 ) == std::vector < int > ( { 11, 12, 13 } ) );
+        REQUIRE( p1.calls == 1 );
+        REQUIRE( p2.calls == 1 );
+        REQUIRE( p3.calls == 1 );
+    }
+
+    SECTION( "clearing the memos calls plugins again" ) {
+        REQUIRE( all( 10 ).size() == 3 );
+        pm.clearHookMemos();
+        REQUIRE( all( 10 ).size() == 3 );
+        REQUIRE( p1.calls == 2 );
+        REQUIRE( p3.calls == 2 );
+    }
+}
+
+TEST_CASE( "PluginManager memoized hooks called from plugins", "[plugins]" ) {
+
+    // the plugin calls the same hook (with other parameters) while handling it,
+    // which must not deadlock on the memo lock
+    TestPluginManager pm;
+    CountPlugin nested( 1, & pm );
+    pm.addPlugin( & nested );
+
+    REQUIRE( pm.prepare < CountHook > ( 0 ).first().val() == 1 + 101 );
+    REQUIRE( pm.prepare < CountHook > ( 0 ).first().val() == 1 + 101 );
+    REQUIRE( nested.calls == 2 );
+}
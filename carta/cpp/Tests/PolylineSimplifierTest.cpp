@@ -0,0 +1,43 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Algorithms/PolylineSimplifier.h"
+
+using Carta::Lib::Algorithms::PolylineSimplifier;
+
+TEST_CASE( "PolylineSimplifier testing", "[lod]" ) {
+
+    SECTION( "collinear vertices are removed" ) {
+        QPolygonF line;
+        for ( int i = 0 ; i <= 100 ; ++i ) {
+            line << QPointF( i, 0.5 * i );
+        }
+        QPolygonF simple = PolylineSimplifier( 0.01 ).simplify( line );
+        REQUIRE( simple == QPolygonF( { QPointF( 0, 0 ), QPointF( 100, 50 ) } ) );
+    }
+
+    SECTION( "details larger than the tolerance are kept" ) {
+        QPolygonF zigzag;
+        for ( int i = 0 ; i <= 10 ; ++i ) {
+            zigzag << QPointF( i, ( i % 2 ) * 2.0 );
+        }
+        REQUIRE( PolylineSimplifier( 1.0 ).simplify( zigzag ) == zigzag );
+        REQUIRE( PolylineSimplifier( 3.0 ).simplify( zigzag ).size() == 2 );
+    }
+
+    SECTION( "closed polylines stay closed" ) {
+        QPolygonF square( { QPointF( 0, 0 ), QPointF( 1, 0 ), QPointF( 2, 0 ),
+                            QPointF( 2, 1 ), QPointF( 2, 2 ), QPointF( 1, 2 ),
+                            QPointF( 0, 2 ), QPointF( 0, 1 ), QPointF( 0, 0 ) } );
+        QPolygonF simple = PolylineSimplifier( 0.1 ).simplify( square );
+        REQUIRE( simple == QPolygonF( { QPointF( 0, 0 ), QPointF( 2, 0 ), QPointF( 2, 2 ),
+                                        QPointF( 0, 2 ), QPointF( 0, 0 ) } ) );
+    }
+
+    SECTION( "zero tolerance leaves polylines alone" ) {
+        QPolygonF line( { QPointF( 0, 0 ), QPointF( 1, 0 ), QPointF( 2, 0 ) } );
+        REQUIRE( PolylineSimplifier().simplify( line ) == line );
+    }
+}
@@ -22,6 +22,10 @@ public:
         stateString_p = s;
     }
 
+    int slotCount () const {
+        return keySlotCount();
+    }
+
 private:
 
     virtual QString fetchStateImpl (){
@@ -264,6 +268,86 @@ TEST_CASE( "Carta state test", "[testname]" ) {
         tester.flushState();
     }
 
+    SECTION( "Test keys looked up in advance"){
+        tester.setStateString ("{\"i\":123,\"sub\":{\"s\":7,\"z\": [10,20,30]}}");
+        tester.fetchState();
+        Carta::State::StateInterface::Key iKey = tester.key( "i" );
+        Carta::State::StateInterface::Key sKey = tester.key( "sub" + del + "s" );
+        Carta::State::StateInterface::Key zKey = tester.key( subZ + del + "1" );
+        REQUIRE( iKey.isValid() );
+        REQUIRE( tester.getValue<int>( iKey ) == 123 );
+        REQUIRE( tester.getValue<int>( sKey ) == 7 );
+        REQUIRE( tester.getValue<int>( zKey ) == 20 );
+
+        //Keys and key strings refer to the same values.
+        tester.setValue<int>( iKey, 321 );
+        REQUIRE( tester.getValue<int>( "i" ) == 321 );
+        tester.setValue<int>( "sub" + del + "s", 8 );
+        REQUIRE( tester.getValue<int>( sKey ) == 8 );
+
+        //Keys still work after the structure of the state changed.
+        tester.insertValue<int>( "sub" + del + "a", 1 );
+        tester.insertObject( "obj" );
+        tester.resizeArray( subZ, 5, StateInterfaceTestImpl::PreserveAll );
+        REQUIRE( tester.getValue<int>( iKey ) == 321 );
+        REQUIRE( tester.getValue<int>( sKey ) == 8 );
+        REQUIRE( tester.getValue<int>( zKey ) == 20 );
+
+        //Values that no longer exist.
+        tester.resizeArray( subZ, 1, StateInterfaceTestImpl::PreserveAll );
+        try {
+            tester.getValue<int>( zKey );
+            REQUIRE( false );
+        }
+        catch( invalid_argument & e ){
+            qDebug() << "Expected exception: "<< e.what();
+        }
+        tester.setObject( "sub" );
+        try {
+            tester.getValue<int>( sKey );
+            REQUIRE( false );
+        }
+        catch( invalid_argument & e ){
+            qDebug() << "Expected exception: "<< e.what();
+        }
+
+        //And values that exist again.
+        tester.insertValue<int>( "sub" + del + "s", 9 );
+        REQUIRE( tester.getValue<int>( sKey ) == 9 );
+
+        //Keys work with copies of the state.
+        StateInterfaceTestImpl copy( tester );
+        copy.setValue<int>( iKey, 5 );
+        REQUIRE( copy.getValue<int>( iKey ) == 5 );
+        REQUIRE( tester.getValue<int>( iKey ) == 321 );
+        tester.flushState();
+    }
+
+    SECTION( "Test many different key strings"){
+        tester.setStateString ("{\"i\":1,\"a\": []}");
+        tester.fetchState();
+        Carta::State::StateInterface::Key iKey = tester.key( "i" );
+        const int count = 1000;
+        tester.resizeArray( "a", count );
+        for ( int i = 0; i < count; i++ ){
+            tester.setValue<int>( "a" + del + QString::number( i ), i );
+        }
+        //The key strings looked up on the way are dropped, but not the Keys.
+        for ( int i = 0; i < count; i++ ){
+            REQUIRE( tester.getValue<int>( "a" + del + QString::number( i ) ) == i );
+        }
+        REQUIRE( tester.getValue<int>( iKey ) == 1 );
+        //At most 256 key strings are kept, plus the Key.
+        REQUIRE( tester.slotCount() <= 256 + 1 );
+
+        //Copies share the looked up keys until they add their own.
+        StateInterfaceTestImpl copy( tester );
+        copy.setValue<int>( "a" + del + "5", 50 );
+        REQUIRE( copy.getValue<int>( iKey ) == 1 );
+        REQUIRE( tester.getValue<int>( "a" + del + "5" ) == 5 );
+        tester.flushState();
+    }
+
     SECTION( "Test null"){
         tester.setStateString ("{}");
         tester.insertNull ("n");
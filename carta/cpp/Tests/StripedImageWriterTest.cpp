@@ -0,0 +1,88 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "core/StripedImageWriter.h"
+#include <QImageReader>
+#include <QTemporaryDir>
+#include <algorithm>
+
+using Carta::Core::ImageSaveService::StripedImageWriter;
+
+namespace
+{
+/// a different color for (almost) every pixel
+QRgb
+color( int x, int y )
+{
+    return qRgb( x % 256, y % 256, ( x * 7 + y * 13 ) % 256 );
+}
+
+/// write an image in bands of the given height, read it back and compare every pixel
+void
+roundTrip( const QString & fileName, const QSize & size, int bandHeight )
+{
+    StripedImageWriter::UniquePtr writer = StripedImageWriter::create( fileName, size );
+    REQUIRE( writer != nullptr );
+    for ( int y0 = 0 ; y0 < size.height() ; y0 += bandHeight ) {
+        QImage band( size.width(), std::min( bandHeight, size.height() - y0 ), QImage::Format_RGB32 );
+        for ( int y = 0 ; y < band.height() ; y++ ) {
+            for ( int x = 0 ; x < band.width() ; x++ ) {
+                band.setPixel( x, y, color( x, y0 + y ) );
+            }
+        }
+        REQUIRE( writer-> writeRows( band ) );
+    }
+    REQUIRE( writer-> finish() );
+    writer.reset();
+
+    QImageReader reader( fileName );
+    QImage image = reader.read();
+    INFO( reader.errorString().toStdString() );
+    REQUIRE_FALSE( image.isNull() );
+    REQUIRE( image.size() == size );
+    image = image.convertToFormat( QImage::Format_RGB32 );
+    int mismatches = 0;
+    for ( int y = 0 ; y < size.height() ; y++ ) {
+        for ( int x = 0 ; x < size.width() ; x++ ) {
+            if ( image.pixel( x, y ) != color( x, y ) ) {
+                mismatches++;
+            }
+        }
+    }
+    REQUIRE( mismatches == 0 );
+}
+}
+
+TEST_CASE( "StripedImageWriter testing", "[save]" ) {
+
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    // several full bands and a partial last one
+    const QSize size( 301, 530 );
+
+    SECTION( "png" ) {
+        roundTrip( dir.path() + "/striped.png", size, 256 );
+    }
+
+    SECTION( "tiff" ) {
+        // reading tiff needs the qtimageformats plugin
+        if ( QImageReader::supportedImageFormats().contains( "tiff" ) ) {
+            roundTrip( dir.path() + "/striped.tif", size, 256 );
+        }
+        else {
+            WARN( "no tiff support in QImageReader, only writing the file" );
+            StripedImageWriter::UniquePtr writer = StripedImageWriter::create( dir.path() + "/striped.tif", size );
+            REQUIRE( writer != nullptr );
+        }
+    }
+
+    SECTION( "unsupported formats" ) {
+        REQUIRE( StripedImageWriter::isSupported( "a.PNG" ) );
+        REQUIRE( StripedImageWriter::isSupported( "a.tiff" ) );
+        REQUIRE_FALSE( StripedImageWriter::isSupported( "a.jpg" ) );
+        REQUIRE( StripedImageWriter::create( dir.path() + "/a.jpg", size ) == nullptr );
+    }
+}
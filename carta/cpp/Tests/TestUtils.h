@@ -0,0 +1,28 @@
+/**
+ * Helpers shared by the tests.
+ **/
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include <memory>
+#include <vector>
+
+namespace Carta
+{
+namespace Tests
+{
+/// all the values of a slice of the image, in the order of the slice
+inline std::vector < float >
+pixels( Carta::Lib::Image::ImageInterface & image, const SliceND & slice = SliceND() )
+{
+    std::vector < float > all;
+    std::unique_ptr < Carta::Lib::NdArray::RawViewInterface > view( image.getDataSlice( slice ) );
+    Carta::Lib::NdArray::Float( view.get(), false ).forEach( [& all] ( const float & v ) {
+                                                                 all.push_back( v );
+                                                             }
+                                                             );
+    return all;
+}
+}
+}
@@ -3,7 +3,8 @@
 }
 
 QT      +=  core
-HEADERS += catch.h
+HEADERS += catch.h \
+    TestUtils.h
 
 SOURCES += \
     TopoSortTest.cpp \
@@ -11,7 +12,17 @@ SOURCES += \
     SliceTester.cpp \
     StateTester.cpp \
     pixelPipelineTest.cpp \
-    LineCombinerTest.cpp
+    LineCombinerTest.cpp \
+    VGBufferTest.cpp \
+    CacheRegistryTest.cpp \
+    FloatRawViewTest.cpp \
+    MomentGeneratorTest.cpp \
+    DerivedImageTest.cpp \
+    PolylineSimplifierTest.cpp \
+    PluginManagerTest.cpp \
+    CoordSystemConverterTest.cpp \
+    DisplacementGridTest.cpp \
+    StripedImageWriterTest.cpp
 
 #CONFIG += precompile_header
 #PRECOMPILED_HEADER = catch.h
@@ -0,0 +1,87 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "CartaLib/VectorGraphics/VGList.h"
+#include "CartaLib/VectorGraphics/VGBuffer.h"
+
+using namespace Carta::Lib::VectorGraphics;
+
+static VGList
+makeGrid( int n, QColor color )
+{
+    VGComposer vgc;
+    vgc.append < Entries::SetPen > ( QPen( color, 1 ) );
+    for ( int i = 0 ; i < n ; i++ ) {
+        vgc.append < Entries::DrawLine > ( QPointF( i, 0 ), QPointF( i, n ) );
+    }
+    vgc.append < Entries::DrawText > ( "label", QPointF( 1, 2 ) );
+    return vgc.vgList();
+}
+
+TEST_CASE( "VGBuffer testing", "[vg]" ) {
+
+    SECTION( "conversion from VGList" ) {
+        VGBuffer buff = makeGrid( 10, "red" ).toBuffer();
+        REQUIRE( buff.size() == 12 );
+        REQUIRE( buff.op( 0 ) == VGBuffer::Op::SetPen );
+        REQUIRE( buff.op( 1 ) == VGBuffer::Op::DrawLine );
+        REQUIRE( buff.op( 11 ) == VGBuffer::Op::DrawText );
+    }
+
+    SECTION( "serialization round trip" ) {
+        VGBuffer buff = makeGrid( 100, "red" ).toBuffer();
+        QPolygonF poly;
+        poly << QPointF( 1, 1 ) << QPointF( 2, 3 ) << QPointF( 5, 8 );
+        buff.drawPolyline( poly );
+        buff.setTransform( QTransform().scale( 2, 3 ), true );
+        VGBuffer decoded;
+        REQUIRE( VGBuffer::deserialize( buff.serialize(), decoded ) );
+        REQUIRE( decoded == buff );
+    }
+
+    SECTION( "corrupted data is rejected" ) {
+        QByteArray data = makeGrid( 10, "red" ).toBuffer().serialize();
+        data.chop( 3 );
+        VGBuffer decoded;
+        REQUIRE_FALSE( VGBuffer::deserialize( data, decoded ) );
+        REQUIRE( decoded.size() == 0 );
+
+        // absurd command count in the header (right after the magic and byte order)
+        data = makeGrid( 10, "red" ).toBuffer().serialize();
+        data.replace( 5, 4, QByteArray( 4, char ( 0xff ) ) );
+        REQUIRE_FALSE( VGBuffer::deserialize( data, decoded ) );
+        REQUIRE( decoded.size() == 0 );
+    }
+
+    SECTION( "diff of identical buffers is empty" ) {
+        VGBuffer b1 = makeGrid( 10, "red" ).toBuffer();
+        VGBuffer b2 = makeGrid( 10, "red" ).toBuffer();
+        REQUIRE( VGBufferDiff::compute( b1, b2 ).isEmpty() );
+    }
+
+    SECTION( "color change only ships the pen" ) {
+        VGBuffer b1 = makeGrid( 1000, "red" ).toBuffer();
+        VGBuffer b2 = makeGrid( 1000, "blue" ).toBuffer();
+        VGBufferDiff diff = VGBufferDiff::compute( b1, b2 );
+        REQUIRE( diff.edits().size() == 1 );
+        REQUIRE( diff.edits()[0].insert.size() == 1 );
+        REQUIRE( diff.serialize().size() < b2.serialize().size() / 100 );
+        REQUIRE( diff.apply( b1 ) );
+        REQUIRE( b1 == b2 );
+    }
+
+    SECTION( "diff with different sizes" ) {
+        VGBuffer b1 = makeGrid( 10, "red" ).toBuffer();
+        VGBuffer b2 = makeGrid( 20, "red" ).toBuffer();
+        VGBufferDiff diff;
+        REQUIRE( VGBufferDiff::deserialize( VGBufferDiff::compute( b1, b2 ).serialize(), diff ) );
+        VGBuffer b3 = b1;
+        REQUIRE( diff.apply( b3 ) );
+        REQUIRE( b3 == b2 );
+
+        // applying to the wrong buffer must fail
+        REQUIRE_FALSE( diff.apply( b2 ) );
+    }
+}
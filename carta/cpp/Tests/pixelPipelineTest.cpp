@@ -1,5 +1,6 @@
 #include "catch.h"
 #include "CartaLib/PixelPipeline/CustomizablePixelPipeline.h"
+#include "CartaLib/TPixelPipeline/IScalar2Scalar.h"
 #include "core/GrayColormap.h"
 #include <QColor>
 
@@ -31,4 +32,58 @@ TEST_CASE( "Cached Pixel Pipeline testing", "[pp]" ) {
         REQUIRE( ok);
     }
 
+    SECTION( "Float pipeline matches double pipeline") {
+        Core::GrayColormap::SharedPtr grayCmap = std::make_shared<Core::GrayColormap>();
+        Lib::PixelPipeline::CustomizablePixelPipeline pp;
+        pp.setColormap( grayCmap);
+        pp.setMinMax( -2, 2);
+        Lib::PixelPipeline::CachedPipeline<false> cpp;
+        cpp.cache( pp, 1000, -2, 2);
+        Lib::TemplatedPixelPipeline::CachedPipeline<float, false> fcpp;
+        fcpp.cache( pp, 1000, -2, 2);
+        Lib::TemplatedPixelPipeline::CachedPipeline<float, true> fcppi;
+        fcppi.cache( pp, 1000, -2, 2);
+        for( float x = -3 ; x < 3 ; x += 0.01) {
+            QRgb v1, v2, v3;
+            cpp.convertq( x, v1);
+            fcpp.convertq( x, v2);
+            fcppi.convertq( x, v3);
+            INFO( QString::number(x).toStdString());
+            REQUIRE( std::abs( qRed(v1) - qRed(v2)) <= 1);
+            REQUIRE( std::abs( qRed(v1) - qRed(v3)) <= 1);
+        }
+
+        // NaNs get their own color
+        float row[] = { -5, std::nanf(""), 5 };
+        QRgb out[3];
+        fcpp.convertRow( row, 3, out, qRgb( 255, 0, 0));
+        REQUIRE( out[0] == qRgb( 0, 0, 0));
+        REQUIRE( out[1] == qRgb( 255, 0, 0));
+        REQUIRE( out[2] == qRgb( 255, 255, 255));
+    }
+
+    SECTION( "Float pipeline with an empty clip range") {
+        Core::GrayColormap::SharedPtr grayCmap = std::make_shared<Core::GrayColormap>();
+        Lib::PixelPipeline::CustomizablePixelPipeline pp;
+        pp.setColormap( grayCmap);
+        pp.setMinMax( 3, 4);
+        Lib::TemplatedPixelPipeline::CachedPipeline<float, false> fcpp;
+        fcpp.cache( pp, 100, 3, 3);
+        Lib::TemplatedPixelPipeline::CachedPipeline<float, true> fcppi;
+        fcppi.cache( pp, 100, 3, 3);
+
+        // constant images (min == max) behave as if the range was [min..min+1]
+        float row[] = { 2, 3, 3.5, 4, 100 };
+        QRgb out[5], outi[5];
+        fcpp.convertRow( row, 5, out, qRgb( 255, 0, 0));
+        fcppi.convertRow( row, 5, outi, qRgb( 255, 0, 0));
+        REQUIRE( out[0] == qRgb( 0, 0, 0));
+        REQUIRE( out[1] == qRgb( 0, 0, 0));
+        REQUIRE( out[3] == qRgb( 255, 255, 255));
+        REQUIRE( out[4] == qRgb( 255, 255, 255));
+        REQUIRE( outi[1] == qRgb( 0, 0, 0));
+        REQUIRE( outi[4] == qRgb( 255, 255, 255));
+        REQUIRE( std::abs( qRed( out[2]) - qRed( outi[2])) <= 2);
+    }
+
 }
@@ -8,6 +8,7 @@ CASACOREDIR=../../ThirdParty/casacore-2.0.1-shared
 ASTLIBDIR = ../../ThirdParty/ast-8.2.0
 WCSLIBDIR=../../ThirdParty/wcslib-4.23-shared
 CFITSIODIR=../../ThirdParty/cfitsio-3360-shared
+LEVELDBDIR=../../ThirdParty/leveldb-1.19
 
 # don't edit these:
 # relative links are replaced by absolute paths
@@ -15,3 +16,4 @@ CASACOREDIR=$$absolute_path($${CASACOREDIR})
 ASTLIBDIR=$$absolute_path($${ASTLIBDIR})
 WCSLIBDIR=$$absolute_path($${WCSLIBDIR})
 CFITSIODIR=$$absolute_path($${CFITSIODIR})
+LEVELDBDIR=$$absolute_path($${LEVELDBDIR})
@@ -20,6 +20,7 @@
 #include <QtCore/qmath.h>
 #include <QDir>
 #include <QDebug>
+#include <QtConcurrent>
 
 namespace Carta {
 
@@ -99,6 +100,18 @@ Histogram::Histogram( const QString& path, const QString& id):
     _initializeCallbacks();
     _setErrorMargin();
 
+    m_binCountKey = m_state.key( BIN_COUNT );
+    m_clipBufferKey = m_state.key( CLIP_BUFFER );
+    m_frequencyUnitKey = m_state.key( FREQUENCY_UNIT );
+    m_planeModeKey = m_state.key( PLANE_MODE );
+    m_planeMinKey = m_stateData.key( PLANE_MIN );
+    m_planeMaxKey = m_stateData.key( PLANE_MAX );
+    m_clipMinKey = m_stateData.key( CLIP_MIN );
+    m_clipMaxKey = m_stateData.key( CLIP_MAX );
+    m_clipMinPercentKey = m_stateData.key( CLIP_MIN_PERCENT );
+    m_clipMaxPercentKey = m_stateData.key( CLIP_MAX_PERCENT );
+    m_clipBufferSizeKey = m_stateData.key( CLIP_BUFFER_SIZE );
+
     m_view.reset( new ImageView( path, QColor("yellow"), QImage(), &m_stateMouse));
     connect( m_view.get(), SIGNAL(resize(const QSize&)), this, SLOT(_updateSize(const QSize&)));
     registerView(m_view.get());
@@ -107,6 +120,7 @@ Histogram::Histogram( const QString& path, const QString& id):
     m_controllerLinked = false;
     m_cubeChannel = 0;
     m_histogram = new Carta::Histogram::HistogramGenerator();
+    connect( &m_dataWatcher, SIGNAL(finished()), this, SLOT(_loadDataDone()));
 
     //Load the available clips.
     if ( m_clips == nullptr ){
@@ -298,15 +312,15 @@ QString Histogram::getStateString( const QString& sessionId, SnapshotType type )
 }
 
 
-double Histogram::_getBufferedIntensity( const QString& clipKey, const QString& percentKey ){
-    double intensity = m_stateData.getValue<double>(clipKey);
+double Histogram::_getBufferedIntensity( bool clipMax ){
+    double intensity = m_stateData.getValue<double>( clipMax ? m_clipMaxKey : m_clipMinKey );
     //Add padding to either side of the intensity if we are not already at our max.
-    if ( m_state.getValue<bool>(CLIP_BUFFER) ){
-        float bufferPercentile = m_stateData.getValue<int>(CLIP_BUFFER_SIZE ) / 2.0;
+    if ( m_state.getValue<bool>( m_clipBufferKey ) ){
+        float bufferPercentile = m_stateData.getValue<int>( m_clipBufferSizeKey ) / 2.0;
         //See how much padding we have on either side.
-        float existing = m_stateData.getValue<double>(percentKey);
+        float existing = m_stateData.getValue<double>( clipMax ? m_clipMaxPercentKey : m_clipMinPercentKey );
         float actual = existing - bufferPercentile;
-        if ( clipKey == CLIP_MAX){
+        if ( clipMax ){
             actual = existing + bufferPercentile;
         }
         if ( actual < 0 ){
@@ -351,7 +365,7 @@ Controller* Histogram::_getControllerSelected() const {
 std::pair<int,int> Histogram::_getFrameBounds() const {
     int minChannel = -1;
     int maxChannel = -1;
-    QString planeMode = m_state.getValue<QString>(PLANE_MODE );
+    QString planeMode = m_state.getValue<QString>( m_planeModeKey );
     if ( planeMode == PLANE_MODE_SINGLE ){
         minChannel = m_cubeChannel;
         maxChannel = m_cubeChannel;
@@ -908,6 +922,22 @@ bool Histogram::isLinked( const QString& linkId ) const {
 }
 
 
+Carta::Lib::IMomentGeneratorService::Params Histogram::getDataSelection(){
+    Carta::Lib::IMomentGeneratorService::Params selection;
+    selection.rangeUnits = m_state.getValue<QString>( m_frequencyUnitKey );
+    QString planeMode = m_state.getValue<QString>( m_planeModeKey );
+    if ( planeMode == PLANE_MODE_RANGE ){
+        selection.minFrequency = m_stateData.getValue<double>( m_planeMinKey );
+        selection.maxFrequency = m_stateData.getValue<double>( m_planeMaxKey );
+    }
+    std::pair<int,int> frameBounds = _getFrameBounds();
+    selection.minChannel = frameBounds.first;
+    selection.maxChannel = frameBounds.second;
+    selection.minIntensity = _getBufferedIntensity( false );
+    selection.maxIntensity = _getBufferedIntensity( true );
+    return selection;
+}
+
 void Histogram::_loadData( Controller* controller )
 {
 
@@ -915,20 +945,15 @@ void Histogram::_loadData( Controller* controller )
         return;
     }
 
-    int binCount = m_state.getValue<int>(BIN_COUNT)+1;
-    double minFrequency = -1;
-    double maxFrequency = -1;
-    QString rangeUnits = m_state.getValue<QString>(FREQUENCY_UNIT );
-    QString planeMode = m_state.getValue<QString>(PLANE_MODE);
-    if ( planeMode == PLANE_MODE_RANGE ){
-        minFrequency = m_stateData.getValue<double>(PLANE_MIN);
-        maxFrequency = m_stateData.getValue<double>(PLANE_MAX);
-    }
-    std::pair<int,int> frameBounds = _getFrameBounds();
-    int minChannel = frameBounds.first;
-    int maxChannel = frameBounds.second;
-    double minIntensity = _getBufferedIntensity( CLIP_MIN, CLIP_MIN_PERCENT );
-    double maxIntensity = _getBufferedIntensity( CLIP_MAX, CLIP_MAX_PERCENT );
+    int binCount = m_state.getValue<int>( m_binCountKey )+1;
+    Carta::Lib::IMomentGeneratorService::Params selection = getDataSelection();
+    double minFrequency = selection.minFrequency;
+    double maxFrequency = selection.maxFrequency;
+    QString rangeUnits = selection.rangeUnits;
+    int minChannel = selection.minChannel;
+    int maxChannel = selection.maxChannel;
+    double minIntensity = selection.minIntensity;
+    double maxIntensity = selection.maxIntensity;
 
 
 //    std::vector<std::shared_ptr<Carta::Lib::Image::ImageInterface>> dataSources;
@@ -938,27 +963,30 @@ void Histogram::_loadData( Controller* controller )
 //        if ( stackedImageCount > 0 ){
         if ( dataSources.size() > 0 ) {
 //            dataSources = _generateData( controller );
-            auto result = Globals::instance()-> pluginManager()
+            //Reading the images can take a while, so the plugins run on a worker
+            //thread and the result is applied in _loadDataDone().
+            m_dataPending = true;
+            m_dataWatcher.setFuture( QtConcurrent::run( [=] () {
+                HistogramData data;
+                auto result = Globals::instance()-> pluginManager()
                                       -> prepare <Carta::Lib::Hooks::HistogramHook>(dataSources, binCount,
                                               minChannel, maxChannel, minFrequency, maxFrequency, rangeUnits,
                                               minIntensity, maxIntensity);
-            auto lam = [=] ( const Carta::Lib::Hooks::HistogramResult &data ) {
-                m_histogram->setData(data);
-                double freqLow = data.getFrequencyMin();
-                double freqHigh = data.getFrequencyMax();
-                setPlaneRange( freqLow, freqHigh);
-            };
-            try {
-                result.forEach( lam );
-            }
-            catch( char*& error ){
-                QString errorStr( error );
-                ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
-                hr->registerError( errorStr );
-            }
+                auto lam = [&data] ( const Carta::Lib::Hooks::HistogramResult &res ) {
+                    data.results.push_back( res );
+                };
+                try {
+                    result.forEach( lam );
+                }
+                catch( char*& error ){
+                    data.error = QString( error );
+                }
+                return data;
+            }));
         }
 //        else if ( stackedImageCount == 0 ){
         else {
+            m_dataPending = false;
             _resetDefaultStateData();
             const Carta::Lib::Hooks::HistogramResult data;
             m_histogram->setData( data );
@@ -966,6 +994,26 @@ void Histogram::_loadData( Controller* controller )
 //    }
 }
 
+void Histogram::_loadDataDone(){
+    //A newer request replaced this one, or the result was already applied.
+    if ( !m_dataPending ){
+        return;
+    }
+    m_dataPending = false;
+    HistogramData data = m_dataWatcher.result();
+    for ( const Carta::Lib::Hooks::HistogramResult& result : data.results ){
+        m_histogram->setData( result );
+        double freqLow = result.getFrequencyMin();
+        double freqHigh = result.getFrequencyMax();
+        setPlaneRange( freqLow, freqHigh );
+    }
+    if ( !data.error.isEmpty() ){
+        ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+        hr->registerError( data.error );
+    }
+    _generateHistogram( false );
+}
+
 void Histogram::refreshState() {
     CartaObject::refreshState();
     m_stateData.refreshState();
@@ -1574,6 +1622,11 @@ QString Histogram::saveHistogram( const QString& fileName ){
         result = "Please make sure the save path is valid: "+fileName;
     }
     else {
+        //Save the histogram of the current settings, even if it is still being computed.
+        if ( m_dataPending ){
+            m_dataWatcher.waitForFinished();
+            _loadDataDone();
+        }
         PreferencesSave* prefSave = Util::findSingletonObject<PreferencesSave>();
         int width = prefSave->getWidth();
         int height = prefSave->getHeight();
@@ -9,8 +9,11 @@
 #include "State/StateInterface.h"
 #include "Data/ILinkable.h"
 #include "CartaLib/IImage.h"
+#include "CartaLib/IMomentGeneratorService.h"
+#include "CartaLib/Hooks/HistogramResult.h"
 
 #include <QObject>
+#include <QFutureWatcher>
 
 namespace Carta {
 namespace Lib {
@@ -68,6 +71,13 @@ public:
      */
     QString getPreferencesId() const;
 
+    /**
+     * Returns the channels and intensities the histogram is computed from, so that
+     * other analyses (e.g. moment maps) can use the same selection.
+     * @return the selection, with no moments requested.
+     */
+    Carta::Lib::IMomentGeneratorService::Params getDataSelection();
+
     /**
      * Return a string representing the histogram state of a particular type.
      * @param type - the type of state needed.
@@ -339,6 +349,9 @@ private slots:
 
     void _updateSize( const QSize& size );
     void _updateChannel( Controller* controller );
+
+    //The histogram data computed on a worker thread is ready.
+    void _loadDataDone();
     
 
 private:
@@ -346,7 +359,7 @@ private:
     void _finishClips();
     void _finishColor();
 
-    double _getBufferedIntensity( const QString& clipKey, const QString& percentKey );
+    double _getBufferedIntensity( bool clipMax );
     std::pair<int,int> _getFrameBounds() const;
     double _getPercentile( const QString& fileName, int frameIndex, double intensity ) const;
     bool _getIntensity( const QString& fileName, int frameIndex, double percentile, double* intensity ) const;
@@ -470,8 +483,31 @@ private:
 
     Carta::Histogram::HistogramGenerator* m_histogram = nullptr;
 
+    //Histogram data computed by the plugins.
+    struct HistogramData {
+        std::vector<Carta::Lib::Hooks::HistogramResult> results;
+        QString error;
+    };
+
+    //The plugins read the images on a worker thread, only the latest request is applied.
+    QFutureWatcher<HistogramData> m_dataWatcher;
+    bool m_dataPending = false;
+
     //State specific to the data that is loaded.
     Carta::State::StateInterface m_stateData;
+
+    //State read every time the histogram is computed, looked up once.
+    Carta::State::StateInterface::Key m_binCountKey;
+    Carta::State::StateInterface::Key m_clipBufferKey;
+    Carta::State::StateInterface::Key m_frequencyUnitKey;
+    Carta::State::StateInterface::Key m_planeModeKey;
+    Carta::State::StateInterface::Key m_planeMinKey;
+    Carta::State::StateInterface::Key m_planeMaxKey;
+    Carta::State::StateInterface::Key m_clipMinKey;
+    Carta::State::StateInterface::Key m_clipMaxKey;
+    Carta::State::StateInterface::Key m_clipMinPercentKey;
+    Carta::State::StateInterface::Key m_clipMaxPercentKey;
+    Carta::State::StateInterface::Key m_clipBufferSizeKey;
     //Separate state for mouse events since they get updated rapidly and not
     //everyone wants to listen to them.
     Carta::State::StateInterface m_stateMouse;
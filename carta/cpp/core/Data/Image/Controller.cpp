@@ -13,11 +13,20 @@
 #include "Data/Util.h"
 #include "ImageView.h"
 #include "CartaLib/IImage.h"
+#include "CartaLib/ImageRegistry.h"
+#include "CartaLib/DerivedImage.h"
+#include "CartaLib/Hooks/GetMomentGeneratorService.h"
+#include "CartaLib/Hooks/RawViewFunction.h"
+#include "DefaultMomentGeneratorService.h"
+#include "Globals.h"
 #include "CartaLib/PixelPipeline/CustomizablePixelPipeline.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QList>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+#include <cmath>
 #include <memory>
 #include <set>
 
@@ -44,9 +53,15 @@ const QString Controller::AUTO_CLIP = "autoClip";
 const QString Controller::DATA = "data";
 const QString Controller::DATA_PATH = "dataPath";
 const QString Controller::CURSOR = "formattedCursorCoordinates";
+const int Controller::CURSOR_UPDATE_INTERVAL = 16;
 const QString Controller::CENTER = "center";
 const QString Controller::POINTER_MOVE = "pointer-move";
 const QString Controller::ZOOM = "zoom";
+const QString Controller::LOAD = "load";
+const QString Controller::LOAD_FILE = "file";
+const QString Controller::LOAD_STATUS = "status";
+const QString Controller::LOAD_PROGRESS = "progress";
+const QString Controller::LOAD_FRAMES = "frames";
 const QString Controller::REGIONS = "regions";
 const QString Controller::PLUGIN_NAME = "CasaImageLoader";
 
@@ -65,11 +80,14 @@ Controller::Controller( const QString& path, const QString& id ) :
         m_view(nullptr),
         m_stateData( UtilState::getLookup(path, StateInterface::STATE_DATA )),
         m_stateMouse(UtilState::getLookup(path, ImageView::VIEW)),
+        m_stateLoad(UtilState::getLookup(path, LOAD)),
+        m_pendingData(nullptr),
         m_viewSize( 400, 400){
     m_view.reset( new ImageView( path, QColor("pink"), QImage(), &m_stateMouse));
     
     m_reloadFrameQueued = false;
     m_repaintFrameQueued = false;
+    m_cursorUpdateQueued = false;
     
     _initializeSelections();
 
@@ -124,16 +142,7 @@ bool Controller::addData(const QString& fileName) {
 
     bool successfulLoad = m_datas[targetIndex]->_setFileName(fileName );
     if ( successfulLoad ){
-        int frameCount = m_datas[targetIndex]->_getFrameCount();
-        m_selectChannel->setUpperBound( frameCount );
-        m_selectImage->setIndex(targetIndex);
-        saveState();
-
-        //Refresh the view of the data.
-        _scheduleFrameReload();
-
-        //Notify others there has been a change to the data.
-        emit dataChanged( this );
+        _dataAdded( targetIndex );
     }
     else {
         QString error = "Unable to load image: "+fileName+".  Please check the file is a supported image format.";
@@ -143,6 +152,260 @@ bool Controller::addData(const QString& fileName) {
     return successfulLoad;
 }
 
+void Controller::addDataAsync(const QString& fileName) {
+    //Data we already have does not need to be read again.
+    for (int i = 0; i < m_datas.size(); i++) {
+        if (m_datas[i]->_contains(fileName)) {
+            addData( fileName );
+            return;
+        }
+    }
+
+    //Only one load at a time; a new request replaces the old one.
+    cancelLoad();
+
+    //The data source is not added to m_datas until its image is ready, so
+    //rendering continues with the data we have in the meantime.
+    Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
+    m_pendingData = objMan->createObject<DataSource>();
+    connect( m_pendingData, & DataSource::fileOpened, this, & Controller::_dataOpened );
+    connect( m_pendingData, & DataSource::fileLoaded, this, & Controller::_dataLoaded );
+    m_stateLoad.setValue<QString>( LOAD_FILE, fileName );
+    m_stateLoad.setValue<int>( LOAD_FRAMES, 0 );
+    _setLoadStatus( "opening", 0 );
+    m_pendingData->_setFileNameAsync( fileName );
+}
+
+void Controller::cancelLoad(){
+    if ( m_pendingData != nullptr ){
+        //Reading the file cannot be interrupted, but its result will be discarded.
+        m_pendingData->_cancelLoad();
+        Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
+        objMan->destroyObject( m_pendingData->getId() );
+        m_pendingData = nullptr;
+        _setLoadStatus( "cancelled", 0 );
+    }
+}
+
+void Controller::addImage( const QString& name, std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    //The image is not in the registry, so it gets a key of its own for the caches.
+    QString key = "memory:" + QString::number( reinterpret_cast<quintptr>( image.get() ), 16 );
+    Carta::Lib::ImageRegistry::HandlePtr handle =
+            std::make_shared<Carta::Lib::ImageRegistry::Handle>( image, key );
+    Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
+    DataSource* targetSource = objMan->createObject<DataSource>();
+    targetSource->_setImage( name, handle );
+    connect( targetSource, SIGNAL(renderingDone(QImage)), this, SLOT(_renderingDone(QImage)));
+    connect( targetSource, & DataSource::saveImageResult, this, & Controller::saveImageResultCB );
+    int targetIndex = m_datas.size();
+    m_datas.append( targetSource );
+    targetSource->_viewResize( m_viewSize );
+    m_selectImage->setUpperBound(m_datas.size());
+    _dataAdded( targetIndex );
+}
+
+QString Controller::deriveImage( const QString& operation, double value, int otherIndex ){
+    typedef Carta::Lib::Image::DerivedImage DerivedImage;
+    int imageIndex = getSelectImageIndex();
+    if ( imageIndex < 0 || imageIndex >= m_datas.size() ){
+        return "There is no image to derive a new one from.";
+    }
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image = m_datas[imageIndex]->_getImage();
+    DerivedImage::Node::SharedPtr input = DerivedImage::source( image );
+    DerivedImage::Node::SharedPtr root;
+    QString result;
+    QString op = operation.toLower();
+    if ( op == "smooth" ){
+        if ( value > 0 ){
+            root = DerivedImage::smooth( input, value );
+        }
+        else {
+            result = "The smoothing width must be positive: " + QString::number( value );
+        }
+    }
+    else if ( op == "rebin" ){
+        int factor = qRound( value );
+        if ( factor >= 1 && image->dims().size() > 2 ){
+            root = DerivedImage::rebin( input, 2, factor );
+        }
+        else {
+            result = "Could not rebin the channels by " + QString::number( value );
+        }
+    }
+    else if ( op == "ratio" || op == "difference" ){
+        if ( 0 <= otherIndex && otherIndex < m_datas.size() ){
+            DerivedImage::Node::SharedPtr other = DerivedImage::source( m_datas[otherIndex]->_getImage() );
+            if ( op == "ratio" ){
+                root = DerivedImage::combine( input, other, [] ( float a, float b ) { return a / b; } );
+            }
+            else {
+                root = DerivedImage::combine( input, other, [] ( float a, float b ) { return a - b; } );
+            }
+            if ( !root ){
+                result = "The images do not have the same dimensions.";
+            }
+        }
+        else {
+            result = "Invalid image index: " + QString::number( otherIndex );
+        }
+    }
+    else if ( op == "polarizedintensity" ){
+        //Stokes planes are assumed to be in the order I, Q, U, V.
+        int stokesAxis = -1;
+        auto metaData = image->metaData();
+        if ( metaData ){
+            auto cf = metaData->coordinateFormatter();
+            for ( int i = 0; i < cf->nAxes(); i++ ){
+                if ( cf->axisInfo( i ).knownType() == Carta::Lib::AxisInfo::KnownType::STOKES ){
+                    stokesAxis = i;
+                }
+            }
+        }
+        DerivedImage::Node::SharedPtr q, u;
+        if ( stokesAxis >= 0 ){
+            q = DerivedImage::select( input, stokesAxis, 1 );
+            u = DerivedImage::select( input, stokesAxis, 2 );
+        }
+        if ( q && u ){
+            root = DerivedImage::combine( q, u, [] ( float a, float b ) { return std::sqrt( a * a + b * b ); } );
+        }
+        else {
+            result = "The image does not have Q and U stokes planes.";
+        }
+    }
+    else {
+        result = "Unknown operation: " + operation;
+    }
+    if ( root ){
+        auto derived = std::make_shared<DerivedImage>( root, image->getPixelUnit(), image->metaData() );
+        addImage( QFileInfo( m_datas[imageIndex]->_getFileName() ).fileName() + "." + op, derived );
+    }
+    return result;
+}
+
+QString Controller::generateMoments( const Carta::Lib::IMomentGeneratorService::Params& params ){
+    QString result;
+    int imageIndex = getSelectImageIndex();
+    if ( imageIndex < 0 || imageIndex >= m_datas.size() ){
+        result = "There is no image to compute moments of.";
+    }
+    else if ( params.moments.empty() ){
+        result = "No moments were requested.";
+    }
+    else {
+        if ( !m_momentService ){
+            auto res = Globals::instance()-> pluginManager()
+                           -> prepare < Carta::Lib::Hooks::GetMomentGeneratorService > ().first();
+            if ( !res.isNull() && res.val() ){
+                m_momentService = res.val();
+            }
+            else {
+                m_momentService.reset( new Carta::Core::DefaultMomentGeneratorService() );
+            }
+            connect( m_momentService.get(), & Carta::Lib::IMomentGeneratorService::done,
+                    this, & Controller::_momentsDone );
+        }
+        //A new request replaces one that is still running.
+        m_momentSource = m_datas[imageIndex]->_getFileName();
+        m_momentNames.clear();
+        for ( Carta::Lib::IMomentGeneratorService::Moment moment : params.moments ){
+            m_momentNames.append( Carta::Lib::IMomentGeneratorService::momentName( moment ) );
+        }
+        m_momentService->setInput( m_datas[imageIndex]->_getImage() );
+        m_momentService->setParams( params );
+        m_momentService->start();
+    }
+    return result;
+}
+
+QString Controller::callRawViewFunction( const QString& funcName ){
+    QString result;
+    int imageIndex = getSelectImageIndex();
+    if ( imageIndex < 0 || imageIndex >= m_datas.size() ){
+        result = "There is no image to call "+funcName+" on.";
+    }
+    else {
+        int channel = getFrameChannel();
+        std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view(
+                m_datas[imageIndex]->_getRawData( channel, channel ) );
+        if ( !view ){
+            result = "Could not read the pixels of channel "+QString::number( channel )+".";
+        }
+        else {
+            auto res = Globals::instance()-> pluginManager()
+                           -> prepare < Carta::Lib::Hooks::RawViewFunction > ( funcName, view.get() ).first();
+            if ( res.isNull() ){
+                result = "No plugin provides the function "+funcName+".";
+            }
+            else if ( !res.val() ){
+                result = "The function "+funcName+" failed.";
+            }
+        }
+    }
+    return result;
+}
+
+void Controller::_momentsDone( const Carta::Lib::IMomentGeneratorService::Result& result,
+        Carta::Lib::IMomentGeneratorService::JobId /*jobId*/ ){
+    if ( result.empty() ){
+        Util::commandPostProcess( "Could not compute the moments of " + m_momentSource );
+    }
+    //The names follow the order the moments were requested in.
+    QString baseName = QFileInfo( m_momentSource ).fileName();
+    int momentCount = result.size();
+    for ( int i = 0; i < momentCount; i++ ){
+        addImage( baseName + "." + m_momentNames.value( i ), result[i] );
+    }
+}
+
+void Controller::_dataAdded( int targetIndex ){
+    int frameCount = m_datas[targetIndex]->_getFrameCount();
+    m_selectChannel->setUpperBound( frameCount );
+    m_selectImage->setIndex(targetIndex);
+    saveState();
+    _updateReprojections();
+
+    //Refresh the view of the data.
+    _scheduleFrameReload();
+
+    //Notify others there has been a change to the data.
+    emit dataChanged( this );
+}
+
+void Controller::_dataOpened( bool success, int frameCount ){
+    if ( success && m_pendingData != nullptr ){
+        //The header is known; the pixels are still being read.
+        m_stateLoad.setValue<int>( LOAD_FRAMES, frameCount );
+        _setLoadStatus( "header", 0.5 );
+    }
+}
+
+void Controller::_dataLoaded( bool success ){
+    DataSource* targetSource = m_pendingData;
+    if ( targetSource == nullptr ){
+        return;
+    }
+    m_pendingData = nullptr;
+    if ( success ){
+        connect( targetSource, SIGNAL(renderingDone(QImage)), this, SLOT(_renderingDone(QImage)));
+        connect( targetSource, & DataSource::saveImageResult, this, & Controller::saveImageResultCB );
+        int targetIndex = m_datas.size();
+        m_datas.append( targetSource );
+        targetSource->_viewResize( m_viewSize );
+        m_selectImage->setUpperBound(m_datas.size());
+        _dataAdded( targetIndex );
+        _setLoadStatus( "ready", 1 );
+    }
+    else {
+        QString fileName = m_stateLoad.getValue<QString>( LOAD_FILE );
+        QString error = "Unable to load image: "+fileName+".  Please check the file is a supported image format.";
+        Util::commandPostProcess( error );
+        Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
+        objMan->destroyObject( targetSource->getId() );
+        _setLoadStatus( "failed", 0 );
+    }
+}
+
 QString Controller::applyClips( double minIntensityPercentile, double maxIntensityPercentile ){
     QString result;
     bool clipsChanged = false;
@@ -235,6 +498,15 @@ bool Controller::getIntensity( int frameLow, int frameHigh, double percentile, d
     return validIntensity;
 }
 
+std::function<bool(double*)> Controller::getIntensityFunction( int frameLow, int frameHigh, double percentile ) const {
+    std::function<bool(double*)> intensityFunction;
+    int imageIndex = m_selectImage->getIndex();
+    if ( 0 <= imageIndex && imageIndex < m_datas.size() && percentile >= 0.0 && percentile <= 1.0 ){
+        intensityFunction = m_datas[imageIndex]->_getIntensityFunction( frameLow, frameHigh, percentile );
+    }
+    return intensityFunction;
+}
+
 double Controller::getPercentile( int frameLow, int frameHigh, double intensity ) const {
     double percentile = -1;
     int imageIndex = m_selectImage->getIndex();
@@ -317,9 +589,10 @@ QString Controller::getPixelUnits() const {
 QStringList Controller::getCoordinates( double x, double y, Carta::Lib::KnownSkyCS system) const {
     QStringList result;
     int imageIndex = m_selectImage->getIndex();
+    int frameIndex = m_selectChannel->getIndex();
     if ( imageIndex >= 0 && imageIndex < m_datas.size()){
         for ( int i = 0; i <= 1; i++ ){
-            result.append( m_datas[imageIndex]->_getCoordinates( x, y, system, i ) );
+            result.append( m_datas[imageIndex]->_getCoordinates( x, y, frameIndex, system, i ) );
         }
     }
     return result;
@@ -412,6 +685,12 @@ void Controller::_gridChanged( const StateInterface& state, bool applyAll ){
 }
 
 void Controller::_initializeCallbacks(){
+    addCommandCallback( "cancelLoad", [=] (const QString & /*cmd*/,
+                const QString & /*params*/, const QString & /*sessionId*/) -> QString {
+        cancelLoad();
+        return "";
+    });
+
     //Listen for updates to the clip and reload the frame.
     addCommandCallback( "setClipValue", [=] (const QString & /*cmd*/,
                 const QString & params, const QString & /*sessionId*/) -> QString {
@@ -601,6 +880,16 @@ void Controller::_initializeState(){
     m_stateMouse.insertValue<int>(ImageView::MOUSE_X, 0 );
     m_stateMouse.insertValue<int>(ImageView::MOUSE_Y, 0 );
     m_stateMouse.flushState();
+    m_mouseXKey = m_stateMouse.key( ImageView::MOUSE_X );
+    m_mouseYKey = m_stateMouse.key( ImageView::MOUSE_Y );
+    m_cursorKey = m_stateMouse.key( CURSOR );
+
+    //Progress of a background load; not part of any snapshot.
+    m_stateLoad.insertValue<QString>( LOAD_FILE, "" );
+    m_stateLoad.insertValue<QString>( LOAD_STATUS, "" );
+    m_stateLoad.insertValue<double>( LOAD_PROGRESS, 0 );
+    m_stateLoad.insertValue<int>( LOAD_FRAMES, 0 );
+    m_stateLoad.flushState();
 }
 
 void Controller::_loadView( ) {
@@ -674,6 +963,7 @@ void Controller::_removeData( int index ){
         setFrameChannel( 0 );
     }
     m_selectChannel->setUpperBound( frameCount );
+    _updateReprojections();
     this->_loadView();
 
     //Clear the statistics window if there are no images.
@@ -685,6 +975,14 @@ void Controller::_removeData( int index ){
     saveState();
 }
 
+void Controller::_updateReprojections(){
+    //The mappings are cached by the render services, so this is cheap for images
+    //that were already lined up.
+    for ( int i = 0; i < m_datas.size(); i++ ){
+        m_datas[i]->_setReprojection( i > 0 ? m_datas[0] : nullptr );
+    }
+}
+
 void Controller::_render(){
     int imageIndex = m_selectImage->getIndex();
     if ( imageIndex >= 0 && imageIndex < m_datas.size()){
@@ -808,7 +1106,7 @@ QString Controller::saveImage( const QString& fileName ){
     return saveImage( fileName, zoomLevel );
 }
 
-QString Controller::saveImage( const QString& fileName, double scale ){
+QString Controller::saveImage( const QString& fileName, double scale, const QString& saveId ){
     QString result;
     DataLoader* dLoader = Util::findSingletonObject<DataLoader>();
     bool securityRestricted = dLoader->isSecurityRestricted();
@@ -827,7 +1125,7 @@ QString Controller::saveImage( const QString& fileName, double scale ){
                 result = "Please make sure the save path is valid: "+fileName;
             }
             else {
-                m_datas[imageIndex]->_saveImage( fileName, scale, frameIndex );
+                m_datas[imageIndex]->_saveImage( fileName, scale, frameIndex, saveId );
             }
         }
         else {
@@ -840,7 +1138,7 @@ QString Controller::saveImage( const QString& fileName, double scale ){
     return result;
 }
 
-void Controller::saveImageResultCB( bool result ){
+void Controller::saveImageResultCB( bool result, const QString& saveId ){
     if ( !result ){
         QString msg = "There was a problem saving the image.";
         Util::commandPostProcess( msg );
@@ -850,7 +1148,7 @@ void Controller::saveImageResultCB( bool result ){
         ErrorManager* errorMan = Util::findSingletonObject<ErrorManager>();
         errorMan->registerInformation( msg );
     }
-    emit saveImageResult( result );
+    emit saveImageResult( result, saveId );
 }
 
 void Controller::_saveRegions(){
@@ -975,11 +1273,29 @@ void Controller::_updateCursor( int mouseX, int mouseY ){
         return;
     }
 
-    int oldMouseX = m_stateMouse.getValue<int>( ImageView::MOUSE_X );
-    int oldMouseY = m_stateMouse.getValue<int>( ImageView::MOUSE_Y );
+    //Mouse events can arrive much faster than the display refreshes, so we only
+    //remember the latest position and update the cursor text once per refresh.
+    m_cursorPending = QPoint( mouseX, mouseY );
+    if ( m_cursorUpdateQueued ){
+        return;
+    }
+    m_cursorUpdateQueued = true;
+    QTimer::singleShot( CURSOR_UPDATE_INTERVAL, this, SLOT(_updateCursorNow()) );
+}
+
+void Controller::_updateCursorNow(){
+    m_cursorUpdateQueued = false;
+    if ( m_datas.size() == 0 ){
+        return;
+    }
+
+    int mouseX = m_cursorPending.x();
+    int mouseY = m_cursorPending.y();
+    int oldMouseX = m_stateMouse.getValue<int>( m_mouseXKey );
+    int oldMouseY = m_stateMouse.getValue<int>( m_mouseYKey );
     if ( oldMouseX != mouseX || oldMouseY != mouseY ){
-        m_stateMouse.setValue<int>( ImageView::MOUSE_X, mouseX);
-        m_stateMouse.setValue<int>( ImageView::MOUSE_Y, mouseY );
+        m_stateMouse.setValue<int>( m_mouseXKey, mouseX);
+        m_stateMouse.setValue<int>( m_mouseYKey, mouseY );
         _updateCursorText( false );
         m_stateMouse.flushState();
     }
@@ -989,11 +1305,11 @@ void Controller::_updateCursorText(bool notifyClients ){
     QString formattedCursor;
     int imageIndex = m_selectImage->getIndex();
     int frameIndex = m_selectChannel->getIndex();
-    int mouseX = m_stateMouse.getValue<int>(ImageView::MOUSE_X );
-    int mouseY = m_stateMouse.getValue<int>(ImageView::MOUSE_Y );
+    int mouseX = m_stateMouse.getValue<int>( m_mouseXKey );
+    int mouseY = m_stateMouse.getValue<int>( m_mouseYKey );
     QString cursorText = m_datas[imageIndex]->_getCursorText( mouseX, mouseY,frameIndex);
-    if ( cursorText != m_stateMouse.getValue<QString>(CURSOR)){
-        m_stateMouse.setValue<QString>( CURSOR, cursorText );
+    if ( cursorText != m_stateMouse.getValue<QString>( m_cursorKey )){
+        m_stateMouse.setValue<QString>( m_cursorKey, cursorText );
         if ( notifyClients ){
             m_stateMouse.flushState();
         }
@@ -1127,6 +1443,12 @@ QString Controller::setClipValue( double clipVal  ) {
     return result;
 }
 
+void Controller::_setLoadStatus( const QString& status, double progress ){
+    m_stateLoad.setValue<QString>( LOAD_STATUS, status );
+    m_stateLoad.setValue<double>( LOAD_PROGRESS, progress );
+    m_stateLoad.flushState();
+}
+
 void Controller::_viewResize( const QSize& newSize ){
     for ( int i = 0; i < m_datas.size(); i++ ){
         m_datas[i]->_viewResize( newSize );
@@ -1136,6 +1458,7 @@ void Controller::_viewResize( const QSize& newSize ){
 }
 
 Controller::~Controller(){
+    cancelLoad();
     clear();
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
     if ( m_selectChannel != nullptr){
@@ -8,11 +8,15 @@
 #include <State/ObjectManager.h>
 #include <Data/IColoredView.h>
 #include "CartaLib/CartaLib.h"
+#include "CartaLib/IMomentGeneratorService.h"
 
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <QObject>
 #include <QImage>
+#include <QPoint>
+#include <functional>
 #include <memory>
 
 class ImageView;
@@ -58,6 +62,57 @@ public:
      */
     bool addData(const QString& fileName);
 
+    /**
+     * Add data to this controller without waiting for it to load.  Progress is
+     * published in the load state of the controller; the data is added once its
+     * pixels are ready.  A load already in progress is cancelled.
+     * @param fileName the location of the data;
+     *        this could represent a url or an absolute path on a local filesystem.
+     */
+    void addDataAsync(const QString& fileName);
+
+    /**
+     * Cancel the load started by addDataAsync(), if there is one.
+     */
+    void cancelLoad();
+
+    /**
+     * Add an image that does not come from a file, e.g. one computed from other data.
+     * @param name an identifier for the image, used in place of a file name.
+     * @param image the image.
+     */
+    void addImage( const QString& name, std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
+    /**
+     * Add an image computed on demand from the selected image; only the parts of it
+     * that are looked at are ever computed.
+     * @param operation one of smooth (gaussian with a width of value pixels), rebin
+     *      (averages value channels), ratio or difference (with the image at otherIndex),
+     *      or polarizedintensity (from the Q and U stokes planes).
+     * @param value the parameter of the operation, if it has one.
+     * @param otherIndex the index of the second image of the operation, if it has one.
+     * @return an error message if the image could not be derived; an empty string otherwise.
+     */
+    QString deriveImage( const QString& operation, double value, int otherIndex );
+
+    /**
+     * Compute moment maps of the selected image in the background; they are added
+     * to this controller once they are ready.
+     * @param params the moments to compute and the pixels to use.
+     * @return an error message if the computation could not be started; an empty
+     *      string otherwise.
+     */
+    QString generateMoments( const Carta::Lib::IMomentGeneratorService::Params& params );
+
+    /**
+     * Hand the pixels of the current channel of the selected image to a function
+     * provided by a plugin, e.g. a python script.
+     * @param funcName the name of the plugin function.
+     * @return an error message if no plugin has the function or it failed; an empty
+     *      string otherwise.
+     */
+    QString callRawViewFunction( const QString& funcName );
+
     /**
      * Apply the indicated clips to managed images.
      * @param minIntensityPercentile the minimum clip percentile [0,1].
@@ -99,6 +154,17 @@ public:
      */
     bool getIntensity( int frameLow, int frameHigh, double percentile, double* intensity ) const;
 
+    /**
+     * Returns a function computing the intensity corresponding to a given percentile
+     * of the current image, which can be called on any thread.
+     * @param frameLow a lower bound for the image channels or -1 if there is no lower bound.
+     * @param frameHigh an upper bound for the image channels or -1 if there is no upper bound.
+     * @param percentile a number [0,1] for which an intensity is desired.
+     * @return a function storing the intensity in its argument and returning true if it is
+     *      valid; an empty function if there is no image or the percentile is out of range.
+     */
+    std::function<bool(double*)> getIntensityFunction( int frameLow, int frameHigh, double percentile ) const;
+
     //IColoredView interface.
     virtual void setColorMap( const QString& colorMapName ) Q_DECL_OVERRIDE;
     virtual void setColorInverted( bool inverted ) Q_DECL_OVERRIDE;
@@ -175,10 +241,11 @@ public:
      * Save a copy of the full image in the current image view.
      * @param filename the full path where the file is to be saved.
      * @param scale the scale (zoom level) of the saved image.
+     * @param saveId - passed back with saveImageResult() to tell saves apart.
      * @return an error message if there is an initial problem with saving;
      *      an empty string if the save operation has been initiated.
      */
-    QString saveImage( const QString& filename,  double scale );
+    QString saveImage( const QString& filename,  double scale, const QString& saveId = "" );
 
     /**
      * Save a copy of the full image in the current image view using the current scale.
@@ -326,8 +393,8 @@ signals:
     void channelChanged( Controller* controller );
 
     /// Return the result of SaveFullImage() after the image has been rendered
-    /// and a save attempt made.
-    void saveImageResult( bool result );
+    /// and a save attempt made, along with the id the save was started with.
+    void saveImageResult( bool result, const QString& saveId );
 
 protected:
     virtual QString getSnapType(CartaObject::SnapshotType snapType) const Q_DECL_OVERRIDE;
@@ -344,6 +411,12 @@ private slots:
      */
     void _renderingDone( QImage img );
 
+    /**
+     * The moment generator has finished; the moment maps are added as images.
+     */
+    void _momentsDone( const Carta::Lib::IMomentGeneratorService::Result& result,
+            Carta::Lib::IMomentGeneratorService::JobId jobId );
+
     /**
      * The view has been resized.
      */
@@ -360,7 +433,18 @@ private slots:
     void _repaintFrameNow();
 
     // Asynchronous result from saveFullImage().
-    void saveImageResultCB( bool result );
+    void saveImageResultCB( bool result, const QString& saveId );
+
+    /**
+     * Update the cursor text for the latest mouse position.
+     */
+    void _updateCursorNow();
+
+    //The header of the data loading in the background is available.
+    void _dataOpened( bool success, int frameCount );
+
+    //The data loading in the background is ready, or could not be loaded.
+    void _dataLoaded( bool success );
 
 private:
 
@@ -380,9 +464,14 @@ private:
     void _initializeSelection( Selection* & selection );
 
     void _clearData();
+    //Select data that was just loaded and refresh the view.
+    void _dataAdded( int targetIndex );
     QString _makeRegion( const QString& regionType );
     void _removeData( int index );
+    //Draw all images on the pixels of the first one, so they line up on the sky.
+    void _updateReprojections();
     void _render();
+    void _setLoadStatus( const QString& status, double progress );
     void _saveRegions();
     void _scheduleFrameRepaint( const QImage& img );
     void _updateCursor( int mouseX, int mouseY );
@@ -400,6 +489,14 @@ private:
     static const QString CENTER;
     static const QString POINTER_MOVE;
     static const QString ZOOM;
+    static const QString LOAD;
+    static const QString LOAD_FILE;
+    static const QString LOAD_STATUS;
+    static const QString LOAD_PROGRESS;
+    static const QString LOAD_FRAMES;
+
+    //Minimum time in milliseconds between cursor updates (roughly the display rate).
+    static const int CURSOR_UPDATE_INTERVAL;
 
     //Data Selections
     Selection* m_selectChannel;
@@ -427,11 +524,32 @@ private:
     //everyone wants to listen to them.
     Carta::State::StateInterface m_stateMouse;
 
+    //Mouse position and cursor text in m_stateMouse, looked up once.
+    Carta::State::StateInterface::Key m_mouseXKey;
+    Carta::State::StateInterface::Key m_mouseYKey;
+    Carta::State::StateInterface::Key m_cursorKey;
+
+    //Progress of loading data in the background.
+    Carta::State::StateInterface m_stateLoad;
+
+    //Data being loaded in the background; added to m_datas once it is ready.
+    DataSource* m_pendingData;
+
+    //Computes moment maps in the background; the name of the image they are from
+    //and of the requested moments.
+    Carta::Lib::IMomentGeneratorService::SharedPtr m_momentService;
+    QString m_momentSource;
+    QStringList m_momentNames;
+
     QSize m_viewSize;
 
     bool m_reloadFrameQueued;
     bool m_repaintFrameQueued;
 
+    //Latest mouse position waiting for a cursor update.
+    QPoint m_cursorPending;
+    bool m_cursorUpdateQueued;
+
     Controller(const Controller& other);
     Controller& operator=(const Controller& other);
 
@@ -0,0 +1,133 @@
+#include "CursorService.h"
+#include "CartaLib/IImage.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace Carta {
+
+namespace Data {
+
+const int CursorService::TILE_SIZE = 64;
+
+CursorService::CursorService() :
+    m_image( nullptr ),
+    m_tileX( 0 ),
+    m_tileY( 0 ),
+    m_tileWidth( 0 ),
+    m_tileHeight( 0 ){
+}
+
+void CursorService::setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    if ( image != m_image ){
+        m_image = image;
+        m_formatters.clear();
+        m_tile.clear();
+        m_tileWidth = 0;
+        m_tileHeight = 0;
+        m_tilePlane.clear();
+    }
+}
+
+CoordinateFormatterInterface* CursorService::getFormatter( Carta::Lib::KnownSkyCS cs ){
+    if ( !m_image ){
+        return nullptr;
+    }
+    auto iter = m_formatters.find( cs );
+    if ( iter == m_formatters.end() ){
+        CoordinateFormatterInterface::SharedPtr cf(
+                m_image-> metaData()-> coordinateFormatter()-> clone() );
+        cf-> setSkyCS( cs );
+        iter = m_formatters.insert( std::make_pair( cs, cf ) ).first;
+    }
+    return iter->second.get();
+}
+
+QStringList CursorService::formatCoordinates( double x, double y,
+        const std::vector<int>& frameIndices, Carta::Lib::KnownSkyCS cs ){
+    QStringList result;
+    CoordinateFormatterInterface* cf = getFormatter( cs );
+    if ( cf != nullptr ){
+        std::vector<int> plane = _planeIndices( frameIndices );
+        std::vector < double > pixel { x, y };
+        pixel.insert( pixel.end(), plane.begin(), plane.end() );
+        result = cf-> formatFromPixelCoordinate( pixel );
+    }
+    return result;
+}
+
+bool CursorService::getPixelValue( int x, int y, const std::vector<int>& frameIndices,
+        double* value ){
+    if ( !m_image ){
+        return false;
+    }
+    const std::vector<int> dims = m_image->dims();
+    if ( x < 0 || x >= dims[0] || y < 0 || y >= dims[1] ){
+        return false;
+    }
+    std::vector<int> plane = _planeIndices( frameIndices );
+    bool inTile = plane == m_tilePlane && m_tileWidth > 0 &&
+            x >= m_tileX && x < m_tileX + m_tileWidth &&
+            y >= m_tileY && y < m_tileY + m_tileHeight;
+    if ( !inTile ){
+        _loadTile( x, y, plane );
+    }
+    int index = ( y - m_tileY ) * m_tileWidth + ( x - m_tileX );
+    if ( index < 0 || index >= static_cast<int>( m_tile.size() ) ){
+        return false;
+    }
+    *value = m_tile[index];
+    return true;
+}
+
+std::vector<int> CursorService::_planeIndices( const std::vector<int>& frameIndices ) const {
+    const std::vector<int> dims = m_image->dims();
+    std::vector<int> plane;
+    for ( size_t i = 2; i < dims.size(); i++ ){
+        int index = i - 2 < frameIndices.size() ? frameIndices[i - 2] : 0;
+        plane.push_back( std::max( 0, std::min( index, dims[i] - 1 ) ) );
+    }
+    return plane;
+}
+
+void CursorService::_loadTile( int x, int y, const std::vector<int>& frameIndices ){
+    const std::vector<int> dims = m_image->dims();
+
+    //Align tiles to a grid so moving around within a tile does not reload it.
+    m_tileX = ( x / TILE_SIZE ) * TILE_SIZE;
+    m_tileY = ( y / TILE_SIZE ) * TILE_SIZE;
+    m_tileWidth = std::min( TILE_SIZE, dims[0] - m_tileX );
+    m_tileHeight = std::min( TILE_SIZE, dims[1] - m_tileY );
+    m_tilePlane = frameIndices;
+    m_tile.clear();
+    m_tile.reserve( m_tileWidth * m_tileHeight );
+
+    SliceND tileSlice;
+    tileSlice.start( m_tileX ).end( m_tileX + m_tileWidth );
+    tileSlice.next().start( m_tileY ).end( m_tileY + m_tileHeight );
+    for ( size_t i = 2; i < dims.size(); i++ ){
+        tileSlice.next().index( frameIndices[i - 2] );
+    }
+
+    Carta::Lib::NdArray::RawViewInterface* rawData = m_image->getDataSlice( tileSlice );
+    if ( rawData == nullptr ){
+        m_tileWidth = 0;
+        m_tileHeight = 0;
+        return;
+    }
+    Carta::Lib::NdArray::TypedView<double> view( rawData, true );
+    view.forEach( [this] ( const double& val ){
+        m_tile.push_back( val );
+    });
+    if ( static_cast<int>( m_tile.size() ) != m_tileWidth * m_tileHeight ){
+        qWarning() << "Unexpected cursor tile size" << m_tile.size();
+        m_tile.clear();
+        m_tileWidth = 0;
+        m_tileHeight = 0;
+    }
+}
+
+CursorService::~CursorService(){
+}
+
+}
+}
@@ -0,0 +1,107 @@
+/***
+ * Fast access to the information displayed next to the mouse cursor.
+ *
+ * The cursor text is recomputed on every mouse move, so this class keeps everything
+ * that is expensive to set up between calls: one coordinate formatter per sky
+ * coordinate system, and a small tile of pixel values around the last cursor position.
+ */
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/ICoordinateFormatter.h"
+#include <QStringList>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+    namespace Image {
+        class ImageInterface;
+    }
+}
+
+namespace Data {
+
+class CursorService {
+
+public:
+
+    CursorService();
+
+    /**
+     * Set the image the cursor information is about. Cached formatters and pixels
+     * are discarded if the image is different from the current one.
+     * @param image the image being displayed.
+     */
+    void setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
+    /**
+     * Returns a formatter set up for the given sky coordinate system.
+     * @param cs the desired sky coordinate system.
+     * @return a formatter owned by this service, or nullptr if there is no image.
+     */
+    CoordinateFormatterInterface* getFormatter( Carta::Lib::KnownSkyCS cs );
+
+    /**
+     * Format the world coordinates of all axes at the given pixel, using a single
+     * pixel to world conversion.
+     * @param x the x-coordinate of the pixel.
+     * @param y the y-coordinate of the pixel.
+     * @param frameIndices the indices of the axes beyond the first two (channel first),
+     *      missing ones are taken to be 0.
+     * @param cs the desired sky coordinate system.
+     * @return formatted coordinates, one per axis.
+     */
+    QStringList formatCoordinates( double x, double y, const std::vector<int>& frameIndices,
+            Carta::Lib::KnownSkyCS cs );
+
+    /**
+     * Return the value of the pixel at (x, y).
+     * @param x the x-coordinate of the pixel.
+     * @param y the y-coordinate of the pixel.
+     * @param frameIndices the indices of the axes beyond the first two (channel first),
+     *      missing ones are taken to be 0.
+     * @param value set to the value of the pixel.
+     * @return true if the pixel lies inside the image; false otherwise.
+     */
+    bool getPixelValue( int x, int y, const std::vector<int>& frameIndices, double* value );
+
+    virtual ~CursorService();
+
+private:
+
+    /**
+     * Read the tile containing pixel (x, y) in the given plane.
+     */
+    void _loadTile( int x, int y, const std::vector<int>& frameIndices );
+
+    /**
+     * Returns the index of each axis beyond the first two, clamped to the image.
+     */
+    std::vector<int> _planeIndices( const std::vector<int>& frameIndices ) const;
+
+    //Width and height of the cached tile of pixels.
+    static const int TILE_SIZE;
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+
+    //Prepared formatters for each sky coordinate system asked for.
+    std::map<Carta::Lib::KnownSkyCS, CoordinateFormatterInterface::SharedPtr> m_formatters;
+
+    //Cached tile of pixel values, x varies fastest.
+    std::vector<double> m_tile;
+    int m_tileX;
+    int m_tileY;
+    int m_tileWidth;
+    int m_tileHeight;
+    //Indices of the axes beyond the first two the tile was read from.
+    std::vector<int> m_tilePlane;
+
+    CursorService( const CursorService& other);
+    CursorService& operator=( const CursorService& other );
+};
+
+}
+}
@@ -1,13 +1,16 @@
 #include "DataSource.h"
 #include "DataGrid.h"
+#include "ImageLoadJob.h"
 #include "CoordinateSystems.h"
 #include "ImageGridServiceSynchronizer.h"
+#include "CursorService.h"
 #include "Data/Colormap/Colormaps.h"
 #include "Data/Preferences/PreferencesSave.h"
 #include "Globals.h"
 #include "PluginManager.h"
 #include "GrayColormap.h"
 #include "CartaLib/IImage.h"
+#include "CartaLib/PlaneCache.h"
 #include "Data/Util.h"
 #include "Data/Colormap/TransformsData.h"
 #include "CartaLib/Hooks/GetWcsGridRenderer.h"
@@ -32,6 +35,121 @@ const double DataSource::ZOOM_DEFAULT = 1.0;
 
 CoordinateSystems* DataSource::m_coords = nullptr;
 
+namespace {
+
+/// slice description corresponding to the entire frame [:,:,frame,0,0,...0]
+SliceND frameSlice( Carta::Lib::Image::ImageInterface& image, int frameIndex ){
+    auto slice = SliceND().next();
+    for ( size_t i = 2 ; i < image.dims().size() ; i++ ) {
+        slice.next().index( i == 2 ? frameIndex : 0 );
+    }
+    return slice;
+}
+
+/// view of the channels [channelStart..channelEnd] of the image, or of all channels if
+/// either bound is negative
+Carta::Lib::NdArray::RawViewInterface* channelSlice( const Carta::Lib::ImageRegistry::HandlePtr& handle,
+        int channelStart, int channelEnd ){
+    Carta::Lib::Image::ImageInterface& image = *handle->image();
+    auto slice = SliceND().next();
+    for( size_t i=2; i < image.dims().size(); i++ ){
+        if ( i == 2 ){
+            SliceND& channels = slice.next();
+            if (channelStart>=0 && channelEnd >= 0 ){
+                channels.start( channelStart );
+                channels.end( channelEnd + 1);
+            }
+            else {
+                channels.start( 0 );
+                channels.end( image.dims()[2] );
+            }
+            channels.step( 1 );
+        }
+        else {
+            slice.next().index(0);
+        }
+    }
+    return Carta::Lib::PlaneCache::instance().getDataSlice( handle->key(), image, slice );
+}
+
+/// true if the first two axes of the coordinate system are the sky axes
+bool skyAxesFirst( const CoordinateFormatterInterface& cf ){
+    typedef Carta::Lib::AxisInfo::KnownType KnownType;
+    return cf.nAxes() >= 2 &&
+            cf.axisInfo( 0 ).knownType() == KnownType::DIRECTION_LON &&
+            cf.axisInfo( 1 ).knownType() == KnownType::DIRECTION_LAT;
+}
+
+/// convert n pixel positions (x,y pairs) of the image with coordinates targetCF to pixel
+/// positions in the image with coordinates ownCF, through their sky coordinates; the
+/// other world coordinates are taken from ownRef
+bool reprojectPixels( const CoordinateFormatterInterface& targetCF, const CoordinateFormatterInterface& ownCF,
+        const CoordinateFormatterInterface::VD& ownRef, const double* dst, double* src, int64_t n ){
+    //Convert in chunks, so big grids do not need big buffers for all the axes.
+    const int64_t CHUNK_SIZE = 64 * 1024;
+    const int targetAxes = targetCF.nAxes();
+    const int ownAxes = ownCF.nAxes();
+    std::vector<double> targetPixel, targetWorld, ownWorld, ownPixel;
+    bool allValid = true;
+    for ( int64_t start = 0; start < n; start += CHUNK_SIZE ){
+        int64_t count = std::min( CHUNK_SIZE, n - start );
+        targetPixel.assign( count * targetAxes, 0 );
+        for ( int64_t i = 0; i < count; i++ ){
+            targetPixel[i * targetAxes] = dst[2 * ( start + i )];
+            targetPixel[i * targetAxes + 1] = dst[2 * ( start + i ) + 1];
+        }
+        targetWorld.resize( count * targetAxes );
+        allValid = targetCF.toWorld( targetPixel.data(), targetWorld.data(), count ) && allValid;
+
+        ownWorld.resize( count * ownAxes );
+        for ( int64_t i = 0; i < count; i++ ){
+            std::copy( ownRef.begin(), ownRef.end(), ownWorld.begin() + i * ownAxes );
+            ownWorld[i * ownAxes] = targetWorld[i * targetAxes];
+            ownWorld[i * ownAxes + 1] = targetWorld[i * targetAxes + 1];
+        }
+        ownPixel.resize( count * ownAxes );
+        allValid = ownCF.toPixel( ownWorld.data(), ownPixel.data(), count ) && allValid;
+        for ( int64_t i = 0; i < count; i++ ){
+            src[2 * ( start + i )] = ownPixel[i * ownAxes];
+            src[2 * ( start + i ) + 1] = ownPixel[i * ownAxes + 1];
+        }
+    }
+    return allValid;
+}
+
+/// value at the given percentile of the finite values in rawData, which is deleted
+bool intensityOf( Carta::Lib::NdArray::RawViewInterface* rawData, double percentile, double* intensity ){
+    bool intensityFound = false;
+    if ( rawData != nullptr ){
+        Carta::Lib::NdArray::TypedView<double> view( rawData, true );
+        // read in all values from the view into an array
+        // we need our own copy because we'll do quickselect on it...
+        std::vector < double > allValues;
+        view.forEach(
+                [& allValues] ( const double  val ) {
+            if ( std::isfinite( val ) ) {
+                allValues.push_back( val );
+            }
+        }
+        );
+
+        // indicate bad clip if no finite numbers were found
+        if ( allValues.size() > 0 ) {
+            int locationIndex = allValues.size() * percentile - 1;
+
+            if ( locationIndex < 0 ){
+                locationIndex = 0;
+            }
+            std::nth_element( allValues.begin(), allValues.begin()+locationIndex, allValues.end() );
+            *intensity = allValues[locationIndex];
+            intensityFound = true;
+        }
+    }
+    return intensityFound;
+}
+
+}
+
 class DataSource::Factory : public Carta::State::CartaObjectFactory {
 
 public:
@@ -51,7 +169,8 @@ DataSource::DataSource(const QString& path, const QString& id) :
         CartaObject( CLASS_NAME, path, id),
     m_image( nullptr ),
     m_wcsGridRenderer( nullptr ),
-    m_igSync( nullptr )
+    m_igSync( nullptr ),
+    m_cursorService( new CursorService() )
     {
         m_cmapUseCaching = true;
         m_cmapUseInterpolatedCaching = true;
@@ -105,43 +224,30 @@ QString DataSource::_getCursorText( int mouseX, int mouseY, int frameIndex){
 
     bool valid = false;
     QPointF imgPt = _getImagePt( lastMouse, &valid );
+    if ( valid ){
+        //Report values and coordinates of this image, even if it is drawn on the
+        //pixels of another one.
+        imgPt = m_renderService->img2input( imgPt, &valid );
+    }
     if ( valid ){
         double imgX = imgPt.x();
         double imgY = imgPt.y();
-    
-        CoordinateFormatterInterface::SharedPtr cf(
-                m_image-> metaData()-> coordinateFormatter()-> clone() );
-
-
-        QString coordName = m_coords->getName( cf->skyCS() );
-        //out << "Default sky cs:" << coordName << "\n";
 
         QString pixelValue = _getPixelValue( round(imgX), round(imgY), frameIndex );
         QString pixelUnits = _getPixelUnits();
         out << pixelValue << " " << pixelUnits;
         out <<"Pixel:" << imgX << "," << imgY << "\n";
 
+        //The cursor service keeps a prepared formatter per coordinate system and
+        //converts all axes at once.
         Carta::Lib::KnownSkyCS cs = m_dataGrid->getSkyCS();
-        //QList<Carta::Lib::KnownSkyCS> css = m_coords->getIndices();
-        //for ( Carta::Lib::KnownSkyCS cs : css ) {
-            cf-> setSkyCS( cs );
-            out << m_coords->getName( cs ) << ": ";
-            std::vector < Carta::Lib::AxisInfo > ais;
-            for ( int axis = 0 ; axis < cf->nAxes() ; axis++ ) {
-                const Carta::Lib::AxisInfo & ai = cf-> axisInfo( axis );
-                ais.push_back( ai );
-            }
-            std::vector < double > pixel( m_image-> dims().size(), 0.0 );
-            pixel[0] = imgX;
-            pixel[1] = imgY;
-            if( pixel.size() > 2) {
-                pixel[2] = frameIndex;
-            }
-            for ( size_t i = 0 ; i < ais.size() ; i++ ) {
-                out << ais[i].shortLabel().html() << ":" << _getCoordinates( imgX, imgY, cs, i ) << " ";
-            }
-            out << "\n";
-        //}
+        CoordinateFormatterInterface* cf = m_cursorService->getFormatter( cs );
+        QStringList coords = m_cursorService->formatCoordinates( imgX, imgY, { frameIndex }, cs );
+        out << m_coords->getName( cs ) << ": ";
+        for ( int axis = 0 ; axis < cf->nAxes() && axis < coords.size(); axis++ ) {
+            out << cf-> axisInfo( axis ).shortLabel().html() << ":" << coords[axis] << " ";
+        }
+        out << "\n";
 
         str.replace( "\n", "<br />" );
     }
@@ -171,12 +277,9 @@ QPointF DataSource::_getImagePt( QPointF screenPt, bool* valid ) const {
 
 QString DataSource::_getPixelValue( double x, double y, int frameIndex ) const {
     QString pixelValue = "";
-    if ( x >= 0 && x < m_image->dims()[0] && y >= 0 && y < m_image->dims()[1] ) {
-        Carta::Lib::NdArray::RawViewInterface* rawData = _getRawData( frameIndex, frameIndex );
-        if ( rawData != nullptr ){
-            Carta::Lib::NdArray::TypedView<double> view( rawData, false );
-            pixelValue = QString::number( view.get( {(int)(round(x)), (int)(round(y)) } ) );
-        }
+    double value = 0;
+    if ( m_cursorService->getPixelValue( (int)(round(x)), (int)(round(y)), { frameIndex }, &value ) ) {
+        pixelValue = QString::number( value );
     }
     return pixelValue;
 }
@@ -240,34 +343,18 @@ std::shared_ptr<Carta::Lib::PixelPipeline::CustomizablePixelPipeline> DataSource
 }
 
 bool DataSource::_getIntensity( int frameLow, int frameHigh, double percentile, double* intensity ) const {
-    bool intensityFound = false;
-    Carta::Lib::NdArray::RawViewInterface* rawData = _getRawData( frameLow, frameHigh );
-    if ( rawData != nullptr ){
-        Carta::Lib::NdArray::TypedView<double> view( rawData, false );
-        // read in all values from the view into an array
-        // we need our own copy because we'll do quickselect on it...
-        std::vector < double > allValues;
-        view.forEach(
-                [& allValues] ( const double  val ) {
-            if ( std::isfinite( val ) ) {
-                allValues.push_back( val );
-            }
-        }
-        );
-
-        // indicate bad clip if no finite numbers were found
-        if ( allValues.size() > 0 ) {
-            int locationIndex = allValues.size() * percentile - 1;
+    return intensityOf( _getRawData( frameLow, frameHigh ), percentile, intensity );
+}
 
-            if ( locationIndex < 0 ){
-                locationIndex = 0;
-            }
-            std::nth_element( allValues.begin(), allValues.begin()+locationIndex, allValues.end() );
-            *intensity = allValues[locationIndex];
-            intensityFound = true;
+std::function<bool(double*)> DataSource::_getIntensityFunction( int frameLow, int frameHigh, double percentile ) const {
+    //Hold on to the image, so the function still works if this data source goes away.
+    Carta::Lib::ImageRegistry::HandlePtr handle = m_imageHandle;
+    return [handle, frameLow, frameHigh, percentile] ( double* intensity ) -> bool {
+        if ( !handle ){
+            return false;
         }
-    }
-    return intensityFound;
+        return intensityOf( channelSlice( handle, frameLow, frameHigh ), percentile, intensity );
+    };
 }
 
 double DataSource::_getPercentile( int frameLow, int frameHigh, double intensity ) const {
@@ -276,7 +363,7 @@ double DataSource::_getPercentile( int frameLow, int frameHigh, double intensity
     if ( rawData != nullptr ){
         u_int64_t totalCount = 0;
         u_int64_t countBelow = 0;
-        Carta::Lib::NdArray::TypedView<double> view( rawData, false );
+        Carta::Lib::NdArray::TypedView<double> view( rawData, true );
         view.forEach([&](const double& val) {
             if( Q_UNLIKELY( std::isnan(val))){
                 return;
@@ -316,26 +403,7 @@ QString DataSource::_getPixelUnits() const {
 Carta::Lib::NdArray::RawViewInterface * DataSource::_getRawData( int channelStart, int channelEnd ) const {
     Carta::Lib::NdArray::RawViewInterface* rawData = nullptr;
     if ( m_image ){
-        auto frameSlice = SliceND().next();
-        for( size_t i=2; i < m_image->dims().size(); i++ ){
-            if ( i == 2 ){
-                SliceND& slice = frameSlice.next();
-                if (channelStart>=0 && channelEnd >= 0 ){
-                    slice.start( channelStart );
-                    slice.end( channelEnd + 1);
-                    
-                 }
-                 else {
-                    slice.start( 0 );
-                    slice.end( m_image->dims()[2] );
-                 }
-                 slice.step( 1 );
-            }
-            else {
-                frameSlice.next().index(0);
-            }
-        }
-        rawData = m_image->getDataSlice( frameSlice );
+        rawData = channelSlice( m_imageHandle, channelStart, channelEnd );
     }
     return rawData;
 }
@@ -408,6 +476,9 @@ void DataSource::_initializeState(){
 
 void DataSource::_load(int frameIndex, bool /*recomputeClipsOnNewFrame*/, double minClipPercentile, double maxClipPercentile){
 
+    if ( !m_image ){
+        return;
+    }
     if ( frameIndex < 0 ) {
         frameIndex = 0;
     }
@@ -418,15 +489,16 @@ void DataSource::_load(int frameIndex, bool /*recomputeClipsOnNewFrame*/, double
         frameIndex = Carta::Lib::clamp( frameIndex, 0, m_image-> dims()[2] - 1 );
     }
 
-    // prepare slice description corresponding to the entire frame [:,:,frame,0,0,...0]
-    auto frameSlice = SliceND().next();
-    for ( size_t i = 2 ; i < m_image->dims().size() ; i++ ) {
-        frameSlice.next().index( i == 2 ? frameIndex : 0 );
+    // get a view of the entire frame and make a shared pointer out of it, the decoded
+    // plane is cached so colormap changes don't need to read the image again
+    Carta::Lib::NdArray::RawViewInterface::SharedPtr view(
+            Carta::Lib::PlaneCache::instance().getDataSlice( m_imageHandle->key(), *m_image,
+                    frameSlice( *m_image, frameIndex ) ) );
+    if ( !view ){
+        qWarning() << "Could not read frame" << frameIndex;
+        return;
     }
 
-    // get a view of the data using the slice description and make a shared pointer out of it
-    Carta::Lib::NdArray::RawViewInterface::SharedPtr view( m_image-> getDataSlice( frameSlice ) );
-
     //Update the clip values
     _updateClips( view, frameIndex, minClipPercentile, maxClipPercentile );
 
@@ -439,7 +511,8 @@ void DataSource::_load(int frameIndex, bool /*recomputeClipsOnNewFrame*/, double
     // if grid is active, request a grid rendering as well
 
     if ( m_wcsGridRenderer ) {
-        m_wcsGridRenderer-> setInputImage( m_image );
+        //A reprojected image is drawn on the pixels of another image, so the grid is too.
+        m_wcsGridRenderer-> setInputImage( m_reprojectionImage ? m_reprojectionImage : m_image );
     }
     _render();
 
@@ -475,7 +548,10 @@ void DataSource::_resetZoom(){
 }
 
 void DataSource::_resetPan(){
-    if ( m_image != nullptr ){
+    if ( !m_reprojectionArea.isEmpty() ){
+        m_renderService-> setPan( m_reprojectionArea.center() );
+    }
+    else if ( m_image != nullptr ){
         m_renderService-> setPan(
                 { m_image-> dims()[0] / 2.0, m_image-> dims()[1] / 2.0 }
         );
@@ -483,29 +559,28 @@ void DataSource::_resetPan(){
 }
 
 void DataSource::_saveImage( const QString& saveName, /*int width, int height,*/ double scale,
-        int frameIndex/*, const Qt::AspectRatioMode aspectRatioMode*/ ){
+        int frameIndex/*, const Qt::AspectRatioMode aspectRatioMode*/, const QString& saveId ){
     QString fileName = _getFileName();
-    m_saveService = new Carta::Core::ImageSaveService::ImageSaveService( saveName,
+    Carta::Core::ImageSaveService::ImageSaveService* saveService = new Carta::Core::ImageSaveService::ImageSaveService( saveName,
             m_image, m_pixelPipeline, fileName );
     PreferencesSave* prefSave = Util::findSingletonObject<PreferencesSave>();
     int width = prefSave->getWidth();
     int height = prefSave->getHeight();
     Qt::AspectRatioMode aspectRatioMode = prefSave->getAspectRatioMode();
-    m_saveService->setOutputSize( QSize( width, height ) );
-    m_saveService->setAspectRatioMode( aspectRatioMode );
-    m_saveService->setFrameIndex( frameIndex );
-
-    m_saveService->setZoom( scale );
+    saveService->setOutputSize( QSize( width, height ) );
+    saveService->setAspectRatioMode( aspectRatioMode );
+    saveService->setFrameIndex( frameIndex );
 
-    connect( m_saveService, & Carta::Core::ImageSaveService::ImageSaveService::saveImageResult,
-            this, & DataSource::_saveImageResultCB );
+    saveService->setZoom( scale );
 
-    m_saveService->saveFullImage();
-}
+    //Several saves can be running at once, so each one cleans up after itself.
+    connect( saveService, & Carta::Core::ImageSaveService::ImageSaveService::saveImageResult,
+            this, [this, saveService, saveId] ( bool result ){
+        emit saveImageResult( result, saveId );
+        saveService->deleteLater();
+    });
 
-void DataSource::_saveImageResultCB( bool result ){
-    emit saveImageResult( result );
-    m_saveService->deleteLater();
+    saveService->saveFullImage();
 }
 
 bool DataSource::_setFileName( const QString& fileName ){
@@ -513,34 +588,18 @@ bool DataSource::_setFileName( const QString& fileName ){
     bool successfulLoad = true;
     if (file.length() > 0) {
         if ( file != m_state.getValue<QString>(DATA_PATH)){
-            try {
-                auto res = Globals::instance()-> pluginManager()
-                                      -> prepare <Carta::Lib::Hooks::LoadAstroImage>( file )
-                                      .first();
-                if (!res.isNull()){
-                    m_image = res.val();
-
-                    // reset zoom/pan
-                    _resetZoom();
-                    _resetPan();
-
-                    // clear quantile cache
-                    m_quantileCache.resize(0);
-                    int nf = 1;
-                    if( m_image-> dims().size() > 2){
-                        nf = m_image-> dims()[2];
-                    }
-                    m_quantileCache.resize( nf);
-                    m_state.setValue<QString>( DATA_PATH, file );
-                }
-                else {
-                    qWarning( "Could not find any plugin to load image");
-                    successfulLoad = false;
-                }
-
+            //The image is opened on the I/O thread even when we wait for it here, so
+            //that images are only ever read by one job at a time; the GUI keeps
+            //repainting while we wait.
+            _cancelLoad();
+            ImageLoadJob::SharedPtr job = _startLoad( file );
+            job->wait();
+            Carta::Lib::ImageRegistry::HandlePtr handle = job->getHandle();
+            if ( handle ){
+                _setImage( file, handle );
             }
-            catch( std::logic_error& err ){
-                qDebug() << "Failed to load image "<<fileName;
+            else {
+                qWarning() << "Could not load image" << file;
                 successfulLoad = false;
             }
         }
@@ -552,6 +611,123 @@ bool DataSource::_setFileName( const QString& fileName ){
     return successfulLoad;
 }
 
+bool DataSource::_setReprojection( const DataSource* target ){
+    bool reprojected = false;
+    if ( target != nullptr && target != this && m_image && target->m_image ){
+        //Both images get their own formatters, converting in the same sky system.
+        CoordinateFormatterInterface::SharedPtr targetCF(
+                target->m_image->metaData()->coordinateFormatter()->clone() );
+        CoordinateFormatterInterface::SharedPtr ownCF(
+                m_image->metaData()->coordinateFormatter()->clone() );
+        ownCF->setSkyCS( targetCF->skyCS() );
+        if ( skyAxesFirst( *targetCF ) && skyAxesFirst( *ownCF ) && ownCF->skyCS() == targetCF->skyCS() ){
+            //Axes other than the sky stay at the reference pixel of this image.
+            CoordinateFormatterInterface::VD ownRef;
+            ownCF->toWorld( CoordinateFormatterInterface::VD( ownCF->nAxes(), 0 ), ownRef );
+            ownRef.resize( ownCF->nAxes(), 0 );
+            auto map = [targetCF, ownCF, ownRef] ( const double* dst, double* src, int64_t n ) -> bool {
+                return reprojectPixels( *targetCF, *ownCF, ownRef, dst, src, n );
+            };
+            std::vector<int> targetDims = target->m_image->dims();
+            m_reprojectionArea = QRectF( -0.5, -0.5, targetDims[0], targetDims[1] );
+            m_reprojectionImage = target->m_image;
+            m_renderService->setReprojection( target->_getFileName() + " -> " + _getFileName(),
+                    map, m_reprojectionArea );
+            reprojected = true;
+        }
+        else {
+            qWarning() << "Can not line up" << _getFileName() << "with" << target->_getFileName();
+        }
+    }
+    if ( reprojected ){
+        //Pan and zoom are now in pixels of the target.
+        m_renderService->setPan( target->m_renderService->pan() );
+        m_renderService->setZoom( target->m_renderService->zoom() );
+    }
+    else if ( !m_reprojectionArea.isEmpty() ){
+        m_reprojectionArea = QRectF();
+        m_reprojectionImage.reset();
+        m_renderService->setReprojection( "", nullptr, QRectF() );
+        _resetPan();
+    }
+    return reprojected;
+}
+
+void DataSource::_setFileNameAsync( const QString& fileName ){
+    _cancelLoad();
+    m_loadJob = _startLoad( fileName.trimmed() );
+    connect( m_loadJob.get(), &ImageLoadJob::opened, this, &DataSource::_loadOpened );
+    connect( m_loadJob.get(), &ImageLoadJob::finished, this, &DataSource::_loadFinished );
+}
+
+void DataSource::_cancelLoad(){
+    if ( m_loadJob ){
+        m_loadJob->cancel();
+        disconnect( m_loadJob.get(), nullptr, this, nullptr );
+        m_loadJob.reset();
+    }
+}
+
+std::shared_ptr<ImageLoadJob> DataSource::_startLoad( const QString& file ){
+    // other views of the same file share the image and its caches
+    auto loader = [file] () -> Carta::Lib::Image::ImageInterface::SharedPtr {
+        if ( file.isEmpty() ){
+            return nullptr;
+        }
+        auto res = Globals::instance()-> pluginManager()
+                              -> prepare <Carta::Lib::Hooks::LoadAstroImage>( file )
+                              .first();
+        if ( res.isNull() ){
+            qWarning( "Could not find any plugin to load image");
+            return nullptr;
+        }
+        return res.val();
+    };
+    // decode the first frame while we are on the I/O thread anyways
+    auto prefetch = [] ( const Carta::Lib::ImageRegistry::HandlePtr& handle ){
+        Carta::Lib::Image::ImageInterface& image = *handle->image();
+        std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view(
+                Carta::Lib::PlaneCache::instance().getDataSlice( handle->key(), image, frameSlice( image, 0 ) ) );
+    };
+    return ImageLoadJob::start( file, loader, prefetch );
+}
+
+void DataSource::_setImage( const QString& file, const Carta::Lib::ImageRegistry::HandlePtr& handle ){
+    m_imageHandle = handle;
+    m_image = m_imageHandle->image();
+    m_cursorService->setImage( m_image );
+
+    // reset zoom/pan
+    _resetZoom();
+    _resetPan();
+
+    m_state.setValue<QString>( DATA_PATH, file );
+}
+
+void DataSource::_loadOpened( bool success ){
+    if ( !m_loadJob ){
+        return;
+    }
+    int frameCount = 0;
+    if ( success ){
+        Carta::Lib::Image::ImageInterface::SharedPtr image = m_loadJob->getHandle()->image();
+        frameCount = image->dims().size() > 2 ? image->dims()[2] : 1;
+    }
+    emit fileOpened( success, frameCount );
+}
+
+void DataSource::_loadFinished( bool success ){
+    if ( !m_loadJob ){
+        return;
+    }
+    ImageLoadJob::SharedPtr job = m_loadJob;
+    m_loadJob.reset();
+    if ( success ){
+        _setImage( job->getFileName(), job->getHandle() );
+    }
+    emit fileLoaded( success );
+}
+
 void DataSource::setColorMap( const QString& name ){
     Carta::State::ObjectManager* objManager = Carta::State::ObjectManager::objectManager();
     Carta::State::CartaObject* obj = objManager->getObject( Colormaps::CLASS_NAME );
@@ -605,26 +781,20 @@ void DataSource::setGamma( double gamma ){
 
 void DataSource::_updateClips( std::shared_ptr<Carta::Lib::NdArray::RawViewInterface>& view, int frameIndex,
         double minClipPercentile, double maxClipPercentile ){
-    std::vector<double> clips = m_quantileCache[ frameIndex];
-    Carta::Lib::NdArray::Double doubleView( view.get(), false );
-    std::vector<double> newClips = Carta::Core::Algorithms::quantiles2pixels(
-            doubleView, {minClipPercentile, maxClipPercentile });
-    bool clipsChanged = false;
-    if ( newClips.size() >= 2 ){
-        if( clips.size() < 2 ){
-            clipsChanged = true;
-        }
-        else {
-            double ERROR_MARGIN = 0.000001;
-            if ( qAbs( newClips[0] - clips[0]) > ERROR_MARGIN ||
-                qAbs( newClips[1] - clips[1]) > ERROR_MARGIN ){
-                clipsChanged = true;
-            }
+    // the clips are shared by all views of the image
+    QString key = Carta::Lib::ImageRegistry::Handle::quantileKey(
+            frameIndex, minClipPercentile, maxClipPercentile );
+    std::vector<double> clips;
+    if ( !m_imageHandle->quantiles().find( key, clips ) ){
+        Carta::Lib::NdArray::Double doubleView( view.get(), false );
+        clips = Carta::Core::Algorithms::quantiles2pixels(
+                doubleView, {minClipPercentile, maxClipPercentile });
+        if ( clips.size() >= 2 ){
+            m_imageHandle->quantiles().insert( key, clips, clips.size() * sizeof( double ) );
         }
     }
-    if ( clipsChanged ){
-        m_quantileCache[ frameIndex ] = newClips;
-        m_pixelPipeline-> setMinMax( newClips[0], newClips[1] );
+    if ( clips.size() >= 2 ){
+        m_pixelPipeline-> setMinMax( clips[0], clips[1] );
     }
 
 }
@@ -634,20 +804,20 @@ void DataSource::_viewResize( const QSize& newSize ){
 }
 
 
-QString DataSource::_getCoordinates( double x, double y, Carta::Lib::KnownSkyCS system, int axis ) const{
-    CoordinateFormatterInterface::SharedPtr cf( m_image-> metaData()-> coordinateFormatter()-> clone() );
-    cf-> setSkyCS( system );
-    std::vector < double > pixel( m_image-> dims().size(), 0.0 );
-    pixel[0] = x;
-    pixel[1] = y;
-    auto list = cf-> formatFromPixelCoordinate( pixel );
-    QString result = list[axis];
+QString DataSource::_getCoordinates( double x, double y, int frameIndex,
+        Carta::Lib::KnownSkyCS system, int axis ) const{
+    QString result;
+    QStringList list = m_cursorService->formatCoordinates( x, y, { frameIndex }, system );
+    if ( 0 <= axis && axis < list.size() ){
+        result = list[axis];
+    }
     return result;
 }
 
 
 
 DataSource::~DataSource() {
+    _cancelLoad();
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
     if ( m_dataGrid != nullptr){
         objMan->removeObject(m_dataGrid->getId());
@@ -9,7 +9,10 @@
 #include "State/StateInterface.h"
 #include "Data/IColoredView.h"
 #include "CartaLib/VectorGraphics/VGList.h"
+#include "CartaLib/CacheRegistry.h"
+#include "CartaLib/ImageRegistry.h"
 #include <QImage>
+#include <functional>
 #include <memory>
 
 class CoordinateFormatterInterface;
@@ -40,8 +43,10 @@ namespace Core {
 namespace Data {
 
 class ImageGridServiceSynchronizer;
+class CursorService;
 class DataGrid;
 class CoordinateSystems;
+class ImageLoadJob;
 
 class DataSource : public QObject, public Carta::State::CartaObject, public IColoredView {
 
@@ -97,11 +102,23 @@ signals:
     void renderingDone( QImage img);
 
     /// Return the result of SaveFullImage() after the image has been rendered
-    /// and a save attempt made.
-    void saveImageResult( bool result );
+    /// and a save attempt made, along with the id the save was started with.
+    void saveImageResult( bool result, const QString& saveId );
+
+    /// The header of an image loaded with _setFileNameAsync() is available, or the
+    /// image could not be opened.  The image is not used until fileLoaded(), since
+    /// its first frame is still being read on the I/O thread.
+    void fileOpened( bool success, int frameCount );
+
+    /// The image loaded with _setFileNameAsync() is now used by this data source,
+    /// or loading failed.
+    void fileLoaded( bool success );
 
 private slots:
 
+    void _loadOpened( bool success );
+    void _loadFinished( bool success );
+
     //Notification from the rendering service that a new image has been produced.
     //void _renderingDone( QImage img, int64_t jobId );
 
@@ -110,9 +127,6 @@ private slots:
                           int64_t jobId );
 
 
-    // Asynchronous result from saveFullImage().
-    void _saveImageResultCB( bool result );
-
 private:
 
     /**
@@ -207,6 +221,16 @@ private:
      * @return true if the computed intensity is valid; otherwise false.
      */
     bool _getIntensity( int frameLow, int frameHigh, double percentile, double* intensity ) const;
+
+    /**
+     * Returns a function computing the intensity corresponding to a given percentile,
+     * which can be called on any thread.
+     * @param frameLow a lower bound for the image channels or -1 if there is no lower bound.
+     * @param frameHigh an upper bound for the image channels or -1 if there is no upper bound.
+     * @param percentile a number [0,1] for which an intensity is desired.
+     * @return a function storing the intensity in its argument and returning true if it is valid.
+     */
+    std::function<bool(double*)> _getIntensityFunction( int frameLow, int frameHigh, double percentile ) const;
     
     /**
      * Returns the pipeline responsible for rendering the image.
@@ -257,10 +281,13 @@ private:
      * Return the coordinates at pixel (x, y) in the given coordinate system.
      * @param x the x-coordinate of the desired pixel.
      * @param y the y-coordinate of the desired pixel.
+     * @param frameIndex the channel index.
      * @param system the desired coordinate system.
+     * @param axis the axis whose coordinate should be returned.
      * @return the coordinates at pixel (x, y).
      */
-    QString _getCoordinates( double x, double y, Carta::Lib::KnownSkyCS system, int axis ) const;
+    QString _getCoordinates( double x, double y, int frameIndex,
+            Carta::Lib::KnownSkyCS system, int axis ) const;
 
     
 
@@ -269,7 +296,7 @@ private:
      * Returns the raw data as an array.
      * @param frameLow the lower bound for the channel range or -1 for the whole image.
      * @param frameHigh the upper bound for the channel range or -1 for the whole image.
-     * @return the raw data or nullptr if there is none.
+     * @return the raw data or nullptr if there is none; the caller takes ownership.
      */
     Carta::Lib::NdArray::RawViewInterface *  _getRawData( int frameLow, int frameHigh ) const;
 
@@ -319,8 +346,10 @@ private:
      * @param filename the full path where the file is to be saved.
      * @param scale the scale (zoom level) of the saved image.
      * @param frameIndex the channel index.
+     * @param saveId - passed back with saveImageResult() to tell saves apart.
      */
-    void _saveImage( const QString& savename,  double scale, int frameIndex );
+    void _saveImage( const QString& savename,  double scale, int frameIndex,
+            const QString& saveId = "" );
     /**
      * Set the center for this image's display.
      * @param imgX the x-coordinate of the center.
@@ -342,6 +371,32 @@ private:
      */
     bool _setFileName( const QString& fileName );
 
+    /**
+     * Start loading the data in the background; progress is reported by the
+     * fileOpened() and fileLoaded() signals.  The data source keeps showing
+     * its current data until the new one is ready.
+     * @param fileName an identifier for the location of a data source.
+     */
+    void _setFileNameAsync( const QString& fileName );
+
+    /**
+     * Stop a load started with _setFileNameAsync(); no signals are emitted for it.
+     */
+    void _cancelLoad();
+
+    std::shared_ptr<ImageLoadJob> _startLoad( const QString& fileName );
+    void _setImage( const QString& fileName, const Carta::Lib::ImageRegistry::HandlePtr& handle );
+
+
+    /**
+     * Draw this image on the pixel grid of another image, so that the two line up on the sky.
+     * Pan and zoom are then in pixels of the other image.
+     * @param target - the image to line up with, or nullptr to draw this image on its
+     *      own pixel grid again.
+     * @return true if the image will be reprojected; false if there is no target, or
+     *      the coordinate systems of the two images can not be matched.
+     */
+    bool _setReprojection( const DataSource* target );
 
     /**
      * Set the data transform.
@@ -379,14 +434,23 @@ private:
     //Pointer to image interface.
     std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
 
+    /// m_image and the analytics shared with other views of the same file
+    Carta::Lib::ImageRegistry::HandlePtr m_imageHandle;
+
+    /// background load in progress, if any
+    std::shared_ptr<ImageLoadJob> m_loadJob;
+
     /// coordinate formatter
     std::shared_ptr<CoordinateFormatterInterface> m_coordinateFormatter;
 
-    /// clip cache, hard-coded to single quantile
-    std::vector< std::vector<double> > m_quantileCache;
-
     /// the rendering service
     std::shared_ptr<Carta::Core::ImageRenderService::Service> m_renderService;
+
+    /// pixels of the image we are reprojected onto, empty if we are not reprojected
+    QRectF m_reprojectionArea;
+
+    /// the image we are reprojected onto, its coordinates are used for the grid
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_reprojectionImage;
     
     /// wcs grid render service
     std::shared_ptr<Carta::Lib::IWcsGridRenderService> m_wcsGridRenderer;
@@ -396,11 +460,12 @@ private:
     
     std::unique_ptr<DataGrid> m_dataGrid;
 
+    /// cached formatters and pixels for the cursor readout
+    std::unique_ptr<CursorService> m_cursorService;
+
     ///pixel pipeline
     std::shared_ptr<Carta::Lib::PixelPipeline::CustomizablePixelPipeline> m_pixelPipeline;
 
-    /// Saves images
-    Carta::Core::ImageSaveService::ImageSaveService *m_saveService;
     QImage m_qimage;
     DataSource(const DataSource& other);
     DataSource& operator=(const DataSource& other);
@@ -0,0 +1,105 @@
+#include "ImageLoadJob.h"
+#include "FunctionRunnable.h"
+#include <QDebug>
+#include <QEventLoop>
+#include <QThreadPool>
+#include <stdexcept>
+
+namespace Carta {
+
+namespace Data {
+
+namespace {
+
+/// A single thread, so that images are not read by two jobs at the same time.
+QThreadPool& ioThread(){
+    static QThreadPool* pool = nullptr;
+    if ( pool == nullptr ){
+        pool = new QThreadPool();
+        pool->setMaxThreadCount( 1 );
+    }
+    return *pool;
+}
+
+}
+
+ImageLoadJob::ImageLoadJob( const QString& fileName ) :
+    m_fileName( fileName ),
+    m_cancelled( false ),
+    m_done( false ){
+}
+
+ImageLoadJob::SharedPtr ImageLoadJob::start( const QString& fileName,
+        const Carta::Lib::ImageRegistry::Loader& loader, const Prefetch& prefetch ){
+    //The job lives on the GUI thread, but the last reference can go away on the I/O thread.
+    SharedPtr job( new ImageLoadJob( fileName ), [] ( ImageLoadJob* obj ){ obj->deleteLater(); } );
+    ioThread().start( new FunctionRunnable( [job, loader, prefetch] () {
+        job->_run( loader, prefetch );
+    }));
+    return job;
+}
+
+void ImageLoadJob::_run( const Carta::Lib::ImageRegistry::Loader& loader, const Prefetch& prefetch ){
+    Carta::Lib::ImageRegistry::HandlePtr handle;
+    bool loaded = false;
+    if ( !m_cancelled ){
+        try {
+            handle = Carta::Lib::ImageRegistry::instance().open( m_fileName, loader, &loaded );
+        }
+        catch( std::logic_error& err ){
+            qDebug() << "Failed to load image "<<m_fileName<<err.what();
+        }
+    }
+    {
+        QMutexLocker locker( &m_mutex );
+        m_handle = handle;
+    }
+    emit opened( handle != nullptr );
+
+    //Images somebody else opened before could be in use on the GUI thread, so
+    //only new ones are read here.
+    if ( handle && loaded && !m_cancelled && prefetch ){
+        prefetch( handle );
+    }
+    bool success = handle && !m_cancelled;
+    {
+        QMutexLocker locker( &m_mutex );
+        m_done = true;
+    }
+    emit finished( success );
+}
+
+void ImageLoadJob::cancel(){
+    m_cancelled = true;
+}
+
+bool ImageLoadJob::isCancelled() const {
+    return m_cancelled;
+}
+
+void ImageLoadJob::wait(){
+    //Keep the GUI painting while the I/O thread works; user input is held back
+    //so nothing can start another load in the meantime.
+    QEventLoop loop;
+    connect( this, &ImageLoadJob::finished, &loop, &QEventLoop::quit, Qt::QueuedConnection );
+    if ( !isDone() ){
+        loop.exec( QEventLoop::ExcludeUserInputEvents );
+    }
+}
+
+bool ImageLoadJob::isDone() const {
+    QMutexLocker locker( &m_mutex );
+    return m_done;
+}
+
+QString ImageLoadJob::getFileName() const {
+    return m_fileName;
+}
+
+Carta::Lib::ImageRegistry::HandlePtr ImageLoadJob::getHandle() const {
+    QMutexLocker locker( &m_mutex );
+    return m_handle;
+}
+
+}
+}
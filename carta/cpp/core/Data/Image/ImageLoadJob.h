@@ -0,0 +1,102 @@
+/***
+ * Opens an image on the I/O thread, so that a big file or a slow file system
+ * does not block the GUI.
+ */
+
+#pragma once
+
+#include "CartaLib/ImageRegistry.h"
+#include <QMutex>
+#include <QObject>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace Carta {
+
+namespace Data {
+
+class ImageLoadJob : public QObject {
+
+    Q_OBJECT
+
+public:
+
+    typedef std::shared_ptr<ImageLoadJob> SharedPtr;
+
+    /// Reads the pixels needed first (e.g. the first frame) of a newly opened image,
+    /// called on the I/O thread.
+    typedef std::function<void( const Carta::Lib::ImageRegistry::HandlePtr& )> Prefetch;
+
+    /**
+     * Start loading an image on the I/O thread.  Images are loaded one at a time,
+     * in the order they were requested.
+     * @param fileName - the file to open.
+     * @param loader - opens the image if nobody has it open already.
+     * @param prefetch - reads the pixels needed first, if the image was opened by this job.
+     * @return the job; progress is reported through its signals.
+     */
+    static SharedPtr start( const QString& fileName,
+            const Carta::Lib::ImageRegistry::Loader& loader, const Prefetch& prefetch );
+
+    /**
+     * Ask the job to stop; a job that has not started yet will not open the image,
+     * and one that has will skip reading the pixels.
+     */
+    void cancel();
+
+    /**
+     * Returns true if the job was cancelled.
+     * @return true if cancel() was called.
+     */
+    bool isCancelled() const;
+
+    /**
+     * Wait until the job is done, handling events other than user input
+     * in the meantime.
+     */
+    void wait();
+
+    /**
+     * Returns true once the job has finished.
+     * @return true if the finished() signal has been emitted or is about to be.
+     */
+    bool isDone() const;
+
+    /**
+     * Returns the file being loaded.
+     * @return the file name passed to start().
+     */
+    QString getFileName() const;
+
+    /**
+     * Returns the loaded image.
+     * @return the handle of the image once opened() was emitted, nullptr before
+     *      that or if opening failed.
+     */
+    Carta::Lib::ImageRegistry::HandlePtr getHandle() const;
+
+signals:
+
+    /// The header of the image is available through getHandle(), or opening failed.
+    void opened( bool success );
+
+    /// The pixels needed first are ready; false if the load failed or was cancelled.
+    void finished( bool success );
+
+private:
+
+    ImageLoadJob( const QString& fileName );
+    void _run( const Carta::Lib::ImageRegistry::Loader& loader, const Prefetch& prefetch );
+
+    const QString m_fileName;
+    std::atomic<bool> m_cancelled;
+    Carta::Lib::ImageRegistry::HandlePtr m_handle;
+    bool m_done;
+    mutable QMutex m_mutex;
+
+    ImageLoadJob( const ImageLoadJob& other);
+    ImageLoadJob& operator=( const ImageLoadJob& other );
+};
+}
+}
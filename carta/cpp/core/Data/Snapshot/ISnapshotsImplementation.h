@@ -7,6 +7,8 @@
 
 #include "State/ObjectManager.h"
 #include "Snapshot.h"
+#include <QBuffer>
+#include <functional>
 
 namespace Carta {
 
@@ -42,6 +44,26 @@ public:
     virtual QString save( const QString& sessionId, const QString& snapshotType,
             const QString& snapName, const QString saveStr ) = 0;
 
+    /**
+     * Save a snapshot of a specific type, with the contents written by a callback
+     * directly to where the snapshot is stored.
+     * @param sessionId - an identifier for a user session.
+     * @param snapshotType - an identifier for the type of snapshot to save.
+     * @param snapName - an identifier for the snapshot.
+     * @param writer - writes the contents to the device; returns false if there was a problem.
+     * @return an empty string if the snapshot was saved; an error message otherwise.
+     */
+    //By default the contents are collected in memory and passed to save().
+    virtual QString saveStream( const QString& sessionId, const QString& snapshotType,
+            const QString& snapName, const std::function<bool(QIODevice&)>& writer ){
+        QBuffer buffer;
+        buffer.open( QIODevice::WriteOnly );
+        if ( !writer( buffer ) ){
+            return "There was a problem saving the "+snapshotType+" snapshot "+snapName;
+        }
+        return save( sessionId, snapshotType, snapName, QString::fromUtf8( buffer.data() ) );
+    }
+
     /**
      * Read a snapshot of a specific type.
      * @param sessionId - an identifier for a user session.
@@ -247,15 +247,19 @@ QString Snapshots::_saveLayout(const QString& sessionId, const QString& snapName
 
 QString Snapshots::_savePreferences(const QString& sessionId, const QString& snapName){
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
-    QString prefStr = objMan->getStateString( sessionId, Preferences::CLASS_NAME,SNAPSHOT_PREFERENCES );
-    QString result = m_snapImpl->save( sessionId, Snapshot::DIR_PREFERENCES, snapName, prefStr );
+    QString result = m_snapImpl->saveStream( sessionId, Snapshot::DIR_PREFERENCES, snapName,
+            [=]( QIODevice& device ){
+        return objMan->writeState( device, sessionId, SNAPSHOT_PREFERENCES );
+    });
     return result;
 }
 
 QString Snapshots::_saveData(const QString& sessionId, const QString& baseName){
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
-    QString dataStr = objMan->getStateString( sessionId, "Data", SNAPSHOT_DATA );
-    QString result = m_snapImpl->save( sessionId, Snapshot::DIR_DATA, baseName, dataStr );
+    QString result = m_snapImpl->saveStream( sessionId, Snapshot::DIR_DATA, baseName,
+            [=]( QIODevice& device ){
+        return objMan->writeState( device, sessionId, SNAPSHOT_DATA );
+    });
     return result;
 }
 
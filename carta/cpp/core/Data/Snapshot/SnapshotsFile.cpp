@@ -130,9 +130,8 @@ QString SnapshotsFile::read(const QString& sessionId, Carta::State::CartaObject:
 }
 
 
-QString SnapshotsFile::save( const QString& sessionId, const QString& snapshotType,
-                const QString& snapName, const QString saveStr ){
-    QString result;
+QString SnapshotsFile::_getFilePath( const QString& sessionId, const QString& snapshotType,
+        const QString& snapName ) const {
     QString fullName = snapName;
     if ( !snapName.endsWith( SUFFIX ) ){
         fullName = fullName + SUFFIX;
@@ -143,6 +142,14 @@ QString SnapshotsFile::save( const QString& sessionId, const QString& snapshotTy
         filePath = filePath + snapshotType + QDir::separator();
     }
     filePath = filePath + fullName;
+    return filePath;
+}
+
+
+QString SnapshotsFile::save( const QString& sessionId, const QString& snapshotType,
+                const QString& snapName, const QString saveStr ){
+    QString result;
+    QString filePath = _getFilePath( sessionId, snapshotType, snapName );
     bool saved = _save( filePath, saveStr );
     if ( !saved ){
         result = "There was a problem saving the "+snapshotType+" snapshot "+snapName;
@@ -150,6 +157,22 @@ QString SnapshotsFile::save( const QString& sessionId, const QString& snapshotTy
     return result;
 }
 
+QString SnapshotsFile::saveStream( const QString& sessionId, const QString& snapshotType,
+                const QString& snapName, const std::function<bool(QIODevice&)>& writer ){
+    QString result;
+    QString filePath = _getFilePath( sessionId, snapshotType, snapName );
+    QFile file( filePath );
+    bool saved = file.open( QIODevice::WriteOnly );
+    if ( saved ){
+        saved = writer( file );
+        file.close();
+    }
+    if ( !saved ){
+        result = "There was a problem saving the "+snapshotType+" snapshot "+snapName;
+    }
+    return result;
+}
+
 bool SnapshotsFile::_save( const QString& fileLocation, const QString& stateStr ) const {
     QFile file( fileLocation );
     bool fileSaved = true;
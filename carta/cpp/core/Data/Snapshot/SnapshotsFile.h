@@ -28,6 +28,9 @@ public:
     virtual QString save( const QString& sessionId, const QString& snapshotType,
                 const QString& snapName, const QString saveStr ) Q_DECL_OVERRIDE;
 
+    virtual QString saveStream( const QString& sessionId, const QString& snapshotType,
+                const QString& snapName, const std::function<bool(QIODevice&)>& writer ) Q_DECL_OVERRIDE;
+
     virtual QString read(const QString& sessionId, Carta::State::CartaObject::SnapshotType snapshotType,
                 const QString& snapName ) const Q_DECL_OVERRIDE;
 
@@ -38,6 +41,7 @@ private:
     const static QString SUFFIX;
     const static QString BASE_DIR;
     QString _getRootDir(const QString& /*sessionId*/) const;
+    QString _getFilePath( const QString& sessionId, const QString& snapshotType, const QString& snapName ) const;
     void _processDirectory(const QString& sessionId, const QDir& rootDir, QMap<QString,Snapshot>& snapshotList) const;
     QString _read( const QString& fileLocation ) const;
     bool _save( const QString& fileLocation, const QString& stateStr ) const;
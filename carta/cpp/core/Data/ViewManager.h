@@ -84,9 +84,11 @@ public:
      * @param fileName a locater for the data to load.
      * @param objectId the unique server side id of the controller which is
      * responsible for displaying the file.
-     * @return true if successful, false otherwise.
+     * @param async true to return as soon as the load has started; the controller
+     * then publishes the progress of the load.
+     * @return true if successful (or, for an asynchronous load, if it was started), false otherwise.
      */
-    bool loadFile( const QString& objectId, const QString& fileName);
+    bool loadFile( const QString& objectId, const QString& fileName, bool async = false );
 
 
     /**
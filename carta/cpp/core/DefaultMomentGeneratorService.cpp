@@ -0,0 +1,289 @@
+/**
+ *
+ **/
+
+#include "DefaultMomentGeneratorService.h"
+#include "CartaLib/MemoryImage.h"
+#include "CartaLib/PlaneCache.h"
+#include "CartaLib/Slice.h"
+#include "CartaLib/SpectralAxis.h"
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace Carta
+{
+namespace Core
+{
+namespace
+{
+typedef Lib::IMomentGeneratorService::Moment Moment;
+
+/// how many bytes of the cube to read at once
+static const int64_t CHUNK_BYTES = 64 * 1024 * 1024;
+
+/// rows of the image accumulated by one task
+static const int TILE_ROWS = 64;
+
+/// channels to use, min > max if there are none
+void
+channelRange( const Lib::IMomentGeneratorService::Params & params,
+              const std::vector < double > & spec,
+              const QString & specUnit,
+              int * minChannel,
+              int * maxChannel )
+{
+    int last = spec.size() - 1;
+    * minChannel = 0;
+    * maxChannel = last;
+    if ( params.minFrequency >= 0 && params.maxFrequency >= 0 ) {
+        if ( ! Lib::SpectralAxis::channelRange( spec, specUnit, params.minFrequency, params.maxFrequency,
+                                                params.rangeUnits, minChannel, maxChannel ) ) {
+            qWarning() << "Moments: cannot convert" << params.rangeUnits << "to" << specUnit
+                       << ", using all channels";
+        }
+        return;
+    }
+    if ( params.minChannel >= 0 ) {
+        * minChannel = std::min( params.minChannel, last + 1 );
+    }
+    if ( params.maxChannel >= 0 ) {
+        * maxChannel = std::min( params.maxChannel, last );
+    }
+}
+}
+
+DefaultMomentGeneratorService::DefaultMomentGeneratorService( QObject * parent )
+    : Lib::IMomentGeneratorService( parent )
+      , m_lastJobId( - 1 )
+{ }
+
+void
+DefaultMomentGeneratorService::setInput( Lib::Image::ImageInterface::SharedPtr image )
+{
+    m_image = image;
+}
+
+void
+DefaultMomentGeneratorService::setParams( const Params & params )
+{
+    m_params = params;
+}
+
+Lib::IMomentGeneratorService::JobId
+DefaultMomentGeneratorService::start( JobId jobId )
+{
+    if ( jobId < 0 ) {
+        jobId = m_lastJobId + 1;
+    }
+    m_lastJobId = jobId;
+
+    auto image = m_image;
+    auto params = m_params;
+    m_jobs.addFuture( QtConcurrent::run( [this, image, params, jobId] () {
+        Result result = compute( image, params, [this, jobId] () {
+                                     return m_lastJobId != jobId;
+                                 }
+                                 );
+        {
+            QMutexLocker locker( & m_resultMutex );
+            if ( m_lastJobId != jobId ) {
+                return;
+            }
+            m_result = result;
+            m_resultJobId = jobId;
+        }
+        QMetaObject::invokeMethod( this, "deliverResult", Qt::QueuedConnection );
+    }
+    ) );
+
+    return jobId;
+}
+
+void
+DefaultMomentGeneratorService::deliverResult()
+{
+    Result result;
+    JobId jobId;
+    {
+        QMutexLocker locker( & m_resultMutex );
+        if ( m_resultJobId != m_lastJobId ) {
+            return;
+        }
+        std::swap( result, m_result );
+        jobId = m_resultJobId;
+        m_resultJobId = - 1;
+    }
+    emit done( result, jobId );
+}
+
+Lib::IMomentGeneratorService::Result
+DefaultMomentGeneratorService::compute( Lib::Image::ImageInterface::SharedPtr image,
+                                        const Params & params,
+                                        const std::function < bool () > & cancelled )
+{
+    Result result;
+    if ( ! image || params.moments.empty() ) {
+        return result;
+    }
+    const Lib::Image::ImageInterface::VI dims = image-> dims();
+    if ( dims.size() < 2 ) {
+        return result;
+    }
+    const int nx = dims[0];
+    const int ny = dims[1];
+    const int nChannels = dims.size() > 2 ? dims[2] : 1;
+    const int64_t planeSize = int64_t( nx ) * ny;
+
+    QString specUnit;
+    std::vector < double > spec = Lib::SpectralAxis::channelValues( * image, 2, & specUnit );
+    int minChannel, maxChannel;
+    channelRange( params, spec, specUnit, & minChannel, & maxChannel );
+
+    // channel widths
+    std::vector < double > width( nChannels, 1 );
+    for ( int c = 0 ; c < nChannels && nChannels > 1 ; c++ ) {
+        int next = c + 1 < nChannels ? c + 1 : c - 1;
+        width[c] = std::fabs( spec[next] - spec[c] );
+    }
+
+    // spectral coordinates are accumulated relative to the first channel to keep the
+    // sums of squares accurate
+    const double vRef = minChannel <= maxChannel ? spec[minChannel] : 0;
+    bool wantWeights = false, wantSecond = false, wantIntegrated = false, wantPeak = false;
+    for ( Moment moment : params.moments ) {
+        wantWeights |= moment == Moment::SpectralMean || moment == Moment::SpectralDispersion;
+        wantSecond |= moment == Moment::SpectralDispersion;
+        wantIntegrated |= moment == Moment::Integrated;
+        wantPeak |= moment == Moment::Peak;
+    }
+    const float nan = std::numeric_limits < float >::quiet_NaN();
+    std::vector < double > sumI( wantWeights ? planeSize : 0, 0 );
+    std::vector < double > sumIV( wantWeights ? planeSize : 0, 0 );
+    std::vector < double > sumIVV( wantSecond ? planeSize : 0, 0 );
+    std::vector < double > sumIdV( wantIntegrated ? planeSize : 0, 0 );
+    std::vector < float > peak( wantPeak ? planeSize : 0, nan );
+    std::vector < char > hit( planeSize, 0 );
+
+    // bands of rows, accumulated in parallel
+    std::vector < std::pair < int, int > > tiles;
+    for ( int y = 0 ; y < ny ; y += TILE_ROWS ) {
+        tiles.push_back( std::make_pair( y, std::min( y + TILE_ROWS, ny ) ) );
+    }
+
+    const double minI = params.minIntensity;
+    const double maxI = params.maxIntensity;
+    const int chunkChannels = std::max < int64_t > ( 1, CHUNK_BYTES / ( planeSize * sizeof( float ) ) );
+    std::vector < float > chunk;
+    for ( int c0 = minChannel ; c0 <= maxChannel ; c0 += chunkChannels ) {
+        if ( cancelled() ) {
+            return result;
+        }
+        int c1 = std::min( c0 + chunkChannels, maxChannel + 1 );
+        SliceND slice = SliceND().next();
+        for ( size_t i = 2 ; i < dims.size() ; i++ ) {
+            if ( i == 2 ) {
+                slice.next().start( c0 ).end( c1 ).step( 1 );
+            }
+            else {
+                slice.next().index( 0 );
+            }
+        }
+        if ( ! Lib::PlaneCache::instance().readSlice( * image, slice, chunk ) ||
+             int64_t( chunk.size() ) != planeSize * ( c1 - c0 ) ) {
+            qWarning() << "Moments: could not read channels" << c0 << "to" << c1 - 1;
+            return result;
+        }
+
+        const float * data = chunk.data();
+        QtConcurrent::blockingMap( tiles, [&] ( const std::pair < int, int > & tile ) {
+            int64_t first = int64_t( tile.first ) * nx;
+            int64_t last = int64_t( tile.second ) * nx;
+            for ( int c = c0 ; c < c1 ; c++ ) {
+                const float * plane = data + int64_t( c - c0 ) * planeSize;
+                double v = spec[c] - vRef;
+                double dv = width[c];
+                for ( int64_t i = first ; i < last ; i++ ) {
+                    float val = plane[i];
+                    if ( std::isnan( val ) || val < minI || val > maxI ) {
+                        continue;
+                    }
+                    hit[i] = 1;
+                    if ( wantWeights ) {
+                        sumI[i] += val;
+                        sumIV[i] += val * v;
+                        if ( wantSecond ) {
+                            sumIVV[i] += val * v * v;
+                        }
+                    }
+                    if ( wantIntegrated ) {
+                        sumIdV[i] += val * dv;
+                    }
+                    if ( wantPeak && ! ( peak[i] >= val ) ) {
+                        peak[i] = val;
+                    }
+                }
+            }
+        }
+        );
+    }
+
+    // one channel, same coordinates as the cube
+    Lib::Image::ImageInterface::VI outDims = dims;
+    for ( size_t i = 2 ; i < outDims.size() ; i++ ) {
+        outDims[i] = 1;
+    }
+    QString unit = image-> getPixelUnit().toStr();
+    QString integratedUnit = unit;
+    if ( ! specUnit.isEmpty() ) {
+        integratedUnit = unit.isEmpty() ? specUnit : unit + "." + specUnit;
+    }
+    auto meta = image-> metaData();
+
+    for ( Moment moment : params.moments ) {
+        auto pixels = std::make_shared < std::vector < float > > ( planeSize, nan );
+        std::vector < float > & out = * pixels;
+        for ( int64_t i = 0 ; i < planeSize ; i++ ) {
+            if ( ! hit[i] ) {
+                continue;
+            }
+            switch ( moment ) {
+            case Moment::Integrated :
+                out[i] = sumIdV[i];
+                break;
+            case Moment::SpectralMean :
+                if ( sumI[i] != 0 ) {
+                    out[i] = vRef + sumIV[i] / sumI[i];
+                }
+                break;
+            case Moment::SpectralDispersion :
+                if ( sumI[i] != 0 ) {
+                    double mean = sumIV[i] / sumI[i];
+                    out[i] = std::sqrt( std::max( 0.0, sumIVV[i] / sumI[i] - mean * mean ) );
+                }
+                break;
+            case Moment::Peak :
+                out[i] = peak[i];
+                break;
+            }
+        }
+        QString momentUnit = moment == Moment::Integrated ? integratedUnit
+                             : moment == Moment::Peak ? unit : specUnit;
+        result.push_back( std::make_shared < Lib::Image::MemoryImage > (
+                              pixels, outDims, Lib::Unit( momentUnit ), meta ) );
+    }
+    return result;
+} // compute
+
+DefaultMomentGeneratorService::~DefaultMomentGeneratorService()
+{
+    // running jobs notice this and stop at the next chunk
+    m_lastJobId = - 2;
+    m_jobs.waitForFinished();
+}
+}
+}
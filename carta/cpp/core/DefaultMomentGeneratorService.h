@@ -0,0 +1,76 @@
+/**
+ *
+ **/
+
+#pragma once
+#include "CartaLib/IMomentGeneratorService.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QFutureSynchronizer>
+#include <atomic>
+#include <functional>
+
+namespace Carta
+{
+namespace Core
+{
+/// Default implementation of IMomentGeneratorService.
+///
+/// The cube is streamed through in chunks of channels, so that only the chunk being
+/// processed and a few accumulators per spatial pixel are kept in memory. Each chunk is
+/// accumulated in parallel over bands of rows. The computation runs on a thread pool,
+/// the result is reported on the thread of the service.
+///
+/// The moments 1 and 2 are in the units of the spectral axis, see Moment.
+class DefaultMomentGeneratorService : public Lib::IMomentGeneratorService
+{
+    Q_OBJECT
+    CLASS_BOILERPLATE( DefaultMomentGeneratorService );
+
+public:
+
+    explicit
+    DefaultMomentGeneratorService( QObject * parent = 0 );
+
+    virtual void
+    setInput( Lib::Image::ImageInterface::SharedPtr image ) override;
+
+    virtual void
+    setParams( const Params & params ) override;
+
+    virtual JobId
+    start( JobId jobId = - 1 ) override;
+
+    /// compute the moments synchronously
+    /// \param image the cube
+    /// \param params what to compute
+    /// \param cancelled polled between chunks, the computation gives up if it returns true
+    /// \return the moment maps, empty if they could not be computed
+    static Result
+    compute( Lib::Image::ImageInterface::SharedPtr image,
+             const Params & params,
+             const std::function < bool () > & cancelled );
+
+    virtual
+    ~DefaultMomentGeneratorService();
+
+private slots:
+
+    void deliverResult();
+
+private:
+
+    Lib::Image::ImageInterface::SharedPtr m_image = nullptr;
+    Params m_params;
+    std::atomic < JobId > m_lastJobId;
+
+    /// result of the last finished job, handed from the worker to deliverResult()
+    QMutex m_resultMutex;
+    Result m_result;
+    JobId m_resultJobId = - 1;
+
+    QFutureSynchronizer < void > m_jobs;
+};
+}
+}
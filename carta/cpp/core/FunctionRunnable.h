@@ -0,0 +1,24 @@
+/**
+ * QRunnable running a std::function, for handing lambdas to a QThreadPool.
+ **/
+
+#pragma once
+
+#include <QRunnable>
+#include <functional>
+
+class FunctionRunnable : public QRunnable {
+
+public:
+
+    FunctionRunnable( const std::function<void()>& func ) : m_func( func ){
+    }
+
+    virtual void run() Q_DECL_OVERRIDE {
+        m_func();
+    }
+
+private:
+
+    std::function<void()> m_func;
+};
@@ -1,6 +1,10 @@
 #include "ContourEditorController.h"
 #include "core/Globals.h"
+#include "CartaLib/Algorithms/PolylineSimplifier.h"
+#include <QTimer>
 #include <functional>
+#include <cmath>
+#include <iterator>
 
 /*
 namespace Impl
@@ -30,6 +34,8 @@ namespace Carta
 
 namespace Hacks
 {
+namespace VGE = Carta::Lib::VectorGraphics::Entries;
+
 ContourEditorController::ContourEditorController( QObject * parent,
                                                   QString statePrefix
                                                   ) : QObject( parent )
@@ -91,7 +97,20 @@ ContourEditorController::startRendering( ContourEditorController::JobId jobId )
         m_lastJobId = jobId;
     }
 
-    (void) m_contourSvc-> start( m_lastJobId );
+    if ( m_contours ) {
+        // the contours are already computed, only the level of detail is needed;
+        // it's reported asynchronously, like the result of the contour service
+        JobId id = m_lastJobId;
+        QTimer::singleShot( 0, this, [this, id] () {
+                                if ( id == m_lastJobId ) {
+                                    emit done( lodVG(), id );
+                                }
+                            }
+                            );
+    }
+    else {
+        (void) m_contourSvc-> start( m_lastJobId );
+    }
 
     return m_lastJobId;
 }
@@ -100,9 +119,68 @@ void
 ContourEditorController::setInput( Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView )
 {
     m_contourSvc-> setInput( rawView );
+    invalidateContours();
 }
 
-namespace VGE = Carta::Lib::VectorGraphics::Entries;
+bool
+ContourEditorController::setZoom( double zoom )
+{
+    if ( ! ( zoom > 0 ) ) {
+        return false;
+    }
+    int bucket = std::floor( std::log2( zoom ) * ZoomBucketsPerOctave );
+    if ( bucket == m_zoomBucket ) {
+        return false;
+    }
+    m_zoomBucket = bucket;
+    return true;
+}
+
+void
+ContourEditorController::invalidateContours()
+{
+    m_contours = nullptr;
+    m_lodCache.clear();
+}
+
+Carta::Lib::VectorGraphics::VGList
+ContourEditorController::lodVG()
+{
+    if ( ! m_contours ) {
+        return Carta::Lib::VectorGraphics::VGList();
+    }
+    auto it = m_lodCache.find( m_zoomBucket );
+    if ( it != m_lodCache.end() ) {
+        return it-> second;
+    }
+
+    // contours are in image pixels, so the tolerance shrinks as the zoom grows; use
+    // the largest zoom of the bucket so that no zoom in it exceeds the tolerance
+    double maxZoom = std::pow( 2.0, ( m_zoomBucket + 1 ) / double ( ZoomBucketsPerOctave ) );
+    Carta::Lib::Algorithms::PolylineSimplifier simplifier( LodTolerance / maxZoom );
+
+    Carta::Lib::VectorGraphics::VGComposer vgc;
+    const auto & contourSet = m_contours-> contours();
+    for ( size_t k = 0 ; k < contourSet.size() ; ++k ) {
+        const auto & con = contourSet[k].polylines();
+        vgc.append< VGE::SetPen >( m_pens[k]);
+        for ( size_t i = 0 ; i < con.size() ; ++i ) {
+            vgc.append < VGE::DrawPolyline > ( simplifier.simplify( con[i] ) );
+        }
+    }
+
+    // drop the level of detail furthest from the current one
+    if ( m_lodCache.size() >= MaxLodEntries ) {
+        auto furthest = m_lodCache.begin();
+        if ( std::abs( m_lodCache.rbegin()-> first - m_zoomBucket ) >
+             std::abs( furthest-> first - m_zoomBucket ) ) {
+            furthest = std::prev( m_lodCache.end() );
+        }
+        m_lodCache.erase( furthest );
+    }
+    m_lodCache[m_zoomBucket] = vgc.vgList();
+    return vgc.vgList();
+} // lodVG
 
 void
 ContourEditorController::contourServiceCB(
@@ -120,18 +198,10 @@ ContourEditorController::contourServiceCB(
         return;
     }
 
-    // convert the raw contours into VG
-    Carta::Lib::VectorGraphics::VGComposer vgc;
-    const auto & contourSet = result.contours();
-    for ( size_t k = 0 ; k < contourSet.size() ; ++k ) {
-        const auto & con = contourSet[k].polylines();
-        vgc.append< VGE::SetPen >( m_pens[k]);
-        for ( size_t i = 0 ; i < con.size() ; ++i ) {
-            const QPolygonF & poly = con[i];
-            vgc.append < VGE::DrawPolyline > ( poly );
-        }
-    }
-    emit done( vgc.vgList(), m_lastJobId );
+    // keep the raw contours, and convert them into VG for the current zoom
+    invalidateContours();
+    m_contours = std::make_shared < Carta::Lib::IContourGeneratorService::Result > ( result );
+    emit done( lodVG(), m_lastJobId );
 } // contourServiceCB
 
 void
@@ -212,6 +282,7 @@ ContourEditorController::stdVarCB()
         }
     }
     m_contourSvc-> setLevels( levels);
+    invalidateContours();
     emit updated();
 
 //    text.replace( ',',' ');
@@ -5,6 +5,8 @@
  * - monitors the shared state to see when user changed the UI related to contours
  * - it can start a rendering request (asynchronously)
  * - it reports rendered vector graphics via signal
+ * - it keeps the contours simplified to the detail visible at each zoom level, so
+ *   zooming out of noisy data doesn't draw millions of sub-pixel segments
  *
  * It is essentially a combination of service & controller in one class.
  **/
@@ -18,6 +20,7 @@
 #include "core/Hacks/SharedState.h"
 #include "core/DefaultContourGeneratorService.h"
 #include <QObject>
+#include <map>
 
 namespace Carta
 {
@@ -59,6 +62,13 @@ public:
     void
     setInput( Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView );
 
+    /// set the zoom (screen pixels per image pixel) the contours will be drawn at,
+    /// which determines how much detail they need
+    /// \return true if the zoom needs a different level of detail, i.e. the contours
+    /// should be rendered again
+    bool
+    setZoom( double zoom );
+
 signals:
 
     /// emitted when user changed some parameters, and a recompute/re-render is required
@@ -91,6 +101,24 @@ private:
     void
     stdVarCB();
 
+    /// vector graphics for the last computed contours, simplified for the current zoom
+    Carta::Lib::VectorGraphics::VGList
+    lodVG();
+
+    /// forget the computed contours, e.g. because the input or the levels changed
+    void
+    invalidateContours();
+
+    /// zoom levels are grouped into buckets of this many per factor of 2, all zooms
+    /// in a bucket share the same simplified contours
+    static constexpr int ZoomBucketsPerOctave = 2;
+
+    /// how far (in screen pixels) simplified contours may be from the exact ones
+    static constexpr double LodTolerance = 0.5;
+
+    /// how many levels of detail to keep for the computed contours
+    static constexpr size_t MaxLodEntries = 8;
+
     IConnector * m_connector = nullptr;
     QString m_statePrefix = "/";
 
@@ -99,6 +127,15 @@ private:
     Carta::Core::DefaultContourGeneratorService::UniquePtr m_contourSvc = nullptr;
 
     std::vector<QPen> m_pens;
+
+    /// last computed contours, nullptr if they need to be computed
+    std::shared_ptr < Carta::Lib::IContourGeneratorService::Result > m_contours = nullptr;
+
+    /// zoom bucket the contours are drawn at
+    int m_zoomBucket = 0;
+
+    /// vector graphics of the computed contours for each zoom bucket
+    std::map < int, Carta::Lib::VectorGraphics::VGList > m_lodCache;
 };
 }
 }
@@ -236,6 +236,11 @@ ImageViewController::requestImageAndGridUpdate()
 //    m_igSync-> startAll();
     m_syncSvc-> startImage();
     m_syncSvc-> startGrid();
+
+    // contours only need to be redone if the zoom needs a different level of detail
+    if ( m_contourEditorController-> setZoom( m_renderService-> zoom() ) ) {
+        m_syncSvc-> startContour();
+    }
 } // updateGridAfterPanZoom
 
 QString
@@ -401,12 +406,7 @@ ImageViewController::loadImage( QString fname )
                               );
 
     // clear quantile cache
-    m_quantileCache.resize( 0 );
-    int nf = 1;
-    if ( m_astroImage-> dims().size() > 2 ) {
-        nf = m_astroImage-> dims()[2];
-    }
-    m_quantileCache.resize( nf );
+    m_quantileCache.clear();
 
     // set the frame to first one
     m_frameVar-> set( 0 );
@@ -490,14 +490,15 @@ ImageViewController::loadFrame( int frame )
     Carta::Lib::NdArray::RawViewInterface::SharedPtr view( m_astroImage-> getDataSlice( frameSlice ) );
 
     // compute 95% clip values, unless we already have them in the cache
-    std::vector < double > clips = m_quantileCache[m_currentFrame];
+    std::vector < double > clips;
+    m_quantileCache.find( m_currentFrame, clips );
     if ( clips.size() < 2 ) {
         Carta::Lib::NdArray::Double doubleView( view.get(), false );
         clips = Carta::Core::Algorithms::quantiles2pixels(
             doubleView, { 0.025, 0.975 }
             );
         qDebug() << "recomputed clips" << clips;
-        m_quantileCache[m_currentFrame] = clips;
+        m_quantileCache.insert( m_currentFrame, clips, clips.size() * sizeof( double ) );
     }
 
     m_pixelPipeline-> setMinMax( clips[0], clips[1] );
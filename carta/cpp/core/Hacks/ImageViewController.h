@@ -11,6 +11,7 @@
 #include "CartaLib/PixelPipeline/CustomizablePixelPipeline.h"
 #include "CartaLib/Algorithms/ContourConrec.h"
 #include "CartaLib/Nullable.h"
+#include "CartaLib/CacheRegistry.h"
 #include "CartaLib/Hooks/GetWcsGridRenderer.h"
 #include "WcsGridOptionsController.h"
 #include "ContourEditorController.h"
@@ -319,8 +320,8 @@ private:
     /// the loaded astro image
     Carta::Lib::Image::ImageInterface::SharedPtr m_astroImage = nullptr;
 
-    /// clip cache, hard-coded to single quantile
-    std::vector < std::vector < double > > m_quantileCache;
+    /// clip cache, hard-coded to single quantile, indexed by frame
+    Carta::Lib::LruCache < int, std::vector < double > > m_quantileCache { "clip quantiles" };
 
     /// current filename
     QString m_fileName;
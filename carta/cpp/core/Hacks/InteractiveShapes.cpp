@@ -3,6 +3,8 @@
  **/
 
 #include "InteractiveShapes.h"
+#include <algorithm>
+#include <functional>
 
 
 namespace editable
@@ -14,6 +16,53 @@ void InteractiveShapeBase::handleEvent(Carta::Lib::InputEvents::JsonEvent & ev)
 
 }
 
+void InteractiveShapeBase::geometryChanged()
+{
+    if ( m_controller ) {
+        m_controller-> shapeGeometryChanged( this );
+    }
+}
+
+void InteractiveShapesController::addShape(InteractiveShapeBase::SharedPtr editableShape)
+{
+    if ( editableShape ) {
+        editableShape-> m_controller = this;
+        editableShape-> m_controllerIndex = m_shapes.size();
+    }
+    m_shapes.push_back( editableShape );
+    shapeGeometryChanged( editableShape.get() );
+}
+
+void InteractiveShapesController::reset()
+{
+    for ( auto & shape : m_shapes ) {
+        if ( shape ) {
+            shape-> m_controller = nullptr;
+        }
+    }
+    m_shapes.resize( 0 );
+    m_shapeIndex.clear();
+    m_unboundedShapes.clear();
+    m_draggedShape = nullptr;
+}
+
+void InteractiveShapesController::shapeGeometryChanged(InteractiveShapeBase * shape)
+{
+    if ( ! shape || shape-> m_controller != this ) {
+        return;
+    }
+    size_t index = shape-> m_controllerIndex;
+    QRectF box = shape-> outlineBox();
+    if ( box.isNull() ) {
+        m_shapeIndex.remove( index );
+        m_unboundedShapes.insert( index );
+    }
+    else {
+        m_unboundedShapes.erase( index );
+        m_shapeIndex.insert( index, box );
+    }
+}
+
 void InteractiveShapesController::handleEvent(Carta::Lib::InputEvents::JsonEvent & ev)
 {
 
@@ -66,9 +115,15 @@ InteractiveShapeBase::SharedPtr InteractiveShapesController::findActiveShape(con
 {
     InteractiveShapeBase::SharedPtr currShape = nullptr;
 
+    // only the shapes whose boxes contain the point, and those without a box, can
+    // contain it; shapes added later are on top, so they are tested first
+    std::vector < size_t > candidates = m_shapeIndex.query( pt );
+    candidates.insert( candidates.end(), m_unboundedShapes.begin(), m_unboundedShapes.end() );
+    std::sort( candidates.begin(), candidates.end(), std::greater < size_t > () );
+
     //        for ( auto & shape : m_shapes ) {
-    for ( auto i = m_shapes.rbegin() ; i != m_shapes.rend() ; ++i ) {
-        auto & shape = * i;
+    for ( size_t i : candidates ) {
+        auto & shape = m_shapes[i];
 
         // skip deleted shapes
         if ( ! shape ) { continue; }
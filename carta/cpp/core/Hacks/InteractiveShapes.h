@@ -7,6 +7,8 @@
 #include "CartaLib/CartaLib.h"
 #include "CartaLib/InputEvents.h"
 #include "CartaLib/VectorGraphics/VGList.h"
+#include "CartaLib/Regions/RTree.h"
+#include <set>
 
 namespace editable
 {
@@ -27,6 +29,8 @@ namespace editable
 //    handleDragEvent( Carta::Lib::InputEvents::DragEvent & ev ) = 0;
 //};
 
+class InteractiveShapesController;
+
 class InteractiveShapeBase
 {
     CLASS_BOILERPLATE( InteractiveShapeBase );
@@ -42,6 +46,17 @@ public:
         return false;
     }
 
+    /// returns a box containing all points for which isPointInside() can be true,
+    /// so that the controller only needs to test the shapes near the pointer
+    /// Default is to return a null rectangle, which means the shape is always tested.
+    virtual QRectF
+    outlineBox() { return QRectF(); }
+
+    /// has to be called whenever outlineBox() changes, except in the drag handlers
+    /// (the controller updates the box of the dragged shape itself)
+    void
+    geometryChanged();
+
     /// it is possible to deactivate a shape so it does not participate in
     /// event delivery
     bool m_isActive = true;
@@ -175,6 +190,14 @@ public:
     {
         ;
     }
+
+private:
+
+    friend class InteractiveShapesController;
+
+    /// controller this shape was added to, and our position in its list of shapes
+    InteractiveShapesController * m_controller = nullptr;
+    size_t m_controllerIndex = 0;
 };
 
 /// can
@@ -192,17 +215,11 @@ public:
 
     /// add a shape to the end of the list
     void
-    addShape( InteractiveShapeBase::SharedPtr editableShape )
-    {
-        m_shapes.push_back( editableShape );
-    }
+    addShape( InteractiveShapeBase::SharedPtr editableShape );
 
     /// remove all shapes
     void
-    reset()
-    {
-        m_shapes.resize( 0 );
-    }
+    reset();
 
     /// get the current VGlist
     Carta::Lib::VectorGraphics::VGList
@@ -225,12 +242,19 @@ public:
     hasStateChanged() { return m_stateChanged; }
 
     virtual
-    ~InteractiveShapesController() { }
+    ~InteractiveShapesController()
+    {
+        reset();
+    }
 
     /// find shape under a point
     InteractiveShapeBase::SharedPtr
     findActiveShape( const QPointF & pt );
 
+    /// update the index entry of the shape after its outline box changed
+    void
+    shapeGeometryChanged( InteractiveShapeBase * shape );
+
 private:
 
     /// deliver double tap event
@@ -253,6 +277,7 @@ private:
         m_draggedShape = findActiveShape( pt );
         if ( m_draggedShape ) {
             m_draggedShape-> handleDragStart( pt );
+            shapeGeometryChanged( m_draggedShape.get() );
         }
     }
 
@@ -264,6 +289,7 @@ private:
             return;
         }
         m_draggedShape-> handleDrag( pt );
+        shapeGeometryChanged( m_draggedShape.get() );
     }
 
     /// deliver drag done event
@@ -272,6 +298,7 @@ private:
     {
         if ( m_draggedShape ) {
             m_draggedShape-> handleDragDone( pt );
+            shapeGeometryChanged( m_draggedShape.get() );
         }
         m_draggedShape = nullptr;
     }
@@ -282,5 +309,11 @@ private:
     bool m_stateChanged = true;
 
     std::vector < InteractiveShapeBase::SharedPtr > m_shapes;
+
+    /// outline boxes of the shapes, by position in m_shapes
+    Carta::Lib::Regions::RTree < size_t > m_shapeIndex;
+
+    /// shapes without an outline box, these are always tested
+    std::set < size_t > m_unboundedShapes;
 };
 }
@@ -282,7 +282,11 @@ public:
     }
 
     void
-    setPos( const QPointF & pt ) { m_pos = pt; }
+    setPos( const QPointF & pt )
+    {
+        m_pos = pt;
+        geometryChanged();
+    }
 
     const QPointF &
     pos() const { return m_pos; }
@@ -318,6 +322,12 @@ public:
         return dsq < m_size * m_size;
     }
 
+    virtual QRectF
+    outlineBox() override
+    {
+        return QRectF( m_pos.x() - m_size, m_pos.y() - m_size, m_size * 2, m_size * 2 );
+    }
+
     virtual void
     handleDragStart( const QPointF & pt ) override
     {
@@ -406,6 +416,12 @@ public:
         return m_circleRegion-> isPointInside( {pt} );
     }
 
+    virtual QRectF
+    outlineBox() override
+    {
+        return m_circleRegion-> outlineBox();
+    }
+
     virtual void
     handleDragStart( const QPointF & pt ) override
     {
@@ -538,6 +554,12 @@ public:
         return m_polygonRegion-> isPointInside( {pt} );
     }
 
+    virtual QRectF
+    outlineBox() override
+    {
+        return m_polygonRegion-> outlineBox();
+    }
+
     virtual void
     handleDragStart( const QPointF & pt ) override
     {
@@ -1071,6 +1093,7 @@ EditableCircle::controlPointCB( bool movingCenter, bool final )
     if ( final ) {
         m_circleRegion->setCenter( m_centerCP-> pos() );
         m_circleRegion->setRadius( dist );
+        geometryChanged();
     }
 } // controlPointCB
 
@@ -1129,6 +1152,7 @@ EditablePolygon::controlPointCB( int index, bool final )
 
     if ( final ) {
         m_polygonRegion->setqpolyf( m_shadowPolygon );
+        geometryChanged();
     }
 
 //    auto poly = m_polygonRegion-> qpolyf();
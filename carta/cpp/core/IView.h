@@ -12,6 +12,7 @@ class QString;
 class QSize;
 
 #include <QtGlobal>
+#include <QRect>
 
 /**
  * @brief The IView interface defines the necessary functionality that a server side view
@@ -79,6 +80,15 @@ public:
     /// this is called when a view is refreshed in the GUI
     virtual void viewRefreshed( qint64 id) = 0;
 
+    /// returns the part of the buffer (in buffer coordinates) that changed since the
+    /// last call, and resets the accumulated damage
+    ///
+    /// Connectors use this to ship only the changed pixels to the client. A null
+    /// rectangle means 'everything changed', which is also the default for views that
+    /// do not track damage.
+    virtual QRect
+    takeDirtyRect() { return QRect(); }
+
     virtual
     ~IView() { }
 };
@@ -4,8 +4,10 @@
 
 #include "ImageRenderService.h"
 #include "CartaLib/LinearMap.h"
+#include "CartaLib/FloatRawView.h"
 #include <QColor>
 #include <QPainter>
+#include <cmath>
 
 namespace NdArray = Carta::Lib::NdArray;
 
@@ -19,21 +21,12 @@ static constexpr QImage::Format OptimalQImageFormat = QImage::Format_ARGB32_Prem
 /// \todo check if the bug is still there in Qt5.4+, it definitely is there in Qt5.3
 static constexpr bool QtPremultipliedBugStillExists = true;
 
-/// internal algorithm for converting an instance of image interface to qimage
-/// using the pixel pipeline
-///
-/// \tparam Pipeline
-/// \param m_rawView
-/// \param pipe
-/// \param m_qImage
-template < class Pipeline >
-static void
-iView2qImage( NdArray::RawViewInterface * rawView, Pipeline & pipe, QImage & qImage )
+/// make sure qImage has the right size/format for rendering a frame of the given size
+/// \return pointer to the beginning of the last row (we are constructing images
+/// bottom-up)
+static QRgb *
+prepareFrameImage( const QSize & size, QImage & qImage )
 {
-    qDebug() << "rv2qi2" << rawView-> dims();
-    typedef double Scalar;
-    QSize size( rawView->dims()[0], rawView->dims()[1] );
-
     QImage::Format desiredFormat = OptimalQImageFormat;
     if ( QtPremultipliedBugStillExists ) {
         desiredFormat = QImage::Format_ARGB32;
@@ -48,12 +41,27 @@ iView2qImage( NdArray::RawViewInterface * rawView, Pipeline & pipe, QImage & qIm
     CARTA_ASSERT( bytesPerLine == size.width() * 4 );
     Q_UNUSED( bytesPerLine );
 
-    // start with a pointer to the beginning of last row (we are constructing image
-    // bottom-up)
-    QRgb * outPtr = reinterpret_cast < QRgb * > (
+    return reinterpret_cast < QRgb * > (
         qImage.bits() + size.width() * ( size.height() - 1 ) * 4 );
+}
+
+/// internal algorithm for converting an instance of image interface to qimage
+/// using the pixel pipeline
+///
+/// \tparam Scalar type the pixels are converted to before they go to the pipeline
+/// \tparam Pipeline
+/// \param m_rawView
+/// \param pipe
+/// \param m_qImage
+template < typename Scalar, class Pipeline >
+static void
+iView2qImage( NdArray::RawViewInterface * rawView, Pipeline & pipe, QImage & qImage )
+{
+    qDebug() << "rv2qi2" << rawView-> dims();
+    QSize size( rawView->dims()[0], rawView->dims()[1] );
+    QRgb * outPtr = prepareFrameImage( size, qImage );
 
-    // make a double view
+    // make a typed view
     NdArray::TypedView < Scalar > typedView( rawView, false );
 
     /// @todo for more efficiency, instead of forEach() we should switch to one of the
@@ -79,6 +87,74 @@ iView2qImage( NdArray::RawViewInterface * rawView, Pipeline & pipe, QImage & qIm
     typedView.forEach( lambda );
 } // rawView2QImage
 
+/// version of iView2qImage for float data and float pipelines
+///
+/// in-memory float views (e.g. from the plane cache) are converted a whole row
+/// at a time, without any per-pixel conversions or function calls
+template < class Pipeline >
+static void
+floatView2qImage( NdArray::RawViewInterface * rawView, Pipeline & pipe, QImage & qImage )
+{
+    NdArray::FloatRawView * floatView = dynamic_cast < NdArray::FloatRawView * > ( rawView );
+    if ( ! floatView ) {
+        iView2qImage < float > ( rawView, pipe, qImage );
+        return;
+    }
+
+    QSize size( rawView->dims()[0], rawView->dims()[1] );
+    QRgb * outPtr = prepareFrameImage( size, qImage );
+    QRgb nanColor = qRgb( 255, 0, 0 );
+    floatView-> forEach(
+        size.width() * sizeof( float ),
+        [&] ( const char * ptr, int64_t count ) {
+            CARTA_ASSERT( count == size.width() );
+            pipe.convertRow( reinterpret_cast < const float * > ( ptr ), count, outPtr, nanColor );
+            outPtr -= size.width();
+        }
+        );
+} // floatView2qImage
+
+/// reprojection grids never have more nodes than this, to bound the time it takes
+/// to build one
+static constexpr double MaxGridNodes = 1 << 20;
+
+/// reprojection grids are grown to multiples of this many nodes, so that panning
+/// around does not need a new grid every time
+static constexpr double GridBlockNodes = 64;
+
+/// distance between the nodes of a reprojection grid covering the area, for the given zoom
+static double
+reprojectionGridStep( double zoom, const QRectF & area )
+{
+    // nodes about 16 screen pixels apart, rounded to a power of two so that
+    // zooms close to each other share a grid
+    double step = std::pow( 2.0, std::round( std::log2( 16.0 / zoom ) ) );
+    step = Carta::Lib::clamp( step, 1.0, 64.0 );
+    while ( ( area.width() / step + GridBlockNodes ) * ( area.height() / step + GridBlockNodes )
+            > MaxGridNodes ) {
+        step *= 2;
+    }
+    return step;
+}
+
+/// part of the area a reprojection grid needs to cover to show the visible rectangle,
+/// grown to whole blocks of nodes (counted from the top left corner of the area)
+static QRectF
+reprojectionGridArea( const QRectF & visible, const QRectF & area, double step )
+{
+    QRectF needed = visible.intersected( area );
+    if ( needed.isEmpty() ) {
+        return QRectF();
+    }
+    double block = step * GridBlockNodes;
+    double x1 = area.left() + std::floor( ( needed.left() - area.left() ) / block ) * block;
+    double y1 = area.top() + std::floor( ( needed.top() - area.top() ) / block ) * block;
+    double x2 = area.left() + std::ceil( ( needed.right() - area.left() ) / block ) * block;
+    double y2 = area.top() + std::ceil( ( needed.bottom() - area.top() ) / block ) * block;
+    return QRectF( QPointF( x1, y1 ),
+                   QPointF( std::min( x2, area.right() ), std::min( y2, area.bottom() ) ) );
+}
+
 namespace Carta
 {
 namespace Core
@@ -146,6 +222,8 @@ Service::setPixelPipeline( IClippedPixelPipeline::SharedPtr pixelPipeline,
     // invalidate pixel pipeline cache
     m_cachedPP = nullptr;
     m_cachedPPinterp = nullptr;
+    m_cachedPPFloat = nullptr;
+    m_cachedPPinterpFloat = nullptr;
 }
 
 void
@@ -159,6 +237,8 @@ Service::setPixelPipelineCacheSettings( const PixelPipelineCacheSettings & param
     // invalidate pixel pipeline cache
     m_cachedPP = nullptr;
     m_cachedPPinterp = nullptr;
+    m_cachedPPFloat = nullptr;
+    m_cachedPPinterpFloat = nullptr;
 }
 
 const Service::PixelPipelineCacheSettings &
@@ -184,6 +264,8 @@ Service::render( JobId jobId )
 
 Service::Service( QObject * parent )
     : Carta::Lib::IImageRenderService( parent )
+      , m_frameCache( "rendered frames" )
+      , m_gridCache( "reprojection grids" )
 {
     // hook up the internal schedule helper signal to the scheduleJob slot, using
     // queued connection
@@ -194,8 +276,6 @@ Service::Service( QObject * parent )
     m_renderTimer.setSingleShot( true );
     m_renderTimer.setInterval( 1 );
     connect( & m_renderTimer, & QTimer::timeout, this, & Me::internalRenderSlot );
-
-    m_frameCache.setMaxCost( 1 * 1024 * 1024 * 1024 ); // 1 gig
 }
 
 Service::~Service()
@@ -235,6 +315,103 @@ Service::screen2img( const QPointF & p )
     return res;
 }
 
+void
+Service::setReprojection( QString mapId, Lib::DisplacementGrid::BatchMap map, QRectF area )
+{
+    m_reprojectionId = mapId;
+    m_reprojectionMap = map;
+    m_reprojectionArea = area;
+    m_reprojectionGrid = nullptr;
+}
+
+QPointF
+Service::img2input( const QPointF & p, bool * valid )
+{
+    QPointF res = p;
+    bool mapped = true;
+    const Lib::DisplacementGrid * grid = reprojectionGrid();
+    if ( grid && ! grid-> area().contains( p ) ) {
+        // the grid only covers what is visible, map anything else directly
+        double dst[2] = { p.x(), p.y() };
+        double src[2];
+        mapped = m_reprojectionArea.contains( p ) && m_reprojectionMap( dst, src, 1 );
+        res = QPointF( src[0], src[1] );
+    }
+    else if ( grid ) {
+        mapped = grid-> map( p.x(), p.y(), res.rx(), res.ry() );
+    }
+    if ( valid ) {
+        * valid = mapped;
+    }
+    return res;
+}
+
+const Lib::DisplacementGrid *
+Service::reprojectionGrid()
+{
+    if ( m_reprojectionId.isEmpty() ) {
+        return nullptr;
+    }
+
+    // only the visible part of the image needs a grid, so a grid costs about the same
+    // at any zoom, instead of up to MaxGridNodes evaluations of the map when zoomed in
+    QRectF visible = QRectF( screen2img( QPointF( 0, 0 ) ),
+                             screen2img( QPointF( m_outputSize.width(), m_outputSize.height() ) ) )
+                         .normalized();
+    double step = reprojectionGridStep( m_zoom, visible );
+    QRectF gridArea = reprojectionGridArea( visible, m_reprojectionArea, step );
+    if ( gridArea.isEmpty() ) {
+        gridArea = QRectF( m_reprojectionArea.topLeft(), QSizeF( step, step ) );
+    }
+    if ( m_reprojectionGrid && m_reprojectionGrid-> step() == step &&
+         m_reprojectionGrid-> area().contains( gridArea ) ) {
+        return m_reprojectionGrid.get();
+    }
+    QString gridId = QString( "%1/%2/%3,%4,%5,%6" ).arg( m_reprojectionId ).arg( step )
+                         .arg( gridArea.left() ).arg( gridArea.top() )
+                         .arg( gridArea.width() ).arg( gridArea.height() );
+    if ( ! m_gridCache.find( gridId, m_reprojectionGrid ) ) {
+        m_reprojectionGrid = std::make_shared < Lib::DisplacementGrid > (
+            gridArea, step, m_reprojectionMap );
+        m_gridCache.insert( gridId, m_reprojectionGrid, m_reprojectionGrid-> byteCount() );
+    }
+    return m_reprojectionGrid.get();
+}
+
+void
+Service::drawReprojected( const Lib::DisplacementGrid & grid, QImage & img )
+{
+    const int frameWidth = m_frameImage.width();
+    const int frameHeight = m_frameImage.height();
+
+    // image coordinates of the center of the top-left screen pixel (see screen2img()),
+    // and the distance between screen pixels in image coordinates
+    const double delta = 1.0 / m_zoom;
+    const double x0 = m_pan.x() - ( img.width() / 2.0 - 0.5 ) * delta;
+    const double y0 = m_pan.y() + ( img.height() / 2.0 - 0.5 ) * delta;
+
+    // nearest neighbor, just like drawImage() without smoothing
+    for ( int row = 0 ; row < img.height() ; row++ ) {
+        QRgb * outPtr = reinterpret_cast < QRgb * > ( img.scanLine( row ) );
+        double y = y0 - row * delta;
+        for ( int col = 0 ; col < img.width() ; col++ ) {
+            double px, py;
+            if ( ! grid.map( x0 + col * delta, y, px, py ) ) {
+                continue;
+            }
+            int ix = std::floor( px + 0.5 );
+            int iy = std::floor( py + 0.5 );
+            if ( ix < 0 || iy < 0 || ix >= frameWidth || iy >= frameHeight ) {
+                continue;
+            }
+
+            // the frame image is built bottom-up
+            outPtr[col] = reinterpret_cast < const QRgb * > (
+                m_frameImage.constScanLine( frameHeight - 1 - iy ) )[ix];
+        }
+    }
+} // drawReprojected
+
 void
 Service::internalRenderSlot()
 {
@@ -253,6 +430,7 @@ Service::internalRenderSlot()
     // pan
     // zoom
     // pixel pipeline cache settings
+    // reprojection
     // Floats are binary-encoded (base64)
     QString cacheId = QString( "%1/%2/%3x%4/%5,%6/%7" )
                           .arg( m_inputViewCacheId )
@@ -271,19 +449,22 @@ Service::internalRenderSlot()
     else {
         cacheId += "/0";
     }
+    if ( ! m_reprojectionId.isEmpty() ) {
+        cacheId += "/r/" + m_reprojectionId;
+    }
 
 //    qDebug() << "internalRenderSlot... cache size: "
-//             << m_frameCache.totalCost() * 100.0 / m_frameCache.maxCost() << "% "
-//             << m_frameCache.size() << "entries";
+//             << m_frameCache.cacheBytes() << "bytes "
+//             << m_frameCache.cacheEntries() << "entries";
 //    qDebug() << "id:" << cacheId;
     struct Scope {
         ~Scope() { qDebug() << "internalRenderSlot done"; } }
     debugScopeGuard;
 
-    auto cachedImage = m_frameCache.object( cacheId );
-    if ( cachedImage ) {
+    QImage cachedImage;
+    if ( m_frameCache.find( cacheId, cachedImage ) ) {
         qDebug() << "frame cache hit";
-        emit done( * cachedImage, m_lastSubmittedJobId );
+        emit done( cachedImage, m_lastSubmittedJobId );
         return;
     }
     qDebug() << "frame cache miss";
@@ -302,16 +483,37 @@ Service::internalRenderSlot()
     double clipMin, clipMax;
     m_pixelPipelineRaw-> getClips( clipMin, clipMax );
 
-    // render the frame if needed
+    // render the frame if needed, float data goes through the float pipelines
+    bool floatData = m_inputView-> pixelType() == Lib::Image::PixelType::Real32;
     if ( m_frameImage.isNull() ) {
-        if ( pixelPipelineCacheSettings().enabled ) {
+        if ( pixelPipelineCacheSettings().enabled && floatData ) {
+            if ( pixelPipelineCacheSettings().interpolated ) {
+                if ( ! m_cachedPPinterpFloat ) {
+                    m_cachedPPinterpFloat.reset(
+                        new Lib::TemplatedPixelPipeline::CachedPipeline < float, true > () );
+                    m_cachedPPinterpFloat-> cache( * m_pixelPipelineRaw,
+                                                   pixelPipelineCacheSettings().size, clipMin, clipMax );
+                }
+                ::floatView2qImage( m_inputView.get(), * m_cachedPPinterpFloat, m_frameImage );
+            }
+            else {
+                if ( ! m_cachedPPFloat ) {
+                    m_cachedPPFloat.reset(
+                        new Lib::TemplatedPixelPipeline::CachedPipeline < float, false > () );
+                    m_cachedPPFloat-> cache( * m_pixelPipelineRaw,
+                                             pixelPipelineCacheSettings().size, clipMin, clipMax );
+                }
+                ::floatView2qImage( m_inputView.get(), * m_cachedPPFloat, m_frameImage );
+            }
+        }
+        else if ( pixelPipelineCacheSettings().enabled ) {
             if ( pixelPipelineCacheSettings().interpolated ) {
                 if ( ! m_cachedPPinterp ) {
                     m_cachedPPinterp.reset( new Lib::PixelPipeline::CachedPipeline < true > () );
                     m_cachedPPinterp-> cache( * m_pixelPipelineRaw,
                                               pixelPipelineCacheSettings().size, clipMin, clipMax );
                 }
-                ::iView2qImage( m_inputView.get(), * m_cachedPPinterp, m_frameImage );
+                ::iView2qImage < double > ( m_inputView.get(), * m_cachedPPinterp, m_frameImage );
             }
             else {
                 if ( ! m_cachedPP ) {
@@ -319,11 +521,11 @@ Service::internalRenderSlot()
                     m_cachedPP-> cache( * m_pixelPipelineRaw,
                                         pixelPipelineCacheSettings().size, clipMin, clipMax );
                 }
-                ::iView2qImage( m_inputView.get(), * m_cachedPP, m_frameImage );
+                ::iView2qImage < double > ( m_inputView.get(), * m_cachedPP, m_frameImage );
             }
         }
         else {
-            ::iView2qImage( m_inputView.get(), * m_pixelPipelineRaw, m_frameImage );
+            ::iView2qImage < double > ( m_inputView.get(), * m_pixelPipelineRaw, m_frameImage );
         }
     }
 
@@ -332,6 +534,12 @@ Service::internalRenderSlot()
 
 //    img.fill( QColor( "blue" ) );
     img.fill( QColor( 50, 50, 50 ) );
+
+    // reprojected frames are resampled pixel by pixel, before we start painting
+    const Lib::DisplacementGrid * grid = reprojectionGrid();
+    if ( grid ) {
+        drawReprojected( * grid, img );
+    }
     QPainter p( & img );
 
     // draw the frame image to satisfy zoom/pan
@@ -346,7 +554,9 @@ Service::internalRenderSlot()
     p.setRenderHint( QPainter::SmoothPixmapTransform, false );
 
 //    rectf = rectf.normalized();
-    p.drawImage( rectf, m_frameImage );
+    if ( ! grid ) {
+        p.drawImage( rectf, m_frameImage );
+    }
 
 //    qDebug() << "m_frameImage" << m_frameImage.size();
 //    qDebug() << "m_frameImage" << zoom() << rectf.width() / m_frameImage.width()
@@ -394,7 +604,7 @@ Service::internalRenderSlot()
     }
 
     // insert this image into frame cache
-    m_frameCache.insert( cacheId, new QImage( img ), img.byteCount() );
+    m_frameCache.insert( cacheId, img, img.byteCount() );
 } // internalRenderSlot
 
 }
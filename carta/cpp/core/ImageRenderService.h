@@ -31,12 +31,14 @@
 
 #include "CartaLib/IImage.h"
 #include "CartaLib/PixelPipeline/IPixelPipeline.h"
+#include "CartaLib/TPixelPipeline/IScalar2Scalar.h"
 #include "CartaLib/Nullable.h"
 #include "CartaLib/IImageRenderService.h"
+#include "CartaLib/CacheRegistry.h"
+#include "CartaLib/DisplacementGrid.h"
 #include <QImage>
 #include <QObject>
 #include <QStringList>
-#include <QCache>
 #include <QTimer>
 
 namespace Carta
@@ -161,6 +163,27 @@ public:
     virtual QPointF
     screen2img( const QPointF & p ) override;
 
+    /// \brief render the input view reprojected onto the pixel grid of another image
+    ///
+    /// Pan, zoom, img2screen() and screen2img() are then all in the pixel coordinates
+    /// of the other image. The mapping is only evaluated on the nodes of a displacement
+    /// grid covering the visible part of the image, and the grids are cached.
+    /// \param mapId unique id of the mapping (e.g. made from both images), an empty id
+    /// turns the reprojection off
+    /// \param map converts pixel coordinates of the other image to pixel coordinates
+    /// of the input view
+    /// \param area pixels of the other image, i.e. where the map is needed
+    void
+    setReprojection( QString mapId, Lib::DisplacementGrid::BatchMap map, QRectF area );
+
+    /// convert coordinates returned by screen2img() to pixel coordinates of the input
+    /// view, this is only different from the identity when reprojecting
+    /// \param p coordinates to convert
+    /// \param valid set to false if the point does not map to the input view
+    /// \return converted coordinates
+    QPointF
+    img2input( const QPointF & p, bool * valid = nullptr );
+
 public slots:
 
     /// ask the service to render using the current settings and use the given
@@ -187,6 +210,15 @@ protected slots:
 
 private:
 
+    /// displacement grid for the current reprojection, zoom and visible area, nullptr
+    /// if we are not reprojecting
+    const Lib::DisplacementGrid *
+    reprojectionGrid();
+
+    /// draw the frame image into img, reprojected with the grid
+    void
+    drawReprojected( const Lib::DisplacementGrid & grid, QImage & img );
+
     // the following are rendering parameters
     Carta::Lib::NdArray::RawViewInterface::SharedPtr m_inputView = nullptr;
     QString m_inputViewCacheId;
@@ -205,14 +237,31 @@ private:
     // cached pipelines
     Lib::PixelPipeline::CachedPipeline < true >::UniquePtr m_cachedPPinterp = nullptr;
     Lib::PixelPipeline::CachedPipeline < false >::UniquePtr m_cachedPP = nullptr;
+
+    // cached pipelines for float data (most images), these don't use doubles at all
+    Lib::TemplatedPixelPipeline::CachedPipeline < float, true >::UniquePtr m_cachedPPinterpFloat = nullptr;
+    Lib::TemplatedPixelPipeline::CachedPipeline < float, false >::UniquePtr m_cachedPPFloat = nullptr;
     PixelPipelineCacheSettings m_pixelPipelineCacheSettings;
 
     /// here we store the whole frame rendered, it is essentially a cache to make
     /// pan/zoom to work faster
     QImage m_frameImage;
 
-    /// cache for individual frames (to make movie playing little bit faster)
-    QCache < QString, QImage > m_frameCache;
+    /// cache for individual frames (to make movie playing little bit faster), its size
+    /// is governed by the global cache budget
+    Carta::Lib::LruCache < QString, QImage > m_frameCache;
+
+    /// reprojection parameters, see setReprojection()
+    QString m_reprojectionId;
+    Lib::DisplacementGrid::BatchMap m_reprojectionMap;
+    QRectF m_reprojectionArea;
+
+    /// grid for the current zoom and visible area
+    Lib::DisplacementGrid::SharedPtr m_reprojectionGrid = nullptr;
+
+    /// grids for the zoom levels and areas seen recently, indexed by map id, grid
+    /// step and area
+    Carta::Lib::LruCache < QString, Lib::DisplacementGrid::SharedPtr > m_gridCache;
 
     /// last requested job id
     JobId m_lastSubmittedJobId = - 1;
@@ -1,6 +1,13 @@
 #include "ImageSaveService.h"
 #include "ImageRenderService.h"
+#include "StripedImageWriter.h"
 #include "CartaLib/PixelPipeline/CustomizablePixelPipeline.h"
+#include "CartaLib/TPixelPipeline/IScalar2Scalar.h"
+#include "CartaLib/PlaneCache.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
 
 namespace Carta
 {
@@ -9,6 +16,15 @@ namespace Core
 namespace ImageSaveService
 {
 
+namespace
+{
+/// rows in each band of a striped export
+const int STRIPE_HEIGHT = 256;
+
+/// outputs with more bytes than this are always saved in bands
+const qint64 STRIPED_MIN_BYTES = qint64( 256 ) * 1024 * 1024;
+}
+
 ImageSaveService::ImageSaveService( QString savename, std::shared_ptr<Lib::Image::ImageInterface> &m_image, std::shared_ptr<Carta::Lib::PixelPipeline::CustomizablePixelPipeline> &m_pixelPipeline, QString filename, QObject * parent ) : QObject( parent )
 {
     m_outputFilename = savename;
@@ -16,7 +32,7 @@ ImageSaveService::ImageSaveService( QString savename, std::shared_ptr<Lib::Image
     m_pixelPipelineCopy = m_pixelPipeline;
     m_inputFilename = filename;
     m_renderService = new Carta::Core::ImageRenderService::Service();
-    connect( m_renderService, & Carta::Core::ImageRenderService::Service::done,
+    connect( & m_saveWatcher, & QFutureWatcher<bool>::finished,
              this, & ImageSaveService::_saveFullImageCB );
 }
 
@@ -40,51 +56,150 @@ void ImageSaveService::setAspectRatioMode( Qt::AspectRatioMode mode ){
 }
 
 void ImageSaveService::saveFullImage(){
-    _prepareData( m_frameIndex, 0.0, 1.0 );
-    m_renderService->render( 0 );
+    // the pipeline is shared with the data source, so the lookup table is made
+    // here rather than on the worker thread
+    double clipMin, clipMax;
+    m_pixelPipelineCopy-> getClips( clipMin, clipMax );
+    std::shared_ptr< Lib::TemplatedPixelPipeline::CachedPipeline<float, true> > pipe =
+            std::make_shared< Lib::TemplatedPixelPipeline::CachedPipeline<float, true> >();
+    pipe-> cache( * m_pixelPipelineCopy, m_renderService-> pixelPipelineCacheSettings().size,
+            clipMin, clipMax );
+    Colormap colormap = [pipe]( const float * pixels, int64_t count, QRgb * colors ){
+        pipe-> convertRow( pixels, count, colors, qRgb( 255, 0, 0 ) );
+    };
+
+    QSize size = _getSaveSize();
+    qint64 bytes = qint64( size.width() ) * size.height() * 4;
+    bool striped = bytes > STRIPED_MIN_BYTES && StripedImageWriter::isSupported( m_outputFilename );
+    m_saveWatcher.setFuture( QtConcurrent::run( this, & ImageSaveService::_save,
+            size, _getFrameIndex(), colormap, striped ) );
 }
 
-/// \todo not all parameters are being used?
-void ImageSaveService::_prepareData( int frameIndex, double /*minClipPercentile*/, double /*maxClipPercentile*/ ){
-
-    if ( frameIndex < 0 ) {
-        frameIndex = 0;
-    }
+int ImageSaveService::_getFrameIndex() const {
     if ( m_imageCopy-> dims().size() <= 2 ) {
-        frameIndex = 0;
+        return 0;
     }
-    else {
-        frameIndex = Carta::Lib::clamp( frameIndex, 0, m_imageCopy-> dims()[2] - 1 );
+    return Carta::Lib::clamp( m_frameIndex, 0, m_imageCopy-> dims()[2] - 1 );
+}
+
+QSize ImageSaveService::_getSaveSize() const {
+    double zoom = m_renderService->zoom();
+    QSize frameSize( zoom * m_imageCopy->dims()[0], zoom * m_imageCopy->dims()[1] );
+    if ( m_outputSize.isValid() ){
+        return frameSize.scaled( m_outputSize * zoom, m_aspectRatioMode );
     }
+    return frameSize;
+}
 
-    // prepare slice description corresponding to the entire frame [:,:,frame,0,0,...0]
-    auto frameSlice = SliceND().next();
-    for ( size_t i = 2 ; i < m_imageCopy->dims().size() ; i++ ) {
-        frameSlice.next().index( i == 2 ? frameIndex : 0 );
+bool ImageSaveService::_save( QSize size, int frameIndex, Colormap colormap, bool striped ) const {
+    if ( size.isEmpty() ){
+        return false;
     }
 
-    // get a view of the data using the slice description and make a shared pointer out of it
-    Carta::Lib::NdArray::RawViewInterface::SharedPtr view( m_imageCopy-> getDataSlice( frameSlice ) );
+    // nearest data pixel for each output column and row, the frame is stored
+    // bottom up
+    const int width = m_imageCopy-> dims()[0];
+    const int height = m_imageCopy-> dims()[1];
+    std::vector<int> columns( size.width() );
+    for ( int x = 0; x < size.width(); x++ ){
+        columns[x] = std::min( width - 1, int( ( x + 0.5 ) * width / size.width() ) );
+    }
+    std::vector<int> rows( size.height() );
+    for ( int y = 0; y < size.height(); y++ ){
+        rows[y] = height - 1 - std::min( height - 1, int( ( y + 0.5 ) * height / size.height() ) );
+    }
 
-    m_renderService-> setPixelPipeline( m_pixelPipelineCopy, m_pixelPipelineCopy-> cacheId());
+    // renders one band into the given rows, reading only the data rows it needs
+    auto renderBand = [&]( int band, uchar * bits, int bytesPerLine ){
+        int top = band * STRIPE_HEIGHT;
+        int bottom = std::min( size.height(), top + STRIPE_HEIGHT );
+        int yMin = rows[bottom - 1];
+        int yMax = rows[top];
+        SliceND slice;
+        slice.next().start( yMin ).end( yMax + 1 );
+        for ( size_t i = 2 ; i < m_imageCopy->dims().size() ; i++ ) {
+            slice.next().index( i == 2 ? frameIndex : 0 );
+        }
+        std::vector<float> pixels;
+        if ( !Carta::Lib::PlaneCache::instance().readSlice( * m_imageCopy, slice, pixels ) ||
+                pixels.size() != size_t( yMax - yMin + 1 ) * width ){
+            return false;
+        }
+
+        // each data row is colored once, even if it is repeated when zooming in
+        std::vector<QRgb> colors( width );
+        int colored = -1;
+        for ( int y = top; y < bottom; y++ ){
+            if ( rows[y] != colored ){
+                colored = rows[y];
+                colormap( & pixels[size_t( colored - yMin ) * width], width, colors.data() );
+            }
+            QRgb * out = reinterpret_cast<QRgb *>( bits + qint64( y - top ) * bytesPerLine );
+            for ( int x = 0; x < size.width(); x++ ){
+                out[x] = colors[columns[x]];
+            }
+        }
+        return true;
+    };
+    const int bandCount = ( size.height() + STRIPE_HEIGHT - 1 ) / STRIPE_HEIGHT;
+
+    // images that fit in memory are rendered in parallel, a band per task, and
+    // saved in one go
+    if ( !striped ){
+        QImage image( size, QImage::Format_RGB32 );
+        if ( image.isNull() ){
+            return false;
+        }
+        uchar * bits = image.bits();
+        const int bytesPerLine = image.bytesPerLine();
+        QList<int> bands;
+        for ( int band = 0; band < bandCount; band++ ){
+            bands.append( band );
+        }
+        std::atomic<bool> rendered( true );
+        QtConcurrent::blockingMap( bands, [&]( const int & band ){
+            if ( !renderBand( band, bits + qint64( band ) * STRIPE_HEIGHT * bytesPerLine, bytesPerLine ) ){
+                rendered = false;
+            }
+        });
+        return rendered && image.save( m_outputFilename );
+    }
 
-    QString argStr = QString( "%1//%2").arg(m_inputFilename).arg(frameIndex);
-    m_renderService-> setInputView( view, argStr);
+    StripedImageWriter::UniquePtr writer = StripedImageWriter::create( m_outputFilename, size );
+    if ( !writer ){
+        qWarning() << "Could not open" << m_outputFilename;
+        return false;
+    }
 
-    double zoom = m_renderService->zoom();
-    m_renderService->setOutputSize( QSize( zoom * m_imageCopy->dims()[0], zoom * m_imageCopy->dims()[1] ) );
-    m_renderService->setPan( { m_imageCopy->dims()[0] / 2.0 - 0.5, m_imageCopy->dims()[1] / 2.0 - 0.5 });
+    // bands are rendered in parallel a few at a time, which bounds the memory used,
+    // and written in order
+    const int batchSize = std::max( 1, QThread::idealThreadCount() );
+    for ( int first = 0; first < bandCount; first += batchSize ){
+        QList<int> batch;
+        for ( int band = first; band < std::min( bandCount, first + batchSize ); band++ ){
+            batch.append( band );
+        }
+        std::vector<QImage> images( batch.size() );
+        QtConcurrent::blockingMap( batch, [&]( const int & band ){
+            int top = band * STRIPE_HEIGHT;
+            QImage image( size.width(), std::min( size.height(), top + STRIPE_HEIGHT ) - top,
+                    QImage::Format_RGB32 );
+            if ( renderBand( band, image.bits(), image.bytesPerLine() ) ){
+                images[band - first] = image;
+            }
+        });
+        for ( const QImage & image : images ){
+            if ( image.isNull() || !writer-> writeRows( image ) ){
+                qWarning() << "Could not write" << m_outputFilename;
+                return false;
+            }
+        }
+    }
+    return writer-> finish();
 }
 
-void ImageSaveService::_saveFullImageCB( QImage img ){
-    QSize imgSize = img.size();
-    qDebug() << "outputSize width="<<m_outputSize.width() << " height="<<m_outputSize.height();
-    qDebug() << "img height="<<imgSize.height()<<" width="<<imgSize.width();
-    qDebug() << "aspect="<<m_aspectRatioMode;
-    QImage imgScaled = img.scaled( m_outputSize * m_renderService->zoom(), m_aspectRatioMode );
-    QSize scaledSize = imgScaled.size();
-    qDebug() << "scaled height="<<scaledSize.height()<<" width="<<scaledSize.width();
-    bool result = imgScaled.save( m_outputFilename );
+void ImageSaveService::_saveFullImageCB(){
+    bool result = m_saveWatcher.result();
     emit saveImageResult( result );
     m_renderService->deleteLater();
 }
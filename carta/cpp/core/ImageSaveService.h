@@ -9,7 +9,9 @@
 #include <QObject>
 #include <QSize>
 #include <QImage>
+#include <QFutureWatcher>
 
+#include <functional>
 #include <memory>
 
 namespace Carta {
@@ -71,10 +73,11 @@ public:
     /// destructor
     ~ImageSaveService();
 
-    /// Prepares the image to be rendered using ImageRenderService. After the rendering
-    /// has finished, the image is then saved to the location stored in m_outputFilename.
-    /// The return value of the save attempt is passed asynchronously via
-    /// _saveFullImageCB().
+    /// Renders the image and saves it to the location stored in m_outputFilename, on
+    /// worker threads. The return value of the save attempt is passed asynchronously
+    /// via saveImageResult().
+    /// PNG and TIFF outputs too big to render at once are rendered and written a band
+    /// of rows at a time, so that memory use does not depend on the size of the output.
     void saveFullImage();
 
 signals:
@@ -85,23 +88,33 @@ signals:
 
 private slots:
 
-    /// Notification from the rendering service that a new image has been
-    /// produced and is ready to be saved.
-    void _saveFullImageCB( QImage img );
+    /// The save has finished.
+    void _saveFullImageCB();
 
 private:
 
+    /// converts a row of pixels to colors
+    typedef std::function<void( const float*, int64_t, QRgb* )> Colormap;
+
     Carta::Core::ImageRenderService::Service *m_renderService; 
 
+    /// The frame to save, clamped to the frames the image has.
+    int _getFrameIndex() const;
+
+    /// The size of the saved image.
+    QSize _getSaveSize() const;
+
     /**
-     * Prepare the data for rendering.
-     * Most of this code is borrowed from void DataSource::load().
-     * It sets the input view, output size, pixel pipeline, and pan.
-     * @param frameIndex the index of the spectral coordinate to load.
-     * @param clipMinPercentile the minimum clip value.
-     * @param clipMaxPercentile the maximum clip value.
+     * Render the image in bands and save it.
+     * Runs on a worker thread; bands are rendered in parallel.
+     * @param size the size of the output image.
+     * @param frameIndex the frame to save.
+     * @param colormap converts pixels to colors.
+     * @param striped write the bands to the output file in order as they are done,
+     *      instead of keeping the whole image in memory.
+     * @return true if the image was saved.
      */
-    void _prepareData( int frameIndex, double minClipPercentile, double maxClipPercentile );
+    bool _save( QSize size, int frameIndex, Colormap colormap, bool striped ) const;
 
     /// The input FITS file
     QString m_inputFilename;
@@ -118,6 +131,9 @@ private:
     /// Determines how the output image will be scaled if an output size is set.
     Qt::AspectRatioMode m_aspectRatioMode;
 
+    /// Waits for the save.
+    QFutureWatcher<bool> m_saveWatcher;
+
     //Pointer to image interface.
     std::shared_ptr<Carta::Lib::Image::ImageInterface> m_imageCopy;
 
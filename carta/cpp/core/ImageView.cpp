@@ -12,12 +12,19 @@
 #include <cmath>
 #include <QDebug>
 #include <QCoreApplication>
+#include <QPointer>
 
 const QString ImageView::MOUSE = "mouse";
 const QString ImageView::VIEW = "view";
 const QString ImageView::MOUSE_Y = "mouse/x";
 const QString ImageView::MOUSE_X = "mouse/y";
 
+//Frame ids are unique across all views.
+static qint64 newFrameId(){
+    static qint64 lastFrameId = 0;
+    return ++lastFrameId;
+}
+
 ImageView::ImageView(const QString & viewName, QColor bgColor, QImage img,
         Carta::State::StateInterface* mouseState){
     m_defaultImage = img;
@@ -28,10 +35,12 @@ ImageView::ImageView(const QString & viewName, QColor bgColor, QImage img,
     m_connector = nullptr;
     m_bgColor = bgColor;
     m_mouseState = mouseState;
+    m_frameId = newFrameId();
 }
 
 void ImageView::resetImage(QImage img) {
      m_defaultImage = img;
+     m_frameId = newFrameId();
 }
 
 void ImageView::registration(IConnector *connector) {
@@ -54,6 +63,7 @@ const QImage & ImageView::getBuffer() {
 void ImageView::handleResizeRequest(const QSize & size) {
     if ( size.height() > 0 && size.width() > 0 ){
         m_qimage = QImage(size, m_qimage.format());
+        m_frameId = newFrameId();
         emit resize( size );
     }
 }
@@ -79,9 +89,16 @@ void ImageView::redrawBuffer() {
             p.drawImage(m_qimage.rect(), m_defaultImage);
         }
 
-        // execute the pre-render hook
+        // execute the pre-render hook, plugins still working on this frame when the
+        // hook returns ask for a repaint once they are done
+        QPointer<ImageView> self( this );
+        auto requestRepaint = [self](){
+            if ( self ){
+                QMetaObject::invokeMethod( self.data(), "scheduleRedraw", Qt::QueuedConnection );
+            }
+        };
         Globals::instance()->pluginManager()->prepare<PreRender>(m_viewName,
-                &m_qimage).executeAll();
+                &m_qimage, m_frameId, requestRepaint).executeAll();
     }
 }
 
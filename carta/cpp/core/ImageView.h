@@ -22,7 +22,7 @@ public:
     /**
      * Refresh the view.
      */
-    void scheduleRedraw();
+    Q_INVOKABLE void scheduleRedraw();
     virtual void registration(IConnector *connector);
     virtual const QString & name() const;
     virtual QSize size();
@@ -52,6 +52,9 @@ protected:
     int m_timerId;
     QPointF m_lastMouse;
     Carta::State::StateInterface* m_mouseState;
+    //Identifies the pixels drawn before the pre-render hook, changes with the
+    //image or the size of the view.
+    qint64 m_frameId;
 
 
 };
@@ -71,6 +71,18 @@ ParsedInfo parse(const QString & filePath)
             devLayoutStr == "1" || devLayoutStr == "y");
     qDebug() << "Developer layout:" << info.m_developerLayout << devLayoutStr;
 
+    // memory budget for caches, in megabytes
+    if ( json.contains( "cacheBudgetMB" ) ) {
+        double budgetMB = json[ "cacheBudgetMB"].toDouble( -1 );
+        if ( budgetMB >= 0 ) {
+            info.m_cacheBudget = static_cast<int64_t>( budgetMB * 1024 * 1024 );
+        }
+        else {
+            qWarning() << "Invalid cacheBudgetMB in config file, using default";
+        }
+    }
+    qDebug() << "Cache budget:" << info.m_cacheBudget / ( 1024 * 1024 ) << "MB";
+
     return info;
 }
 
@@ -88,6 +100,10 @@ bool ParsedInfo::isDeveloperLayout() const {
     return m_developerLayout;
 }
 
+int64_t ParsedInfo::cacheBudget() const {
+    return m_cacheBudget;
+}
+
 const QJsonObject &ParsedInfo::json() const
 {
     return m_json;
@@ -7,6 +7,7 @@
 
 #include <QJsonObject>
 #include <QStringList>
+#include <cstdint>
 class QString;
 
 namespace MainConfig {
@@ -32,6 +33,9 @@ public:
      */
     bool isDeveloperLayout() const;
 
+    /// memory budget in bytes for all in-memory caches together
+    int64_t cacheBudget() const;
+
     /// the whole config file as json
     const QJsonObject & json() const;
 
@@ -40,6 +44,7 @@ protected:
     QStringList m_pluginDirectories;
     bool m_hacksEnabled = false;
     bool m_developerLayout = false;
+    int64_t m_cacheBudget = 2LL * 1024 * 1024 * 1024;
     QJsonObject m_json;
 
     friend ParsedInfo parse( const QString & filePath);
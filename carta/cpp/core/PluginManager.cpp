@@ -190,8 +190,34 @@ PluginManager::loadPlugins()
             qDebug() << "Plugin initialized";
         }
     }
+
+    buildDispatchTable();
 } // loadPlugins
 
+void
+PluginManager::buildDispatchTable()
+{
+    m_dispatch.clear();
+    for ( auto & entry : m_hook2plugin ) {
+        if ( entry.first < 0 ) {
+            qWarning() << "Ignoring invalid hook id" << entry.first;
+            continue;
+        }
+        if ( HookId( m_dispatch.size() ) <= entry.first ) {
+            m_dispatch.resize( entry.first + 1 );
+        }
+        m_dispatch[entry.first] = entry.second;
+    }
+    clearHookMemos();
+}
+
+void
+PluginManager::clearHookMemos()
+{
+    QMutexLocker locker( & m_hookMemosMutex );
+    m_hookMemos.clear();
+}
+
 const std::vector < PluginManager::PluginInfo > &
 PluginManager::getInfoList()
 {
@@ -7,7 +7,9 @@
 #include "CartaLib/IPlugin.h"
 #include "CartaLib/Nullable.h"
 
+#include <QHash>
 #include <QImage>
+#include <QMutex>
 #include <QString>
 #include <vector>
 #include <functional>
@@ -96,6 +98,19 @@ protected:
         : m_params( std::forward<typename T::Params>( params))
     {}
 
+    /// remembered results of a memoized hook (see HookMemoization)
+    struct MemoEntry {
+        /// results of the plugins called so far, in order
+        std::vector< typename T::ResultType> results;
+        /// index of the next plugin to call in the dispatch list
+        size_t nextPlugin = 0;
+    };
+
+    /// call plugins from the dispatch list, starting at index 'start', until func()
+    /// returns false or we run out of plugins
+    /// \return index of the plugin after the last one called
+    size_t callPlugins( size_t start, std::function< bool(typename T::ResultType)> func);
+
     typename T::Params m_params;
     PluginManager * m_pm;
 
@@ -155,6 +170,9 @@ public:
         return std::move( helper);
     }
 
+    /// forget the remembered results of memoized hooks
+    void clearHookMemos();
+
     ~PluginManager() {
         qDebug() << "~PluginManager is getting called";
     }
@@ -162,10 +180,17 @@ public:
 protected:
 
     /// return a list of plugins that registered the given hook
-    std::vector<PluginInfo *> & listForHook( HookId id) {
-        return m_hook2plugin[ id];
+    const std::vector<PluginInfo *> & listForHook( HookId id) const {
+        if( id >= 0 && id < HookId( m_dispatch.size())) {
+            return m_dispatch[ id];
+        }
+        static const std::vector<PluginInfo *> noPlugins;
+        return noPlugins;
     }
 
+    /// build m_dispatch from m_hook2plugin
+    void buildDispatchTable();
+
     /// find all plugins in the provided search paths and parse their
     /// cooresponding .json files
     std::vector< PluginInfo > findAllPlugins();
@@ -183,6 +208,16 @@ protected:
     /// but that means we'll need to ensure consecutive numbering of hooks...
     std::map< HookId, std::vector< PluginInfo *> > m_hook2plugin;
 
+    /// same as m_hook2plugin, but indexed directly by hook id, this is what hook
+    /// calls use (built once all plugins are loaded)
+    std::vector< std::vector< PluginInfo *> > m_dispatch;
+
+    /// remembered results of memoized hooks, keyed by hook id and parameters,
+    /// values are HookHelper<T>::MemoEntry
+    /// \note the mutex is never held while plugins run, they may call hooks themselves
+    QHash< QString, std::shared_ptr<void> > m_hookMemos;
+    QMutex m_hookMemosMutex;
+
     /// list of all discovered plugins
     std::vector< PluginInfo > m_discoveredPlugins;
 
@@ -199,17 +234,59 @@ protected:
 template <typename T>
 void HookHelper<T>::forEachCond( std::function< bool(typename T::ResultType)> func)
 {
-    HookId hookId = T::staticId;
+    if( ! HookMemoization<T>::memoize) {
+        callPlugins( 0, func);
+        return;
+    }
+
+    // memoized hook: replay the remembered results first, and only call the
+    // remaining plugins if func() wants more results than we have seen so far
+    QString key = QString::number( T::staticId) + "/" + HookMemoization<T>::key( m_params);
+    std::shared_ptr<MemoEntry> entry;
+    MemoEntry memo;
+    {
+        QMutexLocker locker( & m_pm-> m_hookMemosMutex);
+        std::shared_ptr<void> & slot = m_pm-> m_hookMemos[ key];
+        if( ! slot) {
+            slot = std::make_shared<MemoEntry>();
+        }
+        entry = std::static_pointer_cast<MemoEntry>( slot);
+        memo = * entry;
+    }
+
+    // func() and the plugins run on the copy, without the lock
+    for( const auto & res : memo.results) {
+        if( ! func( res)) {
+            return;
+        }
+    }
+    auto recorder = [&] ( typename T::ResultType res) -> bool {
+        memo.results.push_back( res);
+        return func( res);
+    };
+    memo.nextPlugin = callPlugins( memo.nextPlugin, recorder);
 
+    // another thread may have resumed the same memo meanwhile, keep whichever
+    // got further
+    QMutexLocker locker( & m_pm-> m_hookMemosMutex);
+    if( memo.nextPlugin > entry-> nextPlugin) {
+        * entry = std::move( memo);
+    }
+}
+
+template <typename T>
+size_t HookHelper<T>::callPlugins( size_t start, std::function< bool(typename T::ResultType)> func)
+{
     // get the list of plugins that claim they handle this hook
-    auto pluginList = m_pm-> listForHook( hookId);
+    const auto & pluginList = m_pm-> listForHook( T::staticId);
 
     // make an actual instance of the Hook on the stack and give it a pointer
     // to the parameters
     T hookData( & m_params);
 
-    for( auto pluginInfo : pluginList) {
-        bool handled = pluginInfo-> rawPlugin-> handleHook( hookData);
+    size_t ind = start;
+    while( ind < pluginList.size()) {
+        bool handled = pluginList[ ind++]-> rawPlugin-> handleHook( hookData);
         // skip to the next plugin immediately if this hook was not handled by
         // this plugin
         if( ! handled) {
@@ -222,6 +299,7 @@ void HookHelper<T>::forEachCond( std::function< bool(typename T::ResultType)> fu
             break;
         }
     }
+    return ind;
 }
 
 
@@ -28,10 +28,14 @@ MessageListener::MessageListener( int port, QObject * parent )
 }
 
 bool
-MessageListener::send( const TagMessage & msg )
+MessageListener::send( int clientId, const TagMessage & msg )
 {
+    auto it = m_clients.find( clientId );
+    if ( it == m_clients.end() ) {
+        return false;
+    }
     try {
-        m_tmSocket-> send( msg );
+        it-> second-> send( msg );
     }
     catch ( ... ) {
         return false;
@@ -40,47 +44,60 @@ MessageListener::send( const TagMessage & msg )
 }
 
 bool
-MessageListener::sendTypedMessage( QString messageType, const void * data )
+MessageListener::sendTypedMessage( int clientId, QString messageType, const void * data )
 {
-    return send( TagMessage( messageType, QByteArray( reinterpret_cast < const char * > ( data ) ) ) );
+    return send( clientId,
+                 TagMessage( messageType, QByteArray( reinterpret_cast < const char * > ( data ) ) ) );
 }
 
 void
 MessageListener::newConnectionCB()
 {
-    if ( m_tmSocket ) {
-        qWarning() << "Another client trying to connect? Old connection will be aborted...";
-
-        // alternatively, enable below if you instead want to disable
-        // additional connections...
-        // For easier debugging I allow re-connection.
-        if ( 0 ) {
-            qWarning() << "Another client trying to connect? Refusing...";
-            auto socket = m_tcpServer->nextPendingConnection();
-            socket->write( "Bye." );
-            socket->waitForBytesWritten();
-            delete socket;
-            return;
-        }
+    while ( m_tcpServer-> hasPendingConnections() ) {
+        QTcpSocket * sock = m_tcpServer->nextPendingConnection();
+        int clientId = m_nextClientId ++;
+        qDebug() << "Scripted client" << clientId << "connected";
+        TagMessageSocket * tmSocket = new TagMessageSocket( std::shared_ptr < QTcpSocket > ( sock ) );
+        m_clients[clientId].reset( tmSocket );
+        connect( tmSocket, & TagMessageSocket::received,
+                 this, [this, clientId] ( TagMessage msg ) {
+                     tagMessageReceivedCB( clientId, msg );
+                 }
+                 );
+        connect( sock, & QTcpSocket::disconnected,
+                 this, [this, clientId] () {
+                     disconnectedCB( clientId );
+                 }
+                 );
     }
-    QTcpSocket * sock = m_tcpServer->nextPendingConnection();
-    m_tmSocket.reset( new TagMessageSocket( std::shared_ptr < QTcpSocket > ( sock ) ) );
-    connect( m_tmSocket.get(), & TagMessageSocket::received,
-             this, & MessageListener::tagMessageReceivedCB );
 } // newConnectionCB
 
 void
-MessageListener::tagMessageReceivedCB( TagMessage msg )
+MessageListener::tagMessageReceivedCB( int clientId, TagMessage msg )
 {
     /// we just re-emit the message as is
     if ( msg.tag() == "async" ){
-        emit receivedAsync( msg );
+        emit receivedAsync( clientId, msg );
     }
     else {
-        emit received( msg );
+        emit received( clientId, msg );
     }
 }
 
+void
+MessageListener::disconnectedCB( int clientId )
+{
+    auto it = m_clients.find( clientId );
+    if ( it == m_clients.end() ) {
+        return;
+    }
+    qDebug() << "Scripted client" << clientId << "disconnected";
+
+    // we are inside a signal of the socket, so it has to be deleted later
+    it-> second.release()-> deleteLater();
+    m_clients.erase( it );
+    emit clientDisconnected( clientId );
+}
 }
 }
 }
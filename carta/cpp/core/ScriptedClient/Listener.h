@@ -13,6 +13,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDir>
+#include <map>
 #include <memory>
 
 namespace Carta
@@ -21,15 +22,15 @@ namespace Core
 {
 namespace ScriptedClient
 {
-/// The purpose of this class is to wrap the communication between c++ and scripted client
+/// The purpose of this class is to wrap the communication between c++ and scripted clients
 /// in form of TagMessages.
 ///
 /// The class does the following:
 ///   - listens for incoming connection on a user specified port
-///   - open new connection(s)
+///   - open new connection(s), any number of clients can be connected at the same time
 ///   - then listen for incoming TagMessage
-///   - when TagMessage arrives, a signal is emitted
-///   - send a TagMessage
+///   - when TagMessage arrives, a signal is emitted with the id of the client that sent it
+///   - send a TagMessage to a client
 ///
 class MessageListener : public QObject
 {
@@ -41,25 +42,30 @@ public:
     explicit
     MessageListener( int port, QObject * parent = 0 );
 
-    /// send a tag message
+    /// send a tag message to a client
     /// \note instead of throwing exception, this method returns true on success
+    /// (sending to a client that has disconnected fails)
     bool
-    send( const TagMessage & msg );
+    send( int clientId, const TagMessage & msg );
 
     /// not used for anything, just a demostration how 'sendTypedMessage' could be
     /// implemented to mimic ScriptedClientListener
     bool
-    sendTypedMessage( QString messageType, const void * data );
+    sendTypedMessage( int clientId, QString messageType, const void * data );
 
 signals:
 
     /// emitted whenever a TagMessage arrives
     void
-    received( TagMessage message );
+    received( int clientId, TagMessage message );
 
     /// emitted whenever an asyncrhonous message arrives
     void
-    receivedAsync( TagMessage message );
+    receivedAsync( int clientId, TagMessage message );
+
+    /// emitted when a client disconnects
+    void
+    clientDisconnected( int clientId );
 
 public slots:
 
@@ -69,14 +75,23 @@ private slots:
     void
     newConnectionCB();
 
-    /// internal callback, invoked when a TagMessage arrives from TagMessageSocket
+private:
+
+    /// internal callback, invoked when a TagMessage arrives from one of the clients
     void
-    tagMessageReceivedCB( TagMessage msg );
+    tagMessageReceivedCB( int clientId, TagMessage msg );
 
-private:
+    /// internal callback, invoked when a client disconnects
+    void
+    disconnectedCB( int clientId );
 
     std::unique_ptr < QTcpServer > m_tcpServer = nullptr;
-    std::unique_ptr < TagMessageSocket > m_tmSocket = nullptr;
+
+    /// connected clients, by id
+    std::map < int, std::unique_ptr < TagMessageSocket > > m_clients;
+
+    /// id of the next client to connect
+    int m_nextClientId = 1;
 };
 
 }
@@ -12,8 +12,12 @@
 #include "Data/Preferences/PreferencesSave.h"
 #include "Data/Statistics.h"
 #include "Data/Image/GridControls.h"
+#include "CartaLib/CacheRegistry.h"
 
 #include <QDebug>
+#include <QMap>
+#include <QPair>
+#include <algorithm>
 
 using Carta::State::ObjectManager;
 //using Carta::State::CartaObject;
@@ -174,6 +178,33 @@ QStringList ScriptFacade::getPluginList() const {
     return resultList;
 }
 
+QStringList ScriptFacade::getCacheUsage() const {
+    Carta::Lib::CacheRegistry& registry = Carta::Lib::CacheRegistry::instance();
+
+    //Caches of the same kind (e.g. one per image view) are reported together.
+    QStringList names;
+    QMap<QString, QPair<qint64,qint64> > usageByName;
+    qint64 total = 0;
+    for ( const Carta::Lib::CacheRegistry::Usage& usage : registry.usage() ){
+        if ( !usageByName.contains( usage.name ) ){
+            names.append( usage.name );
+        }
+        QPair<qint64,qint64>& sum = usageByName[usage.name];
+        sum.first += usage.bytes;
+        sum.second += usage.entries;
+        total += usage.bytes;
+    }
+
+    QStringList resultList;
+    resultList.append( "total," + QString::number( total ) );
+    resultList.append( "budget," + QString::number( registry.budget() ) );
+    for ( const QString& name : names ){
+        const QPair<qint64,qint64>& sum = usageByName[name];
+        resultList.append( name + "," + QString::number( sum.first ) + "," + QString::number( sum.second ) );
+    }
+    return resultList;
+}
+
 QStringList ScriptFacade::loadFile( const QString& objectId, const QString& fileName ){
     QStringList resultList("");
     bool result = m_viewManager->loadFile( objectId, fileName );
@@ -493,7 +524,7 @@ QStringList ScriptFacade::setClipValue( const QString& controlId, double clipVal
 }*/
 
 QStringList ScriptFacade::saveFullImage( const QString& controlId, const QString& filename, int width, int height,
-        double scale, /*Qt::AspectRatioMode aspectRatioMode*/ const QString& aspectModeStr ){
+        double scale, /*Qt::AspectRatioMode aspectRatioMode*/ const QString& aspectModeStr, const QString& saveId ){
     ObjectManager* objMan = ObjectManager::objectManager();
     //Save the state so the view will update and parse parameters to make
     //sure they are valid before calling save.
@@ -505,12 +536,16 @@ QStringList ScriptFacade::saveFullImage( const QString& controlId, const QString
     if ( widthError.isEmpty() && heightError.isEmpty() && aspectModeError.isEmpty() ){
         QString id = objMan->parseId( controlId );
         Carta::State::CartaObject* obj = objMan->getObject( id );
-        if ( obj != nullptr ){
-            Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
-            if ( controller != nullptr ){
-                controller->saveImage( filename, scale );
+        Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
+        if ( controller != nullptr ){
+            QString saveError = controller->saveImage( filename, scale, saveId );
+            if ( !saveError.isEmpty() ){
+                errorList.append( saveError );
             }
         }
+        else {
+            errorList.append( "The specified image view could not be found." );
+        }
     }
     else {
         if ( !widthError.isEmpty()){
@@ -526,8 +561,8 @@ QStringList ScriptFacade::saveFullImage( const QString& controlId, const QString
     return errorList;
 }
 
-void ScriptFacade::saveImageResultCB( bool result ){
-    emit saveImageResult( result );
+void ScriptFacade::saveImageResultCB( bool result, const QString& saveId ){
+    emit saveImageResult( result, saveId );
 }
 
 
@@ -1075,6 +1110,115 @@ QStringList ScriptFacade::getIntensity( const QString& controlId, int frameLow,
     return resultList;
 }
 
+std::function<QStringList()> ScriptFacade::getIntensityJob( const QString& controlId, int frameLow, int frameHigh, double percentile ) {
+    QStringList errorList;
+    Carta::State::CartaObject* obj = _getObject( controlId );
+    if ( obj != nullptr ){
+        Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
+        if ( controller != nullptr ){
+            std::function<bool(double*)> intensityFunction =
+                    controller->getIntensityFunction( frameLow, frameHigh, percentile );
+            if ( intensityFunction ){
+                QStringList invalidList = _logErrorMessage( ERROR, "Could not get intensity for the specified parameters." );
+                return [intensityFunction, invalidList] () -> QStringList {
+                    double intensity;
+                    if ( intensityFunction( &intensity ) ){
+                        return QStringList( QString::number( intensity ) );
+                    }
+                    return invalidList;
+                };
+            }
+            errorList = _logErrorMessage( ERROR, "Could not get intensity for the specified parameters." );
+        }
+        else {
+            errorList = _logErrorMessage( ERROR, UNKNOWN_ERROR );
+        }
+    }
+    else {
+        errorList = _logErrorMessage( ERROR, "The specified image view could not be found: " + controlId );
+    }
+    return [errorList] () -> QStringList {
+        return errorList;
+    };
+}
+
+QStringList ScriptFacade::deriveImage( const QString& controlId, const QString& operation, double value, int otherIndex ) {
+    QStringList resultList;
+    Carta::State::CartaObject* obj = _getObject( controlId );
+    if ( obj != nullptr ){
+        Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
+        if ( controller != nullptr ){
+            QString result = controller->deriveImage( operation, value, otherIndex );
+            resultList = QStringList( result );
+        }
+        else {
+            resultList = _logErrorMessage( ERROR, UNKNOWN_ERROR );
+        }
+    }
+    else {
+        resultList = _logErrorMessage( ERROR, "The specified image view could not be found: " + controlId );
+    }
+    return resultList;
+}
+
+QStringList ScriptFacade::generateMoments( const QString& controlId, const QString& histogramId, const QStringList& moments ) {
+    QStringList resultList;
+    typedef Carta::Lib::IMomentGeneratorService MomentService;
+    MomentService::Params params;
+    if ( !histogramId.isEmpty() ){
+        Carta::Data::Histogram* histogram = dynamic_cast<Carta::Data::Histogram*>( _getObject( histogramId ) );
+        if ( histogram == nullptr ){
+            return _logErrorMessage( ERROR, "The specified histogram view could not be found: " + histogramId );
+        }
+        params = histogram->getDataSelection();
+    }
+    const std::vector<MomentService::Moment> known = { MomentService::Moment::Integrated,
+            MomentService::Moment::SpectralMean, MomentService::Moment::SpectralDispersion, MomentService::Moment::Peak };
+    for ( const QString& name : moments ){
+        auto it = std::find_if( known.begin(), known.end(), [&name] ( MomentService::Moment moment ) {
+            return QString::compare( MomentService::momentName( moment ), name, Qt::CaseInsensitive ) == 0;
+        });
+        if ( it == known.end() ){
+            return _logErrorMessage( ERROR, "Unknown moment: " + name );
+        }
+        params.moments.push_back( *it );
+    }
+    Carta::State::CartaObject* obj = _getObject( controlId );
+    if ( obj != nullptr ){
+        Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
+        if ( controller != nullptr ){
+            QString result = controller->generateMoments( params );
+            resultList = QStringList( result );
+        }
+        else {
+            resultList = _logErrorMessage( ERROR, UNKNOWN_ERROR );
+        }
+    }
+    else {
+        resultList = _logErrorMessage( ERROR, "The specified image view could not be found: " + controlId );
+    }
+    return resultList;
+}
+
+QStringList ScriptFacade::callRawViewFunction( const QString& controlId, const QString& funcName ){
+    QStringList resultList;
+    Carta::State::CartaObject* obj = _getObject( controlId );
+    if ( obj != nullptr ){
+        Carta::Data::Controller* controller = dynamic_cast<Carta::Data::Controller*>(obj);
+        if ( controller != nullptr ){
+            QString result = controller->callRawViewFunction( funcName );
+            resultList = QStringList( result );
+        }
+        else {
+            resultList = _logErrorMessage( ERROR, UNKNOWN_ERROR );
+        }
+    }
+    else {
+        resultList = _logErrorMessage( ERROR, "The specified image view could not be found: " + controlId );
+    }
+    return resultList;
+}
+
 QStringList ScriptFacade::setBinCount( const QString& histogramId, int binCount ) {
     QStringList resultList;
     Carta::State::CartaObject* obj = _getObject( histogramId );
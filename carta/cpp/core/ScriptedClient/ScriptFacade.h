@@ -7,6 +7,7 @@
 #pragma once
 #include <QString>
 #include <QObject>
+#include <functional>
 #include "CartaLib/CartaLib.h"
 
 namespace Carta {
@@ -220,6 +221,13 @@ public:
      */
     QStringList getPluginList() const;
 
+    /**
+     * Returns the memory used by the in-memory caches.
+     * @return a list with one "name,bytes,entries" string per kind of cache, preceded by
+     *      "total,bytes" and "budget,bytes" for all caches together.
+     */
+    QStringList getCacheUsage() const;
+
     /**
      * Set the image channel to the specified value.
      * @param animatorId the unique server-side id of an object managing an animator.
@@ -262,9 +270,13 @@ public:
      * @param scale the scale (zoom level) of the saved image.
      * @param aspectRatioMode can be either "ignore", "keep", or "expand".
             See http://doc.qt.io/qt-5/qt.html#AspectRatioMode-enum for further information.
+     * @param saveId - passed back with saveImageResult() to tell saves apart.
+     * @return a list whose first element is empty, followed by error messages if the
+     *      save could not be started; there is no saveImageResult() in that case.
      */
     QStringList saveFullImage( const QString& controlId, const QString& filename,
-            int width, int height, double scale, const QString& aspectRatioMode /*Qt::AspectRatioMode aspectRatioMode*/ );
+            int width, int height, double scale, const QString& aspectRatioMode /*Qt::AspectRatioMode aspectRatioMode*/,
+            const QString& saveId );
 
     /**
      * Save the current state.
@@ -505,6 +517,48 @@ public:
      */
     QStringList getIntensity( const QString& controlId, int frameLow, int frameHigh, double percentile ); 
 
+    /**
+     * Returns a function computing the intensity corresponding to a given percentile.
+     * The function is set up on the GUI thread, but does the actual work wherever it is called.
+     * @param controlId the unique server-side id of an object managing a controller.
+     * @param frameLow a lower bound for the image channels or -1 if there is no lower bound.
+     * @param frameHigh an upper bound for the image channels or -1 if there is no upper bound.
+     * @param percentile a number [0,1] for which an intensity is desired.
+     * @return a function returning the same result as getIntensity().
+     */
+    std::function<QStringList()> getIntensityJob( const QString& controlId, int frameLow, int frameHigh, double percentile );
+
+    /**
+     * Add an image computed on demand from the image shown in an image view.
+     * @param controlId the unique server-side id of an object managing a controller.
+     * @param operation one of smooth, rebin, ratio, difference or polarizedintensity.
+     * @param value the smoothing width in pixels, or the number of channels to average.
+     * @param otherIndex the index of the second image for ratio and difference.
+     * @return an error message if the image could not be derived; an empty string otherwise.
+     */
+    QStringList deriveImage( const QString& controlId, const QString& operation, double value, int otherIndex );
+
+    /**
+     * Compute moment maps of the image shown in an image view; they are added to the
+     * view as new images once they are ready.
+     * @param controlId the unique server-side id of an object managing a controller.
+     * @param histogramId the unique server-side id of a histogram whose channel and intensity
+     *      range select the pixels to use, or an empty string to use all of them.
+     * @param moments the moments to compute: moment0, moment1, moment2 and/or peak; moment1 and
+     *      moment2 are the mean and dispersion of the spectral coordinate, in the units of the spectral axis.
+     * @return an error message if the moments could not be started; an empty string otherwise.
+     */
+    QStringList generateMoments( const QString& controlId, const QString& histogramId, const QStringList& moments );
+
+    /**
+     * Hand the pixels of the current channel of the image shown in an image view to a
+     * function provided by a plugin, e.g. a python script.
+     * @param controlId the unique server-side id of an object managing a controller.
+     * @param funcName the name of the plugin function.
+     * @return an error message if no plugin has the function or it failed; an empty string otherwise.
+     */
+    QStringList callRawViewFunction( const QString& controlId, const QString& funcName );
+
     /**
      * Set the number of bins in the histogram.
      * @param histogramId the unique server-side id of an object managing a histogram.
@@ -800,13 +854,13 @@ public:
 signals:
 
     /// Return the result of SaveFullImage() after the image has been rendered
-    /// and a save attempt made.
-    void saveImageResult( bool result );
+    /// and a save attempt made, along with the id the save was started with.
+    void saveImageResult( bool result, const QString& saveId );
 
 private slots:
 
     // Asynchronous result from saveFullImage().
-    void saveImageResultCB( bool result );
+    void saveImageResultCB( bool result, const QString& saveId );
 
 private:
     Carta::Data::ViewManager* m_viewManager; //Used
@@ -4,6 +4,7 @@
 
 #include "Listener.h"
 #include "ScriptedCommandInterpreter.h"
+#include "FunctionRunnable.h"
 
 namespace Carta
 {
@@ -23,6 +24,81 @@ ScriptedCommandInterpreter::ScriptedCommandInterpreter( int port, QObject * pare
 
     connect( m_messageListener.get(), & MessageListener::receivedAsync,
              this, & ScriptedCommandInterpreter::asyncMessageReceivedCB );
+
+    connect( m_messageListener.get(), & MessageListener::clientDisconnected,
+             this, & ScriptedCommandInterpreter::clientDisconnectedCB );
+
+    // results of background commands are sent from the GUI thread
+    connect( this, & ScriptedCommandInterpreter::backgroundResult,
+             this, & ScriptedCommandInterpreter::backgroundResultCB, Qt::QueuedConnection );
+}
+
+ScriptedCommandInterpreter::~ScriptedCommandInterpreter()
+{
+    m_workers.waitForDone();
+}
+
+bool
+ScriptedCommandInterpreter::startBackground( int clientId, const QJsonValue & requestId,
+                                             const QString & cmd, const QJsonObject & args )
+{
+    // the facade can only be used on the GUI thread, so the job is set up here,
+    // and only the actual work is done on the worker thread
+    std::function < QStringList() > job;
+    if ( cmd == "getintensity" ) {
+        QString imageView = args["imageView"].toString();
+        int frameLow = args["frameLow"].toInt();
+        int frameHigh = args["frameHigh"].toInt();
+        double percentile = args["percentile"].toDouble();
+        job = m_scriptFacade->getIntensityJob( imageView, frameLow, frameHigh, percentile );
+    }
+    if ( ! job ) {
+        return false;
+    }
+
+    auto run = [this, clientId, requestId, job] () {
+        QStringList result = job();
+        QString key = "result";
+        if ( result.size() > 0 && result[0] == "error" ) {
+            key = "error";
+        }
+        emit backgroundResult( clientId, requestId, key, result );
+    };
+    m_workers.start( new FunctionRunnable( run ) );
+    return true;
+} // startBackground
+
+void
+ScriptedCommandInterpreter::sendResult( int clientId, const QJsonValue & requestId,
+                                        const QString & key, const QStringList & result )
+{
+    QJsonObject rjo;
+    rjo.insert( key, QJsonValue::fromVariant( result ) );
+    if ( ! requestId.isUndefined() ) {
+        rjo.insert( "id", requestId );
+    }
+    JsonMessage rjm = JsonMessage( QJsonDocument( rjo ) );
+    if ( ! m_messageListener->send( clientId, rjm.toTagMessage() ) ) {
+        qWarning() << "Could not send result to scripted client" << clientId;
+    }
+}
+
+void
+ScriptedCommandInterpreter::backgroundResultCB( int clientId, QJsonValue requestId,
+                                                QString key, QStringList result )
+{
+    sendResult( clientId, requestId, key, result );
+}
+
+void
+ScriptedCommandInterpreter::clientDisconnectedCB( int clientId )
+{
+    // saves already started will still finish, we just won't send their results
+    for ( auto & pending : m_pendingSaves ) {
+        if ( pending.first == clientId ) {
+            pending.first = - 1;
+        }
+    }
 }
 
 /// The bulk of this method is a massive if/else if/.../else statement.
@@ -33,7 +109,7 @@ ScriptedCommandInterpreter::ScriptedCommandInterpreter( int port, QObject * pare
 /// extra comments about the commands, and also to group the commands
 /// according to which Python classes they relate to.
 void
-ScriptedCommandInterpreter::tagMessageReceivedCB( TagMessage tm )
+ScriptedCommandInterpreter::tagMessageReceivedCB( int clientId, TagMessage tm )
 {
     m_scriptFacade = ScriptFacade::getInstance();
     if ( tm.tag() != "json" ) {
@@ -50,6 +126,11 @@ ScriptedCommandInterpreter::tagMessageReceivedCB( TagMessage tm )
     // Arguments will be parsed according to the command name.
     QString cmd = jo["cmd"].toString().toLower();
     auto args = jo["args"].toObject();
+    // Clients that want to pipeline commands tag them with an id.
+    QJsonValue requestId = jo["id"];
+    if ( ! requestId.isUndefined() && startBackground( clientId, requestId, cmd, args ) ) {
+        return;
+    }
     QStringList result;
     // By default, assume that we will be sending a proper result back.
     // If an error occurs, key will be set to "error".
@@ -106,6 +187,10 @@ ScriptedCommandInterpreter::tagMessageReceivedCB( TagMessage tm )
         result = m_scriptFacade->getPluginList();
     }
 
+    else if ( cmd == "getcacheusage" ) {
+        result = m_scriptFacade->getCacheUsage();
+    }
+
     else if ( cmd == "addlink" ) {
         QString source = args["sourceView"].toString();
         QString dest = args["destView"].toString();
@@ -287,6 +372,27 @@ ScriptedCommandInterpreter::tagMessageReceivedCB( TagMessage tm )
         result = m_scriptFacade->getIntensity( imageView, frameLow, frameHigh, percentile );
     }
 
+    else if ( cmd == "deriveimage" ) {
+        QString imageView = args["imageView"].toString();
+        QString operation = args["operation"].toString();
+        double value = args["value"].toDouble();
+        int otherIndex = args["otherIndex"].toInt();
+        result = m_scriptFacade->deriveImage( imageView, operation, value, otherIndex );
+    }
+
+    else if ( cmd == "generatemoments" ) {
+        QString imageView = args["imageView"].toString();
+        QString histogramView = args["histogramView"].toString();
+        QStringList moments = args["moments"].toString().split( ' ', QString::SkipEmptyParts );
+        result = m_scriptFacade->generateMoments( imageView, histogramView, moments );
+    }
+
+    else if ( cmd == "callrawviewfunction" ) {
+        QString imageView = args["imageView"].toString();
+        QString function = args["function"].toString();
+        result = m_scriptFacade->callRawViewFunction( imageView, function );
+    }
+
     else if ( cmd == "getpixelcoordinates" ) {
         QString imageView = args["imageView"].toString();
         double ra = args["ra"].toDouble();
@@ -632,14 +738,11 @@ ScriptedCommandInterpreter::tagMessageReceivedCB( TagMessage tm )
         key = "error";
     }
 
-    QJsonObject rjo;
-    rjo.insert( key, QJsonValue::fromVariant( result ) );
-    JsonMessage rjm = JsonMessage( QJsonDocument( rjo ) );
-    m_messageListener->send( rjm.toTagMessage() );
+    sendResult( clientId, requestId, key, result );
 } // tagMessageReceivedCB
 
 void
-ScriptedCommandInterpreter::asyncMessageReceivedCB( TagMessage tm )
+ScriptedCommandInterpreter::asyncMessageReceivedCB( int clientId, TagMessage tm )
 {
     m_scriptFacade = ScriptFacade::getInstance();
     if ( tm.tag() != "async" ) {
@@ -653,11 +756,12 @@ ScriptedCommandInterpreter::asyncMessageReceivedCB( TagMessage tm )
     }
 
     connect( m_scriptFacade, & ScriptFacade::saveImageResult,
-             this, & ScriptedCommandInterpreter::saveImageResultCB );
+             this, & ScriptedCommandInterpreter::saveImageResultCB, Qt::UniqueConnection );
 
     QJsonObject jo = jm.doc().object();
     QString cmd = jo["cmd"].toString().toLower();
     auto args = jo["args"].toObject();
+    QJsonValue requestId = jo["id"];
     if ( cmd == "savefullimage" ) {
         QString imageView = args["imageView"].toString();
         QString filename = args["filename"].toString();
@@ -675,25 +779,37 @@ ScriptedCommandInterpreter::asyncMessageReceivedCB( TagMessage tm )
         else {
             aspectRatioMode = Qt::IgnoreAspectRatio;
         }*/
-        m_scriptFacade->saveFullImage( imageView, filename, width, height, scale,/* aspectRatioMode*/aspectStr );
+        // saves started from the GUI have no id, so their results are ignored here
+        QString saveId = "script" + QString::number( ++m_saveCount );
+        QStringList errorList = m_scriptFacade->saveFullImage( imageView, filename, width, height, scale,/* aspectRatioMode*/aspectStr, saveId );
+        if ( errorList.size() > 1 ) {
+            // the save was not started, there won't be a saveImageResult() for this one
+            errorList[0] = "error";
+            sendResult( clientId, requestId, "error", errorList );
+        }
+        else {
+            m_pendingSaves.insert( saveId, qMakePair( clientId, requestId ) );
+        }
     }
 
 } // asyncMessageReceivedCB
 
-void ScriptedCommandInterpreter::saveImageResultCB( bool saveResult ){
-    disconnect( m_scriptFacade, & ScriptFacade::saveImageResult,
-             this, & ScriptedCommandInterpreter::saveImageResultCB );
+void ScriptedCommandInterpreter::saveImageResultCB( bool saveResult, const QString & saveId ){
+    if ( ! m_pendingSaves.contains( saveId ) ) {
+        return;
+    }
+    QPair < int, QJsonValue > pending = m_pendingSaves.take( saveId );
+    if ( pending.first < 0 ) {
+        return;
+    }
 
-    QJsonObject rjo;
     QStringList result("");
     QString key = "result";
     if ( saveResult == false ) {
         key = "error";
         result[0] = "Could not save image.";
     }
-    rjo.insert( key, QJsonValue::fromVariant( result ) );
-    JsonMessage rjm = JsonMessage( QJsonDocument( rjo ) );
-    m_messageListener->send( rjm.toTagMessage() );
+    sendResult( pending.first, pending.second, key, result );
 }
 
 }
@@ -14,6 +14,10 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDir>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QThreadPool>
 #include <memory>
 
 namespace Carta
@@ -23,6 +27,13 @@ namespace Core
 namespace ScriptedClient
 {
 /// listens for some json commands, interprets them and sends results back
+///
+/// Any number of clients can be connected. A client can send several commands without
+/// waiting for their results, and tag each command with an "id", which is then included
+/// in its result. Commands are executed in the order they arrive, except the long running
+/// ones with an id (e.g. getIntensity), which are run on worker threads and whose results
+/// are sent back as soon as they are ready, i.e. possibly out of order. Commands without
+/// an id are always answered in order.
 class ScriptedCommandInterpreter : public QObject
 {
     Q_OBJECT
@@ -31,27 +42,64 @@ public:
 
     ScriptedCommandInterpreter( int port, QObject * parent = nullptr );
 
+    ~ScriptedCommandInterpreter();
+
 protected:
 
     ScriptFacade* m_scriptFacade = nullptr;
 
+signals:
+
+    /// emitted from a worker thread when a background command is done
+    void
+    backgroundResult( int clientId, QJsonValue requestId, QString key, QStringList result );
+
 private slots:
 
     /// interpret commands, send results back
     void
-    tagMessageReceivedCB( TagMessage tm );
+    tagMessageReceivedCB( int clientId, TagMessage tm );
 
     /// interpret commands with asynchronous results
     void
-    asyncMessageReceivedCB( TagMessage tm );
+    asyncMessageReceivedCB( int clientId, TagMessage tm );
 
     // Asynchronous result from saveFullImage().
     void
-    saveImageResultCB( bool result );
+    saveImageResultCB( bool result, const QString & saveId );
+
+    /// send the result of a background command
+    void
+    backgroundResultCB( int clientId, QJsonValue requestId, QString key, QStringList result );
+
+    /// forget about results for a client that went away
+    void
+    clientDisconnectedCB( int clientId );
 
 private:
 
+    /// if the command is one of the long running ones, start it on a worker thread
+    /// \return true if the command was started, false if it has to be run right away
+    bool
+    startBackground( int clientId, const QJsonValue & requestId, const QString & cmd,
+                     const QJsonObject & args );
+
+    /// send a result to a client, tagged with the id of the request if it had one
+    void
+    sendResult( int clientId, const QJsonValue & requestId, const QString & key,
+                const QStringList & result );
+
     std::unique_ptr < MessageListener > m_messageListener = nullptr;
+
+    /// clients (and their request ids) waiting for saveFullImage(), by the id
+    /// the save was started with
+    QHash < QString, QPair < int, QJsonValue > > m_pendingSaves;
+
+    /// used to make the save ids
+    qint64 m_saveCount = 0;
+
+    /// threads running the long running commands
+    QThreadPool m_workers;
 };
 }
 }
@@ -3,6 +3,8 @@
  **/
 
 #include "VarLengthMessage.h"
+#include <QDebug>
+#include <QTimer>
 
 namespace Carta
 {
@@ -30,15 +32,42 @@ VarLengthSocket::send( const Carta::Core::ScriptedClient::VarLengthMessage & dat
 void
 VarLengthSocket::socketCB()
 {
-    VarLengthMessage buff;
-    qint64 size;
-    readNBytes( 8, & size );
-    size = qFromLittleEndian( size );
-    buff.resize( size );
-    readNBytes( size, buff.data() );
+    // a client can send several messages before it reads any results, so there
+    // can be more than one message available, and the last one may be incomplete
+    // (we don't wait for the rest of it, that would stall the other clients)
+    while ( ! m_dropped ) {
+        if ( m_pendingSize < 0 ) {
+            if ( m_rawSocket-> bytesAvailable() < 8 ) {
+                return;
+            }
+            qint64 size;
+            readNBytes( 8, & size );
+            size = qFromLittleEndian( size );
+            if ( size < 0 || size > MaxMessageSize ) {
+                // closing the socket right away would delete the client while
+                // we are still in its callback
+                qWarning() << "Dropping scripted client, message too long:" << size;
+                m_dropped = true;
+                auto socket = m_rawSocket;
+                QTimer::singleShot( 0, socket.get(), [socket] () {
+                                        socket-> abort();
+                                    }
+                                    );
+                return;
+            }
+            m_pendingSize = size;
+        }
+        if ( m_rawSocket-> bytesAvailable() < m_pendingSize ) {
+            return;
+        }
+        VarLengthMessage buff;
+        buff.resize( m_pendingSize );
+        readNBytes( m_pendingSize, buff.data() );
+        m_pendingSize = - 1;
 
-    emit received( buff );
-}
+        emit received( buff );
+    }
+} // socketCB
 
 void
 VarLengthSocket::sendNBytes( qint64 n, const void * data )
@@ -25,12 +25,17 @@ typedef QByteArray VarLengthMessage;
 /// Messages are encoded:
 /// 8 bytes representing the length of the data (n) in little endian
 /// n bytes represnting the raw (binary) data
+///
+/// A client announcing a message longer than MaxMessageSize is disconnected.
 class VarLengthSocket : public QObject
 {
     Q_OBJECT
 
 public:
 
+    /// longest message we accept
+    static constexpr qint64 MaxMessageSize = 64 * 1024 * 1024;
+
     VarLengthSocket( std::shared_ptr < QTcpSocket > rawSocket );
 
 public slots:
@@ -47,7 +52,8 @@ signals:
 
 private slots:
 
-    /// raw socket callback when data becomes available to be read
+    /// raw socket callback when data becomes available to be read, emits received()
+    /// for every complete message, and leaves incomplete ones for the next call
     void
     socketCB();
 
@@ -72,6 +78,12 @@ private:
 
     /// pointer to the actual raw socket
     std::shared_ptr < QTcpSocket > m_rawSocket = nullptr;
+
+    /// size of the message whose length was read, but not its data yet (-1 if none)
+    qint64 m_pendingSize = - 1;
+
+    /// set when the client sent something we can't read, the rest is ignored
+    bool m_dropped = false;
 };
 }
 }
@@ -34,12 +34,31 @@ void
 SimpleRemoteVGView::setRaster( const QImage & image )
 {
     m_raster = image;
+    m_dirtyAll = true;
+}
+
+void
+SimpleRemoteVGView::setRasterPartial( const QImage & image, const QRect & dirtyRect )
+{
+    // a change in size invalidates everything
+    if ( image.size() != m_raster.size() ) {
+        m_dirtyAll = true;
+    }
+    else {
+        m_dirtyRect |= dirtyRect.intersected( image.rect() );
+    }
+    m_raster = image;
 }
 
 void
 SimpleRemoteVGView::setVG( const Lib::IRemoteVGView::VGList & vglist )
 {
-    m_vgList = vglist;
+    // re-setting identical VG changes nothing
+    Carta::Lib::VectorGraphics::VGBuffer buffer = vglist.toBuffer();
+    if ( buffer != m_vgBuffer ) {
+        m_dirtyAll = true;
+    }
+    m_vgBuffer = std::move( buffer );
 }
 
 void
@@ -121,11 +140,14 @@ QSize
 SimpleRemoteVGView::size()
 {
     if ( m_buffer.isNull() ) {
+        // share the raster (no copy) if there is nothing to draw on top of it
         m_buffer = m_raster;
-        QPainter painter( & m_buffer );
-        Carta::Lib::VectorGraphics::VGListQPainterRenderer renderer;
-        renderer.render( m_vgList, painter );
-        painter.end();
+        if ( m_vgBuffer.size() > 0 ) {
+            QPainter painter( & m_buffer );
+            Carta::Lib::VectorGraphics::VGListQPainterRenderer renderer;
+            renderer.render( m_vgBuffer, painter );
+            painter.end();
+        }
     }
 
     return m_buffer.size();
@@ -159,6 +181,17 @@ SimpleRemoteVGView::viewRefreshed( qint64 id )
     Q_UNUSED( id );
 }
 
+QRect
+SimpleRemoteVGView::takeDirtyRect()
+{
+    // the VG is rendered on top of the raster, so as long as the VG did not change
+    // the damaged part of the buffer is the same as the damaged part of the raster
+    QRect result = m_dirtyAll ? QRect() : m_dirtyRect;
+    m_dirtyAll = false;
+    m_dirtyRect = QRect();
+    return result;
+}
+
 QString
 SimpleRemoteVGView::inputEventCB( const QString & cmd,
                                   const QString & params,
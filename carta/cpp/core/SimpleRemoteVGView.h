@@ -42,6 +42,9 @@ public:
     virtual void
     setRaster( const QImage & image ) override;
 
+    virtual void
+    setRasterPartial( const QImage & image, const QRect & dirtyRect ) override;
+
     virtual void
     setVG( const VGList & vglist ) override;
 
@@ -74,7 +77,12 @@ private:
     IConnector * m_connector = nullptr;
     QImage m_raster, m_buffer;
 
-    VGList m_vgList;
+    /// accumulated damage since the last takeDirtyRect(), null means everything
+    QRect m_dirtyRect;
+    bool m_dirtyAll = true;
+
+    /// the VG in flat form, converted once in setVG() and rendered on every repaint
+    Carta::Lib::VectorGraphics::VGBuffer m_vgBuffer;
     qint64 m_lastRepaintId = - 1;
 
     // IView interface
@@ -103,6 +111,9 @@ private:
     virtual void
     viewRefreshed( qint64 id) override ;
 
+    virtual QRect
+    takeDirtyRect() override;
+
     // for now this is how we handle input events... same for desktop and server
     QString inputEventCB( const QString & cmd, const QString & params, const QString & sessionId);
 
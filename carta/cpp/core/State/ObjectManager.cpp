@@ -8,9 +8,16 @@
 #include "ObjectManager.h"
 #include "Globals.h"
 #include "UtilState.h"
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <QBuffer>
 #include <QDebug>
+#include <QHash>
+#include <QPair>
 #include <cassert>
 #include <set>
+#include <vector>
 
 using namespace std;
 
@@ -176,47 +183,126 @@ QString ObjectManager::getRoot() const {
     return m_root;
 }
 
+namespace {
+
+/// rapidjson output stream writing to a QIODevice through a buffer
+class DeviceOutputStream {
+
+public:
+
+    typedef char Ch;
+
+    DeviceOutputStream( QIODevice& device )
+    : m_device( device ),
+      m_error( false ){
+        m_buffer.reserve( BUFFER_SIZE );
+    }
+
+    ~DeviceOutputStream(){
+        Flush();
+    }
+
+    void Put( Ch c ){
+        m_buffer.push_back( c );
+        if ( m_buffer.size() >= BUFFER_SIZE ){
+            Flush();
+        }
+    }
+
+    void Flush(){
+        if ( !m_buffer.empty() ){
+            qint64 written = m_device.write( m_buffer.data(), m_buffer.size() );
+            if ( written != static_cast<qint64>( m_buffer.size() ) ){
+                m_error = true;
+            }
+            m_buffer.clear();
+        }
+    }
+
+    bool hasError() const {
+        return m_error;
+    }
+
+    //Not used by the writer, but required by the rapidjson stream concept.
+    Ch Peek() const { RAPIDJSON_ASSERT( false ); return 0; }
+    Ch Take() { RAPIDJSON_ASSERT( false ); return 0; }
+    size_t Tell() const { RAPIDJSON_ASSERT( false ); return 0; }
+    Ch* PutBegin() { RAPIDJSON_ASSERT( false ); return 0; }
+    size_t PutEnd( Ch* ) { RAPIDJSON_ASSERT( false ); return 0; }
+
+private:
+
+    static const size_t BUFFER_SIZE = 64 * 1024;
+    QIODevice& m_device;
+    std::vector<char> m_buffer;
+    bool m_error;
+};
+
+void writeKey( rapidjson::Writer<DeviceOutputStream>& writer, const QString& key ){
+    QByteArray keyUtf8 = key.toUtf8();
+    writer.String( keyUtf8.constData(), keyUtf8.size() );
+}
+
+QString jsonToString( const rapidjson::Value& value ){
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+    value.Accept( writer );
+    return QString::fromUtf8( buffer.GetString(), buffer.GetSize() );
+}
+
+}
+
 bool ObjectManager::restoreSnapshot(const QString stateStr, CartaObject::SnapshotType snapType ) const {
     bool stateRestored = false;
     if ( !stateStr.isEmpty() && stateStr.length() > 0 ){
-        StateInterface state("");
-        state.setState( stateStr );
-        int stateCount = state.getArraySize( STATE_ARRAY );
+        //Parse once, in place, and index the saved states by type and index.  The
+        //state of an object is only turned back into a string when an object
+        //needs it.
+        QByteArray json = stateStr.toUtf8();
+        rapidjson::Document state;
+        state.ParseInsitu<0>( json.data() );
+        if ( state.HasParseError() || !state.IsObject() ){
+            qWarning() << "Could not parse snapshot state";
+            return false;
+        }
+        QByteArray arrayKey = STATE_ARRAY.toUtf8();
+        QByteArray typeKey = StateInterface::OBJECT_TYPE.toUtf8();
+        QByteArray indexKey = StateInterface::INDEX.toUtf8();
+        QHash<QPair<QString,int>, const rapidjson::Value*> statesByIndex;
+        QHash<QString, const rapidjson::Value*> statesByType;
+        if ( state.HasMember( arrayKey.constData() ) && state[arrayKey.constData()].IsArray() ){
+            const rapidjson::Value& states = state[arrayKey.constData()];
+            for ( rapidjson::SizeType j = 0; j < states.Size(); j++ ){
+                const rapidjson::Value& objState = states[j];
+                if ( !objState.IsObject() || !objState.HasMember( typeKey.constData() ) ||
+                        !objState[typeKey.constData()].IsString() ){
+                    continue;
+                }
+                QString objType = QString::fromUtf8( objState[typeKey.constData()].GetString() );
+                if ( !statesByType.contains( objType ) ){
+                    statesByType.insert( objType, &objState );
+                }
+                if ( objState.HasMember( indexKey.constData() ) && objState[indexKey.constData()].IsInt() ){
+                    QPair<QString,int> key( objType, objState[indexKey.constData()].GetInt() );
+                    if ( !statesByIndex.contains( key ) ){
+                        statesByIndex.insert( key, &objState );
+                    }
+                }
+            }
+        }
+
         for(map<QString,ObjectRegistryEntry>::const_iterator it = m_objects.begin(); it != m_objects.end(); ++it) {
             CartaObject* obj = it->second.getObject();
             //Try to assign by index and matching type.  Note:  May want to remove the assigning by id.
-            int targetIndex = obj->getIndex();
             QString targetType = obj->getSnapType( snapType );
-            bool restored = false;
-            for ( int j = 0; j < stateCount; j++ ){
-                QString stateLookup = UtilState::getLookup( STATE_ARRAY, j );
-                int objIndex = state.getValue<int>( UtilState::getLookup(stateLookup, StateInterface::INDEX ) );
-                QString objType = state.getValue<QString>( UtilState::getLookup(stateLookup, StateInterface::OBJECT_TYPE ));
-                if ( objType == targetType && objIndex == targetIndex ){
-                    restored = true;
-                    QString stateVal = state.toString( stateLookup );
-                    obj->resetState( stateVal, snapType );
-                    break;
-                }
-            }
-
-            if ( !restored ){
+            const rapidjson::Value* objState = statesByIndex.value( qMakePair( targetType, obj->getIndex() ), nullptr );
+            if ( !objState ){
                 //We lower our standard and just use the first object with matching type, assuming
                 //we can find one.
-                for ( int j = 0; j < stateCount; j++ ){
-                    QString stateLookup = UtilState::getLookup( STATE_ARRAY, j );
-                    QString typeLookup = UtilState::getLookup(stateLookup,StateInterface::OBJECT_TYPE);
-                    QString objType = state.getValue<QString>( typeLookup );
-                    if ( objType == targetType ){
-                        restored = true;
-                        QString stateVal = state.toString( stateLookup );
-                        obj->resetState( stateVal, snapType );
-                        break;
-                    }
-                }
+                objState = statesByType.value( targetType, nullptr );
             }
-            if ( !restored ){
-                //qDebug() << "Unable to restore "<<targetType<<" snapType="<<snapType;
+            if ( objState ){
+                obj->resetState( jsonToString( *objState ), snapType );
             }
         }
         stateRestored = true;
@@ -225,26 +311,47 @@ bool ObjectManager::restoreSnapshot(const QString stateStr, CartaObject::Snapsho
 }
 
 
-QString ObjectManager::getStateString( const QString& sessionId, const QString& rootName, CartaObject::SnapshotType type ) const {
-    StateInterface state( rootName );
-    int stateCount = m_objects.size();
-    state.insertArray( STATE_ARRAY, stateCount );
-    int arrayIndex = 0;
-    //Create an array of object with each object having an id and state.
+QString ObjectManager::getStateString( const QString& sessionId, const QString& /*rootName*/, CartaObject::SnapshotType type ) const {
+    QBuffer buffer;
+    buffer.open( QIODevice::WriteOnly );
+    writeState( buffer, sessionId, type );
+    return QString::fromUtf8( buffer.data() );
+}
+
+bool ObjectManager::writeState( QIODevice& device, const QString& sessionId, CartaObject::SnapshotType type ) const {
+    DeviceOutputStream stream( device );
+    rapidjson::Writer<DeviceOutputStream> writer( stream );
+
+    //Same members as a fresh StateInterface, followed by an array with the state of
+    //each object.  Objects that do not support a snapshot of this type are left out.
+    writer.StartObject();
+    writeKey( writer, StateInterface::OBJECT_TYPE );
+    writer.String( "" );
+    writeKey( writer, StateInterface::INDEX );
+    writer.Int( 0 );
+    writeKey( writer, StateInterface::FLUSH_STATE );
+    writer.Bool( false );
+    writeKey( writer, STATE_ARRAY );
+    writer.StartArray();
     for(map<QString,ObjectRegistryEntry>::const_iterator it = m_objects.begin(); it != m_objects.end(); ++it) {
         CartaObject* obj = it->second.getObject();
         QString objState = obj->getStateString( sessionId, type );
-        if ( !objState.isEmpty() && objState.trimmed().length() > 0){
-           QString lookup = UtilState::getLookup(STATE_ARRAY, arrayIndex );
-           state.setObject( lookup, objState );
-           arrayIndex++;
+        if ( objState.isEmpty() || objState.trimmed().length() == 0 ){
+            continue;
+        }
+        QByteArray objJson = objState.toUtf8();
+        rapidjson::Document objDoc;
+        objDoc.ParseInsitu<0>( objJson.data() );
+        if ( objDoc.HasParseError() ){
+            qWarning() << "Skipping unparsable state of" << it->first;
+            continue;
         }
+        objDoc.Accept( writer );
     }
-    //Because some of the objects may not support a snapshot of type,
-    //the original array that was created may be too large.  We resize
-    //it according to actual contents.
-    state.resizeArray( STATE_ARRAY, arrayIndex, StateInterface::PreserveAll );
-    return state.toString();
+    writer.EndArray();
+    writer.EndObject();
+    stream.Flush();
+    return !stream.hasError();
 }
 
 
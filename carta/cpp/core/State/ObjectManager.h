@@ -11,6 +11,8 @@
 #include <map>
 #include <QString>
 #include <QTextStream>
+
+class QIODevice;
 #include "StateInterface.h"
 #include "../IConnector.h"
 
@@ -258,6 +260,16 @@ public:
      */
     QString getStateString( const QString& sessionId, const QString& snapName, CartaObject::SnapshotType type ) const;
 
+    /**
+     * Writes the state of all managed objects as JSON to the device, in the same format
+     * as getStateString(), without building the combined state in memory first.
+     * @param device - where to write the state.
+     * @param sessionId - an identifier for a user's session.
+     * @param type - the type of state needed.
+     * @return true if the state was written; false if there was a problem writing to the device.
+     */
+    bool writeState( QIODevice& device, const QString& sessionId, CartaObject::SnapshotType type ) const;
+
 
     void initialize();
 
@@ -13,9 +13,12 @@
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <climits>
+#include <memory>
 #include <sstream>
 #include <QtCore/QString>
 #include <QtCore/QDebug>
+#include <QtCore/QHash>
 #include <stdexcept>
 
 using namespace rapidjson;
@@ -31,8 +34,42 @@ class StateInterfaceImpl {
 
 private:
 
+    // A key string split into its fields.
+
+    struct KeyPath {
+        QString keyString;
+        vector<QByteArray> names;  // fields in UTF-8
+        vector<int> indices;       // fields as array indices, NOT_AN_INDEX if not integers
+
+        static const int NOT_AN_INDEX = INT_MIN;
+    };
+
+    // The key strings looked up so far, by slot number.  Copies of a state share the
+    // table until one of them adds a key.  Slots handed out by key() are kept for good;
+    // the ones only used by key strings are dropped when there are too many of them,
+    // so that states with ever changing keys (e.g. indices) don't grow the table forever.
+
+    struct KeyTable {
+        vector<KeyPath> paths;
+        vector<char> pinned;       // true if a Key refers to the slot
+        QHash<QString, int> slots; // slot number by key string
+        vector<int> freeSlots;
+        int unpinnedCount = 0;
+    };
+
+    static const int MAX_UNPINNED_SLOTS = 256;
+
+    // The value a slot referred to the last time it was looked up.
+
+    struct CachedValue {
+        Value * value = nullptr;
+        unsigned generation = 0;   // generation_p when value was looked up
+    };
+
     StateInterfaceImpl (const QString & path )
-    : path_p (path)
+    : path_p (path),
+      keys_p (make_shared<KeyTable>()),
+      generation_p (1)
     {
         state_p.SetObject();
     }
@@ -43,6 +80,10 @@ private:
         path_p = other.path_p;
         state_p.CopyFrom (other.state_p, state_p.GetAllocator());
 
+        // Keys remain usable with the copy; the values are looked up again.
+
+        keys_p = other.keys_p;
+        generation_p = 1;
     }
 
     vector <QString> getKeys (const QString &) const;
@@ -51,12 +92,27 @@ private:
     const Value & getValueAux (const QString & keyString, const Document & state) const;
     Value & getValueAux (const QString & keyString, Document & state) const;
     Value* _getValueAux( const QString& keyString, const Document& state ) const;
+    Value* _getValueAux( const KeyPath& keyPath, const Document& state ) const;
     void insertObjectAux (const QString & keyString, Value & valueToInsert);
 
+    KeyPath compileKey (const QString & keyString) const;
+    int getSlot (const QString & keyString, bool pin) const;
+    Value & getSlotValue (int slot) const;
+    void detachKeys () const;
+    void pruneKeys () const;
+    void structureChanged ();
+
     Document oldState_p;
     QString path_p;
     Document state_p;
 
+    // Looked up keys, and the values they referred to by slot number.  Cached values
+    // are valid as long as their generation matches generation_p.
+
+    mutable shared_ptr<KeyTable> keys_p;
+    mutable vector<CachedValue> values_p;
+    unsigned generation_p;
+
 };
 
 class AsUtf8 {
@@ -126,6 +182,24 @@ StateInterface::~StateInterface ()
     delete impl_p;
 }
 
+StateInterface::Key
+StateInterface::key (const QString & keyString) const
+{
+    return Key (impl_p->getSlot (keyString, true));
+}
+
+StateInterface::Key
+StateInterface::lookupKey (const QString & keyString) const
+{
+    return Key (impl_p->getSlot (keyString, false));
+}
+
+int
+StateInterface::keySlotCount () const
+{
+    return static_cast<int> (impl_p->keys_p->paths.size());
+}
+
 void StateInterface::setState( const QString& jsonStr  ){
     _restoreState( jsonStr );
 }
@@ -144,6 +218,7 @@ void StateInterface::_restoreState( const QString& json ){
     AsUtf8 jsonUtf8 (json);
 
     impl_p->state_p.Parse (jsonUtf8.data());
+    impl_p->structureChanged();
 
     if (impl_p->state_p.HasParseError()){
 
@@ -237,6 +312,10 @@ StateInterfaceImpl::insertObjectAux (const QString & keyString, Value & valueToI
     // value of the newly created null-filled array.
 
     value.AddMember (lastKeyValue, valueToInsert, state_p.GetAllocator());
+
+    // Adding a member can move the other members of the object.
+
+    structureChanged();
 }
 
 void
@@ -340,6 +419,8 @@ void StateInterface::resizeArray (const QString & keyString,
         nullObject.SetObject();
         value.PushBack(nullObject, impl_p->state_p.GetAllocator());
     }
+
+    impl_p->structureChanged();
 }
 
 
@@ -390,45 +471,45 @@ StateInterfaceImpl::makeKeys (Iterator iterator, const Iterator & end) const
     return result;
 }
 
-void StateInterface::getTypedValue (bool & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (bool & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetBool();
 }
 
-void StateInterface::getTypedValue (double & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (double & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetDouble();
 }
 
-void StateInterface::getTypedValue (int & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (int & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetInt ();
 }
 
-void StateInterface::getTypedValue (int64_t & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (int64_t & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetInt64 ();
 }
 
-void StateInterface::getTypedValue (QString & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (QString & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetString ();
 }
 
-void StateInterface::getTypedValue (uint & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (uint & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetUint ();
 }
 
-void StateInterface::getTypedValue (uint64_t & typedValue, const QString & keyString) const
+void StateInterface::getTypedValue (uint64_t & typedValue, const Key & key) const
 {
-    const Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    const Value & value = impl_p->getSlotValue (key.slot_p);
     typedValue = value.GetUint64();
 }
 
@@ -448,26 +529,170 @@ StateInterfaceImpl::getValueAux (const QString & keyString, Document & state) co
 Value *
 StateInterfaceImpl::_getValueAux( const QString& keyString, const Document& state ) const {
 
+    if ( &state == &state_p ){
+        return &getSlotValue( getSlot( keyString, false ) );
+    }
+    return _getValueAux( compileKey( keyString ), state );
+}
+
+StateInterfaceImpl::KeyPath
+StateInterfaceImpl::compileKey (const QString & keyString) const
+{
+    KeyPath keyPath;
+    keyPath.keyString = keyString;
+
     // Split the keyString up into a vector of keys.
 
     vector<QString> keys =  getKeys (keyString);
 
     if (keys.size() == 0 || keys[0].trimmed().size() == 0 ){
 
+        // If there are no keys, the path refers to the whole state document.
+
+        return keyPath;
+    }
+
+    for (const QString & key : keys){
+        bool isValidInt = false;
+        int keyAsInteger = key.toInt( &isValidInt );
+        keyPath.names.push_back( key.toUtf8() );
+        int index = isValidInt ? keyAsInteger : KeyPath::NOT_AN_INDEX;
+        keyPath.indices.push_back( index );
+    }
+    return keyPath;
+}
+
+int
+StateInterfaceImpl::getSlot (const QString & keyString, bool pin) const
+{
+    QHash<QString, int>::const_iterator it = keys_p->slots.find( keyString );
+    if ( it != keys_p->slots.end() ){
+        int slotIndex = it.value();
+        if ( pin && ! keys_p->pinned[slotIndex] ){
+            detachKeys();
+            keys_p->pinned[slotIndex] = true;
+            keys_p->unpinnedCount --;
+        }
+        return slotIndex;
+    }
+
+    detachKeys();
+    if ( ! pin && keys_p->unpinnedCount >= MAX_UNPINNED_SLOTS ){
+        pruneKeys();
+    }
+    int slotIndex = keys_p->paths.size();
+    if ( ! keys_p->freeSlots.empty() ){
+        slotIndex = keys_p->freeSlots.back();
+        keys_p->freeSlots.pop_back();
+    }
+    else {
+        keys_p->paths.push_back( KeyPath() );
+        keys_p->pinned.push_back( false );
+    }
+    keys_p->paths[slotIndex] = compileKey( keyString );
+    keys_p->pinned[slotIndex] = pin;
+    if ( ! pin ){
+        keys_p->unpinnedCount ++;
+    }
+    keys_p->slots.insert( keyString, slotIndex );
+
+    // The slot may have been used for another key before.
+
+    if ( slotIndex < static_cast<int>( values_p.size() ) ){
+        values_p[slotIndex] = CachedValue();
+    }
+    return slotIndex;
+}
+
+Value &
+StateInterfaceImpl::getSlotValue (int slotIndex) const
+{
+    if ( slotIndex < 0 || slotIndex >= static_cast<int>( keys_p->paths.size() ) ){
+        throw invalid_argument( "StateInterfaceImpl: Invalid key" );
+    }
+    if ( slotIndex >= static_cast<int>( values_p.size() ) ){
+        values_p.resize( keys_p->paths.size() );
+    }
+    CachedValue & cached = values_p[slotIndex];
+    if ( cached.generation != generation_p ){
+
+        // Not looked up since the structure changed; walk the tree (this throws if
+        // the value does not exist, in which case nothing is cached).
+
+        cached.value = _getValueAux( keys_p->paths[slotIndex], state_p );
+        cached.generation = generation_p;
+    }
+    return * cached.value;
+}
+
+void
+StateInterfaceImpl::detachKeys () const
+{
+    if ( keys_p.use_count() > 1 ){
+        keys_p = make_shared<KeyTable>( * keys_p );
+    }
+}
+
+void
+StateInterfaceImpl::pruneKeys () const
+{
+    // Only called on a table of our own, see detachKeys().
+
+    QHash<QString, int>::iterator it = keys_p->slots.begin();
+    while ( it != keys_p->slots.end() ){
+        int slotIndex = it.value();
+        if ( keys_p->pinned[slotIndex] ){
+            ++ it;
+            continue;
+        }
+        keys_p->paths[slotIndex] = KeyPath();
+        keys_p->freeSlots.push_back( slotIndex );
+        it = keys_p->slots.erase( it );
+    }
+    keys_p->unpinnedCount = 0;
+}
+
+void
+StateInterfaceImpl::structureChanged ()
+{
+    generation_p ++;
+    if ( generation_p == 0 ){
+        generation_p = 1; // 0 is never current, so slots that were never looked up stay that way
+        for ( CachedValue & cached : values_p ){
+            cached.generation = 0;
+        }
+    }
+}
+
+Value *
+StateInterfaceImpl::_getValueAux( const KeyPath& keyPath, const Document& state ) const {
+
+    const vector<QByteArray> & keys = keyPath.names;
+
+    if (keys.size() == 0 ){
+
         // If there are no keys, just return the whole state document.
 
         return const_cast<Document*>(&state);
     }
 
-    if (! state.HasMember(keys[0].toUtf8().data())){
+    // Path already used; only needed for error messages.
+
+    auto keysUsed = [&keys] ( size_t count ) -> QString {
+        QString result = QString::fromUtf8( keys[0] );
+        for ( size_t i = 1; i < count; i++ ){
+            result += StateInterface::DELIMITER + QString::fromUtf8( keys[i] );
+        }
+        return result;
+    };
+
+    if (! state.HasMember(keys[0].constData())){
         QString message = QString ("StateInterfaceImpl: No such top-level member '%1'")
-                              .arg (keys[0]);
+                              .arg (QString::fromUtf8( keys[0] ));
         throw invalid_argument (message.toStdString());
     }
 
-    Value * value = const_cast<Value*>( & (state [keys[0].toUtf8().data()]));
-
-    QString keysUsed = keys[0]; // path already used; used for error messages
+    Value * value = const_cast<Value*>( & (state [keys[0].constData()]));
 
     for (int i = 1; i < (int) keys.size(); i++){
 
@@ -478,34 +703,33 @@ StateInterfaceImpl::_getValueAux( const QString& keyString, const Document& stat
             // Check to see if the operation will fail and if so throw an
             // exception.
 
-            if ( ! value->HasMember( keys[i].toUtf8().data())){
+            if ( ! value->HasMember( keys[i].constData())){
                 QString errMsg( "StateInterfaceImpl: No such member '" +
-                        keysUsed + StateInterface::DELIMITER + keys[i] + "'");
+                        keysUsed( i ) + StateInterface::DELIMITER + QString::fromUtf8( keys[i] ) + "'");
                 throw invalid_argument( errMsg.toStdString());
             }
 
             // Navigate another step down the tree.
 
-            value = & ((* value) [keys[i].toUtf8().data()]);
+            value = & ((* value) [keys[i].constData()]);
         }
         else if ( value->IsArray()){
 
             // Value is an array so the key ought to be a nonnegative number that is
             // within the size of the array.
 
-            bool isValidInt = false;
-            int keyAsInteger = keys[i].toInt( &isValidInt );
+            int keyAsInteger = keyPath.indices[i];
 
-            if ( ! isValidInt ){
+            if ( keyAsInteger == KeyPath::NOT_AN_INDEX ){
                 QString message = QString ( "StateInterfaceImpl:: Array index should be integer '%1' at '%2'")
-                                     .arg (keys[i])
-                                     .arg (keysUsed);
+                                     .arg (QString::fromUtf8( keys[i] ))
+                                     .arg (keysUsed( i ));
                 throw invalid_argument (message.toStdString());
             }
 
             if ( keyAsInteger < 0 || keyAsInteger >= static_cast<int>(value->Size())){
-                QString errMsg( "StateInterfaceImpl: Index " + keys[i] +
-                                " out of bounds for array '" + keysUsed + "'");
+                QString errMsg( "StateInterfaceImpl: Index " + QString::fromUtf8( keys[i] ) +
+                                " out of bounds for array '" + keysUsed( i ) + "'");
                 throw invalid_argument( errMsg.toStdString());
             }
 
@@ -519,12 +743,10 @@ StateInterfaceImpl::_getValueAux( const QString& keyString, const Document& stat
             QString message =
                 QString ( "StatInterfaceImpl:: Request for field '%1' is not possible since "
                           "'%2' is neither an array nor object.")
-                     .arg (keys[i])
-                     .arg (keysUsed);
+                     .arg (QString::fromUtf8( keys[i] ))
+                     .arg (keysUsed( i ));
             throw invalid_argument (message.toStdString());
         }
-
-        keysUsed += StateInterface::DELIMITER + keys[i];
     }
 
     return value;
@@ -539,37 +761,52 @@ StateInterface::hasChanged (const QString & keyString) const
     return oldValue != value;
 }
 
-void StateInterface::setTypedValue (const bool & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const bool & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetBool (typedValue);
 }
 
-void StateInterface::setTypedValue (const double & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const double & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetDouble (typedValue);
 }
 
-void StateInterface::setTypedValue (const int & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const int & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetInt  (typedValue);
 }
 
-void StateInterface::setTypedValue (const int64_t & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const int64_t & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetInt64  (typedValue);
 }
 
-void StateInterface::setTypedValue (const QString & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const QString & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     // Convert the value to a byte array using Utf8.
 
@@ -579,16 +816,22 @@ void StateInterface::setTypedValue (const QString & typedValue, const QString &
                       impl_p->state_p.GetAllocator());
 }
 
-void StateInterface::setTypedValue (const uint & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const uint & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetUint  (typedValue);
 }
 
-void StateInterface::setTypedValue (const uint64_t & typedValue, const QString & keyString) const
+void StateInterface::setTypedValue (const uint64_t & typedValue, const Key & key) const
 {
-    Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
+    Value & value = impl_p->getSlotValue (key.slot_p);
+    if (value.IsObject() || value.IsArray()){
+        impl_p->structureChanged(); // its members are gone
+    }
 
     value.SetUint64 (typedValue);
 }
@@ -608,6 +851,7 @@ StateInterface::setObject (const QString & keyString)
     Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
 
     value.SetObject();
+    impl_p->structureChanged();
 }
 
 void
@@ -630,6 +874,7 @@ StateInterface::setObject (const QString & keyString, const QString & valueInJso
 
     value.SetObject();
     value.CopyFrom (newDocument, impl_p->state_p.GetAllocator());
+    impl_p->structureChanged();
 }
 
 
@@ -640,6 +885,7 @@ StateInterface::setNull (const QString & keyString)
     Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
 
     value.SetNull (); // it's null now!
+    impl_p->structureChanged();
 }
 
 int StateInterface::getArraySize( const QString& keyString ) const {
@@ -659,6 +905,7 @@ StateInterface::setArray (const QString & keyString, int size)
     Value & value = impl_p->getValueAux (keyString, impl_p->state_p);
 
     value.SetArray();
+    impl_p->structureChanged();
 
     resizeArray (keyString, size);
 }
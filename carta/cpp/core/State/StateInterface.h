@@ -35,6 +35,31 @@ public:
 
     StateInterface & operator= (const StateInterface & other);
 
+    // Key -- a key string that has been looked up once with key().  Key strings are split
+    // into their fields only once, and the location of the value they refer to is cached
+    // until the structure of the state changes (a member is inserted, an array is resized,
+    // an object or array is replaced, or the state is fetched/set), so using a Key is
+    // usually just a pointer dereference.  The key string routines below use the same
+    // cache, but need to look the key string up every time, and their entries are dropped
+    // again when there are too many of them; only key() keeps an entry for good.  A Key
+    // can only be used with the state it was obtained from, or a copy of it made afterwards.
+    //
+    // The cache is updated by the const routines too, so a StateInterface must not be
+    // used by several threads at once, even just for reading.  Copies share the table of
+    // looked up keys until one of them adds a key, and can be used on different threads.
+
+    class Key {
+    public:
+        Key () : slot_p (-1) {}
+        bool isValid () const { return slot_p >= 0; }
+    private:
+        friend class StateInterface;
+        explicit Key (int slot) : slot_p (slot) {}
+        int slot_p;
+    };
+
+    Key key (const QString & keyString) const;
+
     // fetchState() - loads the state from the central store
     // flushState() - flushes the state back to the central store
     // toString() - converts the state to a QSstring representation (JSON)
@@ -63,6 +88,8 @@ public:
 
     template <typename T>
     T getValue (const QString & keyString) const;
+    template <typename T>
+    T getValue (const Key & key) const;
 
     // hasChanged - returns true if the specified valuehas changed between the
     // current value and the previous time it was fetched.  Usually called after
@@ -127,6 +154,8 @@ public:
     template <typename T>
     void setValue (const QString & keyString, const T & newValue);
     template <typename T>
+    void setValue (const Key & key, const T & newValue);
+    template <typename T>
     void insertValue (const QString & keyString, const T & newValue);
     void insertNull( const QString& keyString );
     void setNull( const QString& keyString );
@@ -140,26 +169,32 @@ private:
 
     StateInterfaceImpl * impl_p;
 
+    // Looks up a key string without keeping its slot for good, for the key string
+    // routines; the Key is only valid until the next key string is looked up.
+
+    Key lookupKey (const QString & keyString) const;
+
 // Testing hooks
 
     virtual QString fetchStateImpl ();
     virtual void flushStateImpl (const QString &);
-
-    void getTypedValue (bool & typedValue, const QString & keyString) const;
-    void getTypedValue (double & typedValue, const QString & keyString) const;
-    void getTypedValue (int & typedValue, const QString & keyString) const;
-    void getTypedValue (int64_t & typedValue, const QString & keyString) const;
-    void getTypedValue (QString & typedValue, const QString & keyString) const;
-    void getTypedValue (uint & typedValue, const QString & keyString) const;
-    void getTypedValue (uint64_t & typedValue, const QString & keyString) const;
-
-    void setTypedValue (const bool & typedValue, const QString & keyString) const;
-    void setTypedValue (const double & typedValue, const QString & keyString) const;
-    void setTypedValue (const int & typedValue, const QString & keyString) const;
-    void setTypedValue (const int64_t & typedValue, const QString & keyString) const;
-    void setTypedValue (const QString & typedValue, const QString & keyString) const;
-    void setTypedValue (const uint & typedValue, const QString & keyString) const;
-    void setTypedValue (const uint64_t & typedValue, const QString & keyString) const;
+    int keySlotCount () const;
+
+    void getTypedValue (bool & typedValue, const Key & key) const;
+    void getTypedValue (double & typedValue, const Key & key) const;
+    void getTypedValue (int & typedValue, const Key & key) const;
+    void getTypedValue (int64_t & typedValue, const Key & key) const;
+    void getTypedValue (QString & typedValue, const Key & key) const;
+    void getTypedValue (uint & typedValue, const Key & key) const;
+    void getTypedValue (uint64_t & typedValue, const Key & key) const;
+
+    void setTypedValue (const bool & typedValue, const Key & key) const;
+    void setTypedValue (const double & typedValue, const Key & key) const;
+    void setTypedValue (const int & typedValue, const Key & key) const;
+    void setTypedValue (const int64_t & typedValue, const Key & key) const;
+    void setTypedValue (const QString & typedValue, const Key & key) const;
+    void setTypedValue (const uint & typedValue, const Key & key) const;
+    void setTypedValue (const uint64_t & typedValue, const Key & key) const;
 
     void _restoreState( const QString& json );
 
@@ -172,8 +207,14 @@ template <typename T>
 T StateInterface::getValue (const QString & keyString) const
 {
     //QString fullPath = impl_p->path_p + DELIMITER + keyString;
+    return getValue<T> (lookupKey (keyString));
+}
+
+template <typename T>
+T StateInterface::getValue (const Key & key) const
+{
     T typedValue;
-    getTypedValue (typedValue, keyString);
+    getTypedValue (typedValue, key);
 
     return typedValue;
 }
@@ -184,7 +225,7 @@ void StateInterface::insertValue (const QString & keyString, const T & newValue)
     insertObject (keyString);
 //printf ("Inserted\n");
 //flushState();
-    setTypedValue (newValue, keyString);
+    setTypedValue (newValue, lookupKey (keyString));
 //printf ("Set\n");
 //flushState();
 }
@@ -192,8 +233,13 @@ void StateInterface::insertValue (const QString & keyString, const T & newValue)
 template <typename T>
 void StateInterface::setValue (const QString & keyString, const T & newValue)
 {
-    setTypedValue (newValue, keyString);
+    setTypedValue (newValue, lookupKey (keyString));
+}
+
+template <typename T>
+void StateInterface::setValue (const Key & key, const T & newValue)
+{
+    setTypedValue (newValue, key);
 }
 }
 }
-
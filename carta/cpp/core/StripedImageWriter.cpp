@@ -0,0 +1,361 @@
+#include "StripedImageWriter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <zlib.h>
+#include <vector>
+
+namespace Carta
+{
+namespace Core
+{
+namespace ImageSaveService
+{
+namespace
+{
+void
+appendBE32( QByteArray & buff, quint32 val )
+{
+    buff.append( char ( val >> 24 ) );
+    buff.append( char ( val >> 16 ) );
+    buff.append( char ( val >> 8 ) );
+    buff.append( char ( val ) );
+}
+
+void
+appendLE16( QByteArray & buff, quint16 val )
+{
+    buff.append( char ( val ) );
+    buff.append( char ( val >> 8 ) );
+}
+
+void
+appendLE32( QByteArray & buff, quint32 val )
+{
+    appendLE16( buff, val );
+    appendLE16( buff, val >> 16 );
+}
+
+/// rows of the band as packed 8 bit RGB
+void
+packRgb( const QImage & band, int row, char * out )
+{
+    const QRgb * pixels = reinterpret_cast < const QRgb * > ( band.constScanLine( row ) );
+    for ( int x = 0 ; x < band.width() ; x++ ) {
+        * out++ = qRed( pixels[x] );
+        * out++ = qGreen( pixels[x] );
+        * out++ = qBlue( pixels[x] );
+    }
+}
+
+/// PNG, with a single deflate stream that is fed one row at a time and split into
+/// IDAT chunks as the compressed data comes out
+class PngWriter : public StripedImageWriter
+{
+public:
+
+    PngWriter( const QString & fileName, const QSize & size )
+        : m_file( fileName )
+          , m_size( size )
+          , m_out( 256 * 1024, 0 )
+    { }
+
+    bool
+    open()
+    {
+        if ( ! m_file.open( QIODevice::WriteOnly ) ) {
+            return false;
+        }
+        m_stream.zalloc = Z_NULL;
+        m_stream.zfree = Z_NULL;
+        m_stream.opaque = Z_NULL;
+        if ( deflateInit( & m_stream, Z_DEFAULT_COMPRESSION ) != Z_OK ) {
+            return false;
+        }
+        m_deflating = true;
+
+        // 8 bit RGB, no interlacing
+        QByteArray header;
+        appendBE32( header, m_size.width() );
+        appendBE32( header, m_size.height() );
+        header.append( char ( 8 ) );
+        header.append( char ( 2 ) );
+        header.append( 3, char ( 0 ) );
+        return m_file.write( "\x89PNG\r\n\x1a\n", 8 ) == 8 &&
+               writeChunk( "IHDR", header.constData(), header.size() );
+    }
+
+    virtual bool
+    writeRows( const QImage & band ) override
+    {
+        if ( band.width() != m_size.width() || m_rows + band.height() > m_size.height() ) {
+            return false;
+        }
+
+        // each row starts with its filter type, 0 = none
+        std::vector < char > row( 1 + 3 * m_size.width(), 0 );
+        for ( int y = 0 ; y < band.height() ; y++ ) {
+            packRgb( band, y, & row[1] );
+            if ( ! compress( row.data(), row.size(), Z_NO_FLUSH ) ) {
+                return false;
+            }
+        }
+        m_rows += band.height();
+        return true;
+    }
+
+    virtual bool
+    finish() override
+    {
+        if ( m_rows != m_size.height() ) {
+            return false;
+        }
+        return compress( nullptr, 0, Z_FINISH ) &&
+               writeChunk( "IEND", nullptr, 0 ) &&
+               m_file.flush();
+    }
+
+    virtual
+    ~PngWriter()
+    {
+        if ( m_deflating ) {
+            deflateEnd( & m_stream );
+        }
+    }
+
+private:
+
+    bool
+    writeChunk( const char * type, const char * data, int size )
+    {
+        QByteArray length;
+        appendBE32( length, size );
+        uLong crc = crc32( 0L, Z_NULL, 0 );
+        crc = crc32( crc, reinterpret_cast < const Bytef * > ( type ), 4 );
+        if ( size > 0 ) {
+            crc = crc32( crc, reinterpret_cast < const Bytef * > ( data ), size );
+        }
+        QByteArray checksum;
+        appendBE32( checksum, crc );
+        return m_file.write( length ) == 4 &&
+               m_file.write( type, 4 ) == 4 &&
+               m_file.write( data, size ) == size &&
+               m_file.write( checksum ) == 4;
+    }
+
+    /// feed data to the compressor, writing out the compressed data whenever the
+    /// output buffer fills up (and at the end)
+    bool
+    compress( const char * data, int size, int flush )
+    {
+        m_stream.next_in = reinterpret_cast < Bytef * > ( const_cast < char * > ( data ) );
+        m_stream.avail_in = size;
+        while ( true ) {
+            m_stream.next_out = reinterpret_cast < Bytef * > ( m_out.data() ) + m_outUsed;
+            m_stream.avail_out = m_out.size() - m_outUsed;
+            int res = deflate( & m_stream, flush );
+            if ( res == Z_STREAM_ERROR ) {
+                return false;
+            }
+            m_outUsed = m_out.size() - m_stream.avail_out;
+            bool done = flush == Z_FINISH ? res == Z_STREAM_END
+                        : m_stream.avail_in == 0 && m_stream.avail_out > 0;
+            if ( m_outUsed == int ( m_out.size() ) || ( done && flush == Z_FINISH && m_outUsed > 0 ) ) {
+                if ( ! writeChunk( "IDAT", m_out.data(), m_outUsed ) ) {
+                    return false;
+                }
+                m_outUsed = 0;
+            }
+            if ( done ) {
+                return true;
+            }
+        }
+    }
+
+    QFile m_file;
+    QSize m_size;
+    int m_rows = 0;
+    z_stream m_stream;
+    bool m_deflating = false;
+    std::vector < char > m_out;
+    int m_outUsed = 0;
+};
+
+/// baseline TIFF, one deflate compressed strip per band; the directory is written
+/// at the end, once the strips are known
+class TiffWriter : public StripedImageWriter
+{
+public:
+
+    TiffWriter( const QString & fileName, const QSize & size )
+        : m_file( fileName )
+          , m_size( size )
+    { }
+
+    bool
+    open()
+    {
+        if ( ! m_file.open( QIODevice::WriteOnly ) ) {
+            return false;
+        }
+
+        // little endian, offset of the directory filled in by finish()
+        QByteArray header( "II" );
+        appendLE16( header, 42 );
+        appendLE32( header, 0 );
+        return m_file.write( header ) == header.size();
+    }
+
+    virtual bool
+    writeRows( const QImage & band ) override
+    {
+        if ( band.width() != m_size.width() || m_rows + band.height() > m_size.height() ) {
+            return false;
+        }
+        if ( m_rowsPerStrip == 0 ) {
+            m_rowsPerStrip = band.height();
+        }
+        else if ( m_shortStrip || band.height() > m_rowsPerStrip ) {
+            qWarning() << "Only the last strip of a TIFF can be shorter";
+            return false;
+        }
+        m_shortStrip = band.height() < m_rowsPerStrip;
+
+        const int rowBytes = 3 * m_size.width();
+        std::vector < char > raw( int64_t( rowBytes ) * band.height() );
+        for ( int y = 0 ; y < band.height() ; y++ ) {
+            packRgb( band, y, & raw[int64_t( y ) * rowBytes] );
+        }
+        uLongf compressedSize = compressBound( raw.size() );
+        std::vector < char > compressed( compressedSize );
+        if ( compress2( reinterpret_cast < Bytef * > ( compressed.data() ), & compressedSize,
+                        reinterpret_cast < const Bytef * > ( raw.data() ), raw.size(),
+                        Z_DEFAULT_COMPRESSION ) != Z_OK ) {
+            return false;
+        }
+
+        // offsets are 32 bit in (non big) TIFF
+        qint64 offset = m_file.pos();
+        if ( offset + qint64( compressedSize ) > qint64( 0xffffffffu ) ) {
+            qWarning() << "TIFF files can't be larger than 4GB";
+            return false;
+        }
+        if ( m_file.write( compressed.data(), compressedSize ) != qint64( compressedSize ) ) {
+            return false;
+        }
+        m_stripOffsets.push_back( offset );
+        m_stripSizes.push_back( compressedSize );
+        m_rows += band.height();
+        return true;
+    } // writeRows
+
+    virtual bool
+    finish() override
+    {
+        if ( m_rows != m_size.height() ) {
+            return false;
+        }
+
+        // the directory starts on a word boundary, the values that don't fit into
+        // the entries follow it
+        if ( m_file.pos() % 2 && m_file.write( "", 1 ) != 1 ) {
+            return false;
+        }
+        const int nEntries = 10;
+        const quint32 nStrips = m_stripOffsets.size();
+        const quint32 ifdOffset = m_file.pos();
+        const quint32 bitsOffset = ifdOffset + 2 + nEntries * 12 + 4;
+        const quint32 offsetsOffset = bitsOffset + 8;
+        const quint32 sizesOffset = offsetsOffset + 4 * nStrips;
+
+        QByteArray ifd;
+        auto entry = [&ifd] ( quint16 tag, quint16 type, quint32 count, quint32 value ) {
+            appendLE16( ifd, tag );
+            appendLE16( ifd, type );
+            appendLE32( ifd, count );
+            if ( type == Short && count == 1 ) {
+                appendLE16( ifd, value );
+                appendLE16( ifd, 0 );
+            }
+            else {
+                appendLE32( ifd, value );
+            }
+        };
+        appendLE16( ifd, nEntries );
+        entry( 256, Long, 1, m_size.width() ); // ImageWidth
+        entry( 257, Long, 1, m_size.height() ); // ImageLength
+        entry( 258, Short, 3, bitsOffset ); // BitsPerSample
+        entry( 259, Short, 1, 8 ); // Compression = deflate
+        entry( 262, Short, 1, 2 ); // PhotometricInterpretation = RGB
+        entry( 273, Long, nStrips, nStrips == 1 ? m_stripOffsets[0] : offsetsOffset ); // StripOffsets
+        entry( 277, Short, 1, 3 ); // SamplesPerPixel
+        entry( 278, Long, 1, m_rowsPerStrip ); // RowsPerStrip
+        entry( 279, Long, nStrips, nStrips == 1 ? m_stripSizes[0] : sizesOffset ); // StripByteCounts
+        entry( 284, Short, 1, 1 ); // PlanarConfiguration = contiguous
+        appendLE32( ifd, 0 );
+
+        for ( int i = 0 ; i < 3 ; i++ ) {
+            appendLE16( ifd, 8 );
+        }
+        appendLE16( ifd, 0 );
+        if ( nStrips > 1 ) {
+            for ( quint32 offset : m_stripOffsets ) {
+                appendLE32( ifd, offset );
+            }
+            for ( quint32 size : m_stripSizes ) {
+                appendLE32( ifd, size );
+            }
+        }
+
+        QByteArray header;
+        appendLE32( header, ifdOffset );
+        return m_file.write( ifd ) == ifd.size() &&
+               m_file.seek( 4 ) &&
+               m_file.write( header ) == 4 &&
+               m_file.flush();
+    } // finish
+
+private:
+
+    /// TIFF field types
+    enum : quint16 { Short = 3, Long = 4 };
+
+    QFile m_file;
+    QSize m_size;
+    int m_rows = 0;
+    int m_rowsPerStrip = 0;
+    bool m_shortStrip = false;
+    std::vector < quint32 > m_stripOffsets;
+    std::vector < quint32 > m_stripSizes;
+};
+}
+
+bool
+StripedImageWriter::isSupported( const QString & fileName )
+{
+    QString suffix = QFileInfo( fileName ).suffix().toLower();
+    return suffix == "png" || suffix == "tif" || suffix == "tiff";
+}
+
+StripedImageWriter::UniquePtr
+StripedImageWriter::create( const QString & fileName, const QSize & size )
+{
+    QString suffix = QFileInfo( fileName ).suffix().toLower();
+    if ( suffix == "png" ) {
+        std::unique_ptr < PngWriter > writer( new PngWriter( fileName, size ) );
+        if ( writer-> open() ) {
+            return std::move( writer );
+        }
+    }
+    else if ( suffix == "tif" || suffix == "tiff" ) {
+        std::unique_ptr < TiffWriter > writer( new TiffWriter( fileName, size ) );
+        if ( writer-> open() ) {
+            return std::move( writer );
+        }
+    }
+    return nullptr;
+}
+}
+}
+}
@@ -0,0 +1,53 @@
+/**
+ * Writes an image file a band of rows at a time, so that images much bigger than
+ * the available memory can be saved. Only PNG and TIFF are supported, picked by the
+ * suffix of the file name; both are written as 8 bit RGB, deflate compressed.
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace Carta{
+namespace Core{
+namespace ImageSaveService{
+
+class StripedImageWriter
+{
+    CLASS_BOILERPLATE( StripedImageWriter );
+
+public:
+
+    /// can images be written to this file a band at a time?
+    static bool
+    isSupported( const QString & fileName );
+
+    /// open the file for writing
+    /// \param fileName the file, its suffix determines the format
+    /// \param size the size of the whole image
+    /// \return nullptr if the format is not supported or the file can't be opened
+    static UniquePtr
+    create( const QString & fileName, const QSize & size );
+
+    /// append rows to the image
+    /// \param band the rows, as wide as the image; all bands but the last one must
+    /// have the same height
+    /// \return false if writing failed
+    virtual bool
+    writeRows( const QImage & band ) = 0;
+
+    /// complete the file, after all the rows were written
+    /// \return false if writing failed
+    virtual bool
+    finish() = 0;
+
+    virtual
+    ~StripedImageWriter() { }
+};
+}
+}
+}
@@ -7,6 +7,7 @@ TEMPLATE = lib
 ###CONFIG += staticlib
 QT += widgets network
 QT += xml
+QT += concurrent
 
 HEADERS += \
     IConnector.h \
@@ -15,6 +16,7 @@ HEADERS += \
     IView.h \
     MyQApp.h \
     CallbackList.h \
+    FunctionRunnable.h \
     PluginManager.h \
     Globals.h \
     Algorithms/Graphs/TopoSort.h \
@@ -43,8 +45,10 @@ HEADERS += \
     Data/Settings.h \
     Data/Image/Controller.h \
     Data/Image/CoordinateSystems.h \
+    Data/Image/CursorService.h \
     Data/Image/DataGrid.h \
     Data/Image/DataSource.h \
+    Data/Image/ImageLoadJob.h \
     Data/Image/Fonts.h \
     Data/Image/GridControls.h \
     Data/Image/ImageGridServiceSynchronizer.h \
@@ -73,6 +77,7 @@ HEADERS += \
     GrayColormap.h \
     ImageRenderService.h \
     ImageSaveService.h \
+    StripedImageWriter.h \
     Histogram/HistogramGenerator.h \
     Histogram/HistogramSelection.h \
     Histogram/HistogramPlot.h \
@@ -85,6 +90,7 @@ HEADERS += \
     ScriptedClient/TagMessage.h \
     ScriptedClient/JsonMessage.h \
     DefaultContourGeneratorService.h \
+    DefaultMomentGeneratorService.h \
     Hacks/HackViewer.h \
     Hacks/ImageViewController.h \
     Hacks/MainModel.h \
@@ -125,8 +131,10 @@ SOURCES += \
     Data/Colormap/TransformsImage.cpp \
     Data/Image/Controller.cpp \
     Data/Image/CoordinateSystems.cpp \
+    Data/Image/CursorService.cpp \
     Data/Image/DataGrid.cpp \
     Data/Image/DataSource.cpp \
+    Data/Image/ImageLoadJob.cpp \
     Data/Image/Fonts.cpp \
     Data/Image/GridControls.cpp \
     Data/Image/ImageGridServiceSynchronizer.cpp \
@@ -162,6 +170,7 @@ SOURCES += \
     ScriptedClient/ScriptFacade.cpp \
     ImageRenderService.cpp \
     ImageSaveService.cpp \
+    StripedImageWriter.cpp \
     Algorithms/quantileAlgorithms.cpp \
     ScriptedClient/Listener.cpp \
     ScriptedClient/ScriptedCommandInterpreter.cpp \
@@ -169,6 +178,7 @@ SOURCES += \
     ScriptedClient/TagMessage.cpp \
     ScriptedClient/JsonMessage.cpp \
     DefaultContourGeneratorService.cpp \
+    DefaultMomentGeneratorService.cpp \
     Hacks/HackViewer.cpp \
     Hacks/ImageViewController.cpp \
     Hacks/MainModel.cpp \
@@ -211,4 +221,7 @@ else {
 	LIBS +=-L../CartaLib -lCartaLib -L$$QWT_ROOT/lib -lqwt
 }
 
+# striped image export writes PNG and TIFF with zlib
+LIBS += -lz
+
 DEPENDPATH += $$PROJECT_ROOT/CartaLib
@@ -10,6 +10,7 @@
 #include "core/CmdLine.h"
 #include "core/MainConfig.h"
 #include "core/Globals.h"
+#include "CartaLib/CacheRegistry.h"
 #include <QDebug>
 
 namespace Carta
@@ -60,6 +61,9 @@ coreMainCPP( QString platformString, int argc, char * * argv )
     globals.setMainConfig( & mainConfig );
     qDebug() << "plugin directories:\n - " + mainConfig.pluginDirectories().join( "\n - " );
 
+    // all in-memory caches share one budget
+    Carta::Lib::CacheRegistry::instance().setBudget( mainConfig.cacheBudget() );
+
     // initialize plugin manager
     // =========================
     globals.setPluginManager( std::make_shared < PluginManager > () );
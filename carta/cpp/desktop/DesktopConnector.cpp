@@ -8,7 +8,6 @@
 #include "core/SimpleRemoteVGView.h"
 #include <iostream>
 #include <QImage>
-#include <QPainter>
 #include <QXmlInputSource>
 #include <cmath>
 #include <QTime>
@@ -39,6 +38,17 @@ struct DesktopConnector::ViewInfo
     /// refresh ID
     qint64 refreshId = -1;
 
+    /// size of the last full frame sent to the client, patches are only valid on top
+    /// of a full frame of the same size
+    QSize lastSentSize;
+
+    /// number of patches sent since the last full frame
+    int nPatches = 0;
+
+    /// after this many patches we send a full frame again, so that the client does not
+    /// accumulate too many patch elements
+    static constexpr int MaxPatches = 16;
+
     ViewInfo( IView * pview )
     {
         view = pview;
@@ -260,39 +270,32 @@ void DesktopConnector::refreshViewNow(IView *view)
         qCritical() << "refreshView cannot find this view: " << view-> name();
         return;
     }
-    // get the image from view
+    // get the image from view, together with the part of it that changed
     const QImage & origImage = view-> getBuffer();
-
-    QSize clientImageSize = viewInfo->clientSize;
-    if( origImage.size() != clientImageSize && clientImageSize.height() > 0 && clientImageSize.width() > 0 ) {
-        qDebug() << "Having to re-scale the image, this is slow" << origImage.size() << viewInfo->clientSize;
-        // scale the image to fit the client size, in case it wasn't scaled alerady
-        QImage destImage = origImage.scaled(
-                               viewInfo->clientSize, Qt::KeepAspectRatio,
-                               //                Qt::SmoothTransformation);
-                               Qt::FastTransformation);
-        // calculate the offset needed to center the image
-        int xOffset = (viewInfo-> clientSize.width() - destImage.size().width())/2;
-        int yOffset = (viewInfo-> clientSize.height() - destImage.size().height())/2;
-        QImage pix( viewInfo->clientSize, QImage::Format_ARGB32_Premultiplied);
-        pix.fill( qRgba( 0, 0, 0, 0));
-        QPainter p( & pix);
-        p.setCompositionMode( QPainter::CompositionMode_Source);
-        p.drawImage( xOffset, yOffset, destImage );
-
-        // remember the transformations we did to the image in the viewInfo so that we can
-        // properly translate mouse events etc
-        viewInfo-> tx = Carta::Lib::LinearMap1D( xOffset, xOffset + destImage.size().width()-1,
-                                     0, origImage.width()-1);
-        viewInfo-> ty = Carta::Lib::LinearMap1D( yOffset, yOffset + destImage.size().height()-1,
-                                     0, origImage.height()-1);
-
-        emit jsViewUpdatedSignal( view-> name(), pix, viewInfo-> refreshId);
+    QRect dirty = view-> takeDirtyRect();
+
+    // views render at the client size (see handleResizeRequest), so the buffer is sent
+    // as is; a frame rendered before the view caught up with a resize simply goes out
+    // as a full frame, and the view sends a correctly sized one once it's re-rendered
+    viewInfo-> tx = Carta::Lib::LinearMap1D( 0, 1, 0, 1);
+    viewInfo-> ty = Carta::Lib::LinearMap1D( 0, 1, 0, 1);
+
+    // if only a small part of the same sized image changed, send just that part
+    dirty = dirty.intersected( origImage.rect());
+    bool sendPatch = ! dirty.isEmpty()
+                     && viewInfo-> lastSentSize == origImage.size()
+                     && viewInfo-> nPatches < ViewInfo::MaxPatches
+                     && qint64( dirty.width()) * dirty.height() * 2
+                        < qint64( origImage.width()) * origImage.height();
+    if( sendPatch) {
+        viewInfo-> nPatches ++;
+        emit jsViewPatchedSignal( view-> name(), origImage.copy( dirty),
+                                  dirty.x(), dirty.y(), viewInfo-> refreshId);
     }
     else {
-        viewInfo-> tx = Carta::Lib::LinearMap1D( 0, 1, 0, 1);
-        viewInfo-> ty = Carta::Lib::LinearMap1D( 0, 1, 0, 1);
-
+        // QImage is implicitly shared, so this does not copy any pixels
+        viewInfo-> nPatches = 0;
+        viewInfo-> lastSentSize = origImage.size();
         emit jsViewUpdatedSignal( view-> name(), origImage, viewInfo-> refreshId);
     }
 }
@@ -73,6 +73,9 @@ signals:
     void jsCommandResultsSignal( const QString & results);
     /// emitted by c++ when we want javascript to repaint the view
     void jsViewUpdatedSignal( const QString & viewName, const QImage & img, qint64 id);
+    /// emitted by c++ when only a part of the view changed, img contains the changed
+    /// pixels and should be drawn at x,y over the last full image
+    void jsViewPatchedSignal( const QString & viewName, const QImage & img, int x, int y, qint64 id);
 
 public:
 
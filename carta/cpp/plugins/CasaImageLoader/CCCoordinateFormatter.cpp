@@ -6,6 +6,8 @@
 #include <casacore/coordinates/Coordinates.h>
 #include <casacore/measures/Measures/Stokes.h>
 #include <QDebug>
+#include <algorithm>
+#include <limits>
 
 #ifdef DONT_COMPILE
 #define CARTA_DEBUG_THIS_FILE 0
@@ -21,6 +23,22 @@
 /// shortcut to HtmlString
 typedef Carta::Lib::HtmlString HtmlString;
 
+/// casacore vector using the supplied memory, i.e. without copying
+static casa::Vector < casa::Double >
+sharedVector( const double * data, size_t size )
+{
+    return casa::Vector < casa::Double > ( casa::IPosition( 1, size ),
+                                           const_cast < double * > ( data ), casa::SHARE );
+}
+
+/// casacore matrix (nRows x nCols, column major) using the supplied memory
+static casa::Matrix < casa::Double >
+sharedMatrix( const double * data, int64_t nRows, int64_t nCols )
+{
+    return casa::Matrix < casa::Double > ( casa::IPosition( 2, nRows, nCols ),
+                                           const_cast < double * > ( data ), casa::SHARE );
+}
+
 class DoubleFormatter
 {
     CLASS_BOILERPLATE( DoubleFormatter );
@@ -190,23 +208,70 @@ bool
 CCCoordinateFormatter::toWorld( const CoordinateFormatterInterface::VD & pixel,
                                 CoordinateFormatterInterface::VD & world ) const
 {
-    Q_UNUSED( pixel );
-    Q_UNUSED( world );
-
-    qFatal( "not implemented" );
+    // convert straight into the caller's vectors, without temporaries
+    world.resize( m_casaCS->nWorldAxes() );
+    casa::Vector < casa::Double > worldD = sharedVector( world.data(), world.size() );
+    return m_casaCS->toWorld( worldD, sharedVector( pixel.data(), pixel.size() ) );
 }
 
 bool
 CCCoordinateFormatter::toPixel( const CoordinateFormatterInterface::VD & world,
                                 CoordinateFormatterInterface::VD & pixel ) const
 {
-    casa::Vector < casa::Double > worldD = world;
-    casa::Vector < casa::Double > pixelD = pixel;
-    bool valid = m_casaCS->toPixel( pixelD, worldD );
-    pixel = { pixelD[0], pixelD[1] };
+    pixel.resize( m_casaCS->nPixelAxes() );
+    casa::Vector < casa::Double > pixelD = sharedVector( pixel.data(), pixel.size() );
+    return m_casaCS->toPixel( pixelD, sharedVector( world.data(), world.size() ) );
+}
+
+bool
+CCCoordinateFormatter::toWorld( const double * pixel, double * world, int64_t n ) const
+{
+    // the batched interface uses nAxes() values for both pixel and world points
+    if ( m_casaCS->nWorldAxes() != m_casaCS->nPixelAxes() ) {
+        return CoordinateFormatterInterface::toWorld( pixel, world, n );
+    }
+    if ( n <= 0 ) {
+        return true;
+    }
+
+    // our layout (one point after another) is a column major nAxes x n matrix, so
+    // casacore can convert all points at once, straight into the output
+    casa::Matrix < casa::Double > worldM = sharedMatrix( world, nAxes(), n );
+    casa::Vector < casa::Bool > failures;
+    bool valid = m_casaCS->toWorldMany( worldM, sharedMatrix( pixel, nAxes(), n ), failures );
+    markFailures( world, n, failures );
+    return valid;
+}
+
+bool
+CCCoordinateFormatter::toPixel( const double * world, double * pixel, int64_t n ) const
+{
+    if ( m_casaCS->nWorldAxes() != m_casaCS->nPixelAxes() ) {
+        return CoordinateFormatterInterface::toPixel( world, pixel, n );
+    }
+    if ( n <= 0 ) {
+        return true;
+    }
+    casa::Matrix < casa::Double > pixelM = sharedMatrix( pixel, nAxes(), n );
+    casa::Vector < casa::Bool > failures;
+    bool valid = m_casaCS->toPixelMany( pixelM, sharedMatrix( world, nAxes(), n ), failures );
+    markFailures( pixel, n, failures );
     return valid;
 }
 
+void
+CCCoordinateFormatter::markFailures( double * points, int64_t n,
+                                     const casa::Vector < casa::Bool > & failures ) const
+{
+    const int nAx = nAxes();
+    for ( int64_t i = 0 ; i < n && i < int64_t( failures.nelements() ) ; i++ ) {
+        if ( failures[i] ) {
+            std::fill( points + i * nAx, points + ( i + 1 ) * nAx,
+                       std::numeric_limits < double >::quiet_NaN() );
+        }
+    }
+}
+
 void
 CCCoordinateFormatter::setTextOutputFormat( CoordinateFormatterInterface::TextFormat fmt )
 {
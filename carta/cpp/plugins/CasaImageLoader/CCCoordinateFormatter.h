@@ -44,6 +44,12 @@ public:
     virtual bool
     toPixel( const VD & world, VD & pixel ) const override;
 
+    virtual bool
+    toWorld( const double * pixel, double * world, int64_t n ) const override;
+
+    virtual bool
+    toPixel( const double * world, double * pixel, int64_t n ) const override;
+
     virtual void
     setTextOutputFormat( TextFormat fmt ) override;
 
@@ -94,4 +100,8 @@ protected:
     /// format a world value for the selected axis
     QString formatWorldValue( int whichAxis, double worldValue);
 
+    /// set the points that casacore could not convert to NaN
+    void markFailures( double * points, int64_t n,
+                       const casa::Vector < casa::Bool > & failures ) const;
+
 };
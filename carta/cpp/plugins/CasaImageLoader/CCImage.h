@@ -10,6 +10,7 @@
 #include "CCMetaDataInterface.h"
 #include "casacore/images/Images/ImageInterface.h"
 #include <QDebug>
+#include <QMutex>
 #include <memory>
 
 /// helper base class so that we can easily determine if this is a an image
@@ -37,6 +38,18 @@ public:
 
 //    virtual casa::ImageInterface<casa::Float> * getCasaIIfloat() = 0;
 
+    /// casacore images can't be read from several threads at once, so every read of
+    /// the underlying image, including reads through getCasaImage(), has to hold this
+    /// lock; it is recursive, so a reader can call back into the views of this image
+    QMutex &
+    casaMutex()
+    {
+        return m_casaMutex;
+    }
+
+protected:
+
+    QMutex m_casaMutex { QMutex::Recursive };
 
 };
 
@@ -130,6 +143,7 @@ public:
         img-> m_pixelType = Carta::Lib::Image::CType2PixelType < PType >::type;
         img-> m_dims      = casaImage-> shape().asStdVector();
         img-> m_casaII    = casaImage;
+        img-> m_tileCache.reset( new CCTileCache < PType > ( casaImage ) );
         img-> m_unit      = Carta::Lib::Unit( casaImage-> units().getName().c_str() );
 
         // get title and escape html characters in case there are any
@@ -194,6 +208,9 @@ protected:
     /// pointer to the actual casa::ImageInterface
     casa::ImageInterface < PType > * m_casaII;
 
+    /// tiles of m_casaII for random access to pixels
+    std::unique_ptr < CCTileCache < PType > > m_tileCache;
+
     /// cached unit
     Carta::Lib::Unit m_unit;
 
@@ -208,3 +225,8 @@ protected:
 /// helper to convert carta's image to casacore image interface
 casa::ImageInterface<casa::Float> *
 cartaII2casaII_float( std::shared_ptr<Carta::Lib::Image::ImageInterface> ii) ;
+
+/// helper to find the lock guarding the casacore image behind carta's image
+/// \return the lock, or nullptr if the image was not created by this plugin
+QMutex *
+cartaII2casaMutex( std::shared_ptr<Carta::Lib::Image::ImageInterface> ii) ;
@@ -8,6 +8,7 @@
 #include <casacore/coordinates/Coordinates/DirectionCoordinate.h>
 #include <casacore/coordinates/Coordinates/SpectralCoordinate.h>
 #include <casacore/coordinates/Coordinates/StokesCoordinate.h>
+#include <cmath>
 
 CCMetaDataInterface::CCMetaDataInterface( QString htmlTitle,
                                           std::shared_ptr < casa::CoordinateSystem > casaCS )
@@ -56,9 +57,12 @@ class CCCoordSystemConverter : public Carta::Lib::Regions::ICoordSystemConverter
 {
 public:
 
+    // the formatter gets a copy of the coordinate system, so that nothing done to the
+    // image's coordinate system (e.g. changing the sky system) affects the conversions
     CCCoordSystemConverter( std::shared_ptr < casa::CoordinateSystem > casaCS )
+        : m_casaCS( std::make_shared < casa::CoordinateSystem > ( * casaCS ) )
+          , m_formatter( m_casaCS )
     {
-        m_casaCS = casaCS;
 
         // source coordinate system will be a pixel CS
         m_srcCS = Carta::Lib::Regions::CompositeCoordinateSystem( m_casaCS-> nPixelAxes() );
@@ -99,6 +103,7 @@ public:
             }
 
             if ( subcs.type() == casa::Coordinate::Type::DIRECTION ) {
+                m_skyAxes.push_back( i );
                 const casa::DirectionCoordinate & dirc = m_casaCS-> directionCoordinate();
                 if ( dirc.directionType() == casa::MDirection::Types::J2000 ) {
                     m_dstCS.setAxis( i,
@@ -151,24 +156,47 @@ public:
         }
     }
 
+    // pixel <-> world conversions are done by the formatter, world coordinates are in
+    // degrees for the sky axes, and in casacore's native units (e.g. Hz) for the others
+
     virtual bool
     src2dst( const Carta::Lib::Regions::PointN & pt,
              Carta::Lib::Regions::PointN & result ) override
     {
-        /// \todo implement
-        Q_UNUSED( pt );
-        Q_UNUSED( result );
-        return false;
+        bool valid = m_formatter.toWorld( pt, result );
+        scaleSkyAxes( result.data(), 1, 180 / M_PI );
+        return valid;
     }
 
     virtual bool
     dst2src( const Carta::Lib::Regions::PointN & pt,
              Carta::Lib::Regions::PointN & result ) override
     {
-        /// \todo implement
-        Q_UNUSED( pt );
-        Q_UNUSED( result );
-        return false;
+        Carta::Lib::Regions::PointN world = pt;
+        scaleSkyAxes( world.data(), 1, M_PI / 180 );
+        return m_formatter.toPixel( world, result );
+    }
+
+    virtual bool
+    src2dst( const double * pts, double * result, int64_t n ) override
+    {
+        if ( m_srcCS.ndim() != m_dstCS.ndim() ) {
+            return ICoordSystemConverter::src2dst( pts, result, n );
+        }
+        bool valid = m_formatter.toWorld( pts, result, n );
+        scaleSkyAxes( result, n, 180 / M_PI );
+        return valid;
+    }
+
+    virtual bool
+    dst2src( const double * pts, double * result, int64_t n ) override
+    {
+        if ( m_srcCS.ndim() != m_dstCS.ndim() ) {
+            return ICoordSystemConverter::dst2src( pts, result, n );
+        }
+        std::vector < double > world( pts, pts + n * m_dstCS.ndim() );
+        scaleSkyAxes( world.data(), n, M_PI / 180 );
+        return m_formatter.toPixel( world.data(), result, n );
     }
 
     virtual const Carta::Lib::Regions::CompositeCoordinateSystem &
@@ -185,8 +213,24 @@ public:
 
 private:
 
+    /// multiply the sky axes of n world points by factor (radians <-> degrees)
+    void
+    scaleSkyAxes( double * world, int64_t n, double factor ) const
+    {
+        const int nWorld = m_dstCS.ndim();
+        for ( int64_t i = 0 ; i < n ; i++ ) {
+            for ( int axis : m_skyAxes ) {
+                world[i * nWorld + axis] *= factor;
+            }
+        }
+    }
+
     std::shared_ptr < casa::CoordinateSystem > m_casaCS;
+    CCCoordinateFormatter m_formatter;
     Carta::Lib::Regions::CompositeCoordinateSystem m_srcCS, m_dstCS;
+
+    /// world axes of the sky coordinate
+    std::vector < int > m_skyAxes;
 };
 
 Carta::Lib::Regions::ICoordSystemConverter::SharedPtr
@@ -195,3 +239,9 @@ CCMetaDataInterface::getCSConv()
     /// \todo cache this, insteady of creating a new one every time
     return std::make_shared < CCCoordSystemConverter > ( m_casaCS );
 }
+
+std::shared_ptr < const casa::CoordinateSystem >
+CCMetaDataInterface::getCoordinateSystem() const
+{
+    return m_casaCS;
+}
@@ -37,6 +37,11 @@ public:
 
     virtual Carta::Lib::Regions::ICoordSystemConverter::SharedPtr getCSConv() override;
 
+    /// the casacore coordinate system, e.g. to make a fits header for images (like moment
+    /// maps or derived images) that share these meta data but are not casacore images
+    std::shared_ptr < const casa::CoordinateSystem >
+    getCoordinateSystem() const;
+
 protected:
 
     Carta::Lib::HtmlString m_title;
@@ -5,9 +5,11 @@
 #pragma once
 
 #include "CartaLib/IImage.h"
+#include "CCTileCache.h"
 #include <casacore/lattices/Lattices/LatticeStepper.h>
 #include <casacore/lattices/Lattices/LatticeIterator.h>
 #include <casacore/casa/Arrays/IPosition.h>
+#include <QMutex>
 
 template < typename PType >
 class CCImage;
@@ -128,6 +130,9 @@ protected:
 
     // minicache to make get() a little bit faster
     VI m_destPos;
+
+    // the tile used by the last get(), consecutive calls usually hit the same tile
+    typename CCTileCache < PType >::TilePtr m_lastTile;
 };
 
 // public constructor
@@ -195,11 +200,24 @@ CCRawView < PType >::get( const Carta::Lib::NdArray::RawViewInterface::VI & pos
                        + p * m_appliedSlice.dims()[i].step;
     }
 
-    // casa::ImageInterface::operator() returns the result by value
-    // so in order to return reference (to satisfy our API) we need to store this
-    // in a buffer first...
-    m_buff = m_ccimage-> m_casaII->
-                 operator() ( m_destPos );
+    // serve the pixel from the tile cache, reading a whole tile is much cheaper
+    // than going through casacore's per-element access for every pixel
+    if ( m_lastTile && m_lastTile-> contains( m_destPos ) ) {
+        m_buff = m_lastTile-> at( m_destPos );
+        return reinterpret_cast < const char * > ( & m_buff );
+    }
+    QMutexLocker locker( & m_ccimage-> casaMutex() );
+    m_lastTile = m_ccimage-> m_tileCache-> tile( m_destPos );
+    if ( m_lastTile ) {
+        m_buff = m_lastTile-> at( m_destPos );
+    }
+    else {
+        // casa::ImageInterface::operator() returns the result by value
+        // so in order to return reference (to satisfy our API) we need to store this
+        // in a buffer first...
+        m_buff = m_ccimage-> m_casaII->
+                     operator() ( m_destPos );
+    }
 
     return reinterpret_cast < const char * > ( & m_buff );
 } // get
@@ -219,12 +237,22 @@ CCRawView < PType >::forEach(
 
 //    qDebug() << "CCRawView::forEach=" << m_appliedSlice.toStr()  ;
 
-    /// \todo I guessed wrong as to what the cursor shape meant when using subSection()
-    /// \todo the shape refers to the shape within the subsection... so there is no need
-    /// \todo to specify cursor shape to be the whole image, it should instead be
-    /// \todo the shape of the subsection... e.g. [3:7:2,5:6] only needs a cursor
-    /// of size 2x1(x1x1x1....x1) regardless of the image size...
-    auto cursorShape = imageShape;
+    // the cursor shape refers to the shape within the subsection; we stream through
+    // the subsection in chunks, so that big slices (e.g. entire cubes) are never held
+    // in memory at once. Chunks span the whole subsection along all the faster axes,
+    // so the pixels come out in the same order as with a single cursor.
+    const int64_t maxChunkPixels = 1024 * 1024;
+    casa::IPosition cursorShape( imgDims, 1 );
+    int64_t chunkPixels = 1;
+    for ( int i = 0 ; i < imgDims ; i++ ) {
+        int64_t count = m_appliedSlice.dims()[i].count;
+        if ( chunkPixels * count > maxChunkPixels ) {
+            cursorShape( i ) = std::max < int64_t > ( maxChunkPixels / chunkPixels, 1 );
+            break;
+        }
+        cursorShape( i ) = count;
+        chunkPixels *= count;
+    }
     casa::LatticeStepper stepper( imageShape, cursorShape, casa::LatticeStepper::RESIZE );
     casa::IPosition blc( imgDims, 0 );
     auto trc = blc;
@@ -236,20 +264,21 @@ CCRawView < PType >::forEach(
         inc( i ) = slice1d.step;
     }
     stepper.subSection( blc, trc, inc );
-    casa::RO_LatticeIterator < PType > iterator( * casaII, stepper );
 
-    bool first = true;
+    // the casacore image can't be read by several threads at once, but we only hold
+    // the lock while reading a chunk, so that other readers (e.g. the cursor) get
+    // their turn while we are streaming
+    std::vector < PType > chunk;
+    QMutexLocker locker( & m_ccimage-> casaMutex() );
+    casa::RO_LatticeIterator < PType > iterator( * casaII, stepper );
     for ( iterator.reset() ; ! iterator.atEnd() ; iterator++ ) {
-        if ( ! first ) {
-            // sanity check for now, to make sure I understand casa cursors
-            // if this works, the outer loop is not necessary...
-            qFatal( "something went wrong" );
-        }
         const auto & cursor = iterator.cursor();
-        for ( const auto & val : cursor ) {
+        chunk.assign( cursor.begin(), cursor.end() );
+        locker.unlock();
+        for ( const auto & val : chunk ) {
             func( reinterpret_cast < const char * > ( & val ) );
         }
-        first = false;
+        locker.relock();
     }
 } // forEach
 
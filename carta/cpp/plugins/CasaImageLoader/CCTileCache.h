@@ -0,0 +1,141 @@
+/**
+ *
+ **/
+
+#pragma once
+
+#include "CartaLib/CacheRegistry.h"
+#include <casacore/images/Images/ImageInterface.h>
+#include <casacore/casa/Arrays/IPosition.h>
+#include <QDebug>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/// Cache of aligned tiles of a casacore image, used for random access to pixels.
+///
+/// Reading a single pixel through casa::ImageInterface::operator() goes through the
+/// lattice machinery for every call, which is very slow when many pixels are read one
+/// by one (e.g. profile extraction, cursor probing). Instead we read the whole tile
+/// containing the pixel with getSlice() and serve subsequent reads from memory.
+///
+/// Tiles are small on the two spatial axes and long on the others (e.g. 32x32xN), so
+/// that both cursor probing and spectral profiles read only a few kB per tile. We don't
+/// use casacore's preferred cursor shape, for FITS images that is whole rows or planes.
+/// The cache registers with the CacheRegistry.
+///
+/// \warning tile() reads the casacore image, so the caller has to hold the image's lock
+/// (CCImageBase::casaMutex())
+template < typename PType >
+class CCTileCache
+{
+    CLASS_BOILERPLATE( CCTileCache );
+
+public:
+
+    /// a tile of pixels, first axis varies fastest
+    struct Tile {
+        casa::IPosition blc, shape;
+        std::vector < PType > data;
+
+        /// is the position inside this tile
+        bool
+        contains( const std::vector < int > & pos ) const
+        {
+            for ( size_t i = 0 ; i < pos.size() ; i++ ) {
+                if ( pos[i] < blc( i ) || pos[i] >= blc( i ) + shape( i ) ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// value at the position, which must be inside this tile
+        const PType &
+        at( const std::vector < int > & pos ) const
+        {
+            int64_t offset = 0, stride = 1;
+            for ( size_t i = 0 ; i < pos.size() ; i++ ) {
+                offset += ( pos[i] - blc( i ) ) * stride;
+                stride *= shape( i );
+            }
+            return data[offset];
+        }
+    };
+
+    typedef std::shared_ptr < const Tile > TilePtr;
+
+    /// \param casaII the image to read, it has to outlive this cache
+    /// \param maxBytes how much memory this cache can use at most
+    CCTileCache( casa::ImageInterface < PType > * casaII, int64_t maxBytes = 4 * 1024 * 1024 )
+        : m_casaII( casaII )
+          , m_cache( "casacore tiles", maxBytes )
+    {
+        m_imageShape = m_casaII-> shape();
+
+        // a handful of tiles need to fit in the cache, otherwise we'd thrash
+        int64_t maxPixels = std::max < int64_t > ( maxBytes / sizeof( PType ) / 8, 1 );
+        m_tileShape = casa::IPosition( m_imageShape.size(), 1 );
+        int64_t tilePixels = 1;
+        for ( size_t i = 0 ; i < m_imageShape.size() ; i++ ) {
+            int64_t extent = i < 2 ? MaxSpatialExtent : maxPixels / tilePixels;
+            m_tileShape( i ) = std::max < int64_t > ( std::min < int64_t > ( extent, m_imageShape( i ) ), 1 );
+            tilePixels *= m_tileShape( i );
+        }
+
+        // strides of the grid of tiles, used to compute the cache key
+        m_gridStrides.resize( m_imageShape.size() );
+        int64_t stride = 1;
+        for ( size_t i = 0 ; i < m_imageShape.size() ; i++ ) {
+            m_gridStrides[i] = stride;
+            stride *= ( m_imageShape( i ) + m_tileShape( i ) - 1 ) / m_tileShape( i );
+        }
+    }
+
+    /// return the tile containing the given position
+    /// \return the tile, or nullptr if the tile could not be read
+    TilePtr
+    tile( const std::vector < int > & pos )
+    {
+        int64_t key = 0;
+        for ( size_t i = 0 ; i < pos.size() ; i++ ) {
+            key += ( pos[i] / m_tileShape( i ) ) * m_gridStrides[i];
+        }
+
+        TilePtr result;
+        if ( m_cache.find( key, result ) ) {
+            return result;
+        }
+
+        auto tile = std::make_shared < Tile > ();
+        tile-> blc = casa::IPosition( pos.size() );
+        tile-> shape = casa::IPosition( pos.size() );
+        for ( size_t i = 0 ; i < pos.size() ; i++ ) {
+            tile-> blc( i ) = ( pos[i] / m_tileShape( i ) ) * m_tileShape( i );
+            tile-> shape( i ) = std::min < int64_t > ( m_tileShape( i ),
+                                                       m_imageShape( i ) - tile-> blc( i ) );
+        }
+        try {
+            casa::Array < PType > arr = m_casaII-> getSlice( tile-> blc, tile-> shape );
+            tile-> data.assign( arr.begin(), arr.end() );
+        }
+        catch ( const casa::AipsError & err ) {
+            qWarning() << "Could not read tile:" << err.getMesg().c_str();
+            return nullptr;
+        }
+
+        result = tile;
+        m_cache.insert( key, result, tile-> data.size() * sizeof( PType ) );
+        return result;
+    } // tile
+
+private:
+
+    /// the most pixels a tile spans along each of the spatial axes
+    static constexpr int64_t MaxSpatialExtent = 32;
+
+    casa::ImageInterface < PType > * m_casaII;
+    casa::IPosition m_imageShape, m_tileShape;
+    std::vector < int64_t > m_gridStrides;
+    Carta::Lib::LruCache < int64_t, TilePtr > m_cache;
+};
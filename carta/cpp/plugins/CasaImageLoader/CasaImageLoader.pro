@@ -19,6 +19,7 @@ HEADERS += \
     CCImage.h \
     CCMetaDataInterface.h \
     CCRawView.h \
+    CCTileCache.h \
     CCCoordinateFormatter.h
 
 casacoreLIBS += -L$${CASACOREDIR}/lib
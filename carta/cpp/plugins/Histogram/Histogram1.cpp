@@ -3,8 +3,13 @@
 #include "ImageHistogram.h"
 #include "CartaLib/Hooks/LoadAstroImage.h"
 #include "CartaLib/Hooks/Initialize.h"
+#include "CartaLib/PlaneCache.h"
+#include "CartaLib/SpectralAxis.h"
 #include <casacore/coordinates/Coordinates/SpectralCoordinate.h>
 #include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 Histogram1::Histogram1( QObject * parent ) :
     QObject( parent )
@@ -32,6 +37,108 @@ Histogram1::_computeHistogram()
     return result;
 } // _computeHistogram
 
+Carta::Lib::Hooks::HistogramResult
+Histogram1::_computeGenericHistogram( Carta::Lib::Image::ImageInterface & image,
+                                      const Carta::Lib::Hooks::HistogramHook::Params & params ) const
+{
+    namespace SpectralAxis = Carta::Lib::SpectralAxis;
+    const auto & dims = image.dims();
+
+    // the histogram is accumulated one plane at a time, the planes being the channels
+    // if there is a spectral axis
+    int specAxis = SpectralAxis::find( image );
+    int planeAxis = specAxis >= 0 ? specAxis : ( dims.size() > 2 ? 2 : - 1 );
+    int nPlanes = planeAxis >= 0 ? dims[planeAxis] : 1;
+    int minPlane = 0;
+    int maxPlane = nPlanes - 1;
+    QString specUnit;
+    std::vector < double > spec = SpectralAxis::channelValues( image, specAxis, & specUnit );
+    if ( specAxis >= 0 ) {
+        if ( params.minFrequency >= 0 && params.maxFrequency >= 0 ) {
+            if ( ! SpectralAxis::channelRange( spec, specUnit, params.minFrequency, params.maxFrequency,
+                                               params.rangeUnits, & minPlane, & maxPlane ) ) {
+                qWarning() << "Histogram: cannot convert" << params.rangeUnits << "to" << specUnit;
+            }
+        }
+        else if ( params.minChannel >= 0 && params.maxChannel >= 0 ) {
+            minPlane = std::max( 0, params.minChannel );
+            maxPlane = std::min( nPlanes - 1, params.maxChannel );
+        }
+    }
+
+    // same convention as ImageHistogram: -1 for both means all intensities
+    bool allIntensities = params.minIntensity == - 1 && params.maxIntensity == - 1;
+    double minValue = params.minIntensity;
+    double maxValue = params.maxIntensity;
+
+    auto readPlane = [&] ( int plane, std::vector < float > & data ) -> bool {
+        SliceND slice;
+        if ( planeAxis >= 0 ) {
+            slice.slice( planeAxis ).index( plane );
+        }
+        if ( ! Carta::Lib::PlaneCache::instance().readSlice( image, slice, data ) ) {
+            qWarning() << "Histogram: could not read plane" << plane;
+            return false;
+        }
+        return true;
+    };
+
+    std::vector < float > data;
+    if ( allIntensities ) {
+        minValue = std::numeric_limits < double >::infinity();
+        maxValue = - minValue;
+        for ( int plane = minPlane ; plane <= maxPlane ; plane++ ) {
+            if ( ! readPlane( plane, data ) ) {
+                return Carta::Lib::Hooks::HistogramResult();
+            }
+            for ( float val : data ) {
+                if ( std::isfinite( val ) ) {
+                    minValue = std::min < double > ( minValue, val );
+                    maxValue = std::max < double > ( maxValue, val );
+                }
+            }
+        }
+    }
+
+    std::vector < std::pair < double, double > > bins;
+    int binCount = std::max( 1, params.binCount );
+    if ( minValue <= maxValue ) {
+        double width = ( maxValue - minValue ) / binCount;
+        std::vector < double > counts( binCount, 0 );
+        for ( int plane = minPlane ; plane <= maxPlane ; plane++ ) {
+            if ( ! readPlane( plane, data ) ) {
+                return Carta::Lib::Hooks::HistogramResult();
+            }
+            for ( float val : data ) {
+                if ( ! ( val >= minValue && val <= maxValue ) ) {
+                    continue;
+                }
+                int bin = width > 0 ? int( ( val - minValue ) / width ) : 0;
+                counts[std::min( bin, binCount - 1 )] += 1;
+            }
+        }
+        for ( int bin = 0 ; bin < binCount ; bin++ ) {
+            bins.push_back( std::make_pair( minValue + ( bin + 0.5 ) * width, counts[bin] ) );
+        }
+    }
+
+    auto meta = image.metaData();
+    Carta::Lib::Hooks::HistogramResult result( meta ? meta-> title() : QString(),
+                                               image.getPixelUnit().toStr(), bins );
+
+    // frequencies of the channels used, in the requested units
+    double from = SpectralAxis::hzPerUnit( specUnit );
+    double to = SpectralAxis::hzPerUnit( params.rangeUnits );
+    if ( specAxis >= 0 && from > 0 && to > 0 && minPlane <= maxPlane ) {
+        auto range = std::minmax( spec[minPlane], spec[maxPlane] );
+        result.setFrequencyBounds( range.first * from / to, range.second * from / to );
+    }
+    else {
+        result.setFrequencyBounds( - 1, - 1 );
+    }
+    return result;
+} // _computeGenericHistogram
+
 std::pair < int, int >
 Histogram1::_getChannelBounds( double freqMin, double freqMax, const QString & unitStr ) const
 {
@@ -174,17 +281,22 @@ Histogram1::handleHook( BaseHook & hookData )
             = static_cast < Carta::Lib::Hooks::HistogramHook & > ( hookData );
 
         const auto & images = hook.paramsPtr-> dataSource;
-        qWarning() << "images[0]" << images[0].get();
         if ( images.size() == 0 ) {
             return false;
         }
+        QMutexLocker locker( & m_mutex );
 
         auto casaImage = cartaII2casaII_float( images.front());
         if( ! casaImage) {
-            qWarning() << "Histogram plugin: not an image created by casaimageloader...";
-            return false;
+            // e.g. moment maps and derived images
+            hook.result = _computeGenericHistogram( * images.front(), * hook.paramsPtr );
+            return true;
         }
 
+        // the casacore image is shared with other threads (e.g. the cursor, movie
+        // frames), and casacore can't be read from several of them at once
+        QMutexLocker casaLocker( cartaII2casaMutex( images.front() ) );
+
         m_histogram.reset( new ImageHistogram < casa::Float >  );
         m_histogram-> setImage( casaImage );
         m_histogram-> setBinCount( hook.paramsPtr->binCount );
@@ -1,11 +1,14 @@
-/// Plugin for generating histograms from casa images.
+/// Plugin for generating histograms from casa images, and from any other image
+/// by reading its pixels through the generic image interface.
 
 #pragma once
 
 #include "plugins/CasaImageLoader/CCImage.h"
+#include "CartaLib/Hooks/Histogram.h"
 #include "CartaLib/Hooks/HistogramResult.h"
 #include "CartaLib/IPlugin.h"
 #include "ImageHistogram.h"
+#include <QMutex>
 #include <QObject>
 #include <vector>
 
@@ -36,6 +39,17 @@ private:
     Carta::Lib::Hooks::HistogramResult
     _computeHistogram( );
 
+    /**
+     * Returns the histogram of an image that is not a casacore image (e.g. a moment map
+     * or a derived image), computed from the pixels of its raw views.
+     * @param image the image.
+     * @param params the bin count, channel and intensity ranges.
+     * @returns the histogram, including the frequency bounds of the channels used.
+     */
+    Carta::Lib::Hooks::HistogramResult
+    _computeGenericHistogram( Carta::Lib::Image::ImageInterface & image,
+                              const Carta::Lib::Hooks::HistogramHook::Params & params ) const;
+
     /**
      * Returns channel range for the given frequency bounds.
      */
@@ -54,4 +68,7 @@ private:
     /// Current histogram image
     std::shared_ptr<Carta::Lib::Image::ImageInterface> m_cartaImage = nullptr;
 
+    /// Histograms are computed on worker threads, one at a time because of the members above.
+    QMutex m_mutex;
+
 };
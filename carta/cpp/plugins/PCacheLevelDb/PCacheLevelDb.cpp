@@ -0,0 +1,461 @@
+#include "PCacheLevelDb.h"
+#include "CartaLib/Hooks/GetPersistantCache.h"
+#include "leveldb/db.h"
+#include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/write_batch.h"
+#include <QDebug>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+
+typedef Carta::Lib::Hooks::GetPersistantCache GetPersistantCacheHook;
+
+namespace
+{
+void
+appendBE64( QByteArray & buff, uint64_t val )
+{
+    for ( int shift = 56 ; shift >= 0 ; shift -= 8 ) {
+        buff.append( char ( val >> shift ) );
+    }
+}
+
+uint64_t
+readBE64( const char * ptr )
+{
+    uint64_t val = 0;
+    for ( int i = 0 ; i < 8 ; i++ ) {
+        val = ( val << 8 ) | uint8_t( ptr[i] );
+    }
+    return val;
+}
+
+leveldb::Slice
+slice( const QByteArray & ba )
+{
+    return leveldb::Slice( ba.constData(), ba.size() );
+}
+}
+
+///
+/// Implementation of IPCache using LevelDB
+///
+/// Every entry is stored as a few records, distinguished by the first byte of
+/// their keys:
+///  - 'v' + key : the value, a flag byte (1 = compressed) followed by the data
+///  - 'i' + key : priority, sequence number and size of the entry
+///  - 'p' + priority + sequence number : the key, in the order entries are evicted,
+///    i.e. lowest priority first, oldest first for equal priorities
+///  - 's' : number of entries, their total size and the next sequence number
+///
+/// Writes are collected in a batch that is written once it's big enough (and when
+/// the cache is destroyed), reads see the batched writes. Once the entries use more
+/// than maxStorage() bytes, the ones with the lowest priority are removed until they
+/// use 10% less. The disk space is given back by leveldb's background compaction, so
+/// evicting never blocks the users of the cache on a compaction.
+///
+class LevelDbPCache : public Carta::Lib::IPCache
+{
+public:
+
+    virtual uint64_t
+    maxStorage() override
+    {
+        return m_maxStorage;
+    }
+
+    virtual uint64_t
+    usedStorage() override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_stats.bytes;
+    }
+
+    virtual uint64_t
+    nEntries() override
+    {
+        QMutexLocker locker( & m_mutex );
+        return m_stats.entries;
+    }
+
+    virtual void
+    deleteAll() override
+    {
+        QMutexLocker locker( & m_mutex );
+        if ( ! m_db ) {
+            return;
+        }
+        m_batch.Clear();
+        m_pending.clear();
+        m_pendingBytes = 0;
+
+        std::unique_ptr < leveldb::Iterator > it( m_db-> NewIterator( leveldb::ReadOptions() ) );
+        for ( it-> SeekToFirst() ; it-> Valid() ; it-> Next() ) {
+            m_batch.Delete( it-> key() );
+        }
+        m_stats = Stats();
+        p_flush();
+        m_db-> CompactRange( nullptr, nullptr );
+    } // deleteAll
+
+    virtual bool
+    readEntry( const QByteArray & key, QByteArray & val ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        if ( ! m_db ) {
+            return false;
+        }
+        auto pending = m_pending.constFind( key );
+        if ( pending != m_pending.constEnd() ) {
+            return p_decode( pending-> stored, val );
+        }
+        std::string stored;
+        if ( ! m_db-> Get( leveldb::ReadOptions(), slice( 'v' + key ), & stored ).ok() ) {
+            return false;
+        }
+        return p_decode( QByteArray::fromRawData( stored.data(), stored.size() ), val );
+    } // readEntry
+
+    virtual void
+    setEntry( const QByteArray & key, const QByteArray & val, int64_t priority ) override
+    {
+        QMutexLocker locker( & m_mutex );
+        if ( ! m_db ) {
+            return;
+        }
+
+        // compress the value, unless that doesn't make it any smaller
+        QByteArray stored;
+        if ( m_compress ) {
+            stored = qCompress( val, 1 );
+        }
+        if ( stored.isEmpty() || stored.size() >= val.size() ) {
+            stored = char ( 0 ) + val;
+        }
+        else {
+            stored.prepend( char ( 1 ) );
+        }
+
+        // replace the previous version of the entry
+        Info old;
+        if ( p_info( key, old ) ) {
+            m_batch.Delete( slice( p_orderKey( old ) ) );
+            m_stats.bytes -= old.size;
+        }
+        else {
+            m_stats.entries++;
+        }
+        Info info;
+        info.priority = priority;
+        info.sequence = m_stats.sequence++;
+        info.size = key.size() + stored.size();
+        m_stats.bytes += info.size;
+
+        m_batch.Put( slice( 'v' + key ), slice( stored ) );
+        m_batch.Put( slice( 'i' + key ), slice( p_encode( info ) ) );
+        m_batch.Put( slice( p_orderKey( info ) ), slice( key ) );
+        m_pending.insert( key, Pending { info, stored } );
+        m_pendingBytes += info.size;
+
+        if ( m_pendingBytes >= m_batchBytes ) {
+            p_flush();
+        }
+    } // setEntry
+
+    virtual void
+    flush() override
+    {
+        QMutexLocker locker( & m_mutex );
+        if ( m_db && ! m_pending.isEmpty() ) {
+            p_flush();
+        }
+    }
+
+    static
+    Carta::Lib::IPCache::SharedPtr
+    getCacheSingleton( QString dirPath, uint64_t maxStorage, int64_t batchBytes, bool compress )
+    {
+        if ( m_cachePtr ) {
+            qCritical() << "PCacheLevelDbPlugin::Calling GetPersistantCacheHook multiple times!!!";
+        }
+        else {
+            LevelDbPCache * cache = new LevelDbPCache( dirPath, maxStorage, batchBytes, compress );
+            if ( cache-> m_db ) {
+                m_cachePtr.reset( cache );
+            }
+            else {
+                delete cache;
+            }
+        }
+        return m_cachePtr;
+    }
+
+    ~LevelDbPCache()
+    {
+        if ( m_db ) {
+            p_flush();
+        }
+
+        // the database uses the cache and the filter, so it has to go first
+        m_db.reset();
+        delete m_options.block_cache;
+        delete m_options.filter_policy;
+    }
+
+private:
+
+    /// bookkeeping for one entry
+    struct Info {
+        int64_t priority = 0;
+        uint64_t sequence = 0;
+        uint64_t size = 0;
+    };
+
+    /// bookkeeping for the whole cache
+    struct Stats {
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+        uint64_t sequence = 0;
+    };
+
+    /// a write that is still in the batch
+    struct Pending {
+        Info info;
+        QByteArray stored;
+    };
+
+    LevelDbPCache( QString dirPath, uint64_t maxStorage, int64_t batchBytes, bool compress )
+    {
+        m_maxStorage = maxStorage;
+        m_batchBytes = batchBytes;
+        m_compress = compress;
+
+        // the values are compressed already, the bloom filter avoids disk reads when
+        // looking up the previous version of new entries
+        m_options.create_if_missing = true;
+        m_options.compression = leveldb::kNoCompression;
+        m_options.filter_policy = leveldb::NewBloomFilterPolicy( 10 );
+        m_options.block_cache = leveldb::NewLRUCache( 64 * 1024 * 1024 );
+        m_options.write_buffer_size = 16 * 1024 * 1024;
+
+        QString fname = dirPath + "/pcache.leveldb";
+        leveldb::DB * db = nullptr;
+        leveldb::Status status = leveldb::DB::Open( m_options, fname.toStdString(), & db );
+        if ( ! status.ok() ) {
+            qCritical() << "Could not open leveldb database";
+            qCritical() << "  - at location:" + fname;
+            qCritical() << "  -" << status.ToString().c_str();
+            return;
+        }
+        m_db.reset( db );
+
+        std::string stats;
+        if ( m_db-> Get( leveldb::ReadOptions(), "s", & stats ).ok() && stats.size() == 24 ) {
+            m_stats.entries = readBE64( stats.data() );
+            m_stats.bytes = readBE64( stats.data() + 8 );
+            m_stats.sequence = readBE64( stats.data() + 16 );
+        }
+    }
+
+    /// the bookkeeping of an existing entry, if there is one
+    bool
+    p_info( const QByteArray & key, Info & info )
+    {
+        auto pending = m_pending.constFind( key );
+        if ( pending != m_pending.constEnd() ) {
+            info = pending-> info;
+            return true;
+        }
+        std::string encoded;
+        if ( ! m_db-> Get( leveldb::ReadOptions(), slice( 'i' + key ), & encoded ).ok() ||
+             encoded.size() != 24 ) {
+            return false;
+        }
+        info.priority = readBE64( encoded.data() );
+        info.sequence = readBE64( encoded.data() + 8 );
+        info.size = readBE64( encoded.data() + 16 );
+        return true;
+    }
+
+    static QByteArray
+    p_encode( const Info & info )
+    {
+        QByteArray encoded;
+        appendBE64( encoded, info.priority );
+        appendBE64( encoded, info.sequence );
+        appendBE64( encoded, info.size );
+        return encoded;
+    }
+
+    /// key of the eviction order record, flipping the sign bit of the priority makes
+    /// the byte order of the keys the numeric order of the priorities
+    static QByteArray
+    p_orderKey( const Info & info )
+    {
+        QByteArray orderKey( "p" );
+        appendBE64( orderKey, uint64_t( info.priority ) ^ ( 1ull << 63 ) );
+        appendBE64( orderKey, info.sequence );
+        return orderKey;
+    }
+
+    static bool
+    p_decode( const QByteArray & stored, QByteArray & val )
+    {
+        if ( stored.isEmpty() ) {
+            return false;
+        }
+        if ( stored[0] == char ( 1 ) ) {
+            val = qUncompress( reinterpret_cast < const uchar * > ( stored.constData() + 1 ),
+                               stored.size() - 1 );
+            return ! val.isEmpty();
+        }
+        val = QByteArray( stored.constData() + 1, stored.size() - 1 );
+        return true;
+    }
+
+    /// add the current stats to the batch
+    void
+    p_putStats()
+    {
+        QByteArray stats;
+        appendBE64( stats, m_stats.entries );
+        appendBE64( stats, m_stats.bytes );
+        appendBE64( stats, m_stats.sequence );
+        m_batch.Put( "s", slice( stats ) );
+    }
+
+    /// write the batch, then make room if the cache got too big
+    void
+    p_flush()
+    {
+        p_putStats();
+        leveldb::Status status = m_db-> Write( leveldb::WriteOptions(), & m_batch );
+        if ( ! status.ok() ) {
+            qWarning() << "leveldb write failed" << status.ToString().c_str();
+        }
+        m_batch.Clear();
+        m_pending.clear();
+        m_pendingBytes = 0;
+
+        if ( m_stats.bytes > m_maxStorage ) {
+            p_evict();
+        }
+    }
+
+    /// remove the lowest priority entries until we are 10% below the limit
+    void
+    p_evict()
+    {
+        uint64_t target = m_maxStorage - m_maxStorage / 10;
+        uint64_t removed = 0;
+        std::unique_ptr < leveldb::Iterator > it( m_db-> NewIterator( leveldb::ReadOptions() ) );
+        for ( it-> Seek( "p" ) ; it-> Valid() && m_stats.bytes > target ; it-> Next() ) {
+            if ( it-> key().empty() || it-> key()[0] != 'p' ) {
+                break;
+            }
+            QByteArray key( it-> value().data(), it-> value().size() );
+            Info info;
+            if ( p_info( key, info ) && info.size <= m_stats.bytes ) {
+                m_stats.bytes -= info.size;
+            }
+            if ( m_stats.entries > 0 ) {
+                m_stats.entries--;
+            }
+            m_batch.Delete( it-> key() );
+            m_batch.Delete( slice( 'v' + key ) );
+            m_batch.Delete( slice( 'i' + key ) );
+            removed++;
+        }
+        it.reset();
+        qDebug() << "PCacheLevelDb: evicted" << removed << "entries";
+
+        p_putStats();
+        m_db-> Write( leveldb::WriteOptions(), & m_batch );
+        m_batch.Clear();
+    } // p_evict
+
+private:
+
+    leveldb::Options m_options;
+    std::unique_ptr < leveldb::DB > m_db;
+    uint64_t m_maxStorage = 0;
+    int64_t m_batchBytes = 0;
+    bool m_compress = true;
+
+    Stats m_stats;
+    leveldb::WriteBatch m_batch;
+    QHash < QByteArray, Pending > m_pending;
+    int64_t m_pendingBytes = 0;
+
+    /// protects everything above, the cache can be used from several threads
+    QMutex m_mutex;
+
+    static Carta::Lib::IPCache::SharedPtr m_cachePtr; //  = nullptr;
+};
+
+Carta::Lib::IPCache::SharedPtr LevelDbPCache::m_cachePtr = nullptr;
+
+PCacheLevelDbPlugin::PCacheLevelDbPlugin( QObject * parent ) :
+    QObject( parent )
+{ }
+
+bool
+PCacheLevelDbPlugin::handleHook( BaseHook & hookData )
+{
+    // we only handle one hook: get the cache object
+    if ( hookData.is < GetPersistantCacheHook > () ) {
+        // decode hook data
+        GetPersistantCacheHook & hook = static_cast < GetPersistantCacheHook & > ( hookData );
+
+        // if no dbdir was specified, refuse to work
+        if ( m_dbDir.isNull() ) {
+            hook.result.reset();
+            return false;
+        }
+
+        // try to create the database
+        hook.result = LevelDbPCache::getCacheSingleton( m_dbDir, m_maxStorage, m_batchBytes, m_compress );
+
+        // return true if result is not null
+        return hook.result != nullptr;
+    }
+
+    qWarning() << "PCacheLevelDbPlugin: Sorrry, dont' know how to handle this hook";
+    return false;
+} // handleHook
+
+void
+PCacheLevelDbPlugin::initialize( const IPlugin::InitInfo & initInfo )
+{
+    qDebug() << "PCacheLevelDbPlugin::initialized";
+
+    // extract the location of the database from carta.config
+    m_dbDir = initInfo.json.value( "dbDir" ).toString();
+    if ( m_dbDir.isNull() ) {
+        qCritical() << "No dbDir specified for PCacheLevelDb plugin!!!";
+    }
+    else {
+        // convert this to absolute path just in case
+        m_dbDir = QDir( m_dbDir ).absolutePath();
+    }
+
+    // optional settings
+    double maxStorageMB = initInfo.json.value( "maxStorageMB" ).toDouble( 1024 );
+    if ( maxStorageMB > 0 ) {
+        m_maxStorage = maxStorageMB * 1024 * 1024;
+    }
+    double batchKB = initInfo.json.value( "batchKB" ).toDouble( 4096 );
+    if ( batchKB >= 0 ) {
+        m_batchBytes = batchKB * 1024;
+    }
+    m_compress = initInfo.json.value( "compress" ).toBool( true );
+} // initialize
+
+std::vector < HookId >
+PCacheLevelDbPlugin::getInitialHookList()
+{
+    return {
+               GetPersistantCacheHook::staticId
+    };
+}
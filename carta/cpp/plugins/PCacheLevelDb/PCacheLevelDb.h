@@ -0,0 +1,38 @@
+/// Implements plugin for persistant cache, using LevelDB
+
+#pragma once
+
+#include "CartaLib/IPlugin.h"
+#include <QObject>
+#include <QString>
+
+class PCacheLevelDbPlugin : public QObject, public IPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA( IID "org.cartaviewer.IPlugin" )
+    Q_INTERFACES( IPlugin )
+
+public :
+        PCacheLevelDbPlugin( QObject * parent = 0 );
+    virtual bool
+    handleHook( BaseHook & hookData ) override;
+
+    virtual std::vector < HookId >
+    getInitialHookList() override;
+
+    virtual void
+    initialize( const InitInfo & initInfo ) override;
+
+private:
+
+    QString m_dbDir;
+
+    /// entries with the lowest priority are removed when the cache grows past this
+    uint64_t m_maxStorage = 1024ull * 1024 * 1024;
+
+    /// writes are buffered until they add up to this many bytes
+    int64_t m_batchBytes = 4 * 1024 * 1024;
+
+    /// whether values are compressed
+    bool m_compress = true;
+};
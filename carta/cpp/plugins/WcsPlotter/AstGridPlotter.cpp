@@ -1,6 +1,7 @@
 #include "AstGridPlotter.h"
 #include <iostream>
 #include "grfdriver.h"
+#include <QMutex>
 
 extern "C" {
 #include <ast.h>
@@ -27,6 +28,12 @@ AstGridPlotter::setFitsHeader( const QString & hdr )
     return true;
 }
 
+void
+AstGridPlotter::setFrameSet( AstGridPlotter::FrameSetPtr frameSet )
+{
+    m_frameSet = frameSet;
+}
+
 void
 AstGridPlotter::setCarLin( bool flag )
 {
@@ -74,23 +81,43 @@ struct AstGuard {
     ~AstGuard() { astEnd; }
 };
 
-bool
-AstGridPlotter::plot()
-{
+/// Serializes all AST calls if AST was built without thread support. With thread
+/// support AST keeps its state per thread and this does nothing.
+struct AstSerializer {
+#if AST__THREADSAFE
+    AstSerializer() { }
+#else
+    AstSerializer() : m_locker( & mutex() ) { }
+
+    static QMutex &
+    mutex()
+    {
+        static QMutex m( QMutex::Recursive );
+        return m;
+    }
 
-    // setup the graphics driver globals
-    // =================================
-    // copy over pens, making sure we have at least one pen
-//    grfGlobals()-> pens = pens();
-//    if( pens().empty()) {
-//        grfGlobals()->pens.push_back( QPen( QColor( "green"), 1));
-//    }
-    // setup shadow pen
-    grfGlobals()-> lineShadowPenIndex = m_shadowPenIndex;
-    // assign VG composer
-    grfGlobals()-> vgComposer = m_vgc;
-    // pre-cache some things
-    grfGlobals()-> prepare();
+    QMutexLocker m_locker;
+#endif
+};
+
+/// AST objects belong to the thread that created them, this makes the current thread
+/// the owner of the object for the lifetime of the lock
+struct AstObjectLock {
+#if AST__THREADSAFE
+    AstObjectLock( AstObject * obj ) : m_obj( obj ) { astLock( m_obj, 1 ); }
+
+    ~AstObjectLock() { astUnlock( m_obj, 1 ); }
+
+    AstObject * m_obj;
+#else
+    AstObjectLock( AstObject * ) { }
+#endif
+};
+
+AstGridPlotter::FrameSetPtr
+AstGridPlotter::readFrameSet( const QString & hdr, bool carLin, QString & errorString )
+{
+    AstSerializer astSerializer;
 
     // get rid of any ast errors from previous calls, just in case
     astClearStatus;
@@ -104,18 +131,18 @@ AstGridPlotter::plot()
     AstFitsChan * fitschan = astFitsChan( NULL, NULL, "" );
 #pragma GCC diagnostic pop
     if ( ! fitschan ) {
-        m_errorString = "astFitsChan returned null :(";
-        return false;
+        errorString = "astFitsChan returned null :(";
+        return nullptr;
     }
-    std::string stdstr = m_fitsHeader.toStdString();
+    std::string stdstr = hdr.toStdString();
     astPutCards( fitschan, stdstr.c_str() );
     if ( ! astOK ) {
         qDebug() << "astPutCards() failed";
-        m_errorString = "astPutCards() failed, check logs.";
-        return false;
+        errorString = "astPutCards() failed, check logs.";
+        return nullptr;
     }
 
-    if ( m_carLin ) {
+    if ( carLin ) {
         astSet( fitschan, "CarLin=1" );
     }
     else {
@@ -125,18 +152,76 @@ AstGridPlotter::plot()
     // try to get WCS out of the fits data
     AstFrameSet * wcsinfo = static_cast < AstFrameSet * > ( astRead( fitschan ) );
     if ( ! astOK ) {
-        m_errorString = "astRead() failed, check logs.";
-        return false;
+        errorString = "astRead() failed, check logs.";
+        return nullptr;
     }
     else if ( wcsinfo == AST__NULL ) {
-        m_errorString = "No WCS found";
-        return false;
+        errorString = "No WCS found";
+        return nullptr;
     }
     else if ( strcmp( astGetC( wcsinfo, "Class" ), "FrameSet" ) ) {
-        m_errorString = "check FITS header (astlib)";
-        return false;
+        errorString = "check FITS header (astlib)";
+        return nullptr;
+    }
+
+    // keep the frameset alive past astEnd, the shared pointer will annul it
+    astExempt( wcsinfo );
+
+#if AST__THREADSAFE
+    // release the frameset from this thread, so that plot() can be called from any thread
+    astUnlock( wcsinfo, 1 );
+#endif
+    return FrameSetPtr( wcsinfo, [] ( AstFrameSet * fs ) {
+                            AstSerializer astSerializer;
+#if AST__THREADSAFE
+                            astLock( fs, 1 );
+#endif
+                            astAnnul( fs );
+                        }
+                        );
+} // readFrameSet
+
+bool
+AstGridPlotter::plot()
+{
+
+    // setup the graphics driver globals
+    // =================================
+    // copy over pens, making sure we have at least one pen
+//    grfGlobals()-> pens = pens();
+//    if( pens().empty()) {
+//        grfGlobals()->pens.push_back( QPen( QColor( "green"), 1));
+//    }
+    // setup shadow pen
+    grfGlobals()-> lineShadowPenIndex = m_shadowPenIndex;
+    // setup line simplification
+    grfGlobals()-> lineSimplifier.setTolerance( m_lineTolerance );
+    // assign VG composer
+    grfGlobals()-> vgComposer = m_vgc;
+    // pre-cache some things
+    grfGlobals()-> prepare();
+
+    // parse the header, unless we were given a parsed frameset
+    FrameSetPtr frameSet = m_frameSet;
+    if ( ! frameSet ) {
+        frameSet = readFrameSet( m_fitsHeader, m_carLin, m_errorString );
+        if ( ! frameSet ) {
+            return false;
+        }
     }
 
+    AstSerializer astSerializer;
+
+    // get rid of any ast errors from previous calls, just in case
+    astClearStatus;
+
+    // make sure we clean up resources no matter how we exit this method
+    AstGuard astGuard;
+
+    // the frameset may be shared with other plotters, take ownership of it while plotting
+    AstFrameSet * wcsinfo = frameSet.get();
+    AstObjectLock frameSetLock( reinterpret_cast < AstObject * > ( wcsinfo ) );
+
     float gbox[] = {
         float ( m_orect.left() ), float ( m_orect.bottom() ),
         float ( m_orect.right() ), float ( m_orect.top() )
@@ -225,8 +310,10 @@ AstGridPlotter::plot()
     }
 
     plot = (AstPlot *) astAnnul( plot );
-    wcsinfo = (AstFrameSet *) astAnnul( wcsinfo );
-    fitschan = (AstFitsChan *) astAnnul( fitschan );
+
+    // remember where the fonts were set
+    m_fontEntries = grfGlobals()-> fontEntries;
+    m_polylineBytes = grfGlobals()-> polylineBytes;
 
     return true;
 } // plot
@@ -5,12 +5,10 @@
 /// This is essentially my attempt to make a simple C++ interface for interacting with AST,
 /// at least for drawing grids.
 ///
-/// \warning This class is very unfriendly to multithreading because it uses
-/// ASTlib's plotting, which I could only get to work using global variables.
-///
-/// \todo there is a way to tell AST to use a different graphics driver without
-/// resorting to globals, but I feel it introduces a small performance penalty.
-/// One day we should investigate whether it's actually signifficant penalty.
+/// AST's plotting calls the graphics driver (grfdriver.cpp) through global functions,
+/// so the driver keeps its state per thread. Different plotters can therefore plot
+/// in different threads at the same time, provided AST was built with thread
+/// support (--with-pthreads). Otherwise all AST calls are serialized.
 
 #pragma once
 
@@ -20,9 +18,13 @@
 #include <QRectF>
 #include <QStringList>
 #include <QFont>
+#include <memory>
 
 class QImage;
 
+// forward declaration of AST's frameset, so that we don't need to include ast.h here
+struct AstFrameSet;
+
 namespace WcsPlotterPluginNS
 {
 ///
@@ -35,15 +37,33 @@ public:
     /// short type alias
     typedef Carta::Lib::VectorGraphics::VGComposer VGComposer;
 
+    /// shared pointer to a parsed AST frameset, annulled when the last reference goes away
+    typedef std::shared_ptr < AstFrameSet > FrameSetPtr;
+
+    /// positions of SetFontIndex entries in the output, together with the font value
+    /// AST asked for
+    typedef std::vector < std::pair < int64_t, int > > FontEntries;
+
     AstGridPlotter();
     ~AstGridPlotter();
 
+    /// parse the raw FITS header (concatenated 80-char strings) into an AST frameset,
+    /// which can be given to any number of plotters via setFrameSet()
+    /// \return nullptr on error, with errorString set
+    static FrameSetPtr
+    readFrameSet( const QString & hdr, bool carLin, QString & errorString );
+
     /// feed the plotter the raw FITS header (concatenated 80-char strings)
     /// returns whether the header has enough information about
     /// about sky coordinates
+    /// \note the header is parsed on every plot(), use setFrameSet() to avoid that
     bool
     setFitsHeader( const QString & hdr );
 
+    /// use an already parsed frameset instead of the fits header
+    void
+    setFrameSet( FrameSetPtr frameSet );
+
     /// set whether to use the old CAR interpretation (i.e. CAR is linear)
     void
     setCarLin( bool flag );
@@ -76,6 +96,10 @@ public:
     /// set shadow color index
     void setShadowPenIndex( int penIndex) { m_shadowPenIndex = penIndex; }
 
+    /// simplify lines so they stay within this many output pixels of the exact ones,
+    /// 0 draws them as computed by AST
+    void setLineTolerance( double tolerance) { m_lineTolerance = tolerance; }
+
     /// set various options for grid drawing
     /// this is a temporary method, and it is dependent on AST lib
     /// \todo Replace this with implementation independent API
@@ -95,6 +119,15 @@ public:
     QString
     getError();
 
+    /// positions of the font entries emitted during the last plot(), this allows
+    /// changing fonts in the output without re-plotting
+    const FontEntries &
+    fontEntries() const { return m_fontEntries; }
+
+    /// bytes of polyline vertices emitted during the last plot()
+    int64_t
+    polylineBytes() const { return m_polylineBytes; }
+
 protected:
 
     bool m_carLin = false;
@@ -108,8 +141,13 @@ protected:
     double m_densityModifier = 1.0;
 
     int m_shadowPenIndex;
+    double m_lineTolerance = 0.0;
 //    QPen m_shadowPen = QPen( QColor( 0, 0, 0, 0), 1);
 
     VGComposer * m_vgc = nullptr;
+
+    FrameSetPtr m_frameSet = nullptr;
+    FontEntries m_fontEntries;
+    int64_t m_polylineBytes = 0;
 };
 }
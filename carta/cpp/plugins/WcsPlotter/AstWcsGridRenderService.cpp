@@ -6,8 +6,13 @@
 #include "AstWcsGridRenderService.h"
 #include "FitsHeaderExtractor.h"
 #include "CartaLib/LinearMap.h"
+#include "CartaLib/CacheRegistry.h"
 #include <QPainter>
 #include <QTime>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QCryptographicHash>
+#include <cmath>
 
 typedef Carta::Lib::LinearMap1D LinMap;
 namespace VG = Carta::Lib::VectorGraphics; // love c++11
@@ -15,6 +20,69 @@ namespace VGE = VG::Entries;
 
 namespace WcsPlotterPluginNS
 {
+// everything that influences the geometry of the grid, but not its style
+struct AstWcsGridRenderService::GeometryKey {
+    // identifies the WCS of the image (hash of its fits header)
+    QString wcsKey;
+    QRectF imgRect, outRect;
+    QSize outSize;
+    Carta::Lib::KnownSkyCS skyCS = Carta::Lib::KnownSkyCS::J2000;
+    double density = 0;
+    bool gridLines = true, axes = true, ticks = true, internalLabels = false;
+
+    // font sizes influence label placement, font indices don't
+    std::vector < double > fontSizes;
+
+    bool
+    operator== ( const GeometryKey & o ) const
+    {
+        return imgRect == o.imgRect && sameLayout( o );
+    }
+
+    // same as == but image rectangles only need to be the same size (i.e. they
+    // can differ by a translation)
+    bool
+    sameLayout( const GeometryKey & o ) const
+    {
+        return wcsKey == o.wcsKey && imgRect.size() == o.imgRect.size() &&
+               outRect == o.outRect && outSize == o.outSize && skyCS == o.skyCS &&
+               density == o.density && gridLines == o.gridLines && axes == o.axes &&
+               ticks == o.ticks && internalLabels == o.internalLabels &&
+               fontSizes == o.fontSizes;
+    }
+
+    // string form of the key, for the geometry cache
+    QString
+    id() const
+    {
+        auto num = [] ( double x ) {
+            return QString::number( x, 'g', 17 );
+        };
+        QStringList parts {
+            wcsKey,
+            num( imgRect.x() ), num( imgRect.y() ), num( imgRect.width() ), num( imgRect.height() ),
+            num( outRect.x() ), num( outRect.y() ), num( outRect.width() ), num( outRect.height() ),
+            QString::number( outSize.width() ), QString::number( outSize.height() ),
+            QString::number( static_cast < int > ( skyCS ) ), num( density ),
+            QString( "%1%2%3%4" ).arg( gridLines ).arg( axes ).arg( ticks ).arg( internalLabels )
+        };
+        for ( double fontSize : fontSizes ) {
+            parts << num( fontSize );
+        }
+        return parts.join( ' ' );
+    }
+};
+
+// cached output of AST for one geometry key, with fonts still to be applied
+struct AstWcsGridRenderService::Geometry {
+    GeometryKey key;
+    VG::VGList body;
+    AstGridPlotter::FontEntries fontEntries;
+
+    // rough estimate of the memory used by body
+    int64_t cost = 0;
+};
+
 struct AstWcsGridRenderService::Pimpl
 {
     // we want to remember index and size about fonts
@@ -23,23 +91,48 @@ struct AstWcsGridRenderService::Pimpl
     // fits header from the input image
     QStringList fitsHeader;
 
+    // hash of the fits header, identifies the image in the caches below
+    QString wcsKey;
+
+    // AST frameset parsed from the fits header
+    AstGridPlotter::FrameSetPtr frameSet = nullptr;
+
     // current sky CS
     Carta::Lib::KnownSkyCS knownSkyCS = Carta::Lib::KnownSkyCS::J2000;
 
     // list of pens
     std::vector < QPen > pens;
 
-    // where in the VG list did we set the pen indices
-    std::vector < int64_t > penEntries;
-
-    // where in the VG list did we set the margin dim color
-    int64_t dimBrushIndex = - 1;
-
     // font info
     std::vector < FontInfo > fonts;
 
+    // the last geometry we reported, a small pan reports it translated
+    GeometryPtr lastGeometry = nullptr;
+
     // last submitted job id
     IWcsGridRenderService::JobId lastSubmittedJobId = 0;
+
+    // geometry being computed on the worker pool (at most one per service)
+    QFutureWatcher < Geometry > geometryWatcher;
+
+    // framesets parsed so far, keyed by wcsKey, shared by all services so that
+    // switching between images does not parse their headers again
+    static Carta::Lib::LruCache < QString, AstGridPlotter::FrameSetPtr > &
+    frameSetCache()
+    {
+        static Carta::Lib::LruCache < QString, AstGridPlotter::FrameSetPtr > cache(
+            "wcs framesets" );
+        return cache;
+    }
+
+    // geometries computed so far, keyed by GeometryKey::id(), shared by all services
+    static Carta::Lib::LruCache < QString, GeometryPtr > &
+    geometryCache()
+    {
+        static Carta::Lib::LruCache < QString, GeometryPtr > cache(
+            "wcs grid geometry", 64 * 1024 * 1024 );
+        return cache;
+    }
 };
 
 AstWcsGridRenderService::AstWcsGridRenderService()
@@ -52,21 +145,35 @@ AstWcsGridRenderService::AstWcsGridRenderService()
     // make default fonts
     Pimpl::FontInfo tuple( 0, 10.0 );
     m().fonts.resize( static_cast < int > ( Element::__count ), tuple );
-    // make default pen entries indicating we have not set them yet
-    m().penEntries.resize( static_cast < int > ( Element::__count ), - 1 );
 
     // setup render timer & hook it up
     m_renderTimer.setSingleShot( true );
     connect( & m_renderTimer, & QTimer::timeout, this, & Me::renderNow );
+
+    // the refine timer replaces a translated grid with an exact one once panning stops
+    m_refineTimer.setSingleShot( true );
+    m_refineTimer.setInterval( 250 );
+    connect( & m_refineTimer, & QTimer::timeout, this, & Me::refineNow );
+
+    // results from the worker pool
+    connect( & m().geometryWatcher, & QFutureWatcherBase::finished,
+             this, & Me::geometryComputed );
 }
 
 AstWcsGridRenderService::~AstWcsGridRenderService()
-{ }
+{
+    // the computation does not reference us, but let's not leave it running
+    // after the plugin is gone
+    m().geometryWatcher.waitForFinished();
+}
 
 void
 AstWcsGridRenderService::setInputImage( Carta::Lib::Image::ImageInterface::SharedPtr image )
 {
     CARTA_ASSERT( image );
+    if ( image == m_iimage ) {
+        return;
+    }
 
     m_iimage = image;
 
@@ -81,37 +188,40 @@ AstWcsGridRenderService::setInputImage( Carta::Lib::Image::ImageInterface::Share
                    << fhExtractor.getErrors();
     }
 
+    // new header means a different frameset, which we may have parsed before
     if ( header != m().fitsHeader ) {
-        m_vgValid = false;
+        QString hdr = header.join( "" );
         m().fitsHeader = header;
+        m().wcsKey = QCryptographicHash::hash( hdr.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+        if ( ! Pimpl::frameSetCache().find( m().wcsKey, m().frameSet ) ) {
+            QString error;
+            m().frameSet = AstGridPlotter::readFrameSet( hdr, false, error );
+            if ( ! m().frameSet ) {
+                qWarning() << "Could not parse fits header:" << error;
+            }
+
+            // an AST frameset takes a few times the size of the header it came from
+            Pimpl::frameSetCache().insert( m().wcsKey, m().frameSet, hdr.size() * 4 );
+        }
     }
 } // setInputImage
 
 void
 AstWcsGridRenderService::setOutputSize( const QSize & size )
 {
-    if ( m_outSize != size ) {
-        m_vgValid = false;
-        m_outSize = size;
-    }
+    m_outSize = size;
 }
 
 void
 AstWcsGridRenderService::setImageRect( const QRectF & rect )
 {
-    if ( m_imgRect != rect ) {
-        m_vgValid = false;
-        m_imgRect = rect;
-    }
+    m_imgRect = rect;
 }
 
 void
 AstWcsGridRenderService::setOutputRect( const QRectF & rect )
 {
-    if ( m_outRect != rect ) {
-        m_vgValid = false;
-        m_outRect = rect;
-    }
+    m_outRect = rect;
 }
 
 Carta::Lib::IWcsGridRenderService::JobId AstWcsGridRenderService::startRendering(JobId jobId)
@@ -131,128 +241,163 @@ Carta::Lib::IWcsGridRenderService::JobId AstWcsGridRenderService::startRendering
 void
 AstWcsGridRenderService::renderNow()
 {
-    // if the VGList is still valid, we are done
-    if ( m_vgValid ) {
-        //qDebug() << "vgValid saved us a grid redraw xyz";
-        emit done( m_vgc.vgList(), m().lastSubmittedJobId );
+    // if the empty grid reporting is activated, report an empty grid
+    if ( m_emptyGridFlag ) {
+        emit done( VGList(), m().lastSubmittedJobId );
         return;
     }
 
-    QTime t;
-    t.start();
-
-    // clear the current vector graphics in case something goes wrong later
-//    m_vgList = VGList();
-    m_vgc.clear();
+    GeometryKey key = p_geometryKey();
 
-    // if the empty grid reporting is activated, report an empty grid
-    if ( m_emptyGridFlag ) {
-        emit done( m_vgc.vgList(), m().lastSubmittedJobId );
+    // if we have computed this geometry before, we only need to apply the current style
+    GeometryPtr last = m().lastGeometry;
+    GeometryPtr hit = nullptr;
+    if ( last && last-> key == key ) {
+        hit = last;
+    }
+    else {
+        Pimpl::geometryCache().find( key.id(), hit );
+    }
+    if ( hit ) {
+        m_refineTimer.stop();
+        m().lastGeometry = hit;
+        emit done( p_compose( * hit, QTransform() ), m().lastSubmittedJobId );
         return;
     }
 
-    m_vgValid = true;
-
-    // local helper - element to integer
-    auto si = [&] ( Element e ) {
-        return static_cast < int > ( e );
-    };
+    // if this is a small pan of the last geometry, report the translated grid right away
+    // and compute the exact one once panning stops
+    if ( last && last-> key.sameLayout( key ) ) {
+        const Geometry & geom = * last;
+        double sx = m_outRect.width() / m_imgRect.width();
+        double sy = m_outRect.height() / m_imgRect.height();
+        double dx = ( geom.key.imgRect.left() - m_imgRect.left() ) * sx;
+        double dy = ( geom.key.imgRect.top() - m_imgRect.top() ) * sy;
+        if ( std::abs( dx ) <= std::abs( m_outRect.width() ) * MaxTranslateFraction &&
+             std::abs( dy ) <= std::abs( m_outRect.height() ) * MaxTranslateFraction ) {
+            emit done( p_compose( geom, QTransform::fromTranslate( dx, dy ) ),
+                       m().lastSubmittedJobId );
+            m_refineTimer.start();
+            return;
+        }
+    }
 
-    // element to pen reference
-    auto pi = [&] ( Element e ) -> QPen & {
-        return m().pens[si( e )];
-    };
+    // we'll report the grid when the computation finishes
+    m_refineTimer.stop();
+    p_startComputation( key );
+} // renderNow
 
-    // element to font info reference
-    auto fi = [&] ( Element e ) -> Pimpl::FontInfo & {
-        return m().fonts[si( e )];
-    };
+void
+AstWcsGridRenderService::refineNow()
+{
+    if ( m_emptyGridFlag ) {
+        return;
+    }
+    GeometryKey key = p_geometryKey();
+    GeometryPtr last = m().lastGeometry;
+    if ( last && last-> key == key ) {
+        return;
+    }
+    p_startComputation( key );
+}
 
-    // make a new VG composer
-//    VG::VGComposer m_vgc;
-//    m_vgc.clear();
+void
+AstWcsGridRenderService::p_startComputation( const GeometryKey & key )
+{
+    // if a computation is already running, geometryComputed() will pick up the latest
+    // settings once it's done
+    if ( m().geometryWatcher.isRunning() ) {
+        return;
+    }
+    m().geometryWatcher.setFuture(
+        QtConcurrent::run( & Me::p_computeGeometry, key, m().frameSet,
+                           m().fitsHeader.join( "" ) ) );
+}
 
-    // dim the border
-    {
-        double x0 = 0;
-        double x1 = m_outRect.left();
-        double x2 = m_outRect.right();
-        double x3 = m_outSize.width();
-        double y0 = 0;
-        double y1 = m_outRect.top();
-        double y2 = m_outRect.bottom();
-        double y3 = m_outSize.height();
-        m_vgc.append < VGE::Save > ();
-        m_vgc.append < VGE::SetPen > ( Qt::NoPen );
-        m().dimBrushIndex =
-            m_vgc.append < VGE::StoreIndexedBrush > ( 0, QBrush( pi( Element::MarginDim ).brush() ) );
-        m_vgc.append < VGE::SetIndexedBrush > ( 0 );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x0, y0 ), QPointF( x1, y3 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x2, y0 ), QPointF( x3, y3 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y0 ), QPointF( x2, y1 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y2 ), QPointF( x2, y3 ) ) );
-        m_vgc.append < VGE::Restore > ();
+void
+AstWcsGridRenderService::geometryComputed()
+{
+    // remember the result, the key tells which image it was computed for
+    GeometryPtr geom = std::make_shared < Geometry > ( m().geometryWatcher.result() );
+    Pimpl::geometryCache().insert( geom-> key.id(), geom, geom-> cost );
+    if ( geom-> key.wcsKey == m().wcsKey ) {
+        m().lastGeometry = geom;
     }
 
-    auto elements {
-        Element::BorderLines,
-        Element::AxisLines1,
-        Element::AxisLines2,
-        Element::GridLines1,
-        Element::GridLines2,
-        Element::TickLines1,
-        Element::TickLines2,
-        Element::NumText1,
-        Element::NumText2,
-        Element::LabelText1,
-        Element::LabelText2,
-        Element::Shadow,
-        Element::MarginDim
-    };
+    // report the grid for the current settings, which either finds the result
+    // in the cache, or starts another computation if settings changed meanwhile
+    renderNow();
+}
 
-    // setup indexed pens
-    for ( auto & e : elements ) {
-        m().penEntries[si( e )] =
-            m_vgc.append < VGE::StoreIndexedPen > ( si( e ), pi( e ) );
+AstWcsGridRenderService::GeometryKey
+AstWcsGridRenderService::p_geometryKey()
+{
+    GeometryKey key;
+    key.wcsKey = m().wcsKey;
+    key.imgRect = m_imgRect;
+    key.outRect = m_outRect;
+    key.outSize = m_outSize;
+    key.skyCS = m().knownSkyCS;
+    key.density = m_gridDensity;
+    key.gridLines = m_gridLines;
+    key.axes = m_axes;
+    key.ticks = m_ticks;
+    key.internalLabels = m_internalLabels;
+    for ( auto & fontInfo : m().fonts ) {
+        key.fontSizes.push_back( fontInfo.second );
     }
+    return key;
+}
 
-//    LinMap tx( m_imgRect.left(), m_imgRect.right(), m_outRect.left(), m_outRect.right() );
-//    LinMap ty( m_imgRect.top(), m_imgRect.bottom(), m_outRect.top(), m_outRect.bottom() );
+AstWcsGridRenderService::Geometry
+AstWcsGridRenderService::p_computeGeometry( GeometryKey key,
+                                            AstGridPlotter::FrameSetPtr frameSet,
+                                            QString fitsHeader )
+{
+    QTime t;
+    t.start();
+
+    // local helper - element to integer
+    auto si = [&] ( Element e ) {
+        return static_cast < int > ( e );
+    };
+
+    // element to font size
+    auto fs = [&] ( Element e ) {
+        return key.fontSizes[si( e )];
+    };
 
     // draw the grid
     // =============================
+    VG::VGComposer vgc;
     AstGridPlotter sgp;
 
-//    for ( const QPen & pen : m().pens ) {
-//        sgp.pens().push_back( pen );
-//    }
-    sgp.pens() = m().pens;
-
-    sgp.setInputRect( m_imgRect );
-    sgp.setOutputRect( m_outRect );
-    sgp.setFitsHeader( m().fitsHeader.join( "" ) );
-    sgp.setOutputVGComposer( & m_vgc );
+    sgp.setInputRect( key.imgRect );
+    sgp.setOutputRect( key.outRect );
+    sgp.setFrameSet( frameSet );
+    sgp.setFitsHeader( fitsHeader );
+    sgp.setOutputVGComposer( & vgc );
 
 //    sgp.setPlotOption( "tol=0.001" ); // this can slow down the grid rendering!!!
     sgp.setPlotOption( "DrawTitle=0" );
 
-    if ( !m_gridLines ){
-        sgp.setPlotOption( "Grid=0");
+    if ( ! key.gridLines ) {
+        sgp.setPlotOption( "Grid=0" );
     }
 
-    if ( !m_axes ) {
-        sgp.setPlotOption("Border=0");
-        sgp.setPlotOption("DrawAxes(2)=0");
-        sgp.setPlotOption("DrawAxes(1)=0");
-        _turnOffTicks( &sgp );
+    if ( ! key.axes ) {
+        sgp.setPlotOption( "Border=0" );
+        sgp.setPlotOption( "DrawAxes(2)=0" );
+        sgp.setPlotOption( "DrawAxes(1)=0" );
+        _turnOffTicks( & sgp );
     }
     else {
-        if ( !m_ticks ){
-            _turnOffTicks(&sgp);
+        if ( ! key.ticks ) {
+            _turnOffTicks( & sgp );
         }
     }
 
-    if ( m_internalLabels ) {
+    if ( key.internalLabels ) {
         sgp.setPlotOption( QString( "Labelling=Interior" ) );
     }
     else {
@@ -264,37 +409,29 @@ AstWcsGridRenderService::renderNow()
     sgp.setPlotOption( "Size=9" ); // default font
 
     //Turn axis labelling off if we are not drawing the axes.
-    if (m_axes){
+    if ( key.axes ) {
         sgp.setPlotOption( "TextLab(1)=1" );
         sgp.setPlotOption( "TextLab(2)=1" );
     }
     else {
-        sgp.setPlotOption( "TextLab(1)=0");
-        sgp.setPlotOption( "TextLab(2)=0");
-        sgp.setPlotOption( "NumLab(1) = 0");
-        sgp.setPlotOption( "NumLab(2) = 0");
+        sgp.setPlotOption( "TextLab(1)=0" );
+        sgp.setPlotOption( "TextLab(2)=0" );
+        sgp.setPlotOption( "NumLab(1) = 0" );
+        sgp.setPlotOption( "NumLab(2) = 0" );
     }
 
-    // fonts
-    sgp.setPlotOption( QString( "Font(TextLab1)=%1" ).arg( fi( Element::LabelText1 ).first ) );
-    sgp.setPlotOption( QString( "Font(TextLab2)=%1" ).arg( fi( Element::LabelText2 ).first ) );
-    sgp.setPlotOption( QString( "Font(NumLab1)=%1" ).arg( fi( Element::NumText1 ).first ) );
-    sgp.setPlotOption( QString( "Font(NumLab2)=%1" ).arg( fi( Element::NumText2 ).first ) );
+    // fonts - we tell AST to use the element index as the font, and substitute the
+    // real font indices in p_compose(), so that font changes don't need a re-plot
+    sgp.setPlotOption( QString( "Font(TextLab1)=%1" ).arg( si( Element::LabelText1 ) ) );
+    sgp.setPlotOption( QString( "Font(TextLab2)=%1" ).arg( si( Element::LabelText2 ) ) );
+    sgp.setPlotOption( QString( "Font(NumLab1)=%1" ).arg( si( Element::NumText1 ) ) );
+    sgp.setPlotOption( QString( "Font(NumLab2)=%1" ).arg( si( Element::NumText2 ) ) );
 
     // font sizes
-    sgp.setPlotOption( QString( "Size(TextLab1)=%1" ).arg( fi( Element::LabelText1 ).second ) );
-    sgp.setPlotOption( QString( "Size(TextLab2)=%1" ).arg( fi( Element::LabelText2 ).second ) );
-    sgp.setPlotOption( QString( "Size(NumLab1)=%1" ).arg( fi( Element::NumText1 ).second ) );
-    sgp.setPlotOption( QString( "Size(NumLab2)=%1" ).arg( fi( Element::NumText2 ).second ) );
-
-    // line widths
-//    sgp.setPlotOption( QString( "Width(grid1)=%1" ).arg( pi( Element::GridLines1 ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(grid2)=%1" ).arg( pi( Element::GridLines2 ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(border)=%1" ).arg( pi( Element::BorderLines ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(axis1)=%1" ).arg( pi( Element::AxisLines1 ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(axis2)=%1" ).arg( pi( Element::AxisLines2 ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(ticks1)=%1" ).arg( pi( Element::TickLines1 ).widthF() ) );
-//    sgp.setPlotOption( QString( "Width(ticks2)=%1" ).arg( pi( Element::TickLines2 ).widthF() ) );
+    sgp.setPlotOption( QString( "Size(TextLab1)=%1" ).arg( fs( Element::LabelText1 ) ) );
+    sgp.setPlotOption( QString( "Size(TextLab2)=%1" ).arg( fs( Element::LabelText2 ) ) );
+    sgp.setPlotOption( QString( "Size(NumLab1)=%1" ).arg( fs( Element::NumText1 ) ) );
+    sgp.setPlotOption( QString( "Size(NumLab2)=%1" ).arg( fs( Element::NumText2 ) ) );
 
     // colors
     sgp.setPlotOption( QString( "Colour(grid1)=%1" ).arg( si( Element::GridLines1 ) ) );
@@ -311,15 +448,17 @@ AstWcsGridRenderService::renderNow()
 
     sgp.setShadowPenIndex( si( Element::Shadow ) );
 
-//    sgp.setPlotOption( "Format(1)=\"+tms.10\"");
-//            sgp.setPlotOption( "Format(1)=\"gtms\"");
+    // the geometry is computed for one zoom (image rectangle), so the lines only
+    // need as much detail as the output pixels can show
+    sgp.setLineTolerance( LineTolerance );
+
     // grid density
-    sgp.setDensityModifier( m_gridDensity );
+    sgp.setDensityModifier( key.density );
 
     QString system;
     {
         typedef Carta::Lib::KnownSkyCS KS;
-        switch ( m().knownSkyCS )
+        switch ( key.skyCS )
         {
         case KS::J2000 :
             system = "J2000";
@@ -347,60 +486,131 @@ AstWcsGridRenderService::renderNow()
 
     // do the actual plot
     bool plotSuccess = sgp.plot();
-//    qDebug() << "plotSuccess=" << plotSuccess;
-//    qDebug() << "plotError=" << sgp.getError();
     if( ! plotSuccess) {
         qWarning() << "Grid rendering error:" << sgp.getError();
     }
 
     //qDebug() << "Grid rendered in " << t.elapsed() / 1000.0 << "s";
 
-    // Report the result.
-    emit done( m_vgc.vgList(), m().lastSubmittedJobId );
-} // startRendering
+    Geometry geom;
+    geom.key = key;
+    geom.body = vgc.vgList();
+    if ( plotSuccess ) {
+        geom.fontEntries = sgp.fontEntries();
+    }
+
+    // polyline vertices make up most of it, the rest is roughly proportional to the
+    // number of entries (each one a separate heap object)
+    geom.cost = sgp.polylineBytes() + geom.body.entries().size() * 64;
+    return geom;
+} // p_computeGeometry
 
-void AstWcsGridRenderService::setAxesVisible( bool flag ){
-    if ( m_axes != flag ){
-        m_vgValid = false;
-        m_axes = flag;
+AstWcsGridRenderService::VGList
+AstWcsGridRenderService::p_compose( const Geometry & geom, const QTransform & tf )
+{
+    // local helper - element to integer
+    auto si = [&] ( Element e ) {
+        return static_cast < int > ( e );
+    };
+
+    // element to pen reference
+    auto pi = [&] ( Element e ) -> QPen & {
+        return m().pens[si( e )];
+    };
+
+    VG::VGComposer vgc;
+
+    // dim the border
+    {
+        double x0 = 0;
+        double x1 = m_outRect.left();
+        double x2 = m_outRect.right();
+        double x3 = m_outSize.width();
+        double y0 = 0;
+        double y1 = m_outRect.top();
+        double y2 = m_outRect.bottom();
+        double y3 = m_outSize.height();
+        vgc.append < VGE::Save > ();
+        vgc.append < VGE::SetPen > ( Qt::NoPen );
+        vgc.append < VGE::StoreIndexedBrush > ( 0, QBrush( pi( Element::MarginDim ).brush() ) );
+        vgc.append < VGE::SetIndexedBrush > ( 0 );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x0, y0 ), QPointF( x1, y3 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x2, y0 ), QPointF( x3, y3 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y0 ), QPointF( x2, y1 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y2 ), QPointF( x2, y3 ) ) );
+        vgc.append < VGE::Restore > ();
+    }
+
+    auto elements {
+        Element::BorderLines,
+        Element::AxisLines1,
+        Element::AxisLines2,
+        Element::GridLines1,
+        Element::GridLines2,
+        Element::TickLines1,
+        Element::TickLines2,
+        Element::NumText1,
+        Element::NumText2,
+        Element::LabelText1,
+        Element::LabelText2,
+        Element::Shadow,
+        Element::MarginDim
+    };
+
+    // setup indexed pens, the geometry refers to them by element index
+    for ( auto & e : elements ) {
+        vgc.append < VGE::StoreIndexedPen > ( si( e ), pi( e ) );
+    }
+
+    // substitute the real font indices for the element indices AST used
+    VG::VGComposer body( geom.body );
+    for ( auto & fontEntry : geom.fontEntries ) {
+        int value = fontEntry.second;
+        if ( value == si( Element::NumText1 ) || value == si( Element::NumText2 ) ||
+             value == si( Element::LabelText1 ) || value == si( Element::LabelText2 ) ) {
+            value = m().fonts[value].first;
+        }
+        body.set < VGE::SetFontIndex > ( fontEntry.first, value );
     }
+
+    if ( ! tf.isIdentity() ) {
+        vgc.append < VGE::Save > ();
+        vgc.append < VGE::SetTransform > ( tf, true );
+        vgc.appendList( body.vgList() );
+        vgc.append < VGE::Restore > ();
+    }
+    else {
+        vgc.appendList( body.vgList() );
+    }
+
+    return vgc.vgList();
+} // p_compose
+
+void AstWcsGridRenderService::setAxesVisible( bool flag ){
+    m_axes = flag;
 }
 
 void
 AstWcsGridRenderService::setGridDensityModifier( double density )
 {
-    if ( m_gridDensity != density ) {
-        m_gridDensity = density;
-        m_vgValid = false;
-    }
+    m_gridDensity = density;
 }
 
 void
 AstWcsGridRenderService::setInternalLabels( bool flag )
 {
-    if ( m_internalLabels != flag ) {
-        m_vgValid = false;
-        m_internalLabels = flag;
-    }
+    m_internalLabels = flag;
 }
 
 void
 AstWcsGridRenderService::setGridLinesVisible( bool flag ){
-    if ( m_gridLines != flag ){
-        m_vgValid = false;
-        m_gridLines = flag;
-    }
+    m_gridLines = flag;
 }
 
 void
 AstWcsGridRenderService::setSkyCS( Carta::Lib::KnownSkyCS cs )
 {
-    // invalidate vglist if the requested coordinate system is different
-    // from the last one
-    if ( m().knownSkyCS != cs ) {
-        m_vgValid = false;
-        m().knownSkyCS = cs;
-    }
+    m().knownSkyCS = cs;
 }
 
 void
@@ -410,20 +620,8 @@ AstWcsGridRenderService::setPen( Carta::Lib::IWcsGridRenderService::Element e, c
     CARTA_ASSERT( ind >= 0 && ind < int ( m().pens.size() ) );
     m().pens[ind] = pen;
 
-    auto si = [&] ( Element e ) {
-        return static_cast < int > ( e );
-    };
-    auto pi = [&] ( Element e ) -> QPen & {
-        return m().pens[si( e )];
-    };
-
-    // if the list is valid, just change the entry directly
-    if ( m_vgValid ) {
-        m_vgc.set < VGE::StoreIndexedPen > ( m().penEntries[si( e )], si( e ), pi( e ) );
-        if ( e == Element::MarginDim ) {
-            m_vgc.set < VGE::StoreIndexedBrush > ( m().dimBrushIndex, 0, pi( e ).brush() );
-        }
-    }
+    // pens are applied to the cached geometry in p_compose(), so there is nothing else
+    // to do here
 } // setPen
 
 //const QPen &
@@ -445,28 +643,20 @@ AstWcsGridRenderService::setFont( Carta::Lib::IWcsGridRenderService::Element e,
         fontIndex, pointSize
     };
 
-    if ( m().fonts[ind] != fontInfo ) {
-        m_vgValid = false;
-        m().fonts[ind] = fontInfo;
-    }
+    // font sizes are part of the geometry key, font indices are applied in p_compose()
+    m().fonts[ind] = fontInfo;
 }
 
 void
 AstWcsGridRenderService::setEmptyGrid( bool flag )
 {
-    if ( m_emptyGridFlag != flag ) {
-        m_vgValid = false;
-        m_emptyGridFlag = flag;
-    }
+    m_emptyGridFlag = flag;
 }
 
 void
 AstWcsGridRenderService::setTicksVisible( bool flag )
 {
-    if ( m_ticks != flag ){
-        m_vgValid = false;
-        m_ticks = flag;
-    }
+    m_ticks = flag;
 }
 
 inline AstWcsGridRenderService::Pimpl &
@@ -7,15 +7,15 @@
 #include "CartaLib/CartaLib.h"
 #include "CartaLib/VectorGraphics/VGList.h"
 #include "CartaLib/IWcsGridRenderService.h"
+#include "AstGridPlotter.h"
 #include <QColor>
 #include <QObject>
 #include <QTimer>
+#include <QTransform>
 
 namespace WcsPlotterPluginNS
 {
 
-class AstGridPlotter;
-
 /// implementation of Carta::Lib::IWcsGridRenderService APIs
 class AstWcsGridRenderService : public Carta::Lib::IWcsGridRenderService
 {
@@ -78,6 +78,12 @@ private slots:
     // internal slot - does the actual rendering
     void renderNow();
 
+    // internal slot - replaces a translated (preview) grid with the exact one
+    void refineNow();
+
+    // internal slot - called when the worker pool finished computing a geometry
+    void geometryComputed();
+
     // part of a hack to simulate delayed signal
 //    void
 //    reportResult();
@@ -87,10 +93,40 @@ private slots:
 
 private:
     //Don't draw tick marks.
-    void _turnOffTicks(WcsPlotterPluginNS::AstGridPlotter* sgp);
+    static void _turnOffTicks(WcsPlotterPluginNS::AstGridPlotter* sgp);
+
+    // parameters that determine the geometry of the grid
+    struct GeometryKey;
+    // cached grid geometry (AST output)
+    struct Geometry;
+    typedef std::shared_ptr < const Geometry > GeometryPtr;
+
+    // key for the current settings
+    GeometryKey
+    p_geometryKey();
 
-    Carta::Lib::VectorGraphics::VGComposer m_vgc;
-//    VGList m_vgList;
+    // run AST for the given key, this runs on the worker pool so it must not
+    // touch any members
+    static Geometry
+    p_computeGeometry( GeometryKey key,
+                       AstGridPlotter::FrameSetPtr frameSet,
+                       QString fitsHeader );
+
+    // compute the geometry on the worker pool, the result is reported
+    // via geometryComputed()
+    void
+    p_startComputation( const GeometryKey & key );
+
+    // apply current pens/fonts to the geometry, optionally translated
+    VGList
+    p_compose( const Geometry & geom, const QTransform & tf );
+
+    // largest pan (as a fraction of the output rectangle) for which we report
+    // a translated grid before computing the exact one
+    static constexpr double MaxTranslateFraction = 0.25;
+
+    // how far (in output pixels) simplified grid lines may be from the exact ones
+    static constexpr double LineTolerance = 0.25;
 
     Carta::Lib::Image::ImageInterface::SharedPtr m_iimage = nullptr;
     QRectF m_imgRect, m_outRect;
@@ -111,11 +147,12 @@ private:
     // times, but only one rendering will really go through...
     QTimer m_renderTimer;
 
+    // after a translated grid was reported, this timer triggers the exact computation
+    QTimer m_refineTimer;
+
     // part of a hack to simulate delayed signal
     std::unique_ptr < QTimer > m_dbgTimer = nullptr;
 
-    // flag to indicate whether the currently stored VGlist is valid
-    bool m_vgValid = false;
     // flag for whether or not to show grid lines.
     bool m_gridLines = true;
     // flag to indicate whether to draw the axes/border.
@@ -1,11 +1,13 @@
 /**
  * Code that generates a fits header from ImageInterface.
  *
- * It can do this using casacore (on casa images), or using custom code on raw FITS files.
+ * It can do this using casacore (on casa images, or images sharing their meta data),
+ * or using custom code on raw FITS files.
  **/
 
 #include "FitsHeaderExtractor.h"
 #include "../CasaImageLoader/CCImage.h"
+#include "../CasaImageLoader/CCMetaDataInterface.h"
 #include "SimpleFitsParser.h"
 
 #include <casacore/images/Images/ImageFITSConverter.h>
@@ -46,6 +48,7 @@ FitsHeaderExtractor::getHeader()
     // was this created using CasaImageLoader plugin?
     CCImageBase * base = dynamic_cast < CCImageBase * > ( & * m_cartaImage );
     if ( base ) {
+        QMutexLocker locker( & base-> casaMutex() );
         casa::LatticeBase * latticeBase = base-> getCasaImage();
         if ( latticeBase ) {
             // see if we can use a simple fits parser first
@@ -66,6 +69,9 @@ FitsHeaderExtractor::getHeader()
                      << "I have no idea where this image came from.";
         }
     }
+    else {
+        result = tryMetaData();
+    }
 
     return result;
 } // getHeader
@@ -89,9 +95,35 @@ FitsHeaderExtractor::tryRawFits( QString fname )
     return fitsParser.getHeaderInfo().headerLines;
 }
 
-// Most of the code here was extracted from ImageFITS2Converter.cc from casaCore-1.7.0 source
-// tree. There are probably unused pieces of code/weird comments,etc...
-/// \todo clean up the code below
+QStringList
+FitsHeaderExtractor::tryMetaData()
+{
+    auto meta = std::dynamic_pointer_cast < CCMetaDataInterface > ( m_cartaImage-> metaData() );
+    if ( ! meta || ! meta-> getCoordinateSystem() ) {
+        m_errors << "Cannot produce FITS header for this image because"
+                 << "it has no casacore coordinate system.";
+        return QStringList();
+    }
+    const casa::CoordinateSystem & coords = * meta-> getCoordinateSystem();
+
+    // images computed from a cube may have fewer axes than its coordinate system
+    // (the extra ones are degenerate), but not more
+    const auto & dims = m_cartaImage-> dims();
+    if ( dims.size() > coords.nPixelAxes() ) {
+        m_errors << "The image has more axes than its coordinate system.";
+        return QStringList();
+    }
+    casa::IPosition shape( coords.nPixelAxes(), 1 );
+    for ( size_t i = 0 ; i < dims.size() ; i++ ) {
+        shape( i ) = dims[i];
+    }
+
+    return casaCoreFitsHeader( coords, shape,
+                               casa::Unit( m_cartaImage-> getPixelUnit().toStr().toStdString() ),
+                               casa::ImageInfo(), casa::TableRecord(),
+                               m_cartaImage-> hasMask() );
+} // tryMetaData
+
 QStringList
 FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
 {
@@ -108,10 +140,21 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
         return QStringList();
     }
 
-    // alias image to be reference to the image, since the original code used a reference
-    // rather than a pointer and I'm too lazy to convert everything to pointers :)
-    casa::ImageInterface < casa::Float > & image = * fii;
+    return casaCoreFitsHeader( fii-> coordinates(), fii-> shape(), fii-> units(),
+                               fii-> imageInfo(), fii-> miscInfo(), fii-> isMasked() );
+}
 
+// Most of the code here was extracted from ImageFITS2Converter.cc from casaCore-1.7.0 source
+// tree. There are probably unused pieces of code/weird comments,etc...
+/// \todo clean up the code below
+QStringList
+FitsHeaderExtractor::casaCoreFitsHeader( const casa::CoordinateSystem & coords,
+                                         const casa::IPosition & shape,
+                                         const casa::Unit & units,
+                                         const casa::ImageInfo & imageInfo,
+                                         const casa::TableRecord & miscInfo,
+                                         bool masked )
+{
     using namespace casa;
 
     QStringList errors;
@@ -132,7 +175,7 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
     // Get coordinates and test that axis removal has been
     // mercifully absent
     //
-    CoordinateSystem cSys = image.coordinates();
+    CoordinateSystem cSys = coords;
     if ( cSys.nWorldAxes() != cSys.nPixelAxes() ) {
     errors << "FITS requires that the number of world and pixel axes be"
     " identical.";
@@ -143,7 +186,6 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
     // Make degenerate axes last if requested
     // and make Stokes the very last if requested
     //
-    IPosition shape = image.shape();
     IPosition newShape = shape;
     const uInt ndim = shape.nelements();
 
@@ -221,7 +263,7 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
 
     //
     bool applyMask = false;
-    if ( image.isMasked() ) {
+    if ( masked ) {
         applyMask = true;
     }
 
@@ -275,7 +317,7 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
     }
 
     //
-    ImageInfo ii = image.imageInfo();
+    ImageInfo ii = imageInfo;
     String error;
     if ( ! ii.toFITS( error, header ) ) {
         return QStringList();
@@ -286,7 +328,7 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
 
     // I should FITS-ize the units
 
-    header.define( "BUNIT", upcase( image.units().getName() ).chars() );
+    header.define( "BUNIT", upcase( units.getName() ).chars() );
     header.setComment( "BUNIT", "Brightness (pixel) unit" );
 
     //
@@ -338,9 +380,9 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
     //
     // Add in the fields from miscInfo that we can
     //
-    const uInt nmisc = image.miscInfo().nfields();
+    const uInt nmisc = miscInfo.nfields();
     for ( i = 0 ; i < nmisc ; i++ ) {
-        String tmp0 = image.miscInfo().name( i );
+        String tmp0 = miscInfo.name( i );
         String miscname( tmp0.at( 0, 8 ) );
         if ( tmp0.length() > 8 ) {
             errors << "Truncating miscinfo field " << tmp0.c_str()
@@ -350,11 +392,11 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
         //
         if ( miscname != "end" && miscname != "END" ) {
             if ( ! header.isDefined( miscname ) ) {
-                DataType misctype = image.miscInfo().dataType( i );
+                DataType misctype = miscInfo.dataType( i );
                 switch ( misctype )
                 {
                 case TpBool :
-                    header.define( miscname, image.miscInfo().asBool( i ) );
+                    header.define( miscname, miscInfo.asBool( i ) );
                     break;
                 case TpChar :
                 case TpUChar :
@@ -362,19 +404,19 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
                 case TpUShort :
                 case TpInt :
                 case TpUInt :
-                    header.define( miscname, image.miscInfo().asInt( i ) );
+                    header.define( miscname, miscInfo.asInt( i ) );
                     break;
                 case TpFloat :
-                    header.define( miscname, image.miscInfo().asfloat( i ) );
+                    header.define( miscname, miscInfo.asfloat( i ) );
                     break;
                 case TpDouble :
-                    header.define( miscname, image.miscInfo().asdouble( i ) );
+                    header.define( miscname, miscInfo.asdouble( i ) );
                     break;
                 case TpComplex :
-                    header.define( miscname, image.miscInfo().asComplex( i ) );
+                    header.define( miscname, miscInfo.asComplex( i ) );
                     break;
                 case TpDComplex :
-                    header.define( miscname, image.miscInfo().asDComplex( i ) );
+                    header.define( miscname, miscInfo.asDComplex( i ) );
                     break;
                 case TpString :
                     if ( miscname.contains( "date" ) && miscname != "date" ) {
@@ -384,41 +426,41 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
                         // We only need to convert the date, the timesys we'll just
                         // copy through
                         if ( FITSDateUtil::convertDateString( outdate,
-                                                              image.miscInfo().asString( i ) ) ) {
+                                                              miscInfo.asString( i ) ) ) {
                             // Conversion worked - change the header
                             header.define( miscname, outdate );
                         }
                         else {
                             // conversion failed - just copy the existing date
-                            header.define( miscname, image.miscInfo().asString( i ) );
+                            header.define( miscname, miscInfo.asString( i ) );
                         }
                     }
                     else {
                         // Just copy non-date strings through
-                        header.define( miscname, image.miscInfo().asString( i ) );
+                        header.define( miscname, miscInfo.asString( i ) );
                     }
                     break;
 
                 // These should be the cases that we actually see. I don't think
                 // asArray* converts types.
                 case TpArrayBool :
-                    header.define( miscname, image.miscInfo().asArrayBool( i ) );
+                    header.define( miscname, miscInfo.asArrayBool( i ) );
                     break;
                 case TpArrayChar :
                 case TpArrayUShort :
                 case TpArrayInt :
                 case TpArrayUInt :
                 case TpArrayInt64 :
-                    header.define( miscname, image.miscInfo().toArrayInt( i ) );
+                    header.define( miscname, miscInfo.toArrayInt( i ) );
                     break;
                 case TpArrayFloat :
-                    header.define( miscname, image.miscInfo().asArrayfloat( i ) );
+                    header.define( miscname, miscInfo.asArrayfloat( i ) );
                     break;
                 case TpArrayDouble :
-                    header.define( miscname, image.miscInfo().asArraydouble( i ) );
+                    header.define( miscname, miscInfo.asArraydouble( i ) );
                     break;
                 case TpArrayString :
-                    header.define( miscname, image.miscInfo().asArrayString( i ) );
+                    header.define( miscname, miscInfo.asArrayString( i ) );
                     break;
                 default :
                 {
@@ -430,7 +472,7 @@ FitsHeaderExtractor::tryCasaCoreFitsConverter( casa::LatticeBase * lbase )
                 } // switch
             }
             if ( header.isDefined( miscname ) ) {
-                header.setComment( miscname, image.miscInfo().comment( i ) );
+                header.setComment( miscname, miscInfo.comment( i ) );
             }
         }
     }
@@ -8,7 +8,15 @@
 #include "CartaLib/IImage.h"
 #include <QStringList>
 
-namespace casa { class LatticeBase; }
+namespace casa
+{
+class LatticeBase;
+class CoordinateSystem;
+class IPosition;
+class ImageInfo;
+class TableRecord;
+class Unit;
+}
 
 class FitsHeaderExtractor
 {
@@ -38,6 +46,18 @@ private:
     QStringList tryRawFits( QString fname);
     QStringList tryCasaCoreFitsConverter( casa::LatticeBase * lbase);
 
+    /// header for an image that is not a casacore image, but shares the casacore
+    /// meta data of one (e.g. moment maps and derived images)
+    QStringList tryMetaData();
+
+    /// make the header from the pieces of a casacore image
+    QStringList casaCoreFitsHeader( const casa::CoordinateSystem & coords,
+                                    const casa::IPosition & shape,
+                                    const casa::Unit & units,
+                                    const casa::ImageInfo & imageInfo,
+                                    const casa::TableRecord & miscInfo,
+                                    bool masked );
+
     Carta::Lib::Image::ImageInterface::SharedPtr m_cartaImage = nullptr;
     QStringList m_errors;
 };
@@ -2,7 +2,7 @@
   error( "Could not find the common.pri file!" )
 }
 
-QT       += core gui
+QT       += core gui concurrent
 TARGET = plugin
 TEMPLATE = lib
 CONFIG += plugin
@@ -2,7 +2,6 @@
 
 /// and vector graphics
 /// \todo clean up the code that draws into QImage, only leave vector graphics code
-/// \todo convert this to astGetGrfContext/astGrfSet APIs?
 /// \todo combine this file with the C++ code that drives this
 
 #include "grfdriver.h"
@@ -12,7 +11,9 @@
 #include <string.h>
 #include <QPainter>
 
-static GrfDriverGlobals globals;
+// AST calls the grf functions below without any context, so each thread gets its own
+// copy of the globals, which lets different threads plot grids at the same time
+static thread_local GrfDriverGlobals globals;
 
 GrfDriverGlobals *
 grfGlobals()
@@ -20,6 +21,12 @@ grfGlobals()
     return & globals;
 }
 
+GrfDriverGlobals::~GrfDriverGlobals()
+{
+    delete painter;
+    delete image;
+}
+
 namespace VG = Carta::Lib::VectorGraphics;
 namespace VGE = VG::Entries;
 
@@ -47,6 +54,8 @@ void GrfDriverGlobals::prepare()
 
     // reset font index
      currentFontIndex = 0;
+     fontEntries.clear();
+     polylineBytes = 0;
 }
 
 static VG::VGComposer *
@@ -505,6 +514,12 @@ astGLine( int n, const float * x, const float * y )
             qpts[i].setY( y[i] );
         }
 
+        // AST samples curved grid lines much more finely than pixels at low zoom
+        qpts = grfGlobals()-> lineSimplifier.simplify( qpts );
+
+        // the shadow shares the vertices with the line
+        grfGlobals()-> polylineBytes += qpts.size() * sizeof( QPointF );
+
         if ( grfGlobals()-> lineShadowPenIndex >= 0 ) {
 //            QPen shadowPen( grfGlobals()-> lineShadowColor, grfGlobals()->penWidth +
 //                            grfGlobals()-> lineShadowWidth );
@@ -906,7 +921,8 @@ astGAttr( int attr, double value, double * old_value, int /* prim */ )
         if ( value != AST__BAD ) {
             int ind = value;
             grfGlobals()->currentFontIndex = ind;
-            vgc()-> append < VGE::SetFontIndex > ( ind );
+            int64_t pos = vgc()-> append < VGE::SetFontIndex > ( ind );
+            grfGlobals()-> fontEntries.push_back( std::make_pair( pos, ind ) );
         }
     }
 
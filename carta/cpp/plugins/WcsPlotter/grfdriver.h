@@ -3,6 +3,7 @@
 // new APIs for using vector graphics
 
 #include "CartaLib/VectorGraphics/VGList.h"
+#include "CartaLib/Algorithms/PolylineSimplifier.h"
 #include <QPen>
 #include <QFont>
 
@@ -10,6 +11,8 @@ struct GrfDriverGlobals {
     // externally configurable:
     // ========================
     int lineShadowPenIndex = 0;
+    // simplifies lines before they are drawn, tolerance is in output pixels
+    Carta::Lib::Algorithms::PolylineSimplifier lineSimplifier;
 
     // internal details - these are computed and set inside grfdriverSetVGComposer()
     // then they are used during the plot
@@ -20,9 +23,18 @@ struct GrfDriverGlobals {
     QPainter * painter = nullptr;
     Carta::Lib::VectorGraphics::VGComposer * vgComposer = nullptr;
 
+    /// positions of the SetFontIndex entries appended to vgComposer, and the font
+    /// value AST requested for each
+    std::vector < std::pair < int64_t, int > > fontEntries;
+
+    /// bytes of polyline vertices appended to vgComposer, the bulk of the output
+    int64_t polylineBytes = 0;
+
     /// call this righ before astPlot()
     void prepare();
+
+    ~GrfDriverGlobals();
 };
 
-// c-style singleton access
+// c-style singleton access, there is one instance per thread
 GrfDriverGlobals * grfGlobals();
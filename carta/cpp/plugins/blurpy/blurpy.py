@@ -10,6 +10,7 @@ import scipy
 import numpy as np
 from random import randrange
 
+# data is a (h, w, 4) uint8 array sharing memory with the rendered image (b,g,r,a)
 def no_preRenderHook(w, h, data):
     print("preRenderHook from blurpy.py", w, h, len(data))
 
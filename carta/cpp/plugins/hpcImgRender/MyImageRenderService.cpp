@@ -168,12 +168,11 @@ MyImageRenderService::render( JobId jobId )
 
 MyImageRenderService::MyImageRenderService( QObject * parent )
     : Carta::Lib::IImageRenderService( parent )
+      , m_frameCache( "hpc rendered frames" )
 {
     m_renderTimer.setSingleShot( true );
     m_renderTimer.setInterval( 1 );
     connect( & m_renderTimer, & QTimer::timeout, this, & Me::internalRenderSlot );
-
-    m_frameCache.setMaxCost( 1 * 1024 * 1024 * 1024 ); // 1 gig
 }
 
 MyImageRenderService::~MyImageRenderService()
@@ -251,17 +250,17 @@ MyImageRenderService::internalRenderSlot()
     }
 
 //    qDebug() << "internalRenderSlot... cache size: "
-//             << m_frameCache.totalCost() * 100.0 / m_frameCache.maxCost() << "% "
-//             << m_frameCache.size() << "entries";
+//             << m_frameCache.cacheBytes() << "bytes "
+//             << m_frameCache.cacheEntries() << "entries";
 //    qDebug() << "id:" << cacheId;
     struct Scope {
         ~Scope() { qDebug() << "internalRenderSlot done"; } }
     debugScopeGuard;
 
-    auto cachedImage = m_frameCache.object( cacheId );
-    if ( cachedImage ) {
+    QImage cachedImage;
+    if ( m_frameCache.find( cacheId, cachedImage ) ) {
         qDebug() << "frame cache hit";
-        emit done( * cachedImage, m_lastSubmittedJobId );
+        emit done( cachedImage, m_lastSubmittedJobId );
         return;
     }
     qDebug() << "frame cache miss";
@@ -371,5 +370,5 @@ MyImageRenderService::internalRenderSlot()
     }
 
     // insert this image into frame cache
-    m_frameCache.insert( cacheId, new QImage( img ), img.byteCount() );
+    m_frameCache.insert( cacheId, img, img.byteCount() );
 } // internalRenderSlot
@@ -2,8 +2,8 @@
 
 #include "CartaLib/IImageRenderService.h"
 #include "CartaLib/PixelPipeline/IPixelPipeline.h"
+#include "CartaLib/CacheRegistry.h"
 
-#include <QCache>
 #include <QTimer>
 
 
@@ -156,8 +156,9 @@ private:
     /// pan/zoom to work faster
     QImage m_frameImage;
 
-    /// cache for individual frames (to make movie playing little bit faster)
-    QCache < QString, QImage > m_frameCache;
+    /// cache for individual frames (to make movie playing little bit faster), its size
+    /// is governed by the global cache budget
+    Carta::Lib::LruCache < QString, QImage > m_frameCache;
 
     /// last requested job id
     JobId m_lastSubmittedJobId = - 1;
@@ -18,6 +18,8 @@ HEADERS += \
     MyImageRenderService.h \
     HpcImgRenderPlugin.h
 
+LIBS += -L$$OUT_PWD/../../CartaLib/ -lCartaLib
+
 OTHER_FILES += \
     plugin.json
 
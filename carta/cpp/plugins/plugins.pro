@@ -17,6 +17,7 @@ SUBDIRS += CyberSKA
 SUBDIRS += DevIntegration
 
 SUBDIRS += PCacheSqlite3
+SUBDIRS += PCacheLevelDb
 
 # adrianna's render plugin
 
@@ -1,9 +1,15 @@
 #include <Python.h>
 #include "PyCppPlugin.h"
+#include "CartaLib/IImage.h"
 #include "pluginBridge.h"
 #include "CartaLib/Hooks/ColormapsScalar.h"
+#include "CartaLib/Hooks/RawViewFunction.h"
 #include <QPainter>
 #include <QDebug>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <dlfcn.h>
 #include <csignal>
 
@@ -68,14 +74,91 @@ static void initPythonBridgeOnce()
     dlopen("libpython2.7.so", RTLD_LAZY | RTLD_GLOBAL);
 
     Py_InitializeEx( 0); // make ctrl-c work?
+    PyEval_InitThreads();
 
     // try to enable ctrl-c...
     enableCtrlC();
 
     // call cython generated code (pluginBridge.pyx)
     initpluginBridge();
+
+    // release the GIL, from now on every pb_ function grabs it on the calling thread
+    PyEval_SaveThread();
 }
 
+/// locks the GIL for the lifetime of the object, on any thread
+class GilLock
+{
+public:
+    GilLock() { m_state = PyGILState_Ensure(); }
+    ~GilLock() { PyGILState_Release( m_state); }
+private:
+    PyGILState_STATE m_state;
+};
+
+/// the thread running python hooks, shared by all python plugins, since they
+/// would be serialized by the GIL anyways
+static QThreadPool & pythonThread()
+{
+    static QThreadPool * pool = nullptr;
+    if( ! pool) {
+        pool = new QThreadPool;
+        pool-> setMaxThreadCount( 1);
+        pool-> setExpiryTimeout( -1);
+    }
+    return * pool;
+}
+
+/// how long the render path waits for a python pre-render hook before giving up
+/// on the current frame
+static const unsigned long PreRenderWaitMs = 50;
+
+/// a pre-render hook call executed on the python thread
+struct PyCppPlug::PreRenderJob : public QRunnable
+{
+    PreRenderJob( int modId, const QImage & img, qint64 p_frameId,
+                  std::function<void()> p_requestRepaint)
+        : m_modId( modId)
+        , frameId( p_frameId)
+        , output( img)
+        , requestRepaint( p_requestRepaint)
+    {
+        setAutoDelete( false);
+    }
+
+    virtual void run() override
+    {
+        // bits() detaches the image from the view's buffer, so the copy is made
+        // here, on the python thread
+        uchar * bits = output.bits();
+        bool ok = pb_callPreRenderHook( m_modId, output.width(), output.height(),
+                                        output.bytesPerLine(), bits);
+        QMutexLocker locker( & mutex);
+        success = ok;
+        finished = true;
+        finishedCond.wakeAll();
+        bool repaint = repaintWhenDone && success && requestRepaint;
+        locker.unlock();
+        if( repaint) {
+            requestRepaint();
+        }
+    }
+
+    int m_modId;
+    /// the frame the hook was called on
+    const qint64 frameId;
+    /// the image modified by python
+    QImage output;
+    /// asks the view to render the frame again
+    const std::function<void()> requestRepaint;
+    QMutex mutex;
+    QWaitCondition finishedCond;
+    bool finished = false;
+    bool success = false;
+    /// set when the render path stopped waiting for the result
+    bool repaintWhenDone = false;
+};
+
 PyCppPlug::PyCppPlug(const LoadPlugin::Params & params)
     : QObject( nullptr)
     , m_params( params)
@@ -120,10 +203,12 @@ public:
     ColormapHelper( int pluginId, PyObject * obj) {
         m_pluginId = pluginId;
         m_pyObj = obj;
+        GilLock gil;
         Py_XINCREF( m_pyObj);
     }
 
     virtual ~ColormapHelper() {
+        GilLock gil;
         Py_XDECREF( m_pyObj);
     }
 
@@ -159,10 +244,14 @@ bool PyCppPlug::handleHook(BaseHook & hookData)
         p.fillRect( rect, QColor( 0,0,0,128));
         p.setPen( QColor( "yellow"));
         p.drawText( hook.paramsPtr->imgPtr->rect(), Qt::AlignLeft | Qt::AlignTop, txt);
+        p.end();
 
         QImage & img = * (hook.paramsPtr->imgPtr);
-        pb_callPreRenderHook( m_pyModId, img.width(), img.height(),
-                              img.bytesPerLine(), img.bits());
+        if( img.depth() != 32) {
+            qWarning() << "PyCppPlug: pre-render hook needs 32 bit images";
+            return false;
+        }
+        preRender( img, hook.paramsPtr->frameId, hook.paramsPtr->requestRepaint);
 
         return true;
     }
@@ -175,12 +264,23 @@ bool PyCppPlug::handleHook(BaseHook & hookData)
         qDebug() << "found" << rawList.size() << "colormaps";
         // wrap them up
         for( PyObject * pyCmap : rawList) {
-            qDebug() << "pycmap refcnt" << Py_REFCNT(pyCmap);
             auto wrappedCmap = std::make_shared<colormap_impl::ColormapHelper>( m_pyModId, pyCmap);
             hook.result.push_back( wrappedCmap);
         }
         return true;
     }
+
+    if( hookData.is<Carta::Lib::Hooks::RawViewFunction>()) {
+        Carta::Lib::Hooks::RawViewFunction & hook =
+                static_cast<Carta::Lib::Hooks::RawViewFunction &>( hookData);
+        // let the next plugin try if this module does not have the function
+        if( ! pb_hasFunction( m_pyModId, hook.paramsPtr-> funcName.toStdString())) {
+            return false;
+        }
+        hook.result = callRawViewFunction( hook.paramsPtr-> funcName, hook.paramsPtr-> view,
+                                           hook.paramsPtr-> chunkSize);
+        return true;
+    }
     qWarning() << "PyCppPlug:: Sorrry, don't know how to handle this hook" << hookData.hookId();
     return false;
 }
@@ -201,6 +301,9 @@ std::vector<HookId> PyCppPlug::getInitialHookList()
         qWarning() << "PyCppPlug: does not have colormaps";
     }
 
+    // any module function can be called on raw views, we only find out when it's asked for
+    list.push_back( Carta::Lib::Hooks::RawViewFunction::staticId);
+
     // return the list
     return list;
 }
@@ -208,3 +311,73 @@ std::vector<HookId> PyCppPlug::getInitialHookList()
 void PyCppPlug::initialize(const IPlugin::InitInfo & /*InitInfo*/)
 {
 }
+
+PyCppPlug::~PyCppPlug()
+{
+    // the job could still be running on the python thread
+    if( m_preRenderJob) {
+        QMutexLocker locker( & m_preRenderJob-> mutex);
+        while( ! m_preRenderJob-> finished) {
+            m_preRenderJob-> finishedCond.wait( & m_preRenderJob-> mutex);
+        }
+    }
+}
+
+void PyCppPlug::preRender( QImage & img, qint64 frameId, std::function<void()> requestRepaint)
+{
+    // pick up the result of the last job, if it's done
+    if( m_preRenderJob) {
+        QMutexLocker locker( & m_preRenderJob-> mutex);
+        if( m_preRenderJob-> finished) {
+            if( m_preRenderJob-> success) {
+                m_lastPreRenderFrameId = m_preRenderJob-> frameId;
+                m_lastPreRenderOutput = m_preRenderJob-> output;
+            }
+            locker.unlock();
+            m_preRenderJob.reset();
+        }
+    }
+
+    // python already processed this frame
+    if( frameId >= 0 && frameId == m_lastPreRenderFrameId) {
+        img = m_lastPreRenderOutput;
+        return;
+    }
+
+    // python is still busy with an older frame, this one goes out unmodified, the
+    // busy job asks for a repaint when it's done and we'll get another chance
+    if( m_preRenderJob) {
+        return;
+    }
+
+    // run python on its own thread, and wait for it only for a little while,
+    // slow filters finish in the background and ask for the frame to be repainted
+    m_preRenderJob = std::make_shared<PreRenderJob>( m_pyModId, img, frameId, requestRepaint);
+    pythonThread().start( m_preRenderJob.get());
+    QMutexLocker locker( & m_preRenderJob-> mutex);
+    if( ! m_preRenderJob-> finished) {
+        m_preRenderJob-> finishedCond.wait( & m_preRenderJob-> mutex, PreRenderWaitMs);
+    }
+    if( m_preRenderJob-> finished) {
+        if( m_preRenderJob-> success) {
+            m_lastPreRenderFrameId = m_preRenderJob-> frameId;
+            m_lastPreRenderOutput = m_preRenderJob-> output;
+            img = m_lastPreRenderOutput;
+        }
+        locker.unlock();
+        m_preRenderJob.reset();
+    }
+    else {
+        m_preRenderJob-> repaintWhenDone = true;
+    }
+}
+
+bool PyCppPlug::callRawViewFunction( const QString & funcName,
+                                     Carta::Lib::NdArray::RawViewInterface * view,
+                                     int64_t chunkSize)
+{
+    if( ! view) {
+        return false;
+    }
+    return pb_callRawViewFunction( m_pyModId, funcName.toStdString(), view, chunkSize);
+}
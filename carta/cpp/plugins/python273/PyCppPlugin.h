@@ -4,6 +4,11 @@
 
 #include "CartaLib/IPlugin.h"
 #include "CartaLib/Hooks/LoadPlugin.h"
+#include <QImage>
+#include <functional>
+#include <memory>
+
+namespace Carta { namespace Lib { namespace NdArray { class RawViewInterface; } } }
 
 ///
 /// this is a plugin returned as a result of the hook call when loading a python plugin
@@ -19,10 +24,33 @@ class PyCppPlug : public QObject, public IPlugin
 public:
 
     PyCppPlug( const Carta::Lib::Hooks::LoadPlugin::Params & params);
+    virtual ~PyCppPlug();
     virtual bool handleHook(BaseHook & hookData) override;
     virtual std::vector<HookId> getInitialHookList() override;
     virtual void initialize( const InitInfo & InitInfo) override;
 
+    /// call the python function funcName of this plugin with the pixels of the view,
+    /// as float32 numpy arrays of at most chunkSize values, in-memory float planes are
+    /// passed as a single n-dimensional array without copying
+    /// \return false if the function does not exist or raised an exception
+    bool callRawViewFunction( const QString & funcName,
+                              Carta::Lib::NdArray::RawViewInterface * view,
+                              int64_t chunkSize = 1024 * 1024);
+
     Carta::Lib::Hooks::LoadPlugin::Params m_params;
     int m_pyModId = -1;
+
+private:
+
+    /// run the python pre-render hook on the image, on the python thread
+    void preRender( QImage & img, qint64 frameId, std::function<void()> requestRepaint);
+
+    struct PreRenderJob;
+
+    /// pre-render hook call in progress, if any
+    std::shared_ptr<PreRenderJob> m_preRenderJob;
+
+    /// the last frame python processed, and the result
+    qint64 m_lastPreRenderFrameId = -1;
+    QImage m_lastPreRenderOutput;
 };
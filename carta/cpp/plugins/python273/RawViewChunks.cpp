@@ -0,0 +1,66 @@
+#include "RawViewChunks.h"
+#include "CartaLib/FloatRawView.h"
+#include <algorithm>
+#include <vector>
+
+namespace PyBridge
+{
+
+void forEachFloatChunk( Carta::Lib::NdArray::RawViewInterface * view,
+                        int64_t chunkSize,
+                        FloatChunkCallback callback,
+                        void * ctx)
+{
+    CARTA_ASSERT( view && callback);
+    chunkSize = std::max<int64_t>( chunkSize, 1);
+
+    // shape of the whole view in C order
+    const auto & dims = view-> dims();
+    std::vector<int64_t> shape;
+    int64_t total = 1;
+    for( auto it = dims.rbegin() ; it != dims.rend() ; ++ it) {
+        shape.push_back( std::max( * it, 1));
+        total *= shape.back();
+    }
+    if( dims.empty() || total <= 0) {
+        return;
+    }
+
+    // the whole plane is already in memory as floats, hand it out as is
+    auto floatView = dynamic_cast<Carta::Lib::NdArray::FloatRawView *>( view);
+    if( floatView && floatView-> isContiguous()) {
+        callback( floatView-> data()-> data(), shape.data(), shape.size(), ctx);
+        return;
+    }
+
+    // sliced float views copy runs of rows into the chunk buffer
+    if( floatView) {
+        floatView-> forEach(
+            chunkSize * sizeof( float),
+            [&] ( const char * buff, int64_t count) {
+                callback( reinterpret_cast<const float *>( buff), & count, 1, ctx);
+            });
+        return;
+    }
+
+    // anything else is converted pixel by pixel
+    std::vector<float> buffer;
+    buffer.reserve( std::min( chunkSize, total));
+    auto flush = [&] () {
+        int64_t count = buffer.size();
+        callback( buffer.data(), & count, 1, ctx);
+        buffer.clear();
+    };
+    Carta::Lib::NdArray::Float typedView( view, false);
+    typedView.forEach( [&] ( const float & val) {
+        buffer.push_back( val);
+        if( int64_t( buffer.size()) == chunkSize) {
+            flush();
+        }
+    });
+    if( ! buffer.empty()) {
+        flush();
+    }
+}
+
+}
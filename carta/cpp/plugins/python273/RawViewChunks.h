@@ -0,0 +1,33 @@
+/// helpers for handing pixels of raw views to python without going through
+/// python objects for every pixel
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+#include <cstdint>
+
+namespace PyBridge
+{
+
+/// callback receiving a chunk of pixels
+/// \param data the pixels, only valid during the call
+/// \param shape shape of the chunk in C order (slowest varying axis first)
+/// \param ndim number of entries in shape
+/// \param ctx the context passed to forEachFloatChunk()
+typedef void (* FloatChunkCallback)( const float * data, const int64_t * shape,
+                                     int ndim, void * ctx);
+
+/// Calls the callback with the pixels of the view, converted to floats, in chunks
+/// of at most chunkSize values (1D chunks, first axis of the view varies fastest).
+///
+/// If the view is a FloatRawView covering all of its data (e.g. a plane from the
+/// PlaneCache), the callback is called exactly once with the whole n-dimensional
+/// array and nothing is copied, regardless of chunkSize.
+///
+/// This does not touch python at all, so the GIL should be released while it runs.
+void forEachFloatChunk( Carta::Lib::NdArray::RawViewInterface * view,
+                        int64_t chunkSize,
+                        FloatChunkCallback callback,
+                        void * ctx);
+
+}
@@ -66,7 +66,7 @@ class Modd(object):
         return hasattr(self.loadedMod, 'preRenderHook')
 
 
-cdef public int pb_loadModule( string fname, string modName):
+cdef public int pb_loadModule( string fname, string modName) with gil:
     # mod = importlib.import_module( fname)
     # mod = imp.load_source( modName, fname)
     print( "pb_loadModule", fname, modName)
@@ -77,7 +77,7 @@ cdef public int pb_loadModule( string fname, string modName):
         mods[ mod.getId()] = mod
     return mod.getId()
 
-cdef public bool pb_hasPreRenderHook( int id):
+cdef public bool pb_hasPreRenderHook( int id) with gil:
     if not id in mods:
         return False
     return mods[id].hasPreRenderHook()
@@ -110,22 +110,170 @@ np.import_array()
 #
 #     return True
 
-cdef public bool pb_callPreRenderHook( int id, int w, int h, int stride, unsigned char * data):
-    print("pb_callPreRenderHook id=", id, w, h)
+# ======================================================================
+# zero-copy access to memory owned by c++
+# ======================================================================
+
+from libc.stdint cimport int64_t
+from cpython.buffer cimport PyBUF_WRITABLE, PyBUF_FORMAT
+
+cdef enum:
+    MAX_BUFFER_DIMS = 8
+
+# Exposes memory owned by c++ through the buffer protocol, so that np.asarray()
+# can wrap it without copying. The memory is only valid during the call that
+# handed the buffer to python, the bridge calls release() right after, and
+# getting the buffer after that raises. Arrays must not be kept around.
+cdef class CppBuffer:
+    cdef char * data
+    cdef bint readonly
+    cdef int ndim
+    cdef Py_ssize_t itemsize
+    cdef const char * format
+    cdef Py_ssize_t shape[MAX_BUFFER_DIMS]
+    cdef Py_ssize_t strides[MAX_BUFFER_DIMS]
+    cdef int exports
+
+    def __cinit__(self):
+        self.data = NULL
+        self.exports = 0
+
+    def __getbuffer__(self, Py_buffer * buffer, int flags):
+        if self.data == NULL:
+            raise ValueError("c++ buffer is no longer valid")
+        if self.readonly and (flags & PyBUF_WRITABLE):
+            raise BufferError("c++ buffer is read only")
+        cdef Py_ssize_t length = self.itemsize
+        cdef int i
+        for i in range(self.ndim):
+            length *= self.shape[i]
+        buffer.buf = self.data
+        buffer.obj = self
+        buffer.len = length
+        buffer.readonly = self.readonly
+        buffer.itemsize = self.itemsize
+        buffer.format = <char *> self.format if (flags & PyBUF_FORMAT) else NULL
+        buffer.ndim = self.ndim
+        buffer.shape = self.shape
+        buffer.strides = self.strides
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+        self.exports += 1
+
+    def __releasebuffer__(self, Py_buffer * buffer):
+        self.exports -= 1
+
+    cdef release(self):
+        self.data = NULL
+        if self.exports > 0:
+            print("warning: python kept", self.exports, "array(s) of c++ memory past the call")
+
+# wrap a 32 bit per pixel QImage, as a writable (h, w, 4) array
+# note: channels are in memory order, i.e. b,g,r,a on little endian machines
+cdef CppBuffer rgbaBuffer(unsigned char * data, int w, int h, int stride):
+    cdef CppBuffer buf = CppBuffer()
+    buf.data = <char *> data
+    buf.readonly = False
+    buf.itemsize = 1
+    buf.format = b"B"
+    buf.ndim = 3
+    buf.shape[0], buf.shape[1], buf.shape[2] = h, w, 4
+    buf.strides[0], buf.strides[1], buf.strides[2] = stride, 4, 1
+    return buf
+
+# wrap a c-ordered array of floats as a read only array
+cdef CppBuffer floatBuffer(const float * data, const int64_t * shape, int ndim):
+    if ndim < 1 or ndim > MAX_BUFFER_DIMS:
+        raise ValueError("unsupported number of dimensions: %d" % ndim)
+    cdef CppBuffer buf = CppBuffer()
+    buf.data = <char *> data
+    buf.readonly = True
+    buf.itemsize = sizeof(float)
+    buf.format = b"f"
+    buf.ndim = ndim
+    cdef Py_ssize_t stride = buf.itemsize
+    cdef int i
+    for i in reversed(range(ndim)):
+        buf.shape[i] = shape[i]
+        buf.strides[i] = stride
+        stride *= shape[i]
+    return buf
+
+# called with the GIL released from the worker thread (or any other thread)
+cdef public bool pb_callPreRenderHook( int id, int w, int h, int stride, unsigned char * data) with gil:
     if not id in mods:
         print("!!! could not find mod", id)
         return False
-    print("weird", hasattr( mods[id].loadedMod, 'preRenderHook'), mods[id], mods[id].loadedMod)
-    cdef int len = w * h * 3
-    # cdef unsigned char[::1] mv = <unsigned char[:len]> data
-    cdef unsigned char[:,:,:] mv = <unsigned char[:h,:w,:3]> data
-    mv.strides[0] = stride
-    nv = np.asarray( mv)
-    # nv.shape = (h,w,3)
-    mods[id].loadedMod.preRenderHook(w, h, nv)
+    cdef CppBuffer buf = rgbaBuffer(data, w, h, stride)
+    try:
+        mods[id].loadedMod.preRenderHook(w, h, np.asarray(buf))
+    except Exception as e:
+        print("preRenderHook failed:", e)
+        return False
+    finally:
+        buf.release()
 
     return True
 
+# ======================================================================
+# raw views
+# ======================================================================
+
+cdef extern from "CartaLib/IImage.h" namespace "Carta::Lib::NdArray":
+    cdef cppclass RawViewInterface:
+        pass
+
+cdef extern from "RawViewChunks.h" namespace "PyBridge":
+    ctypedef void (*FloatChunkCallback)(const float *, const int64_t *, int, void *)
+    void forEachFloatChunk(RawViewInterface *, int64_t, FloatChunkCallback, void *) nogil
+
+# python function receiving the chunks, stops calling it after the first failure
+cdef class ChunkConsumer:
+    cdef object func
+    cdef bint failed
+
+    def __cinit__(self, func):
+        self.func = func
+        self.failed = False
+
+cdef void floatChunkCallback(const float * data, const int64_t * shape, int ndim, void * ctx) with gil:
+    cdef ChunkConsumer consumer = <ChunkConsumer> ctx
+    if consumer.failed:
+        return
+    cdef CppBuffer buf
+    try:
+        buf = floatBuffer(data, shape, ndim)
+        try:
+            consumer.func(np.asarray(buf))
+        finally:
+            buf.release()
+    except Exception as e:
+        print("raw view chunk function failed:", e)
+        consumer.failed = True
+
+# does the module have a function called funcName
+cdef public bool pb_hasFunction( int id, string funcName) with gil:
+    if not id in mods:
+        return False
+    return callable(getattr(mods[id].loadedMod, funcName, None))
+
+# Calls the module's function funcName with the pixels of the view, as read only
+# float32 arrays of at most chunkSize values. A view of an entire in-memory plane
+# arrives as a single n-dimensional array (C order, i.e. arr[y, x]) without copying.
+# The GIL is released while c++ reads the pixels.
+cdef public bool pb_callRawViewFunction( int id, string funcName, RawViewInterface * view,
+                                         int64_t chunkSize) with gil:
+    if not id in mods:
+        return False
+    func = getattr(mods[id].loadedMod, funcName, None)
+    if func is None:
+        return False
+    cdef ChunkConsumer consumer = ChunkConsumer(func)
+    cdef void * ctx = <void *> consumer
+    with nogil:
+        forEachFloatChunk(view, chunkSize, floatChunkCallback, ctx)
+    return not consumer.failed
+
 # # pyData = data
 # print( "Last line of pluginBridge.pyx...." )
 
@@ -135,7 +283,7 @@ cdef public bool pb_callPreRenderHook( int id, int w, int h, int stride, unsigne
 
 
 # check if the plugin has ColormapScalarHook
-cdef public bool pb_hasColormapScalarHook( int id):
+cdef public bool pb_hasColormapScalarHook( int id) with gil:
     if not id in mods:
         return False
     return hasattr(mods[id].loadedMod, 'colormapScalarHook')
@@ -145,7 +293,7 @@ from cpython.ref cimport PyObject
 list = None
 
 # get all colormaps this plugin implements
-cdef public vector[PyObject*] pb_colormapScalarGetColormaps(int id):
+cdef public vector[PyObject*] pb_colormapScalarGetColormaps(int id) with gil:
     cdef vector[PyObject*] result
     if not id in mods:
         return result
@@ -157,11 +305,11 @@ cdef public vector[PyObject*] pb_colormapScalarGetColormaps(int id):
 
 
 # get a name of the colormap
-cdef public string pb_colormapScalarGetName( PyObject * pyobj):
+cdef public string pb_colormapScalarGetName( PyObject * pyobj) with gil:
     return (<object>pyobj).name()
 
 # run the convert function
-cdef public void pb_colormapScalarConvert( PyObject * pyobj, double val, double * result):
+cdef public void pb_colormapScalarConvert( PyObject * pyobj, double val, double * result) with gil:
     a = (<object>pyobj).convert( val)
     result[0] = a[0]
     result[1] = a[1]
@@ -185,5 +333,5 @@ cdef public object pb_testGetObj():
     # return temp
     return TestClass()
 
-cdef public string pb_testRunMethod( PyObject * pyo, double x):
+cdef public string pb_testRunMethod( PyObject * pyo, double x) with gil:
     return (<object>pyo).method(x)
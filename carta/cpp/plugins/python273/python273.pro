@@ -8,6 +8,7 @@ unix:macx{
 }
 
 LIBS += -lpython2.7
+LIBS += -L$$OUT_PWD/../../CartaLib/ -lCartaLib
 INCLUDEPATH += $$PROJECT_ROOT
 DEPENDPATH += $$PROJECT_ROOT
 
@@ -19,11 +20,13 @@ CONFIG += plugin
 
 SOURCES += \
     Python273Plugin.cpp \
-    PyCppPlugin.cpp
+    PyCppPlugin.cpp \
+    RawViewChunks.cpp
 
 HEADERS += \
      Python273Plugin.h \
     PyCppPlugin.h \
+    RawViewChunks.h \
     pragmaHack.h
 
 OTHER_FILES += \
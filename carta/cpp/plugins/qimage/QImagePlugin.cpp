@@ -321,6 +321,10 @@ public:
         return * this;
     }
 
+    // don't hide the batched versions
+    using CoordinateFormatterInterface::toWorld;
+    using CoordinateFormatterInterface::toPixel;
+
     virtual bool
     toWorld( const VD & pixel, VD & world ) const override
     {
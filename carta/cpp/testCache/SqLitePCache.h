@@ -1,51 +0,0 @@
-/**
- *
- **/
-
-#pragma once
-
-#include "CartaLib/IPCache.h"
-
-#include <QSqlDatabase>
-namespace tCache
-{
-class SqLitePCache : public Carta::Lib::IPCache
-{
-public:
-
-    SqLitePCache();
-
-    virtual uint64_t
-    maxStorage() override
-    {
-        return 1;
-    }
-
-    virtual uint64_t
-    usedStorage() override
-    {
-        return 1;
-    }
-
-    virtual uint64_t
-    nEntries() override
-    {
-        return 1;
-    }
-
-    virtual void
-    deleteAll() override
-    {
-        // not implemented
-    }
-
-    virtual bool
-    readEntry( const QByteArray & key, QByteArray & val ) override;
-
-    virtual void
-    setEntry( const QByteArray & key, const QByteArray & val, int64_t priority ) override;
-
-private:
-    QSqlDatabase m_db;
-};
-}
@@ -5,35 +5,65 @@
 #include "core/CmdLine.h"
 #include "core/MainConfig.h"
 #include "core/Globals.h"
-#include "LevelDbIPCache.h"
-#include "SqLitePCache.h"
 #include <QDebug>
-#include <QTime>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <typeinfo>
 
 namespace tCache
 {
-std::shared_ptr < Carta::Lib::IPCache > pcache;
+/// a cube whose spectral profiles get cached, one entry per pixel
+struct Cube {
+    int width, height, depth;
 
-//int imWidth = 20;
-//int imHeight = 8000;
-//int imDepth = 16000;
-
-int imWidth = 20;
-int imHeight = 20;
-int imDepth = 16000;
+    int64_t
+    profileBytes() const
+    {
+        return sizeof( double ) * depth;
+    }
+};
 
-double
-generateData( int x, int y, int z )
+/// cubes to benchmark with, they can be overridden by setting TCACHE_CUBES,
+/// e.g. TCACHE_CUBES=64x64x1000,512x512x2000
+static std::vector < Cube >
+benchmarkCubes()
 {
-    return ( x + 0.1 ) * ( y - 0.1 ) / ( z * x + 0.1 );
-}
+    std::vector < Cube > cubes = { { 64, 64, 1000 }, { 128, 128, 4000 } };
+    QString env = qgetenv( "TCACHE_CUBES" );
+    if ( env.isEmpty() ) {
+        return cubes;
+    }
+    cubes.clear();
+    for ( const QString & spec : env.split( ',', QString::SkipEmptyParts ) ) {
+        QStringList dims = spec.split( 'x' );
+        Cube cube { 0, 0, 0 };
+        if ( dims.size() == 3 ) {
+            cube = { dims[0].toInt(), dims[1].toInt(), dims[2].toInt() };
+        }
+        if ( cube.width <= 0 || cube.height <= 0 || cube.depth <= 0 ) {
+            qWarning() << "Bad cube size" << spec;
+            continue;
+        }
+        cubes.push_back( cube );
+    }
+    return cubes;
+} // benchmarkCubes
 
+/// a spectral line plus noise, so that the profiles compress like real data
 static std::vector < double >
-genProfile( int x, int y )
+genProfile( const Cube & cube, int x, int y )
 {
-    std::vector < double > arr( imDepth );
-    for ( int z = 0 ; z < imDepth ; z++ ) {
-        arr[z] = generateData( x, y, z );
+    std::mt19937 gen( x * 65537 + y );
+    std::normal_distribution < double > noise( 0.0, 0.05 );
+    double center = cube.depth * ( 0.3 + 0.4 * x / cube.width );
+    double width = cube.depth / 50.0 + 1;
+    std::vector < double > arr( cube.depth );
+    for ( int z = 0 ; z < cube.depth ; z++ ) {
+        double d = ( z - center ) / width;
+        arr[z] = std::exp( - d * d / 2 ) + noise( gen );
     }
     return arr;
 }
@@ -62,140 +92,150 @@ qb2vd( const QByteArray & ba )
     return vd;
 }
 
-static std::vector < double >
-readProfile( int x, int y )
+static QByteArray
+profileKey( const Cube & cube, int x, int y )
 {
-    QString key = QString( "%1/%2" ).arg( x ).arg( y );
-    QByteArray val;
-    if ( ! pcache-> readEntry( key.toUtf8(), val ) ) {
-        return { };
-    }
-    if ( val.size() != int (sizeof( double ) * imDepth) ) {
-        qWarning() << "Cache size mismatch";
-        return { };
-    }
-
-//    std::vector<double> res(imWidth);
-//    const double * dptr = reinterpret_cast<const double*> (val.constData());
-//    for( int z = 0 ; z < imDepth ; z ++ ) {
-//        res[z] = * dptr;
-//        dptr ++;
-//    }
+    return QString( "bench/%1x%2x%3/%4/%5" )
+               .arg( cube.width ).arg( cube.height ).arg( cube.depth )
+               .arg( x ).arg( y ).toUtf8();
+}
 
-    return qb2vd( val );
-} // readProfile
+/// results of one workload, only the time spent in the cache is counted
+struct Timing {
+    const char * name = "";
+    int64_t ops = 0;
+    int64_t bytes = 0;
+    int64_t misses = 0;
+    int64_t mismatches = 0;
+    int64_t nsecs = 0;
+};
 
 static void
-populateCache()
+report( const Timing & t )
 {
-    // figure out which row we have already finished generating
-
-    int startx = 0;
+    double secs = std::max( t.nsecs, int64_t( 1 ) ) / 1e9;
+    std::printf( "  %-12s %9lld ops %10.1f ops/s %9.1f MB/s %8lld misses %6lld bad\n",
+                 t.name, (long long) t.ops, t.ops / secs, t.bytes / secs / 1e6,
+                 (long long) t.misses, (long long) t.mismatches );
+    std::fflush( stdout );
+}
 
-    QByteArray buff;
-    if ( pcache-> readEntry( "lastx", buff ) ) {
-        QString str = buff;
-        bool ok;
-        int x = str.toInt( & ok );
-        if ( ok ) {
-            startx = x;
-        }
+/// read one profile and check it against the generated one
+static void
+timedRead( Carta::Lib::IPCache & pcache, const Cube & cube, int x, int y, bool verify, Timing & t )
+{
+    QByteArray val;
+    QElapsedTimer timer;
+    timer.start();
+    bool found = pcache.readEntry( profileKey( cube, x, y ), val );
+    t.nsecs += timer.nsecsElapsed();
+    t.ops++;
+    if ( ! found ) {
+        t.misses++;
+        return;
     }
-
-    qDebug() << "Starting from x" << startx;
-    for ( int x = startx ; x < imWidth ; x++ ) {
-        qDebug() << "Writing x" << x;
-        for ( int y = 0 ; y < imHeight ; y++ ) {
-            std::vector < double > arr = genProfile( x, y );
-
-            // write the entry
-            QString keyString = QString( "%1/%2" ).arg( x ).arg( y );
-            pcache-> setEntry( keyString.toUtf8(), vd2qb( arr ), 0 );
-        }
-        pcache-> setEntry( "lastx", QString::number( x + 1 ).toUtf8(), 0 );
+    t.bytes += val.size();
+    if ( verify && qb2vd( val ) != genProfile( cube, x, y ) ) {
+        t.mismatches++;
     }
-} // populateCache
+}
 
 static void
-readCache()
+timedWrite( Carta::Lib::IPCache & pcache, const Cube & cube, int x, int y, Timing & t )
 {
-    QTime t;
-    t.restart();
-    qDebug() << "Sequential read...";
-    for ( int x = 0 ; x < imWidth ; x++ ) {
-        qDebug() << "Testing x" << x;
-        for ( int y = 0 ; y < imHeight ; y++ ) {
-            std::vector < double > arr = genProfile( x, y );
-            QString keyString = QString( "%1/%2" ).arg( x ).arg( y );
-
-            QByteArray ba;
-            if ( ! pcache-> readEntry( keyString.toUtf8(), ba ) ) {
-                qCritical() << "Failed to read" << x << y;
-                continue;
-            }
-            std::vector < double > arr2 = qb2vd( ba );
-            if ( arr != arr2 ) {
-                qCritical() << "Failed to match" << x << y;
-            }
-
-            /*
-
-            QByteArray ba = QByteArray::fromRawData(
-                reinterpret_cast < char * > ( & arr[0] ),
-                sizeof( double ) * imDepth );
+    QByteArray key = profileKey( cube, x, y );
+    QByteArray val = vd2qb( genProfile( cube, x, y ) );
+    QElapsedTimer timer;
+    timer.start();
+    pcache.setEntry( key, val, 0 );
+    t.nsecs += timer.nsecsElapsed();
+    t.ops++;
+    t.bytes += val.size();
+}
 
-            QString keyString = QString( "%1/%2" ).arg( x ).arg( y );
-            QByteArray ba2;
-            if( ! pcache-> readEntry( keyString.toUtf8(), ba2)) {
-                qCritical() << "Failed to read" << x << y;
-            }
-            if( ba != ba2) {
-                qCritical() << "Failed to match" << x << y << ba.size() << ba2.size();
-                qDebug() << * (const double *) (ba.constData());
-                qDebug() << * (const double *) (ba2.constData());
-            }
-            */
+/// write the profiles of the whole cube, as when it is first loaded; buffered writes
+/// are flushed (and timed), so that the reads that follow hit the database
+static Timing
+bulkWrite( Carta::Lib::IPCache & pcache, const Cube & cube )
+{
+    Timing t;
+    t.name = "bulk write";
+    for ( int x = 0 ; x < cube.width ; x++ ) {
+        for ( int y = 0 ; y < cube.height ; y++ ) {
+            timedWrite( pcache, cube, x, y, t );
         }
-        qDebug() << "  " << ( x + 1 ) * imHeight * 1000.0 / t.elapsed() << "pix/s";
     }
-} // readCache
+    QElapsedTimer timer;
+    timer.start();
+    pcache.flush();
+    t.nsecs += timer.nsecsElapsed();
+    return t;
+}
 
-static void
-testCache()
+/// read profiles at random positions, as when the cursor moves around the image
+static Timing
+randomRead( Carta::Lib::IPCache & pcache, const Cube & cube, int count )
 {
-//    pcache.reset(
-//        new LevelDbIPCache() );
-
-//    pcache.reset(
-//        new SqLitePCache() );
+    Timing t;
+    t.name = "random read";
+    std::mt19937 gen( 1 );
+    for ( int i = 0 ; i < count ; i++ ) {
+        int x = gen() % cube.width;
+        int y = gen() % cube.height;
+        timedRead( pcache, cube, x, y, i % 100 == 0, t );
+    }
+    return t;
+}
 
-    {
-        pcache-> setEntry( "hello", "world", 0 );
-        QByteArray val;
-        if ( pcache-> readEntry( "hello", val ) ) {
-            qDebug() << "hello=" << val;
+/// mostly reads, with some of the profiles computed and written again
+static Timing
+mixed( Carta::Lib::IPCache & pcache, const Cube & cube, int count, double writeFraction )
+{
+    Timing t;
+    t.name = "mixed";
+    std::mt19937 gen( 2 );
+    std::uniform_real_distribution < double > coin( 0.0, 1.0 );
+    for ( int i = 0 ; i < count ; i++ ) {
+        int x = gen() % cube.width;
+        int y = gen() % cube.height;
+        if ( coin( gen ) < writeFraction ) {
+            timedWrite( pcache, cube, x, y, t );
         }
         else {
-            qDebug() << "hello not found";
+            timedRead( pcache, cube, x, y, i % 100 == 0, t );
         }
     }
+    return t;
+}
 
-    // populate cache
-    populateCache();
-
-    // test cache by reading it
-    readCache();
-
-    QByteArray key = "hello";
+static void
+benchmark( Carta::Lib::IPCache & pcache )
+{
+    // sanity check
+    pcache.setEntry( "hello", "world", 0 );
     QByteArray val;
-    if ( pcache-> readEntry( key, val ) ) {
-        qDebug() << "db already had value" << val;
+    if ( ! pcache.readEntry( "hello", val ) || val != "world" ) {
+        qCritical() << "Cache does not return what was written";
     }
-    else {
-        qDebug() << "db did not have value";
+
+    for ( const Cube & cube : benchmarkCubes() ) {
+        // every cube starts from an empty cache, so that the numbers don't depend on
+        // what the previous cubes (or runs) left behind
+        pcache.deleteAll();
+        int64_t profiles = int64_t( cube.width ) * cube.height;
+        int count = std::min < int64_t > ( profiles, 20000 );
+        std::printf( " cube %dx%dx%d, %lld profiles, %.1f MB\n",
+                     cube.width, cube.height, cube.depth,
+                     (long long) profiles, profiles * cube.profileBytes() / 1e6 );
+        report( bulkWrite( pcache, cube ) );
+        report( randomRead( pcache, cube, count ) );
+        report( mixed( pcache, cube, count, 0.2 ) );
+        std::printf( "  storage: %llu bytes in %llu entries (max %llu)\n",
+                     (unsigned long long) pcache.usedStorage(),
+                     (unsigned long long) pcache.nEntries(),
+                     (unsigned long long) pcache.maxStorage() );
     }
-    pcache-> setEntry( key, "hola", 0 );
-} // testCache
+} // benchmark
 
 static int
 coreMainCPP( QString platformString, int argc, char * * argv )
@@ -227,10 +267,6 @@ coreMainCPP( QString platformString, int argc, char * * argv )
     auto cmdLineInfo = CmdLine::parse( MyQApp::arguments() );
     globals.setCmdLineInfo( & cmdLineInfo );
 
-    if ( cmdLineInfo.fileList().size() < 2 ) {
-        qFatal( "Need 2 files" );
-    }
-
     // load the config file
     // ====================
     QString configFilePath = cmdLineInfo.configFilePath();
@@ -259,18 +295,25 @@ coreMainCPP( QString platformString, int argc, char * * argv )
     // send an initialize hook to all plugins, because some may rely on it
     pm-> prepare < Carta::Lib::Hooks::Initialize > ().executeAll();
 
-    // let's get pcache object
-    auto pcacheRes = pm-> prepare< Carta::Lib::Hooks::GetPersistantCache >().first();
-    if( pcacheRes.isNull()) {
+    // benchmark every persistent cache the loaded plugins provide, so that the
+    // backends can be compared by enabling their plugins in carta.config
+    std::vector < Carta::Lib::IPCache::SharedPtr > caches;
+    pm-> prepare < Carta::Lib::Hooks::GetPersistantCache > ().forEach(
+        [& caches] ( const Carta::Lib::IPCache::SharedPtr & cache ) {
+            if ( cache ) {
+                caches.push_back( cache );
+            }
+        }
+        );
+    if ( caches.empty() ) {
         qWarning() << "Could not initialize persistent cache.";
-        return -1;
+        return - 1;
     }
-    else {
-        pcache = pcacheRes.val();
+    for ( const auto & cache : caches ) {
+        std::printf( "%s\n", typeid( * cache ).name() );
+        benchmark( * cache );
     }
 
-    testCache();
-
     // give QT control
 //    int res = qapp.exec();
     int res = 0;
@@ -4,14 +4,8 @@
 
 QT      +=  webkitwidgets network widgets xml sql
 
-HEADERS += \
-    LevelDbIPCache.h \
-    SqLitePCache.h
-
 SOURCES += \
-    main.cpp \
-    LevelDbIPCache.cpp \
-    SqLitePCache.cpp
+    main.cpp
 
 RESOURCES =
 
@@ -34,8 +28,3 @@ else{
     PRE_TARGETDEPS += $$OUT_PWD/../core/libcore.so
 }
 
-
-LEVELDBDIR=/home/pfederl/Downloads/build/leveldb-1.19
-#unix: LIBS += -L$$LEVELDBDIR/out-shared -lleveldb
-unix: LIBS += -L$$LEVELDBDIR/out-static -lleveldb
-INCLUDEPATH += $$LEVELDBDIR/include
@@ -14,6 +14,10 @@
 #include "CartaLib/Regions/IRegion.h"
 #include "CartaLib/Regions/CoordinateSystemFormatter.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <limits>
+#include <random>
 
 namespace tRegion
 {
@@ -62,6 +66,117 @@ testFormatting()
                                       );
 } // apiTestFormatting
 
+/// compares the indexed kid queries of a union with thousands of circles (think catalog
+/// overlays) against testing every kid
+static void
+benchmarkRegionIndex()
+{
+    const int nRegions = 20000;
+    const int nQueries = 20000;
+    const double size = 10000;
+
+    std::mt19937 rng( 42 );
+    std::uniform_real_distribution < double > pos( 0, size ), radius( 2, 20 );
+
+    CLR::Union set;
+    for ( int i = 0 ; i < nRegions ; i++ ) {
+        set.addChild( new CLR::Circle( { pos( rng ), pos( rng ) }, radius( rng ) ) );
+    }
+    const auto & kids = set.children();
+
+    std::vector < CLR::RegionPointV > points( nQueries );
+    for ( auto & pt : points ) {
+        pt = { CLR::RegionPoint( pos( rng ), pos( rng ) ) };
+    }
+
+    auto linearHits = [&] () {
+        int64_t hits = 0;
+        for ( const auto & pt : points ) {
+            for ( auto kid : kids ) {
+                if ( kid-> isPointInside( pt ) ) {
+                    hits++;
+                }
+            }
+        }
+        return hits;
+    };
+    auto indexedHits = [&] () {
+        int64_t hits = 0;
+        for ( const auto & pt : points ) {
+            hits += set.childrenAt( pt ).size();
+        }
+        return hits;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    int64_t linear = linearHits();
+    qint64 linearTime = timer.restart();
+    int64_t indexed = indexedHits();
+    qint64 indexedTime = timer.restart();
+    qDebug() << "Point queries:" << nQueries << "points," << nRegions << "circles";
+    qDebug() << "  linear:" << linearTime << "ms," << linear << "hits";
+    qDebug() << "  indexed (incl. building the index):" << indexedTime << "ms," << indexed << "hits";
+    CARTA_ASSERT( linear == indexed );
+
+    // rectangles
+    int64_t linearRect = 0, indexedRect = 0;
+    timer.restart();
+    for ( const auto & pt : points ) {
+        QRectF rect( pt[0], QSizeF( 100, 100 ) );
+        for ( auto kid : kids ) {
+            if ( kid-> outlineBox().intersects( rect ) ) {
+                linearRect++;
+            }
+        }
+    }
+    linearTime = timer.restart();
+    for ( const auto & pt : points ) {
+        indexedRect += set.childrenIntersecting( QRectF( pt[0], QSizeF( 100, 100 ) ) ).size();
+    }
+    indexedTime = timer.restart();
+    qDebug() << "Rectangle queries: linear" << linearTime << "ms," << linearRect << "hits, indexed"
+             << indexedTime << "ms," << indexedRect << "hits";
+    CARTA_ASSERT( linearRect == indexedRect );
+
+    // nearest region
+    int mismatches = 0;
+    qint64 nearestTime = 0;
+    for ( const auto & pt : points ) {
+        timer.restart();
+        CLR::RegionBase * nearest = set.nearestChild( pt[0] );
+        nearestTime += timer.nsecsElapsed();
+        double best = std::numeric_limits < double >::infinity();
+        for ( auto kid : kids ) {
+            QRectF box = kid-> outlineBox();
+            double dx = std::max( { box.left() - pt[0].x(), 0.0, pt[0].x() - box.right() } );
+            double dy = std::max( { box.top() - pt[0].y(), 0.0, pt[0].y() - box.bottom() } );
+            best = std::min( best, dx * dx + dy * dy );
+        }
+        QRectF box = nearest-> outlineBox();
+        double dx = std::max( { box.left() - pt[0].x(), 0.0, pt[0].x() - box.right() } );
+        double dy = std::max( { box.top() - pt[0].y(), 0.0, pt[0].y() - box.bottom() } );
+        if ( dx * dx + dy * dy != best ) {
+            mismatches++;
+        }
+    }
+    qDebug() << "Nearest queries:" << nearestTime / 1000000 << "ms," << mismatches << "mismatches";
+    CARTA_ASSERT( mismatches == 0 );
+
+    // move a tenth of the circles around, the index is updated as they move
+    timer.restart();
+    for ( int i = 0 ; i < nRegions ; i += 10 ) {
+        auto circle = static_cast < CLR::Circle * > ( kids[i] );
+        circle-> setCenter( { pos( rng ), pos( rng ) } );
+    }
+    qint64 moveTime = timer.restart();
+    linear = linearHits();
+    indexed = indexedHits();
+    qDebug() << "Moved" << nRegions / 10 << "circles in" << moveTime << "ms,"
+             << linear << "hits linear," << indexed << "hits indexed";
+    CARTA_ASSERT( linear == indexed );
+} // benchmarkRegionIndex
+
 typedef Carta::Lib::Regions::RegionSet RegionSet;
 typedef Carta::Lib::Image::ImageInterface Image;
 typedef Carta::Lib::Regions::ICoordSystemConverter ICoordSystemConverter;
@@ -84,6 +199,9 @@ class StagedCSConverter : public ICoordSystemConverter
 {
 public:
 
+    using ICoordSystemConverter::src2dst;
+    using ICoordSystemConverter::dst2src;
+
     virtual bool
     src2dst( const Carta::Lib::Regions::PointN & pt,
              Carta::Lib::Regions::PointN & result ) override
@@ -351,6 +469,8 @@ coreMainCPP( QString platformString, int argc, char * * argv )
 
     testFormatting();
 
+    benchmarkRegionIndex();
+
     testRegionOnImage( cmdLineInfo.fileList()[0], cmdLineInfo.fileList()[1] );
 
     // give QT control
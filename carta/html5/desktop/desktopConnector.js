@@ -92,6 +92,7 @@
                 return;
             }
             buffer.assignToHTMLImageElement( view.m_imgTag );
+            view._removePatches();
             QtConnector.jsViewRefreshedSlot( view.getName(), refreshId );
             view._callViewCallbacks();
         }
@@ -101,6 +102,25 @@
         }
     });
 
+    // listen for jsViewPatchedSignal to render only the changed part of the image
+    QtConnector.jsViewPatchedSignal.connect( function(viewName, buffer, x, y, refreshId)
+    {
+        try {
+            var view = m_views[viewName];
+            if( view == null ) {
+                console.warn( "Ignoring patch for unconnected view '" + viewName + "'" );
+                return;
+            }
+            view._addPatch( buffer, x, y );
+            QtConnector.jsViewRefreshedSlot( view.getName(), refreshId );
+            view._callViewCallbacks();
+        }
+        catch( error ) {
+            window.console.error( "Caught error in view patched callback ", error );
+            window.console.trace();
+        }
+    });
+
     // convenience function to create & get or just get a state
     function getOrCreateState(path) {
         var st = m_states[path];
@@ -148,6 +168,35 @@
         this.m_mousePos = { x : 0, y: 0 };
         this.m_mousePosSlotScheduled = false;
         this.m_viewCallbacks = new CallbackList();
+
+        // image tags for partial updates, layed over the main image tag
+        this.m_patchTags = [];
+    };
+
+    /**
+     * Draws a partial update over the last full image. The patches are discarded
+     * when the next full image arrives.
+     *
+     * @param buffer
+     * @param x
+     * @param y
+     */
+    View.prototype._addPatch = function( buffer, x, y ) {
+        var tag = document.createElement( "img" );
+        tag.style.position = "absolute";
+        tag.style.left = (this.m_imgTag.offsetLeft + x) + "px";
+        tag.style.top = (this.m_imgTag.offsetTop + y) + "px";
+        tag.style.pointerEvents = "none";
+        buffer.assignToHTMLImageElement( tag );
+        this.m_container.appendChild( tag );
+        this.m_patchTags.push( tag );
+    };
+
+    View.prototype._removePatches = function() {
+        for( var i = 0; i < this.m_patchTags.length; i++ ) {
+            this.m_container.removeChild( this.m_patchTags[i] );
+        }
+        this.m_patchTags = [];
     };
 
     /**
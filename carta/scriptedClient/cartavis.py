@@ -298,6 +298,28 @@ class Cartavis:
         result = self.con.cmdTagList("getPluginList")
         return result
 
+    def getCacheUsage(self):
+        """
+        Returns the memory used by the in-memory caches of the viewer.
+        All caches share one budget, which is set with 'cacheBudgetMB' in
+        the main config file.
+
+        Returns
+        -------
+        dict
+            Maps 'total' and 'budget' to a number of bytes, and the name
+            of each kind of cache to a (bytes, entries) tuple.
+        """
+        result = self.con.cmdTagList("getCacheUsage")
+        usage = {}
+        for line in result:
+            fields = line.split(',')
+            if len(fields) == 2:
+                usage[fields[0]] = int(fields[1])
+            elif len(fields) == 3:
+                usage[fields[0]] = (int(fields[1]), int(fields[2]))
+        return usage
+
     def getEmptyWindowCount(self):
         """
         Returns the number of empty windows in the application.
@@ -532,6 +532,83 @@ class Image(CartaView):
         else:
             return float(result[0])
 
+    def deriveImage(self, operation, value=0, otherIndex=-1):
+        """
+        Adds an image computed from the current image. Only the parts of it
+        that are displayed or analysed are ever computed.
+
+        Parameters
+        ----------
+        operation: string
+            One of "smooth", "rebin", "ratio", "difference" or
+            "polarizedintensity".
+        value: float
+            The gaussian smoothing width in pixels, or the number of channels
+            to average when rebinning.
+        otherIndex: integer
+            The index of the second image for "ratio" and "difference".
+
+        Returns
+        -------
+        list
+            An error message if the image could not be derived.
+        """
+        result = self.con.cmdTagList("deriveImage", imageView=self.getId(),
+                                     operation=operation, value=value,
+                                     otherIndex=otherIndex)
+        return result
+
+    def generateMoments(self, moments, histogram=None):
+        """
+        Computes moment maps of the image in the background. The maps are
+        added to this image view as new images once they are ready.
+
+        Parameters
+        ----------
+        moments: list
+            The moments to compute; any of "moment0", "moment1", "moment2"
+            and "peak". "moment1" and "moment2" are the intensity weighted
+            mean and dispersion of the spectral coordinate in the units of
+            the spectral axis (e.g. Hz), not velocities.
+        histogram: Histogram
+            A histogram whose channel and intensity range select the pixels
+            to use. If it is None, all pixels are used.
+
+        Returns
+        -------
+        list
+            An error message if the moments could not be computed.
+        """
+        histogramView = ""
+        if (histogram is not None):
+            histogramView = histogram.getId()
+        result = self.con.cmdTagList("generateMoments", imageView=self.getId(),
+                                     histogramView=histogramView,
+                                     moments=' '.join(moments))
+        return result
+
+    def callRawViewFunction(self, function):
+        """
+        Hands the pixels of the current channel of the image to a function
+        of a python plugin loaded by the server. The function is called
+        with read only float32 numpy arrays; a plane that is already in
+        memory arrives as a single 2D array, anything else in chunks.
+
+        Parameters
+        ----------
+        function: string
+            The name of the function in the plugin module.
+
+        Returns
+        -------
+        list
+            An error message if no plugin has the function or it failed.
+        """
+        result = self.con.cmdTagList("callRawViewFunction",
+                                     imageView=self.getId(),
+                                     function=function)
+        return result
+
     def centerOnCoordinate(self, skyCoord):
         """
         Centers the image on an Astropy SkyCoord object.
@@ -25,6 +25,10 @@ class TagConnector:
         self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         self.socket.connect(("localhost", self.port))
         self.tagMessageSocket = TagMessageSocket(self.socket)
+        # Results of pipelined commands (see sendCmd()) that arrived while
+        # waiting for some other result, by request id.
+        self.pendingResults = {}
+        self.nextRequestId = 1
 
     def cmdTagList(self, cmd, ** kwargs):
         """
@@ -48,14 +52,69 @@ class TagConnector:
         """
         self.tagMessageSocket.send(
             JsonMessage.fromKW(cmd=cmd, args=kwargs).toTagMessage())
-        tm = self.tagMessageSocket.receive()
-        result = JsonMessage.fromTagMessage(tm)
-        j = json.loads(str(result.jsonString))
-        try:
-            returnValue = j['result']
-        except KeyError:
-            returnValue = j['error']
-        return returnValue
+        return self._receiveResult(None)
+
+    def sendCmd(self, cmd, ** kwargs):
+        """
+        Send a command without waiting for its result, so that several
+        commands can be in flight at the same time. Long running commands
+        (e.g. getIntensity) are run in the background by the server, so
+        their results can arrive out of order.
+
+        Parameters
+        ----------
+        cmd: string
+            The name of the command to send.
+        kwargs: dict
+            The arguments to the command, if any.
+
+        Returns
+        -------
+        integer
+            The id of the request, to be passed to getResult().
+        """
+        requestId = self.nextRequestId
+        self.nextRequestId += 1
+        self.tagMessageSocket.send(
+            JsonMessage.fromKW(cmd=cmd, args=kwargs, id=requestId).toTagMessage())
+        return requestId
+
+    def getResult(self, requestId):
+        """
+        Wait for the result of a command sent with sendCmd().
+
+        Parameters
+        ----------
+        requestId: integer
+            The id returned by sendCmd().
+
+        Returns
+        -------
+        list
+            The contents of the list vary depending on the command.
+        """
+        return self._receiveResult(requestId)
+
+    def _receiveResult(self, requestId):
+        """
+        Return the result of the given request, keeping the results of
+        other pipelined requests that arrive in the meantime.
+        A requestId of None is for commands sent without an id.
+        """
+        if requestId is not None and requestId in self.pendingResults:
+            return self.pendingResults.pop(requestId)
+        while True:
+            tm = self.tagMessageSocket.receive()
+            result = JsonMessage.fromTagMessage(tm)
+            j = json.loads(str(result.jsonString))
+            try:
+                returnValue = j['result']
+            except KeyError:
+                returnValue = j['error']
+            resultId = j.get('id')
+            if resultId == requestId:
+                return returnValue
+            self.pendingResults[resultId] = returnValue
 
     def cmdAsyncList(self, cmd, ** kwargs):
         """
@@ -78,11 +137,4 @@ class TagConnector:
         """
         self.tagMessageSocket.send(
             JsonMessage.fromKW(cmd=cmd, args=kwargs).toAsyncMessage())
-        tm = self.tagMessageSocket.receive()
-        result = JsonMessage.fromTagMessage(tm)
-        j = json.loads(str(result.jsonString))
-        try:
-            returnValue = j['result']
-        except KeyError:
-            returnValue = j['error']
-        return returnValue
+        return self._receiveResult(None)
@@ -291,4 +291,13 @@ def test_setBinCount(cartavisInstance, tempImageDir, cleanSlate):
     h[0].saveHistogram(tempImageDir + '/' + imageName, 200, 200)
     reference = Image.open(os.getcwd() + '/data/' + imageName)
     comparison = Image.open(tempImageDir + '/' + imageName)
-    assert list(reference.getdata()) == list(comparison.getdata())
\ No newline at end of file
+    assert list(reference.getdata()) == list(comparison.getdata())
+def test_getCacheUsage(cartavisInstance):
+    """
+    Test that cache usage is reported and stays within the budget.
+    """
+    i = cartavisInstance.getImageViews()
+    i[0].loadLocalFile(os.getcwd() + '/data/mexinputtest.fits')
+    usage = cartavisInstance.getCacheUsage()
+    assert usage['budget'] > 0
+    assert 0 <= usage['total'] <= usage['budget']